@@ -0,0 +1,147 @@
+/*
+ * @licence MIT
+ *
+ * @file: bench_cache.c
+ *
+ * bench-cache: how much logging slows down the application's hot data.
+ *
+ * Usage: bench-cache [HOT_KIB [BURST [ROUNDS]]]
+ *
+ * Alternates a burst of log_event() calls into a large context with one
+ * pass over a hot working set, once with ordinary stores and once with
+ * log_set_streaming(). The time per pass over the hot set is the cost the
+ * application pays for logging: with ordinary stores every new slot is
+ * pulled into the cache and evicts hot lines. Where perf_event_open() is
+ * permitted, the hardware counters of the hot passes show the misses.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <inttypes.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "../include/log.h"
+
+#include "perf_counters.h"
+
+#define LINE (64u)
+
+static struct log_ctx bench_log;
+
+static uint64_t
+now_ns(void)
+{
+        struct timespec ts;
+        (void)clock_gettime(CLOCK_MONOTONIC, &ts);
+        return ((uint64_t)ts.tv_sec * 1000000000u) + (uint64_t)ts.tv_nsec;
+}
+
+static uint32_t
+ticks(void)
+{
+        return (uint32_t)now_ns();
+}
+
+/* One read per cache line of the hot set. */
+static uint64_t
+touch(const volatile uint8_t *hot, size_t len)
+{
+        uint64_t sum = 0u;
+        for (size_t i = 0u; i < len; i += LINE) {
+                sum += hot[i];
+        }
+        return sum;
+}
+
+struct result {
+        double log_ns;  /* Per event. */
+        double pass_ns; /* Per pass over the hot set. */
+        struct perf_counters pass; /* Summed over the hot passes. */
+};
+
+static struct result
+run(uint8_t stream, const uint8_t *hot, size_t len, uint32_t burst,
+    uint32_t rounds, struct perf_counters *p, uint64_t *sink)
+{
+        struct result r = { 0.0, 0.0, { { 0 }, { 0u }, { 0u }, 0u } };
+        uint64_t log_ns = 0u;
+        uint64_t pass_ns = 0u;
+
+        log_init(&bench_log, ticks);
+        (void)log_set_streaming(&bench_log, stream);
+        *sink += touch(hot, len);
+        for (uint32_t n = 0u; n < rounds; ++n) {
+                uint64_t t0 = now_ns();
+                for (uint32_t i = 0u; i < burst; ++i) {
+                        log_event_mod(&bench_log, (uint8_t)(i % 8u), INFO,
+                                      "rx len=%u seq=%u", i, n);
+                }
+                uint64_t t1 = now_ns();
+                perf_counters_start(p);
+                *sink += touch(hot, len);
+                perf_counters_stop(p);
+                uint64_t t2 = now_ns();
+                log_ns += t1 - t0;
+                pass_ns += t2 - t1;
+                for (int i = 0; i < PERF_COUNTERS; ++i) {
+                        r.pass.value[i] += p->value[i];
+                        r.pass.valid[i] = (n == 0u)
+                                              ? p->valid[i]
+                                              : (uint8_t)(r.pass.valid[i]
+                                                          & p->valid[i]);
+                }
+                r.pass.ns += p->ns;
+        }
+        r.log_ns = (double)log_ns / ((double)rounds * burst);
+        r.pass_ns = (double)pass_ns / rounds;
+        return r;
+}
+
+int
+main(int argc, char **argv)
+{
+        size_t hot_kib = (argc > 1) ? strtoul(argv[1], NULL, 0) : 256u;
+        uint32_t burst = (argc > 2) ? (uint32_t)strtoul(argv[2], NULL, 0)
+                                    : 4096u;
+        uint32_t rounds = (argc > 3) ? (uint32_t)strtoul(argv[3], NULL, 0)
+                                     : 500u;
+        size_t len = hot_kib * 1024u;
+        uint8_t *hot = malloc(len);
+        if ((hot == NULL) || (burst == 0u) || (rounds == 0u)) {
+                fprintf(stderr, "usage: bench-cache [HOT_KIB [BURST "
+                                "[ROUNDS]]]\n");
+                free(hot);
+                return 2;
+        }
+        for (size_t i = 0u; i < len; ++i) {
+                hot[i] = (uint8_t)i;
+        }
+
+        uint64_t sink = 0u;
+        struct perf_counters p;
+        struct result r[2];
+        (void)perf_counters_open(&p);
+        printf("ring %u entries (%zu KiB), hot set %zu KiB, burst %" PRIu32
+               "\n",
+               (unsigned)LOG_ENTRIES,
+               sizeof(bench_log.buffer) / 1024u, hot_kib, burst);
+        printf("%-10s %12s %16s\n", "stores", "ns/event", "ns/hot pass");
+        for (uint8_t stream = 0u; stream < 2u; ++stream) {
+                r[stream] = run(stream, hot, len, burst, rounds, &p, &sink);
+                printf("%-10s %12.1f %16.1f\n",
+                       (stream != 0u) ? "streaming" : "ordinary",
+                       r[stream].log_ns, r[stream].pass_ns);
+        }
+        perf_counters_close(&p);
+        perf_counters_header("per hot pass");
+        perf_counters_print("ordinary", &r[0].pass, rounds);
+        perf_counters_print("streaming", &r[1].pass, rounds);
+        if (log_set_streaming(&bench_log, 1u) == 0u) {
+                printf("(no non-temporal stores on this target)\n");
+        }
+        free(hot);
+        return (sink == 0u) ? 1 : 0;
+}
@@ -0,0 +1,167 @@
+/*
+ * @licence MIT
+ *
+ * @file: bench_ops.c
+ *
+ * bench-ops: cost of the basic operations, with hardware counters.
+ *
+ * Usage: bench-ops [ROUNDS]
+ *
+ * Fills a large context with log_event(), then reads it back with
+ * log_get_entry(), exports it with log_export() and drains it through a
+ * sink into export batches. Each row gives wall time and, where
+ * perf_event_open() is permitted, cycles, instructions, cache misses and
+ * branch misses per operation, averaged over ROUNDS (default 20).
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "../include/log.h"
+#include "../include/log_export.h"
+#include "../include/log_sink.h"
+
+#include "perf_counters.h"
+
+#define STAGING (4096u)
+
+static struct log_ctx bench_log;
+static uint8_t staging[STAGING];
+
+static uint32_t
+ticks(void)
+{
+        struct timespec ts;
+        (void)clock_gettime(CLOCK_MONOTONIC, &ts);
+        return (uint32_t)ts.tv_nsec;
+}
+
+/* Sum of every row of one benchmark. */
+struct total {
+        struct perf_counters sum;
+        uint64_t ops;
+};
+
+static void
+add(struct total *t, const struct perf_counters *p, uint64_t ops)
+{
+        t->sum.ns += p->ns;
+        for (int i = 0; i < PERF_COUNTERS; ++i) {
+                t->sum.value[i] += p->value[i];
+                t->sum.valid[i] = (t->ops == 0u)
+                                      ? p->valid[i]
+                                      : (uint8_t)(t->sum.valid[i]
+                                                  & p->valid[i]);
+        }
+        t->ops += ops;
+}
+
+static uint64_t
+fill(void)
+{
+        for (uint32_t i = 0u; i < LOG_ENTRIES; ++i) {
+                log_event_mod(&bench_log, (uint8_t)(i % 8u),
+                              ((i % 16u) == 0u) ? WARN : INFO,
+                              "rx len=%u seq=%u", i % 1500u, i);
+        }
+        return LOG_ENTRIES;
+}
+
+static uint64_t
+read_all(uint64_t *sink)
+{
+        uint16_t n = log_get_count(&bench_log);
+        for (uint16_t i = 0u; i < n; ++i) {
+                const struct log_entry *e = log_get_entry(&bench_log, i);
+                *sink += e->timestamp + (uint8_t)e->msg[3];
+        }
+        return n;
+}
+
+static uint64_t
+export_all(uint64_t *sink)
+{
+        uint16_t idx = 0u;
+        size_t n;
+        while ((n = log_export(&bench_log, &idx, staging, sizeof(staging)))
+               > 0u) {
+                *sink += staging[n - 1u];
+        }
+        return idx;
+}
+
+static uint64_t
+drain_all(uint64_t *sink)
+{
+        struct log_batch_buf bb = { staging, sizeof(staging), 0u, 0u, 0u };
+        struct log_sink s;
+        uint64_t n = 0u;
+        log_sink_init(&s, log_batch_write, &bb, INFO, LOG_MODULES_ALL);
+        log_sink_seek(&s, &bench_log, 0u);
+        for (;;) {
+                bb.len = 0u;
+                bb.count = 0u;
+                (void)log_sink_drain(&s, &bench_log, UINT16_MAX);
+                if (bb.count == 0u) {
+                        break;
+                }
+                n += bb.count;
+                *sink += staging[bb.len - 1u];
+        }
+        return n;
+}
+
+int
+main(int argc, char **argv)
+{
+        uint32_t rounds = (argc > 1) ? (uint32_t)strtoul(argv[1], NULL, 0)
+                                     : 20u;
+        if (rounds == 0u) {
+                fprintf(stderr, "usage: bench-ops [ROUNDS]\n");
+                return 2;
+        }
+        struct perf_counters p;
+        int avail = perf_counters_open(&p);
+        struct total t[4] = { 0 };
+        uint64_t sink = 0u;
+
+        log_init(&bench_log, ticks);
+        (void)fill();
+        for (uint32_t r = 0u; r < rounds; ++r) {
+                uint64_t n;
+                perf_counters_start(&p);
+                n = fill();
+                perf_counters_stop(&p);
+                add(&t[0], &p, n);
+
+                perf_counters_start(&p);
+                n = read_all(&sink);
+                perf_counters_stop(&p);
+                add(&t[1], &p, n);
+
+                perf_counters_start(&p);
+                n = export_all(&sink);
+                perf_counters_stop(&p);
+                add(&t[2], &p, n);
+
+                perf_counters_start(&p);
+                n = drain_all(&sink);
+                perf_counters_stop(&p);
+                add(&t[3], &p, n);
+        }
+        perf_counters_close(&p);
+
+        printf("ring %u entries, %u rounds, %d of %d hardware counters\n",
+               (unsigned)LOG_ENTRIES, (unsigned)rounds, avail,
+               (int)PERF_COUNTERS);
+        perf_counters_header("per entry");
+        perf_counters_print("log_event", &t[0].sum, t[0].ops);
+        perf_counters_print("log_get_entry", &t[1].sum, t[1].ops);
+        perf_counters_print("log_export", &t[2].sum, t[2].ops);
+        perf_counters_print("sink->batch", &t[3].sum, t[3].ops);
+        return (sink == 0u) ? 1 : 0;
+}
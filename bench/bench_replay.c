@@ -0,0 +1,213 @@
+/*
+ * @licence MIT
+ *
+ * @file: bench_replay.c
+ *
+ * bench-replay: log a captured workload again.
+ *
+ * Usage: bench-replay [-s] [-p] [-r ROUNDS] TRACE
+ *
+ * Reads a trace written by log_capture_open() into memory and logs every
+ * event with log_replay_emit(), so the formats, arguments, modules and
+ * levels are those of the captured process. By default the events are
+ * logged back to back, ROUNDS times (default 5), and the cost per event is
+ * reported with hardware counters as in bench-ops. With -p they are logged
+ * once at the captured pace, waiting out each inter-arrival time, and the
+ * latency percentiles of the logging calls are reported instead. -s enables
+ * streaming stores (log_set_streaming()).
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <inttypes.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "../include/log.h"
+#include "../include/log_capture.h"
+
+#include "perf_counters.h"
+
+static struct log_ctx bench_log;
+static struct log_replay rep;
+
+static uint64_t
+now_ns(void)
+{
+        struct timespec ts;
+        (void)clock_gettime(CLOCK_MONOTONIC, &ts);
+        return ((uint64_t)ts.tv_sec * 1000000000u) + (uint64_t)ts.tv_nsec;
+}
+
+static uint32_t
+ticks(void)
+{
+        return (uint32_t)now_ns();
+}
+
+static int
+cmp_u64(const void *a, const void *b)
+{
+        uint64_t x = *(const uint64_t *)a;
+        uint64_t y = *(const uint64_t *)b;
+        return (x > y) - (x < y);
+}
+
+/* Read the whole trace; returns the number of events or -1. */
+static long
+load(const char *path, struct log_replay_event **ev)
+{
+        size_t cap = 4096u;
+        size_t n = 0u;
+        int rc;
+        *ev = malloc(cap * sizeof(**ev));
+        if ((*ev == NULL) || (log_replay_open(&rep, path) != 0)) {
+                perror(path);
+                return -1;
+        }
+        while ((rc = log_replay_next(&rep, &(*ev)[n])) == 1) {
+                if (++n == cap) {
+                        struct log_replay_event *p;
+                        cap *= 2u;
+                        p = realloc(*ev, cap * sizeof(**ev));
+                        if (p == NULL) {
+                                perror("realloc");
+                                return -1;
+                        }
+                        *ev = p;
+                }
+        }
+        if (rc < 0) {
+                fprintf(stderr, "%s: malformed trace after %zu events\n",
+                        path, n);
+                return -1;
+        }
+        return (long)n;
+}
+
+static uint64_t
+burst(const struct log_replay_event *ev, size_t n)
+{
+        uint64_t done = 0u;
+        for (size_t i = 0u; i < n; ++i) {
+                done += log_replay_emit(&bench_log, &ev[i]);
+        }
+        return done;
+}
+
+static void
+paced(const struct log_replay_event *ev, size_t n)
+{
+        uint64_t *lat = malloc((n + 1u) * sizeof(*lat));
+        uint64_t due = now_ns();
+        uint64_t late = 0u;
+        size_t done = 0u;
+        if (lat == NULL) {
+                perror("malloc");
+                return;
+        }
+        for (size_t i = 0u; i < n; ++i) {
+                due += ev[i].delta_ns;
+                uint64_t t0;
+                while ((t0 = now_ns()) < due) {
+                }
+                late += t0 - due;
+                if (log_replay_emit(&bench_log, &ev[i]) != 0u) {
+                        lat[done++] = now_ns() - t0;
+                }
+        }
+        if (done == 0u) {
+                free(lat);
+                return;
+        }
+        qsort(lat, done, sizeof(*lat), cmp_u64);
+        printf("paced: %zu events, mean lateness %.0f ns\n", done,
+               (double)late / (double)n);
+        printf("latency ns p50 %" PRIu64 " p99 %" PRIu64 " p99.9 %" PRIu64
+               " max %" PRIu64 "\n", lat[done / 2u],
+               lat[(done * 99u) / 100u], lat[(done * 999u) / 1000u],
+               lat[done - 1u]);
+        free(lat);
+}
+
+int
+main(int argc, char **argv)
+{
+        uint32_t rounds = 5u;
+        uint8_t pace = 0u;
+        uint8_t stream = 0u;
+        int opt;
+
+        while ((opt = getopt(argc, argv, "spr:h")) != -1) {
+                switch (opt) {
+                case 's': stream = 1u; break;
+                case 'p': pace = 1u; break;
+                case 'r': rounds = (uint32_t)strtoul(optarg, NULL, 0); break;
+                default:
+                        fprintf(stderr, "usage: bench-replay [-s] [-p] "
+                                        "[-r ROUNDS] TRACE\n");
+                        return (opt == 'h') ? 0 : 2;
+                }
+        }
+        if ((optind != (argc - 1)) || (rounds == 0u)) {
+                fprintf(stderr, "usage: bench-replay [-s] [-p] [-r ROUNDS] "
+                                "TRACE\n");
+                return 2;
+        }
+
+        struct log_replay_event *ev;
+        long n = load(argv[optind], &ev);
+        if (n <= 0) {
+                if (n == 0) {
+                        fprintf(stderr, "%s: no events\n", argv[optind]);
+                }
+                return 1;
+        }
+        uint64_t span = 0u;
+        uint64_t skipped = 0u;
+        for (long i = 0; i < n; ++i) {
+                span += ev[i].delta_ns;
+                skipped += (ev[i].site->nargs < 0) ? 1u : 0u;
+        }
+        log_init(&bench_log, ticks);
+        if (stream != 0u) {
+                stream = log_set_streaming(&bench_log, 1u);
+        }
+        printf("%ld events from %u sites over %.3f s, %" PRIu64
+               " not replayable; ring %u entries%s\n",
+               n, (unsigned)rep.sites, (double)span / 1e9, skipped,
+               (unsigned)LOG_ENTRIES, (stream != 0u) ? ", streaming" : "");
+
+        if (pace != 0u) {
+                paced(ev, (size_t)n);
+        } else {
+                struct perf_counters p;
+                struct perf_counters sum = { 0 };
+                uint64_t done = 0u;
+                int avail = perf_counters_open(&p);
+                for (uint32_t r = 0u; r < rounds; ++r) {
+                        perf_counters_start(&p);
+                        done += burst(ev, (size_t)n);
+                        perf_counters_stop(&p);
+                        sum.ns += p.ns;
+                        for (int i = 0; i < PERF_COUNTERS; ++i) {
+                                sum.value[i] += p.value[i];
+                                sum.valid[i] = (r == 0u)
+                                                   ? p.valid[i]
+                                                   : (uint8_t)(sum.valid[i]
+                                                               & p.valid[i]);
+                        }
+                }
+                perf_counters_close(&p);
+                printf("%u rounds, %d of %d hardware counters\n",
+                       (unsigned)rounds, avail, (int)PERF_COUNTERS);
+                perf_counters_header("per event");
+                perf_counters_print("replay", &sum, done);
+        }
+        log_replay_close(&rep);
+        free(ev);
+        return 0;
+}
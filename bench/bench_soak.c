@@ -0,0 +1,576 @@
+/*
+ * @licence MIT
+ *
+ * @file: bench_soak.c
+ *
+ * bench-soak: concurrent stress run with loss and ordering accounting.
+ *
+ * Usage: bench-soak [-S] [-t SECONDS] [-p PRODUCERS] [-c CONTEXTS]
+ *                   [-r READERS] [-s SNAPSHOTTERS] [-d DRAINS]
+ *
+ * Producer threads log as fast as they can to one of several contexts,
+ * each guarded by a mutex, or with -S through a log_stage hub. A log_drain
+ * pool delivers every context to a checking sink while reader threads
+ * walk the newest entries and snapshot threads copy whole contexts, all
+ * under the context lock. Every entry carries its producer, a per-producer
+ * sequence number and a check word, so afterwards the run verifies that
+ * every sequence number was delivered or counted as overwritten by the
+ * sink, that no entry was torn and that each producer's entries stayed in
+ * order, wherever they were observed.
+ *
+ * Prints the rate for each second, the sustained (lowest) and mean rate,
+ * and the latency percentiles of one logging call including lock waits.
+ * Exits non-zero if any check failed.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <inttypes.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "../include/log.h"
+#include "../include/log_drain.h"
+#include "../include/log_sink.h"
+#include "../include/log_stage.h"
+
+#define MAX_PRODUCERS (64u)
+#define MAX_CONTEXTS  (16u)
+#define MAX_THREADS   (16u)
+#define READ_WINDOW   (256u)
+
+/* Latency histogram: exact below 16 ns, then 16 buckets per power of two. */
+#define HIST_SUB     (16u)
+#define HIST_BUCKETS (HIST_SUB + (60u * HIST_SUB))
+
+struct producer {
+        pthread_t thread;
+        uint32_t id;
+        struct context *ctx;
+        _Alignas(64) atomic_uint_fast64_t produced;
+        uint64_t hist[HIST_BUCKETS];
+};
+
+/* Per-producer state of the checking sink, owned by the context lock. */
+struct seen {
+        uint64_t next;      /* Next expected sequence number. */
+        uint64_t delivered;
+        uint64_t lost;      /* Skipped, i.e. overwritten before delivery. */
+};
+
+struct context {
+        struct log_ctx *log;
+        struct log_stage_hub *hub; /* -S only */
+        pthread_mutex_t lock;
+        pthread_mutex_t *held;     /* The lock that serialises log. */
+        struct log_sink sink;
+        struct log_drain_src src;
+        struct seen seen[MAX_PRODUCERS];
+        uint64_t torn;
+        uint64_t disorder;
+};
+
+/* Failures seen by readers and snapshotters. */
+struct observer {
+        pthread_t thread;
+        uint32_t id;
+        uint64_t passes;
+        uint64_t entries;
+        uint64_t torn;
+        uint64_t disorder;
+};
+
+static struct producer producer[MAX_PRODUCERS];
+static struct context context[MAX_CONTEXTS];
+static struct observer reader[MAX_THREADS];
+static struct observer snapshotter[MAX_THREADS];
+static struct log_drain pool;
+static uint32_t producers = 4u;
+static uint32_t contexts = 2u;
+static uint8_t staged;
+static atomic_int stop;
+
+static uint64_t
+now_ns(void)
+{
+        struct timespec ts;
+        (void)clock_gettime(CLOCK_MONOTONIC, &ts);
+        return ((uint64_t)ts.tv_sec * 1000000000u) + (uint64_t)ts.tv_nsec;
+}
+
+/* Microseconds: monotonic across threads, as log_stage requires. */
+static uint32_t
+ticks(void)
+{
+        return (uint32_t)(now_ns() / 1000u);
+}
+
+static void
+pause_ns(long ns)
+{
+        struct timespec ts = { 0, ns };
+        (void)nanosleep(&ts, NULL);
+}
+
+static uint32_t
+check_word(uint32_t p, uint64_t s)
+{
+        return (uint32_t)((s * 0x9E3779B97F4A7C15ull) >> 32)
+               ^ (p * 0x85EBCA6Bu);
+}
+
+static enum log_level
+level_of(uint64_t s)
+{
+        return ((s % 64u) == 0u) ? WARN : INFO;
+}
+
+static int
+hex(const char *c, uint32_t digits, uint64_t *v)
+{
+        *v = 0u;
+        for (uint32_t i = 0u; i < digits; ++i) {
+                uint32_t d;
+                if ((c[i] >= '0') && (c[i] <= '9')) {
+                        d = (uint32_t)(c[i] - '0');
+                } else if ((c[i] >= 'a') && (c[i] <= 'f')) {
+                        d = (uint32_t)(c[i] - 'a') + 10u;
+                } else {
+                        return -1;
+                }
+                *v = (*v << 4) | d;
+        }
+        return 0;
+}
+
+/*
+ * Decode "p=PP s=SSSSSSSSSSSS k=KKKKKKKK" and check it against the entry's
+ * level and module. Returns 0 and the producer and sequence number, or -1
+ * for a torn entry.
+ */
+static int
+decode(const struct log_entry *e, uint32_t *p, uint64_t *s)
+{
+        uint64_t pp;
+        uint64_t k;
+        if ((e == NULL) || (memcmp(e->msg, "p=", 2u) != 0)
+            || (memcmp(&e->msg[4], " s=", 3u) != 0)
+            || (memcmp(&e->msg[19], " k=", 3u) != 0) || (e->msg[30] != '\0')
+            || (hex(&e->msg[2], 2u, &pp) != 0)
+            || (hex(&e->msg[7], 12u, s) != 0)
+            || (hex(&e->msg[22], 8u, &k) != 0) || (pp >= producers)) {
+                return -1;
+        }
+        *p = (uint32_t)pp;
+        if ((k != check_word(*p, *s)) || (e->module != (*p % LOG_MODULES))
+            || (e->level != (uint16_t)level_of(*s))) {
+                return -1;
+        }
+        return 0;
+}
+
+static void
+hist_add(uint64_t *hist, uint64_t ns)
+{
+        uint32_t b;
+        if (ns < HIST_SUB) {
+                b = (uint32_t)ns;
+        } else {
+                uint32_t m = 63u - (uint32_t)__builtin_clzll(ns);
+                b = HIST_SUB + ((m - 4u) * HIST_SUB)
+                    + (uint32_t)((ns >> (m - 4u)) & (HIST_SUB - 1u));
+        }
+        hist[b]++;
+}
+
+/* Lower bound of a bucket, within 1/16 of the values it holds. */
+static uint64_t
+hist_value(uint32_t b)
+{
+        if (b < HIST_SUB) {
+                return b;
+        }
+        uint32_t m = ((b - HIST_SUB) / HIST_SUB) + 4u;
+        return (uint64_t)(HIST_SUB + ((b - HIST_SUB) % HIST_SUB)) << (m - 4u);
+}
+
+static uint64_t
+hist_quantile(const uint64_t *hist, uint64_t total, double q)
+{
+        uint64_t want = (uint64_t)((double)total * q);
+        uint64_t sum = 0u;
+        for (uint32_t b = 0u; b < HIST_BUCKETS; ++b) {
+                sum += hist[b];
+                if ((sum > want) && (hist[b] > 0u)) {
+                        return hist_value(b);
+                }
+        }
+        return 0u;
+}
+
+static void *
+produce(void *arg)
+{
+        struct producer *pr = arg;
+        struct context *c = pr->ctx;
+        uint8_t module = (uint8_t)(pr->id % LOG_MODULES);
+        uint64_t s = 0u;
+
+        while (atomic_load_explicit(&stop, memory_order_relaxed) == 0) {
+                uint32_t k = check_word(pr->id, s);
+                uint64_t t0 = now_ns();
+                if (staged != 0u) {
+                        log_stage_event(c->hub, module, level_of(s),
+                                        "p=%02x s=%012" PRIx64 " k=%08x",
+                                        pr->id, s, k);
+                } else {
+                        (void)pthread_mutex_lock(&c->lock);
+                        log_event_mod(c->log, module, level_of(s),
+                                      "p=%02x s=%012" PRIx64 " k=%08x",
+                                      pr->id, s, k);
+                        (void)pthread_mutex_unlock(&c->lock);
+                }
+                hist_add(pr->hist, now_ns() - t0);
+                log_drain_notify(&pool, &c->src);
+                s++;
+                atomic_store_explicit(&pr->produced, s, memory_order_relaxed);
+        }
+        if (staged != 0u) {
+                log_stage_flush(c->hub);
+                log_drain_notify(&pool, &c->src);
+        }
+        return NULL;
+}
+
+/* The checking sink, called by the drain pool with the context locked. */
+static int
+deliver(void *user, const struct log_entry *e, uint32_t seq)
+{
+        struct context *c = user;
+        uint32_t p;
+        uint64_t s;
+        (void)seq;
+        if (decode(e, &p, &s) != 0) {
+                c->torn++;
+                return 0;
+        }
+        struct seen *n = &c->seen[p];
+        if (s < n->next) {
+                c->disorder++;
+                return 0;
+        }
+        n->lost += s - n->next;
+        n->next = s + 1u;
+        n->delivered++;
+        return 0;
+}
+
+/*
+ * Check entries oldest first: each must decode, and each producer's
+ * sequence numbers must increase.
+ */
+static void
+check_run(struct observer *o, const struct log_ctx *log, uint32_t first,
+          uint32_t n, uint8_t by_seq)
+{
+        uint64_t last[MAX_PRODUCERS];
+        (void)memset(last, 0, sizeof(last));
+        for (uint32_t i = 0u; i < n; ++i) {
+                const struct log_entry *e =
+                    (by_seq != 0u) ? log_get_entry_seq(log, first + i)
+                                   : log_get_entry(log, (uint16_t)i);
+                uint32_t p;
+                uint64_t s;
+                if (decode(e, &p, &s) != 0) {
+                        o->torn++;
+                        continue;
+                }
+                /* last holds s + 1, 0 before the first entry of p. */
+                if ((last[p] != 0u) && (s < last[p])) {
+                        o->disorder++;
+                }
+                last[p] = s + 1u;
+        }
+        o->entries += n;
+        o->passes++;
+}
+
+static void *
+read_newest(void *arg)
+{
+        struct observer *o = arg;
+        struct context *c = &context[o->id % contexts];
+
+        while (atomic_load_explicit(&stop, memory_order_relaxed) == 0) {
+                (void)pthread_mutex_lock(c->held);
+                uint32_t n = log_get_count(c->log);
+                n = (n < READ_WINDOW) ? n : READ_WINDOW;
+                check_run(o, c->log, log_get_seq(c->log) - n, n, 1u);
+                (void)pthread_mutex_unlock(c->held);
+                pause_ns(100000);
+        }
+        return NULL;
+}
+
+static void *
+snapshot(void *arg)
+{
+        struct observer *o = arg;
+        struct context *c = &context[o->id % contexts];
+        struct log_ctx *copy = malloc(sizeof(*copy));
+        if (copy == NULL) {
+                o->torn++;
+                return NULL;
+        }
+
+        while (atomic_load_explicit(&stop, memory_order_relaxed) == 0) {
+                (void)pthread_mutex_lock(c->held);
+                (void)memcpy(copy, c->log, sizeof(*copy));
+                (void)pthread_mutex_unlock(c->held);
+                check_run(o, copy, 0u, log_get_count(copy), 0u);
+                pause_ns(10000000);
+        }
+        free(copy);
+        return NULL;
+}
+
+static int
+spawn(pthread_t *t, void *(*fn)(void *), void *arg)
+{
+        int rc = pthread_create(t, NULL, fn, arg);
+        if (rc != 0) {
+                fprintf(stderr, "bench-soak: pthread_create: %s\n",
+                        strerror(rc));
+                return -1;
+        }
+        return 0;
+}
+
+static void
+usage(void)
+{
+        fprintf(stderr, "usage: bench-soak [-S] [-t SECONDS] [-p PRODUCERS] "
+                        "[-c CONTEXTS]\n"
+                        "                  [-r READERS] [-s SNAPSHOTTERS] "
+                        "[-d DRAINS]\n");
+}
+
+static int
+setup(uint32_t drains)
+{
+        if (log_drain_start(&pool, (uint8_t)drains, 256u) != 0) {
+                perror("log_drain_start");
+                return -1;
+        }
+        for (uint32_t i = 0u; i < contexts; ++i) {
+                struct context *c = &context[i];
+                c->log = malloc(sizeof(*c->log));
+                if (c->log == NULL) {
+                        return -1;
+                }
+                log_init(c->log, ticks);
+                if (staged != 0u) {
+                        c->hub = malloc(sizeof(*c->hub));
+                        if ((c->hub == NULL)
+                            || (log_stage_hub_init(c->hub, c->log) != 0)) {
+                                perror("log_stage_hub_init");
+                                return -1;
+                        }
+                        c->held = &c->hub->lock;
+                } else {
+                        (void)pthread_mutex_init(&c->lock, NULL);
+                        c->held = &c->lock;
+                }
+                log_sink_init(&c->sink, deliver, c, INFO, LOG_MODULES_ALL);
+                log_drain_src_init(&c->src, c->log, &c->sink, c->held);
+        }
+        return 0;
+}
+
+/* Account for every sequence number; returns the number of failures. */
+static uint64_t
+verify(uint64_t *total)
+{
+        uint64_t failed = 0u;
+        *total = 0u;
+        printf("%-8s %12s %12s %12s %8s %8s\n", "context", "written",
+               "delivered", "overwritten", "torn", "order");
+        for (uint32_t i = 0u; i < contexts; ++i) {
+                struct context *c = &context[i];
+                uint64_t written = 0u;
+                uint64_t delivered = 0u;
+                uint64_t lost = 0u;
+                for (uint32_t p = i; p < producers; p += contexts) {
+                        uint64_t made = atomic_load(&producer[p].produced);
+                        struct seen *n = &c->seen[p];
+                        if ((n->next > made)
+                            || (n->delivered + n->lost != n->next)) {
+                                failed++;
+                                continue;
+                        }
+                        /* Anything after the last delivery was lost too. */
+                        lost += n->lost + (made - n->next);
+                        delivered += n->delivered;
+                        written += made;
+                }
+                if ((log_get_seq(c->log) != (uint32_t)written)
+                    || (c->sink.pos != log_get_seq(c->log))
+                    || ((uint32_t)lost != c->sink.dropped)
+                    || (delivered + lost != written)) {
+                        failed++;
+                }
+                failed += c->torn + c->disorder;
+                printf("%-8u %12" PRIu64 " %12" PRIu64 " %12" PRIu64
+                       " %8" PRIu64 " %8" PRIu64 "\n", i, written, delivered,
+                       lost, c->torn, c->disorder);
+                *total += written;
+        }
+        return failed;
+}
+
+static uint64_t
+report_observers(const char *what, const struct observer *o, uint32_t n)
+{
+        uint64_t failed = 0u;
+        for (uint32_t i = 0u; i < n; ++i) {
+                printf("%-11s %2u %10" PRIu64 " passes %12" PRIu64
+                       " entries %6" PRIu64 " torn %6" PRIu64 " order\n",
+                       what, i, o[i].passes, o[i].entries, o[i].torn,
+                       o[i].disorder);
+                failed += o[i].torn + o[i].disorder;
+        }
+        return failed;
+}
+
+int
+main(int argc, char **argv)
+{
+        uint32_t seconds = 10u;
+        uint32_t readers = 1u;
+        uint32_t snapshotters = 1u;
+        uint32_t drains = 2u;
+        int opt;
+
+        while ((opt = getopt(argc, argv, "St:p:c:r:s:d:h")) != -1) {
+                uint32_t v = (optarg != NULL)
+                                 ? (uint32_t)strtoul(optarg, NULL, 0)
+                                 : 0u;
+                switch (opt) {
+                case 'S': staged = 1u; break;
+                case 't': seconds = v; break;
+                case 'p': producers = v; break;
+                case 'c': contexts = v; break;
+                case 'r': readers = v; break;
+                case 's': snapshotters = v; break;
+                case 'd': drains = v; break;
+                default: usage(); return (opt == 'h') ? 0 : 2;
+                }
+        }
+        if ((optind != argc) || (seconds == 0u) || (producers == 0u)
+            || (producers > MAX_PRODUCERS) || (contexts == 0u)
+            || (contexts > MAX_CONTEXTS) || (contexts > producers)
+            || (readers > MAX_THREADS) || (snapshotters > MAX_THREADS)
+            || (drains == 0u) || (drains > LOG_DRAIN_THREADS)) {
+                usage();
+                return 2;
+        }
+        if (setup(drains) != 0) {
+                return 1;
+        }
+
+        printf("%u producers, %u contexts of %u entries (%s), %u readers, "
+               "%u snapshotters, %u drains, %u s\n",
+               producers, contexts, (unsigned)LOG_ENTRIES,
+               (staged != 0u) ? "staged" : "locked", readers, snapshotters,
+               drains, seconds);
+        for (uint32_t p = 0u; p < producers; ++p) {
+                producer[p].id = p;
+                producer[p].ctx = &context[p % contexts];
+                if (spawn(&producer[p].thread, produce, &producer[p]) != 0) {
+                        return 1;
+                }
+        }
+        for (uint32_t i = 0u; i < readers; ++i) {
+                reader[i].id = i;
+                if (spawn(&reader[i].thread, read_newest, &reader[i]) != 0) {
+                        return 1;
+                }
+        }
+        for (uint32_t i = 0u; i < snapshotters; ++i) {
+                snapshotter[i].id = i;
+                if (spawn(&snapshotter[i].thread, snapshot, &snapshotter[i])
+                    != 0) {
+                        return 1;
+                }
+        }
+
+        uint64_t start = now_ns();
+        uint64_t before = 0u;
+        uint64_t slowest = UINT64_MAX;
+        for (uint32_t t = 1u; t <= seconds; ++t) {
+                (void)sleep(1u);
+                uint64_t sum = 0u;
+                for (uint32_t p = 0u; p < producers; ++p) {
+                        sum += atomic_load_explicit(&producer[p].produced,
+                                                    memory_order_relaxed);
+                }
+                printf("%4us %12" PRIu64 " events/s\n", t, sum - before);
+                slowest = (sum - before < slowest) ? sum - before : slowest;
+                before = sum;
+        }
+        atomic_store(&stop, 1);
+        double elapsed = (double)(now_ns() - start) / 1e9;
+
+        for (uint32_t p = 0u; p < producers; ++p) {
+                (void)pthread_join(producer[p].thread, NULL);
+        }
+        for (uint32_t i = 0u; i < readers; ++i) {
+                (void)pthread_join(reader[i].thread, NULL);
+        }
+        for (uint32_t i = 0u; i < snapshotters; ++i) {
+                (void)pthread_join(snapshotter[i].thread, NULL);
+        }
+        log_drain_stop(&pool);
+
+        uint64_t total;
+        uint64_t failed = verify(&total);
+        failed += report_observers("reader", reader, readers);
+        failed += report_observers("snapshotter", snapshotter, snapshotters);
+
+        static uint64_t hist[HIST_BUCKETS];
+        for (uint32_t p = 0u; p < producers; ++p) {
+                for (uint32_t b = 0u; b < HIST_BUCKETS; ++b) {
+                        hist[b] += producer[p].hist[b];
+                }
+        }
+        uint32_t top = HIST_BUCKETS - 1u;
+        while ((top > 0u) && (hist[top] == 0u)) {
+                top--;
+        }
+        printf("throughput %.0f events/s mean, %" PRIu64
+               " events/s sustained\n", (double)total / elapsed, slowest);
+        printf("latency ns p50 %" PRIu64 " p99 %" PRIu64 " p99.9 %" PRIu64
+               " p99.99 %" PRIu64 " max %" PRIu64 "\n",
+               hist_quantile(hist, total, 0.50),
+               hist_quantile(hist, total, 0.99),
+               hist_quantile(hist, total, 0.999),
+               hist_quantile(hist, total, 0.9999), hist_value(top));
+        printf("%s\n", (failed == 0u) ? "PASS" : "FAIL");
+
+        for (uint32_t i = 0u; i < contexts; ++i) {
+                if (context[i].hub != NULL) {
+                        log_stage_hub_destroy(context[i].hub);
+                        free(context[i].hub);
+                } else {
+                        (void)pthread_mutex_destroy(&context[i].lock);
+                }
+                free(context[i].log);
+        }
+        return (failed == 0u) ? 0 : 1;
+}
@@ -0,0 +1,168 @@
+/*
+ * @licence MIT
+ *
+ * @file: perf_counters.c
+ */
+
+#define _GNU_SOURCE
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#include "perf_counters.h"
+
+static const char *const names[PERF_COUNTERS] = {
+        "cycles", "instr", "cache-miss", "br-miss",
+};
+
+static uint64_t
+now_ns(void)
+{
+        struct timespec ts;
+        (void)clock_gettime(CLOCK_MONOTONIC, &ts);
+        return ((uint64_t)ts.tv_sec * 1000000000u) + (uint64_t)ts.tv_nsec;
+}
+
+#if defined(__linux__)
+static int
+open_counter(uint64_t config)
+{
+        struct perf_event_attr a;
+        (void)memset(&a, 0, sizeof(a));
+        a.size = sizeof(a);
+        a.type = PERF_TYPE_HARDWARE;
+        a.config = config;
+        a.disabled = 1;
+        a.exclude_kernel = 1;
+        a.exclude_hv = 1;
+        a.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED
+                      | PERF_FORMAT_TOTAL_TIME_RUNNING;
+        return (int)syscall(SYS_perf_event_open, &a, 0, -1, -1, 0);
+}
+#endif
+
+int
+perf_counters_open(struct perf_counters *p)
+{
+#if defined(__linux__)
+        static const uint64_t config[PERF_COUNTERS] = {
+                PERF_COUNT_HW_CPU_CYCLES,
+                PERF_COUNT_HW_INSTRUCTIONS,
+                PERF_COUNT_HW_CACHE_MISSES,
+                PERF_COUNT_HW_BRANCH_MISSES,
+        };
+#endif
+        int n = 0;
+        (void)memset(p, 0, sizeof(*p));
+        for (int i = 0; i < PERF_COUNTERS; ++i) {
+#if defined(__linux__)
+                p->fd[i] = open_counter(config[i]);
+#else
+                p->fd[i] = -1;
+#endif
+                if (p->fd[i] >= 0) {
+                        n++;
+                }
+        }
+        return n;
+}
+
+void
+perf_counters_close(struct perf_counters *p)
+{
+        for (int i = 0; i < PERF_COUNTERS; ++i) {
+#if defined(__linux__)
+                if (p->fd[i] >= 0) {
+                        (void)close(p->fd[i]);
+                }
+#endif
+                p->fd[i] = -1;
+        }
+}
+
+void
+perf_counters_start(struct perf_counters *p)
+{
+#if defined(__linux__)
+        for (int i = 0; i < PERF_COUNTERS; ++i) {
+                if (p->fd[i] >= 0) {
+                        (void)ioctl(p->fd[i], PERF_EVENT_IOC_RESET, 0);
+                        (void)ioctl(p->fd[i], PERF_EVENT_IOC_ENABLE, 0);
+                }
+        }
+#endif
+        p->ns = now_ns();
+}
+
+void
+perf_counters_stop(struct perf_counters *p)
+{
+        uint64_t end = now_ns();
+#if defined(__linux__)
+        for (int i = 0; i < PERF_COUNTERS; ++i) {
+                if (p->fd[i] >= 0) {
+                        (void)ioctl(p->fd[i], PERF_EVENT_IOC_DISABLE, 0);
+                }
+        }
+#endif
+        p->ns = end - p->ns;
+        for (int i = 0; i < PERF_COUNTERS; ++i) {
+                p->valid[i] = 0u;
+                p->value[i] = 0u;
+#if defined(__linux__)
+                /* value, time enabled, time running */
+                uint64_t r[3];
+                if ((p->fd[i] < 0)
+                    || (read(p->fd[i], r, sizeof(r)) != (ssize_t)sizeof(r))
+                    || (r[2] == 0u)) {
+                        continue;
+                }
+                /* Scale up if the kernel multiplexed the counter. */
+                p->value[i] = (r[2] < r[1])
+                                  ? (uint64_t)((double)r[0] * r[1] / r[2])
+                                  : r[0];
+                p->valid[i] = 1u;
+#endif
+        }
+}
+
+void
+perf_counters_header(const char *what)
+{
+        printf("%-14s %10s", what, "ns/op");
+        for (int i = 0; i < PERF_COUNTERS; ++i) {
+                printf(" %10s", names[i]);
+        }
+        printf(" %6s\n", "IPC");
+}
+
+void
+perf_counters_print(const char *name, const struct perf_counters *p,
+                    uint64_t ops)
+{
+        double n = (ops > 0u) ? (double)ops : 1.0;
+        printf("%-14s %10.1f", name, (double)p->ns / n);
+        for (int i = 0; i < PERF_COUNTERS; ++i) {
+                if (p->valid[i] != 0u) {
+                        printf(" %10.2f", (double)p->value[i] / n);
+                } else {
+                        printf(" %10s", "-");
+                }
+        }
+        if ((p->valid[PERF_CYCLES] != 0u) && (p->valid[PERF_INSTRUCTIONS] != 0u)
+            && (p->value[PERF_CYCLES] > 0u)) {
+                printf(" %6.2f\n", (double)p->value[PERF_INSTRUCTIONS]
+                                       / (double)p->value[PERF_CYCLES]);
+        } else {
+                printf(" %6s\n", "-");
+        }
+}
@@ -0,0 +1,45 @@
+/*
+ * @licence MIT
+ *
+ * @file: perf_counters.h
+ *
+ * Hardware counters around a benchmark, read with Linux perf_event_open().
+ * Counters the kernel, the CPU or perf_event_paranoid do not allow are
+ * reported as unavailable ("-"), and the wall time is always measured, so
+ * benchmarks run unchanged in containers, VMs and on other systems.
+ */
+
+#ifndef PERF_COUNTERS_H
+#define PERF_COUNTERS_H
+
+#include <stdint.h>
+
+enum perf_counter {
+        PERF_CYCLES,
+        PERF_INSTRUCTIONS,
+        PERF_CACHE_MISSES,
+        PERF_BRANCH_MISSES,
+        PERF_COUNTERS
+};
+
+struct perf_counters {
+        int fd[PERF_COUNTERS];          /* -1 if unavailable. */
+        uint64_t value[PERF_COUNTERS];  /* Last measurement, scaled. */
+        uint8_t valid[PERF_COUNTERS];   /* Counter ran during it. */
+        uint64_t ns;                    /* Wall time of it. */
+};
+
+/* Open the counters; returns how many are available. */
+int perf_counters_open(struct perf_counters *p);
+void perf_counters_close(struct perf_counters *p);
+
+/* Bracket the code to measure. */
+void perf_counters_start(struct perf_counters *p);
+void perf_counters_stop(struct perf_counters *p);
+
+/* Print a table header, then one row per measurement, normalised by ops. */
+void perf_counters_header(const char *what);
+void perf_counters_print(const char *name, const struct perf_counters *p,
+                         uint64_t ops);
+
+#endif /* PERF_COUNTERS_H */
@@ -10,6 +10,10 @@
 #include <stdarg.h>
 #include <stdint.h>
 
+#ifdef __cplusplus
+extern "C" {
+#endif
+
 /**
  * @defgroup log_api Embedded Logging Facility
  *
@@ -61,11 +65,104 @@
  *   }
  *   @endcode
  *
+ *   Contexts need no initialisation call: all-zero storage (.bss) is a
+ *   valid, empty context using log_timestamp_default(), and LOG_CTX_INIT()
+ *   supplies another timestamp source at compile time.
+ *
  * @{
  */
 
+/**
+ * @def LOG_MSG_LEN
+ * @brief Message capacity per entry, including the terminator; at most 256.
+ *
+ * @def LOG_ENTRIES
+ * @brief Number of entries per context; below LOG_IDX_NONE.
+ *
+ * Both may be overridden at build time. External readers learn the values
+ * in use from the context's layout descriptor, see log_layout.h.
+ */
+#ifndef LOG_MSG_LEN
 #define LOG_MSG_LEN (48u)
+#endif
+#ifndef LOG_ENTRIES
 #define LOG_ENTRIES (50u)
+#endif
+
+#define LOG_LEVELS    (3u)
+#define LOG_SPANS_MAX (3u)
+#define LOG_MODULES   (32u)
+#define LOG_IDX_NONE  (0xFFFFu)
+
+/** Level of a slot left by a quota eviction, see log_set_quota(). */
+#define LOG_LEVEL_HOLE (0xFFFFu)
+
+#define LOG_LEVEL_BIT(l)  ((uint8_t)(1u << (l)))
+#define LOG_LEVELS_ALL    ((uint8_t)((1u << LOG_LEVELS) - 1u))
+#define LOG_MODULE_BIT(m) ((uint32_t)1u << (m))
+#define LOG_MODULES_ALL   (0xFFFFFFFFu)
+
+/**
+ * @def LOG_LEVEL_INDEX
+ * @brief Maintain per-level linked lists of entries (1) or not (0).
+ *
+ * Enables log_level_first()/log_level_next() at a cost of two bytes per
+ * entry. Per-level counts are always maintained.
+ */
+#ifndef LOG_LEVEL_INDEX
+#define LOG_LEVEL_INDEX (1u)
+#endif
+
+/**
+ * @def LOG_MODULE_QUOTA
+ * @brief Support per-module slot quotas (1) or not (0).
+ *
+ * Enables log_set_quota() and the per-module queries at a cost of eight
+ * bytes per entry (six without LOG_LEVEL_INDEX) plus eight bytes per module.
+ */
+#ifndef LOG_MODULE_QUOTA
+#define LOG_MODULE_QUOTA (0u)
+#endif
+
+/**
+ * @def LOG_QUOTA_SLACK
+ * @brief Slots kept for holes while quotas protect old entries.
+ *
+ * Quota evictions leave holes that are closed in one O(n) pass once
+ * LOG_QUOTA_SLACK of them have built up, see log_set_quota(). Larger
+ * values make evictions cheaper on average and the buffer smaller while
+ * quotas are in effect.
+ */
+#ifndef LOG_QUOTA_SLACK
+#define LOG_QUOTA_SLACK ((LOG_ENTRIES + 7u) / 8u)
+#endif
+
+/**
+ * @def LOG_PROFILE
+ * @brief Support per-call-site cost profiling (1) or not (0).
+ *
+ * Enables log_set_profile(), see log_profile.h. Off by default: it is an
+ * instrumentation build, and costs a pointer per context even when no
+ * profile is attached.
+ */
+#ifndef LOG_PROFILE
+#define LOG_PROFILE (0u)
+#endif
+
+/**
+ * @def LOG_STREAM
+ * @brief Support non-temporal entry stores (1) or not (0).
+ *
+ * Enables log_set_streaming() at a cost of one byte per entry. Defaults to
+ * 1 on targets that have such stores (x86 with SSE2, AArch64), else 0.
+ */
+#ifndef LOG_STREAM
+#if defined(__SSE2__) || defined(__aarch64__)
+#define LOG_STREAM (1u)
+#else
+#define LOG_STREAM (0u)
+#endif
+#endif
 
 /**
  * @brief Log level enum.
@@ -82,27 +179,141 @@ enum log_level {
 struct log_entry {
         uint32_t timestamp;
         uint16_t level;
+        uint8_t module;
         char msg[LOG_MSG_LEN];
 };
 
+struct log_layout;
+struct log_watch;
+struct log_rate;
+struct log_profile;
+struct log_tap;
+
 /**
  * @brief Log context, holding buffer and state.
  */
 struct log_ctx {
+        const struct log_layout *layout; /**< Always first, see log_layout.h. */
         struct log_entry buffer[LOG_ENTRIES];
         uint16_t head;
         uint16_t count;
         uint32_t (*timestamp_fn)(void);
+        uint32_t max_age;
+        uint32_t seq;
+        uint32_t pin_seq; /**< Sequence number of the first pinned entry. */
+        uint16_t pinned;  /**< Size of the pinned region. */
+        uint32_t gen;     /**< Bumped by log_init(), never 0 after it. */
+        uint16_t level_count[LOG_LEVELS];
+        struct log_watch *watch;         /**< See log_watch.h. */
+        uint32_t watch_mask[LOG_LEVELS]; /**< Watched modules per level. */
+        struct log_rate *rate;           /**< See log_rate.h. */
+#if LOG_LEVEL_INDEX
+        uint16_t level_first[LOG_LEVELS]; /**< Valid while level_count > 0. */
+        uint16_t level_last[LOG_LEVELS];
+        uint16_t level_next[LOG_ENTRIES];
+#endif
+#if LOG_MODULE_QUOTA
+#if LOG_LEVEL_INDEX
+        uint16_t level_prev[LOG_ENTRIES]; /**< Holes unlink anywhere. */
+#endif
+        uint16_t holes;              /**< Evicted slots still in count. */
+        uint16_t quota[LOG_MODULES]; /**< Slots guaranteed to each module. */
+        uint16_t module_count[LOG_MODULES];
+        uint16_t module_first[LOG_MODULES]; /**< Valid while count > 0. */
+        uint16_t module_last[LOG_MODULES];
+        uint16_t module_next[LOG_ENTRIES];
+        uint32_t slot_seq[LOG_ENTRIES]; /**< Sequence number per slot. */
+#endif
+#if LOG_PROFILE
+        struct log_profile *profile; /**< See log_profile.h. */
+        struct log_tap *tap;         /**< See log_profile.h. */
+#endif
+#if LOG_STREAM
+        uint8_t stream;                /**< See log_set_streaming(). */
+        uint8_t slot_tag[LOG_ENTRIES]; /**< Level | module << 2 per slot. */
+#endif
+#ifdef __cplusplus
+        constexpr log_ctx(uint32_t (*fn)(void) = nullptr)
+            : layout(nullptr), buffer{}, head(0u), count(0u),
+              timestamp_fn(fn), max_age(0u), seq(0u), pin_seq(0u), pinned(0u),
+              gen(0u), level_count{}, watch(nullptr), watch_mask{},
+              rate(nullptr)
+#if LOG_LEVEL_INDEX
+              , level_first{}, level_last{}, level_next{}
+#endif
+#if LOG_MODULE_QUOTA
+#if LOG_LEVEL_INDEX
+              , level_prev{}
+#endif
+              , holes(0u), quota{}, module_count{}, module_first{},
+              module_last{}, module_next{}, slot_seq{}
+#endif
+#if LOG_PROFILE
+              , profile(nullptr), tap(nullptr)
+#endif
+#if LOG_STREAM
+              , stream(0u), slot_tag{}
+#endif
+        {
+        }
+#endif
 };
 
+/**
+ * @def LOG_CTX_INIT
+ * @brief Constant initializer for a context that needs no log_init().
+ *
+ * @code
+ * static struct log_ctx boot_log = LOG_CTX_INIT(NULL); // .bss, default clock
+ * static struct log_ctx app_log = LOG_CTX_INIT(my_get_ticks);
+ * @endcode
+ *
+ * With NULL the context is all zero and stays in .bss; a timestamp source
+ * places it in .data. In C++, log_ctx(fn) is the equivalent constexpr
+ * constructor.
+ *
+ * @param fn        Timestamp source, or NULL for log_timestamp_default().
+ */
+#ifdef __cplusplus
+#define LOG_CTX_INIT(fn) log_ctx(fn)
+#else
+#define LOG_CTX_INIT(fn) { .timestamp_fn = (fn) }
+#endif
+
+/**
+ * @brief Timestamp source of contexts that were never given one.
+ *
+ * Returns a counter incremented on every call, so entries stay ordered
+ * before any clock is running. With GCC or Clang this is a weak symbol:
+ * define log_timestamp_default() in the application to use a real clock.
+ *
+ * @return          Timestamp.
+ */
+uint32_t log_timestamp_default(void);
+
 /**
  * @brief Initialize the log context.
  *
+ * Optional for contexts that are zero-initialised or set up with
+ * LOG_CTX_INIT(). Sequence numbers restart at 0; the context's generation
+ * is advanced instead of reset, so sinks (see log_sink.h) notice that it
+ * was re-initialised.
+ *
  * @param ctx           Pointer to user-supplied log context.
- * @param timestamp_fn  Pointer to user-supplied timestamp function.
+ * @param timestamp_fn  Pointer to user-supplied timestamp function. NULL
+ *                      disables logging until the next log_init().
  */
 void log_init(struct log_ctx *ctx, uint32_t (*timestamp_fn)(void));
 
+/**
+ * @brief Discard all entries, keeping the timestamp source and settings.
+ *
+ * Unlike log_init(), the buffer contents are not cleared, so this is O(1).
+ *
+ * @param ctx           Pointer to log context.
+ */
+void log_clear(struct log_ctx *ctx);
+
 /**
  * @brief Add a log entry.
  *
@@ -115,9 +326,49 @@ void log_init(struct log_ctx *ctx, uint32_t (*timestamp_fn)(void));
  */
 void log_event(struct log_ctx *ctx, enum log_level level, const char *fmt, ...);
 
+/**
+ * @brief Add a log entry tagged with a module.
+ *
+ * log_event() logs as module 0. Modules let consumers filter entries
+ * without looking at the message.
+ *
+ * @param ctx       Pointer to log context.
+ * @param module    Module number, below LOG_MODULES.
+ * @param level     Log level (INFO, WARN, FAULT).
+ * @param fmt       printf-style format string.
+ * @param ...       Arguments for format string.
+ */
+void log_event_mod(struct log_ctx *ctx, uint8_t module, enum log_level level,
+                   const char *fmt, ...);
+
+/**
+ * @brief Add a log entry from a va_list.
+ *
+ * @param ctx       Pointer to log context.
+ * @param module    Module number, below LOG_MODULES.
+ * @param level     Log level (INFO, WARN, FAULT).
+ * @param fmt       printf-style format string.
+ * @param args      Arguments for format string.
+ */
+void log_vevent(struct log_ctx *ctx, uint8_t module, enum log_level level,
+                const char *fmt, va_list args);
+
+/**
+ * @brief Add a copy of an entry built elsewhere, keeping its timestamp.
+ *
+ * For entries staged or recorded outside the context; ordering by
+ * timestamp is up to the caller, see log_set_retention().
+ *
+ * @param ctx       Pointer to log context.
+ * @param e         Entry to copy. Its level and module must be in range.
+ */
+void log_put_entry(struct log_ctx *ctx, const struct log_entry *e);
+
 /**
  * @brief Get the number of valid log entries in the buffer.
  *
+ * With LOG_MODULE_QUOTA this includes the holes left by quota evictions.
+ *
  * @param ctx       Pointer to log context.
  *
  * @return          Number of valid log entries.
@@ -130,13 +381,180 @@ uint16_t log_get_count(const struct log_ctx *ctx);
  * @param ctx       Pointer to log context.
  * @param idx       Index (0 = oldest).
  *
- * @return          Pointer to log entry, or NULL if out of bounds.
+ * @return          Pointer to log entry, or NULL if out of bounds or a hole
+ *                  left by a quota eviction.
  */
 const struct log_entry *log_get_entry(const struct log_ctx *ctx, uint16_t idx);
 
+/**
+ * @brief Get the sequence number the next entry will receive.
+ *
+ * Every entry is numbered as it is written, starting from 0 at log_init(),
+ * and the numbers keep counting across log_clear() and wrap at 2^32.
+ * Buffered entries are numbered in write order; log_get_seq_at() gives the
+ * number of each.
+ *
+ * @param ctx       Pointer to log context.
+ *
+ * @return          Next sequence number.
+ */
+uint32_t log_get_seq(const struct log_ctx *ctx);
+
+/**
+ * @brief Get the sequence number of a buffered entry by index.
+ *
+ * Without quota evictions (see log_set_quota()) the numbers are consecutive
+ * and the oldest entry has log_get_seq() - log_get_count(), plus the pinned
+ * region's own run (see log_get_pinned()). An eviction leaves a gap; a hole
+ * still in the buffer reports the number of the entry it replaced.
+ *
+ * @param ctx       Pointer to log context.
+ * @param idx       Index as for log_get_entry(), 0 for the oldest.
+ *
+ * @return          Sequence number of entry idx, or log_get_seq() if idx is
+ *                  log_get_count() or beyond.
+ */
+uint32_t log_get_seq_at(const struct log_ctx *ctx, uint16_t idx);
+
+/**
+ * @brief Get a buffered entry by sequence number.
+ *
+ * @param ctx       Pointer to log context.
+ * @param seq       Sequence number.
+ *
+ * O(1), or O(log n) in the ring with LOG_MODULE_QUOTA.
+ *
+ * @return          Pointer to log entry, or NULL if it has been overwritten,
+ *                  evicted or not written yet.
+ */
+const struct log_entry *log_get_entry_seq(const struct log_ctx *ctx,
+                                          uint32_t seq);
+
+/**
+ * @brief Get the number of buffered entries at one level.
+ *
+ * Maintained incrementally, O(1).
+ *
+ * @param ctx       Pointer to log context.
+ * @param level     Log level (INFO, WARN, FAULT).
+ *
+ * @return          Number of entries at that level.
+ */
+uint16_t log_count_level(const struct log_ctx *ctx, enum log_level level);
+
+#if LOG_LEVEL_INDEX
+/**
+ * @brief Get the oldest entry at one level.
+ *
+ * Together with log_level_next(), visits only entries of the requested
+ * level, oldest first, in O(1) per entry.
+ *
+ * @code
+ * uint16_t it;
+ * for (const struct log_entry *e = log_level_first(ctx, FAULT, &it);
+ *      e != NULL; e = log_level_next(ctx, &it)) {
+ *     ...
+ * }
+ * @endcode
+ *
+ * @param ctx       Pointer to log context.
+ * @param level     Log level (INFO, WARN, FAULT).
+ * @param it        Iterator state for log_level_next().
+ *
+ * @return          Pointer to log entry, or NULL if there is none.
+ */
+const struct log_entry *log_level_first(const struct log_ctx *ctx,
+                                        enum log_level level, uint16_t *it);
+
+/**
+ * @brief Get the next entry at the level passed to log_level_first().
+ *
+ * @param ctx       Pointer to log context.
+ * @param it        Iterator state from log_level_first().
+ *
+ * @return          Pointer to log entry, or NULL at the end.
+ */
+const struct log_entry *log_level_next(const struct log_ctx *ctx,
+                                       uint16_t *it);
+#endif
+
+#if LOG_MODULE_QUOTA
+/**
+ * @brief Guarantee a module a share of the buffer.
+ *
+ * When the buffer is full and the oldest entry belongs to a module holding
+ * no more than its quota, the entry overwritten instead is the oldest one of
+ * the module furthest over its quota, so one chatty module cannot flush the
+ * recent history of the others. The module is chosen in O(LOG_MODULES)
+ * from per-module counts, and its oldest ring entry found through its list
+ * past any pinned entries of that module, O(k) for k pinned. With all
+ * quotas 0 (the default after log_init()) the oldest entry is always
+ * overwritten.
+ *
+ * The evicted entry is not moved or overwritten: it stays in place as a
+ * hole, with level LOG_LEVEL_HOLE, so the buffer stays in write order and
+ * an eviction costs O(LOG_MODULES + k). Holes count towards
+ * log_get_count(), log_get_entry() returns NULL for them and spans and
+ * raw readers see them with that level. The evicted sequence number is
+ * missing: log_get_entry_seq() returns NULL for it and a sink counts it as
+ * dropped. To have room for the holes, evictions start once LOG_ENTRIES -
+ * LOG_QUOTA_SLACK entries are held; the holes are closed in one O(n) pass
+ * when the buffer is full, and those at the front are reused at once.
+ * Pinned entries count towards their module's share but are never evicted.
+ *
+ * @param ctx       Pointer to log context.
+ * @param module    Module number, below LOG_MODULES.
+ * @param slots     Number of entries guaranteed to the module. Quotas adding
+ *                  up to more than the ring size are honoured as far as
+ *                  possible.
+ *
+ * @return          1 if applied, 0 if the module is out of range.
+ */
+uint8_t log_set_quota(struct log_ctx *ctx, uint8_t module, uint16_t slots);
+
+/**
+ * @brief Get the number of buffered entries of one module.
+ *
+ * Maintained incrementally, O(1).
+ *
+ * @param ctx       Pointer to log context.
+ * @param module    Module number, below LOG_MODULES.
+ *
+ * @return          Number of entries of that module.
+ */
+uint16_t log_count_module(const struct log_ctx *ctx, uint8_t module);
+
+/**
+ * @brief Get the oldest entry of one module.
+ *
+ * Used like log_level_first(), with log_module_next().
+ *
+ * @param ctx       Pointer to log context.
+ * @param module    Module number, below LOG_MODULES.
+ * @param it        Iterator state for log_module_next().
+ *
+ * @return          Pointer to log entry, or NULL if there is none.
+ */
+const struct log_entry *log_module_first(const struct log_ctx *ctx,
+                                         uint8_t module, uint16_t *it);
+
+/**
+ * @brief Get the next entry of the module passed to log_module_first().
+ *
+ * @param ctx       Pointer to log context.
+ * @param it        Iterator state from log_module_first().
+ *
+ * @return          Pointer to log entry, or NULL at the end.
+ */
+const struct log_entry *log_module_next(const struct log_ctx *ctx,
+                                        uint16_t *it);
+#endif
+
 /**
  * @brief Return pointer to log buffer for direct inspection.
  *
+ * With LOG_MODULE_QUOTA, skip entries whose level is LOG_LEVEL_HOLE.
+ *
  * @param ctx       Pointer to log context.
  * @param count     If non-NULL, writes number of valid entries.
  *
@@ -145,6 +563,139 @@ const struct log_entry *log_get_entry(const struct log_ctx *ctx, uint16_t idx);
 const struct log_entry *log_get_buffer(const struct log_ctx *ctx,
                                        uint16_t *count);
 
+/**
+ * @brief Describe the valid entries as at most LOG_SPANS_MAX contiguous runs.
+ *
+ * The runs are returned oldest first and point straight into the buffer,
+ * so they can be handed to DMA or a single scatter write without copying.
+ * Without a pinned region there are at most two. Holes left by quota
+ * evictions are included, with level LOG_LEVEL_HOLE.
+ *
+ * @param ctx       Pointer to log context.
+ * @param span      Receives the start of each run.
+ * @param len       Receives the number of entries in each run.
+ *
+ * @return          Number of runs (0 to LOG_SPANS_MAX).
+ */
+uint8_t log_get_spans(const struct log_ctx *ctx,
+                      const struct log_entry *span[LOG_SPANS_MAX],
+                      uint16_t len[LOG_SPANS_MAX]);
+
+/**
+ * @brief Keep the first k entries after reset permanently.
+ *
+ * The first k entries written since log_init() or log_clear() (versions,
+ * configuration, reset cause, ...) are never overwritten, expired or
+ * trimmed; only the remaining LOG_ENTRIES - k slots wrap. Readers see the
+ * pinned entries first, as the oldest ones, followed by the ring. The
+ * region costs no extra entry storage and refills after log_clear().
+ *
+ * Can be called at any point before the first entry is overwritten, so
+ * early boot code may log first and pin afterwards. With LOG_LEVEL_INDEX,
+ * overwriting an entry also walks the pinned entries of its level, O(k).
+ *
+ * @param ctx       Pointer to log context.
+ * @param k         Number of entries to pin, below LOG_ENTRIES; 0 disables.
+ *
+ * @return          1 if applied, 0 if k is too large, fewer than the entries
+ *                  already buffered, or entries have already been dropped.
+ */
+uint8_t log_set_pinned(struct log_ctx *ctx, uint16_t k);
+
+/**
+ * @brief Get the pinned entries currently held.
+ *
+ * They are entries 0 to n - 1 of log_get_entry() and carry consecutive
+ * sequence numbers; see log_get_seq_at() for the ring entries that follow.
+ *
+ * @param ctx       Pointer to log context.
+ * @param seq       If non-NULL, receives the sequence number of the first
+ *                  pinned entry.
+ *
+ * @return          Number of pinned entries held, n.
+ */
+uint16_t log_get_pinned(const struct log_ctx *ctx, uint32_t *seq);
+
+/**
+ * @brief Write entries without pulling the buffer into the cache.
+ *
+ * Each entry is built on the stack and then copied to its slot with
+ * non-temporal stores (MOVNTI on x86 with SSE2, STNP on AArch64), and
+ * overwriting an entry no longer reads it: its level and module are kept
+ * in a per-slot tag. A large buffer that is rarely read then no longer
+ * evicts the application's working set, at the price of one extra copy per
+ * entry and slower reads of recent entries.
+ *
+ * Streamed entries are visible to the writing thread at once. The stores
+ * are weakly ordered, so other threads and DMA are only sure to see them
+ * once the writer has run log_stream_fence() or, on x86, a locked
+ * read-modify-write; a plain or release store does not publish them, nor
+ * does a lock whose unlock is one. log_pingpong_publish() and the
+ * log_stage.h hub fence before handing entries over. A context shared under
+ * a lock of your own, such as a log_drain.h source, needs
+ * log_stream_fence() before each unlock.
+ *
+ * @param ctx       Pointer to log context.
+ * @param on        1 to enable, 0 for ordinary stores (the default).
+ *
+ * @return          1 if entries now bypass the cache, 0 if disabled or the
+ *                  target has no non-temporal stores (plain stores are used).
+ */
+uint8_t log_set_streaming(struct log_ctx *ctx, uint8_t on);
+
+/**
+ * @brief Make streamed entries visible to any observer.
+ *
+ * A store fence (SFENCE, DMB ISHST); nothing on other targets. Call before
+ * handing the buffer to DMA or another thread, see log_set_streaming().
+ */
+void log_stream_fence(void);
+
+/**
+ * @brief Treat entries older than a given age as expired.
+ *
+ * Expired entries stay in the buffer until overwritten or trimmed, but
+ * log_first_live() and the exporters skip them. Pinned entries never
+ * expire. Timestamps are assumed to be non-decreasing and may wrap.
+ *
+ * @param ctx       Pointer to log context.
+ * @param max_age   Maximum age in timestamp units, or 0 to disable expiry.
+ */
+void log_set_retention(struct log_ctx *ctx, uint32_t max_age);
+
+/**
+ * @brief Find the oldest entry that has not expired.
+ *
+ * Binary search on timestamps, O(log n). Pinned entries are always live
+ * and not considered: entries from log_get_pinned() up to the returned
+ * index are the expired ones.
+ *
+ * The current time is read from the context's timestamp source. A context
+ * that was never given one logs with log_timestamp_default(), which is
+ * shared and advances on every call, so it is not read here: the newest
+ * entry's timestamp stands in for the current time. A context disabled
+ * with log_init(ctx, NULL) has no clock, so nothing in it expires.
+ *
+ * @param ctx       Pointer to log context.
+ *
+ * @return          Index of the oldest live ring entry (0 = oldest), or the
+ *                  entry count if every ring entry has expired.
+ */
+uint16_t log_first_live(const struct log_ctx *ctx);
+
+/**
+ * @brief Drop every entry with a timestamp before t, except pinned ones.
+ *
+ * Binary search on timestamps, O(log n), plus O(1) per dropped entry to
+ * keep the per-level counts exact.
+ *
+ * @param ctx       Pointer to log context.
+ * @param t         Oldest timestamp to keep.
+ *
+ * @return          Number of entries dropped.
+ */
+uint16_t log_trim_before(struct log_ctx *ctx, uint32_t t);
+
 /**
  * @def LOG_ONCE
  * @brief Log a message at most once per code location per reset.
@@ -179,4 +730,8 @@ const struct log_entry *log_get_buffer(const struct log_ctx *ctx,
  * @}
  */
 
+#ifdef __cplusplus
+}
+#endif
+
 #endif /* LOG_H */
@@ -0,0 +1,261 @@
+/*
+ * @licence MIT
+ *
+ * @file: log_capture.h
+ */
+
+#ifndef LOG_CAPTURE_H
+#define LOG_CAPTURE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "log_profile.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @defgroup log_capture Workload Capture and Replay (host only)
+ * @ingroup log_api
+ *
+ * @brief
+ *   Record what a live process logs, then log exactly that again.
+ *
+ *   A capture is a tap (see log_profile.h) that writes one record per event
+ *   to a trace file: the call site, the time since the previous event, the
+ *   level and module, and the argument shape of the format. Integer,
+ *   pointer and floating-point arguments are stored by value, strings by
+ *   length only, so the trace holds no message text beyond the format
+ *   strings. Each call site and its format are written once, when first
+ *   seen; an event then takes a few bytes.
+ *
+ *   A replay reads the trace back one event at a time and
+ *   log_replay_emit() logs it with log_event_mod(), with strings of the
+ *   recorded lengths, so a benchmark sees the same formats, argument
+ *   values, module and level mix and, if it paces itself by delta_ns, the
+ *   same burstiness.
+ *
+ *   File layout: an 8 byte header (magic "EMLC", format version, zero),
+ *   then records starting with a LEB128 varint tag. A tag of 2 * id + 1
+ *   defines call site id with varints for its address and format length,
+ *   then the format bytes. A tag of 2 * id is an event from site id: a
+ *   varint of nanoseconds since the previous event, one byte of
+ *   level << 5 | module, then the arguments: a varint for integers and
+ *   pointers, zigzag encoded if signed, a string's length as a varint, and
+ *   the 8 bytes of a double, little-endian.
+ *
+ *   Capturing needs LOG_PROFILE; replay does not. The capture is called
+ *   under whatever serialises the context, so one capture per context.
+ *   Formats with %n, long double or wide-character conversions, or more
+ *   than LOG_CAPTURE_ARGS arguments, are recorded without arguments and
+ *   skipped on replay, as are events with floating-point arguments past
+ *   the fourth. Strings longer than LOG_CAPTURE_STR_MAX are replayed at
+ *   that length. Replay passes integer arguments as 64-bit values and so
+ *   needs a 64-bit host.
+ *
+ *   **Example Usage:**
+ *   @code
+ *   // In the live process, built with LOG_PROFILE
+ *   static struct log_capture cap;
+ *   log_capture_open(&cap, &my_log, "app.trace");
+ *   ...
+ *   log_capture_close(&cap);
+ *
+ *   // In the benchmark
+ *   static struct log_replay r;
+ *   struct log_replay_event e;
+ *   log_replay_open(&r, "app.trace");
+ *   while (log_replay_next(&r, &e) > 0) {
+ *       log_replay_emit(&bench_log, &e);
+ *   }
+ *   log_replay_close(&r);
+ *   @endcode
+ *
+ *   Requires a POSIX host; not part of the embedded library.
+ *
+ * @{
+ */
+
+#define LOG_CAPTURE_MAGIC      (0x434C4D45u)
+#define LOG_CAPTURE_VERSION    (1u)
+#define LOG_CAPTURE_HEADER_LEN (8u)
+#define LOG_CAPTURE_BUF_LEN    (4096u)
+#define LOG_CAPTURE_FMT_MAX    (255u)
+#define LOG_CAPTURE_STR_MAX    (1024u)
+
+#ifndef LOG_CAPTURE_SITES
+#define LOG_CAPTURE_SITES (256u)
+#endif
+#ifndef LOG_CAPTURE_ARGS
+#define LOG_CAPTURE_ARGS (8u)
+#endif
+
+/**
+ * @brief Argument types, as read from the format.
+ */
+enum log_arg {
+        LOG_ARG_INT,
+        LOG_ARG_UINT,
+        LOG_ARG_LONG,
+        LOG_ARG_ULONG,
+        LOG_ARG_LLONG,
+        LOG_ARG_ULLONG,
+        LOG_ARG_INTMAX,
+        LOG_ARG_UINTMAX,
+        LOG_ARG_SIZE,
+        LOG_ARG_PTRDIFF,
+        LOG_ARG_PTR,
+        LOG_ARG_STR,
+        LOG_ARG_DOUBLE,
+};
+
+/**
+ * @brief Capture state. Counters may be read at any time.
+ */
+struct log_capture {
+        struct log_tap tap;
+        struct log_ctx *ctx;
+        int fd;
+        int error;           /**< errno of the first failed write, or 0. */
+        uint8_t buf[LOG_CAPTURE_BUF_LEN];
+        size_t len;
+        uint64_t last_ns;
+        const void *addr[LOG_CAPTURE_SITES]; /**< Hash table of sites, */
+        const char *fmt[LOG_CAPTURE_SITES];  /**< NULL fmt if free, */
+        uint16_t id[LOG_CAPTURE_SITES];      /**< with their ids. */
+        uint16_t sites;      /**< Sites defined. */
+        uint64_t events;     /**< Events recorded. */
+        uint32_t lost;       /**< Events from sites that did not fit. */
+};
+
+/**
+ * @brief A call site read from a trace.
+ */
+struct log_replay_site {
+        const void *addr;   /**< Address in the captured process. */
+        const char *fmt;
+        int8_t nargs;       /**< Arguments, or -1 if not replayable. */
+        uint8_t shape[LOG_CAPTURE_ARGS]; /**< enum log_arg of each. */
+};
+
+/**
+ * @brief One argument of a replayed event.
+ */
+union log_replay_arg {
+        uint64_t u; /**< Integers, pointers and strings of the length. */
+        double d;
+};
+
+/**
+ * @brief A replayed event.
+ */
+struct log_replay_event {
+        const struct log_replay_site *site;
+        uint64_t delta_ns; /**< Time since the previous event. */
+        uint8_t module;
+        enum log_level level;
+        union log_replay_arg arg[LOG_CAPTURE_ARGS];
+};
+
+/**
+ * @brief Replay state. Treat as opaque.
+ */
+struct log_replay {
+        int fd;
+        uint8_t buf[LOG_CAPTURE_BUF_LEN];
+        size_t len;
+        size_t off;
+        struct log_replay_site site[LOG_CAPTURE_SITES];
+        uint16_t sites;
+        char fmt[LOG_CAPTURE_SITES][LOG_CAPTURE_FMT_MAX + 1u];
+        char pad[LOG_CAPTURE_STR_MAX + 1u]; /**< Replayed strings. */
+};
+
+/**
+ * @brief Start capturing a context to a trace file.
+ *
+ * Creates or truncates the file, writes the header and attaches the
+ * capture to the context with log_set_tap().
+ *
+ * @param c         Capture to initialise.
+ * @param ctx       Context to capture.
+ * @param path      Trace file.
+ *
+ * @return          0 on success, -1 on error (errno is set; ENOTSUP
+ *                  without LOG_PROFILE).
+ */
+int log_capture_open(struct log_capture *c, struct log_ctx *ctx,
+                     const char *path);
+
+/**
+ * @brief Write buffered records to the file.
+ *
+ * @param c         Capture.
+ *
+ * @return          0 on success, -1 if this or an earlier write failed.
+ */
+int log_capture_flush(struct log_capture *c);
+
+/**
+ * @brief Detach the capture, flush and close the file.
+ *
+ * @param c         Capture.
+ *
+ * @return          0 on success, -1 if a write failed.
+ */
+int log_capture_close(struct log_capture *c);
+
+/**
+ * @brief Open a trace file for replay.
+ *
+ * @param r         Replay to initialise.
+ * @param path      Trace file.
+ *
+ * @return          0 on success, -1 on error (errno is set; EINVAL for a
+ *                  file that is not a trace).
+ */
+int log_replay_open(struct log_replay *r, const char *path);
+
+/**
+ * @brief Read the next event.
+ *
+ * The event points into the replay, which must stay open while it is
+ * used.
+ *
+ * @param r         Replay.
+ * @param e         Receives the event.
+ *
+ * @return          1 if an event was read, 0 at the end of the trace, -1 on
+ *                  a malformed trace or read error.
+ */
+int log_replay_next(struct log_replay *r, struct log_replay_event *e);
+
+/**
+ * @brief Log a replayed event with log_event_mod().
+ *
+ * @param ctx       Pointer to log context.
+ * @param e         Event.
+ *
+ * @return          1 if logged, 0 if its site cannot be replayed.
+ */
+uint8_t log_replay_emit(struct log_ctx *ctx, const struct log_replay_event *e);
+
+/**
+ * @brief Close the trace file.
+ *
+ * @param r         Replay.
+ */
+void log_replay_close(struct log_replay *r);
+
+/**
+ * Close group: log_capture
+ * @}
+ */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* LOG_CAPTURE_H */
@@ -0,0 +1,47 @@
+/*
+ * @licence MIT
+ *
+ * @file: log_crc.h
+ */
+
+#ifndef LOG_CRC_H
+#define LOG_CRC_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @defgroup log_crc Checksums
+ * @ingroup log_api
+ *
+ * @brief
+ *   The CRC shared by the serial frames (log_uart.h) and the flash pages
+ *   (log_flash.h).
+ *
+ * @{
+ */
+
+/**
+ * @brief CRC-16/CCITT-FALSE (poly 0x1021, init 0xFFFF).
+ *
+ * @param buf       Data.
+ * @param len       Length of data.
+ *
+ * @return          CRC.
+ */
+uint16_t log_crc16(const uint8_t *buf, size_t len);
+
+/**
+ * Close group: log_crc
+ * @}
+ */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* LOG_CRC_H */
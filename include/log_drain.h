@@ -0,0 +1,171 @@
+/*
+ * @licence MIT
+ *
+ * @file: log_drain.h
+ */
+
+#ifndef LOG_DRAIN_H
+#define LOG_DRAIN_H
+
+#include <pthread.h>
+#include <stdint.h>
+
+#include "log_sink.h"
+
+#ifdef __cplusplus
+/* Same layout as the C11 atomics the sources use. */
+#include <atomic>
+using std::atomic_uint_least8_t;
+using std::atomic_uint;
+#else
+#include <stdatomic.h>
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @defgroup log_drain Drain Scheduler (host only)
+ * @ingroup log_api
+ *
+ * @brief
+ *   A small pool of exporter threads draining many contexts.
+ *
+ *   Each context is paired with one sink as a source. After logging, the
+ *   producer calls log_drain_notify(); a per-source flag makes sure a
+ *   source is queued at most once, so notifying an already queued source
+ *   costs one atomic exchange and nothing else.
+ *
+ *   Every worker owns a deque of sources with pending data. It takes work
+ *   from its own end, and when that runs dry steals from the other end of
+ *   another worker's deque, so a burst on a few contexts is spread over
+ *   the pool. A source is drained by one worker at a time, at most budget
+ *   entries per turn, and while it has more it is requeued at the far end
+ *   of the same worker's deque, behind every other source queued there, so
+ *   a context that logs without pause cannot starve the others. Entries of
+ *   one context are delivered in order, while different contexts proceed
+ *   in parallel.
+ *
+ *   **Example Usage:**
+ *   @code
+ *   static struct log_drain pool;
+ *   static struct log_drain_src src[CONNS];
+ *
+ *   log_drain_start(&pool, 4u, 64u);
+ *   log_drain_src_init(&src[i], &conn[i].log, &conn[i].sink, &conn[i].lock);
+ *
+ *   // Producer of connection i, holding conn[i].lock while logging
+ *   log_event(&conn[i].log, INFO, "rx %u", len);
+ *   log_drain_notify(&pool, &src[i]);
+ *   @endcode
+ *
+ *   A worker may drain a source as soon as its lock is released, so a
+ *   context written with log_set_streaming() needs log_stream_fence()
+ *   before each unlock.
+ *
+ *   Requires a POSIX host; not part of the embedded library.
+ *
+ * @{
+ */
+
+#ifndef LOG_DRAIN_THREADS
+#define LOG_DRAIN_THREADS (16u)
+#endif
+
+/* Sources per pool; a power of 2. */
+#ifndef LOG_DRAIN_SOURCES
+#define LOG_DRAIN_SOURCES (1024u)
+#endif
+
+/**
+ * @brief A context and the sink it is drained to.
+ */
+struct log_drain_src {
+        struct log_ctx *ctx;
+        struct log_sink *sink;
+        pthread_mutex_t *lock;          /**< Held while draining, or NULL. */
+        atomic_uint_least8_t scheduled; /**< Queued or being drained. */
+        uint32_t turns;                 /**< Times drained. */
+};
+
+/**
+ * @brief One worker's deque. Treat as opaque.
+ */
+struct log_drain_deque {
+        struct log_drain *pool;
+        pthread_mutex_t lock;
+        uint32_t top;    /**< Stealing end. */
+        uint32_t bottom; /**< Owner end. */
+        struct log_drain_src *item[LOG_DRAIN_SOURCES];
+};
+
+/**
+ * @brief Worker pool. Counters may be read at any time.
+ */
+struct log_drain {
+        pthread_t thread[LOG_DRAIN_THREADS];
+        struct log_drain_deque deque[LOG_DRAIN_THREADS];
+        uint8_t threads;
+        uint16_t budget;
+        pthread_mutex_t idle_lock;
+        pthread_cond_t wake;
+        atomic_uint queued;    /**< Sources in all deques. */
+        atomic_uint next;      /**< Deque for the next notification. */
+        atomic_uint steals;    /**< Sources taken from another worker. */
+        uint8_t stop;          /**< Under idle_lock. */
+};
+
+/**
+ * @brief Start the worker threads.
+ *
+ * @param d         Pool to initialise.
+ * @param threads   Number of workers, 1 to LOG_DRAIN_THREADS.
+ * @param budget    Entries examined per source per turn, 0 for 64.
+ *
+ * @return          0 on success, -1 on error (errno is set).
+ */
+int log_drain_start(struct log_drain *d, uint8_t threads, uint16_t budget);
+
+/**
+ * @brief Pair a context with its sink.
+ *
+ * @param src       Source to initialise.
+ * @param ctx       Context to drain.
+ * @param sink      Sink to deliver to, positioned by the caller.
+ * @param lock      Mutex the producers hold while logging to ctx, or NULL
+ *                  if they never run concurrently with the pool.
+ */
+void log_drain_src_init(struct log_drain_src *src, struct log_ctx *ctx,
+                        struct log_sink *sink, pthread_mutex_t *lock);
+
+/**
+ * @brief Schedule a source that may have pending entries.
+ *
+ * Call after logging, with or without the source lock held. A sink that
+ * reports busy keeps its source scheduled and is retried every 100 us.
+ *
+ * @param d         Pool.
+ * @param src       Source; up to LOG_DRAIN_SOURCES per pool.
+ */
+void log_drain_notify(struct log_drain *d, struct log_drain_src *src);
+
+/**
+ * @brief Finish every queued source, then stop and join the workers.
+ *
+ * Sources whose sink is still busy are left with their entries pending.
+ *
+ * @param d         Pool.
+ */
+void log_drain_stop(struct log_drain *d);
+
+/**
+ * Close group: log_drain
+ * @}
+ */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* LOG_DRAIN_H */
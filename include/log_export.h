@@ -0,0 +1,212 @@
+/*
+ * @licence MIT
+ *
+ * @file: log_export.h
+ */
+
+#ifndef LOG_EXPORT_H
+#define LOG_EXPORT_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "log.h"
+#include "log_filter.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @defgroup log_export Binary Log Export
+ * @ingroup log_api
+ *
+ * @brief
+ *   Compact, host-independent encoding of log entries.
+ *
+ *   An exported log is an 8 byte file header followed by variable length
+ *   records, oldest first. All multi-byte fields are little-endian, so dumps
+ *   taken on any target can be read back on any host.
+ *
+ *   File header:
+ *   | Offset | Size | Field                         |
+ *   |--------|------|-------------------------------|
+ *   | 0      | 4    | Magic, "EMLG"                 |
+ *   | 4      | 2    | Format version                |
+ *   | 6      | 2    | Reserved, written as zero     |
+ *
+ *   Record:
+ *   | Offset | Size | Field                         |
+ *   |--------|------|-------------------------------|
+ *   | 0      | 4    | Timestamp                     |
+ *   | 4      | 1    | Level                         |
+ *   | 5      | 1    | Module                        |
+ *   | 6      | 1    | Message length (n)            |
+ *   | 7      | n    | Message bytes, no terminator  |
+ *
+ *   For streaming, records are grouped into batches, each prefixed by a
+ *   16 byte batch header:
+ *   | Offset | Size | Field                                       |
+ *   |--------|------|---------------------------------------------|
+ *   | 0      | 4    | Source identifier                           |
+ *   | 4      | 4    | Sequence number of the first record         |
+ *   | 8      | 4    | Entries the sender has lost so far          |
+ *   | 12     | 2    | Number of records                           |
+ *   | 14     | 2    | Length of the records in bytes              |
+ *
+ * @{
+ */
+
+#define LOG_EXPORT_MAGIC      (0x474C4D45u)
+#define LOG_EXPORT_VERSION    (1u)
+#define LOG_EXPORT_HEADER_LEN (8u)
+#define LOG_RECORD_HEADER_LEN (7u)
+#define LOG_RECORD_MAX_LEN    (LOG_RECORD_HEADER_LEN + 255u)
+#define LOG_BATCH_HEADER_LEN  (16u)
+
+/**
+ * @brief Batch header fields.
+ */
+struct log_batch {
+        uint32_t source;
+        uint32_t seq;
+        uint32_t dropped;
+        uint16_t count;
+        uint16_t len;
+};
+
+/**
+ * @brief Staging area filled by log_batch_write().
+ */
+struct log_batch_buf {
+        uint8_t *buf;   /**< Record storage. */
+        size_t cap;     /**< Size of record storage. */
+        size_t len;     /**< Bytes used. */
+        uint16_t count; /**< Records written. */
+        uint32_t seq;   /**< Sequence number of the first record. */
+};
+
+/**
+ * @brief Write the export file header.
+ *
+ * @param buf       Destination buffer.
+ * @param len       Size of destination buffer.
+ *
+ * @return          Bytes written, or 0 if the buffer is too small.
+ */
+size_t log_export_header(uint8_t *buf, size_t len);
+
+/**
+ * @brief Validate an export file header.
+ *
+ * @param buf       Source buffer.
+ * @param len       Number of bytes available.
+ *
+ * @return          Header length on success, or 0 if not a valid header.
+ */
+size_t log_export_check_header(const uint8_t *buf, size_t len);
+
+/**
+ * @brief Encode one log entry as an export record.
+ *
+ * @param e         Entry to encode.
+ * @param buf       Destination buffer.
+ * @param len       Size of destination buffer.
+ *
+ * @return          Bytes written, or 0 if the record does not fit.
+ */
+size_t log_record_encode(const struct log_entry *e, uint8_t *buf, size_t len);
+
+/**
+ * @brief Decode one export record.
+ *
+ * @param buf       Source buffer.
+ * @param len       Number of bytes available.
+ * @param e         Destination entry. Messages longer than LOG_MSG_LEN - 1
+ *                  are truncated.
+ *
+ * @return          Bytes consumed, or 0 if the record is incomplete.
+ */
+size_t log_record_decode(const uint8_t *buf, size_t len, struct log_entry *e);
+
+/**
+ * @brief Encode buffered entries, oldest first, as export records.
+ *
+ * Only whole records are written, and expired entries are skipped (see
+ * log_set_retention()). Call repeatedly with the same cursor to export a
+ * context through a small staging buffer.
+ *
+ * @param ctx       Pointer to log context.
+ * @param idx       Cursor holding the next entry index (0 = oldest). Advanced
+ *                  past every entry written.
+ * @param buf       Destination buffer.
+ * @param len       Size of destination buffer.
+ *
+ * @return          Bytes written.
+ */
+size_t log_export(const struct log_ctx *ctx, uint16_t *idx, uint8_t *buf,
+                  size_t len);
+
+/**
+ * @brief Like log_export(), writing only entries that match a filter.
+ *
+ * The cursor also advances past entries the filter rejects.
+ *
+ * @param ctx       Pointer to log context.
+ * @param idx       Cursor holding the next entry index (0 = oldest).
+ * @param f         Compiled filter, or NULL to write every entry.
+ * @param buf       Destination buffer.
+ * @param len       Size of destination buffer.
+ *
+ * @return          Bytes written.
+ */
+size_t log_export_filter(const struct log_ctx *ctx, uint16_t *idx,
+                         const struct log_filter *f, uint8_t *buf, size_t len);
+
+/**
+ * @brief Encode a batch header.
+ *
+ * @param b         Header fields.
+ * @param buf       Destination buffer.
+ * @param len       Size of destination buffer.
+ *
+ * @return          LOG_BATCH_HEADER_LEN, or 0 if the buffer is too small.
+ */
+size_t log_batch_header(const struct log_batch *b, uint8_t *buf, size_t len);
+
+/**
+ * @brief Decode a batch header.
+ *
+ * @param buf       Source buffer.
+ * @param len       Number of bytes available.
+ * @param b         Receives the header fields.
+ *
+ * @return          LOG_BATCH_HEADER_LEN, or 0 if incomplete.
+ */
+size_t log_batch_parse(const uint8_t *buf, size_t len, struct log_batch *b);
+
+/**
+ * @brief Sink write callback that appends records to a batch.
+ *
+ * Use with log_sink_init() and a struct log_batch_buf as the user pointer;
+ * reports busy once the next record does not fit, so a drain fills exactly
+ * one batch. Reset len and count to start the next batch.
+ *
+ * @param user      Pointer to struct log_batch_buf.
+ * @param e         Entry to append.
+ * @param seq       Sequence number of the entry.
+ *
+ * @return          0 if appended, 1 if the batch is full.
+ */
+int log_batch_write(void *user, const struct log_entry *e, uint32_t seq);
+
+/**
+ * Close group: log_export
+ * @}
+ */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* LOG_EXPORT_H */
@@ -0,0 +1,162 @@
+/*
+ * @licence MIT
+ *
+ * @file: log_filter.h
+ */
+
+#ifndef LOG_FILTER_H
+#define LOG_FILTER_H
+
+#include <stdint.h>
+
+#include "log.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @defgroup log_filter Filter Expressions
+ * @ingroup log_api
+ *
+ * @brief
+ *   Entry filters written as expressions, compiled once and evaluated per
+ *   entry without allocation.
+ *
+ *   @code
+ *   level >= WARN && module == 3 && time in [1000, 2000]
+ *   msg contains "retry" || !(level == INFO)
+ *   @endcode
+ *
+ *   Predicates:
+ *   | Predicate               | Matches                                  |
+ *   |-------------------------|------------------------------------------|
+ *   | level OP L              | L is INFO, WARN, FAULT or a number       |
+ *   | module OP N             |                                          |
+ *   | time OP T               | Timestamps compare as unsigned numbers   |
+ *   | time in [A, B]          | A <= timestamp <= B, across wrap         |
+ *   | msg contains "text"     | Substring of the message; \\" and \\\\   |
+ *
+ *   OP is one of == != < <= > >=. Predicates combine with !, && and ||
+ *   (in decreasing precedence) and parentheses; numbers may be decimal or
+ *   0x hexadecimal. The empty expression matches everything.
+ *
+ *   The compiler emits a flat list of instructions with jumps, so && and
+ *   || stop at the first predicate that decides the result. Since
+ *   predicates have no side effects, the operands of each && and || are
+ *   reordered to test level, module and time before any message text.
+ *
+ * @{
+ */
+
+#ifndef LOG_FILTER_INSNS
+#define LOG_FILTER_INSNS (32u)
+#endif
+#ifndef LOG_FILTER_TEXT
+#define LOG_FILTER_TEXT (64u)
+#endif
+
+/**
+ * @brief Instruction opcodes.
+ */
+enum log_filter_op {
+        LOG_FILTER_LEVEL,    /**< r = level CMP a */
+        LOG_FILTER_MODULE,   /**< r = module CMP a */
+        LOG_FILTER_TIME,     /**< r = timestamp CMP a */
+        LOG_FILTER_TIME_IN,  /**< r = timestamp in [a, b] */
+        LOG_FILTER_CONTAINS, /**< r = msg contains text[arg, arg + a) */
+        LOG_FILTER_NOT,      /**< r = !r */
+        LOG_FILTER_JF,       /**< if !r, continue at arg */
+        LOG_FILTER_JT        /**< if r, continue at arg */
+};
+
+/**
+ * @brief Comparison operators.
+ */
+enum log_filter_cmp {
+        LOG_FILTER_EQ,
+        LOG_FILTER_NE,
+        LOG_FILTER_LT,
+        LOG_FILTER_LE,
+        LOG_FILTER_GT,
+        LOG_FILTER_GE
+};
+
+/**
+ * @brief One instruction.
+ */
+struct log_filter_insn {
+        uint8_t op;   /**< enum log_filter_op */
+        uint8_t cmp;  /**< enum log_filter_cmp */
+        uint16_t arg; /**< Jump target or text offset. */
+        uint32_t a;
+        uint32_t b;
+};
+
+/**
+ * @brief Compiled filter. Fields may be read; build it with
+ *        log_filter_compile().
+ */
+struct log_filter {
+        struct log_filter_insn code[LOG_FILTER_INSNS];
+        uint16_t len;   /**< Instructions in use. */
+        uint16_t error; /**< Offset of the syntax error, if compiling failed. */
+        char text[LOG_FILTER_TEXT];
+};
+
+/**
+ * @brief Compile an expression.
+ *
+ * @param f         Receives the compiled filter. On error it matches
+ *                  nothing.
+ * @param expr      Expression, NUL-terminated.
+ *
+ * @return          0 on success, -1 on a syntax error or an expression too
+ *                  large for LOG_FILTER_INSNS / LOG_FILTER_TEXT (f->error
+ *                  holds the offset where compiling stopped).
+ */
+int log_filter_compile(struct log_filter *f, const char *expr);
+
+/**
+ * @brief Evaluate a filter.
+ *
+ * @param f         Compiled filter.
+ * @param e         Entry.
+ *
+ * @return          1 if the entry matches, 0 otherwise or if either is NULL.
+ */
+uint8_t log_filter_match(const struct log_filter *f,
+                         const struct log_entry *e);
+
+/**
+ * @brief Find the next matching entry.
+ *
+ * @code
+ * uint16_t i = 0u;
+ * for (const struct log_entry *e = log_filter_next(&f, ctx, &i); e != NULL;
+ *      e = log_filter_next(&f, ctx, &i)) {
+ *     ...
+ * }
+ * @endcode
+ *
+ * @param f         Compiled filter.
+ * @param ctx       Pointer to log context.
+ * @param idx       Index to start at (0 = oldest); advanced past the entry
+ *                  returned.
+ *
+ * @return          Matching entry, or NULL when there are no more.
+ */
+const struct log_entry *log_filter_next(const struct log_filter *f,
+                                        const struct log_ctx *ctx,
+                                        uint16_t *idx);
+
+/**
+ * Close group: log_filter
+ * @}
+ */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* LOG_FILTER_H */
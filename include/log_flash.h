@@ -0,0 +1,180 @@
+/*
+ * @licence MIT
+ *
+ * @file: log_flash.h
+ */
+
+#ifndef LOG_FLASH_H
+#define LOG_FLASH_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "log_export.h"
+#include "log_sink.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @defgroup log_flash Log-Structured Flash Storage
+ * @ingroup log_api
+ *
+ * @brief
+ *   Persist a context to NOR/NAND flash as an append-only log.
+ *
+ *   Entries are packed as export records (see log_export.h) into a RAM copy
+ *   of one program page, and each page is programmed exactly once, so
+ *   persisting a batch costs one page program rather than one per entry.
+ *   Pages are filled front to back; when an erase block is full the next
+ *   block is erased, round-robin, which spreads erase cycles evenly and
+ *   discards the oldest data first.
+ *
+ *   The first page of every block starts with a block header:
+ *   | Offset | Size | Field                                   |
+ *   |--------|------|-----------------------------------------|
+ *   | 0      | 4    | Magic, "EMLF"                           |
+ *   | 4      | 4    | Block sequence number, +1 per erase     |
+ *
+ *   followed, as in every other page, by a page header:
+ *   | Offset | Size | Field                                   |
+ *   |--------|------|-----------------------------------------|
+ *   | 0      | 2    | Length of the records in bytes          |
+ *   | 2      | 2    | CRC-16/CCITT-FALSE of the records       |
+ *
+ *   All fields are little-endian and the rest of the page is left erased.
+ *   At boot, log_flash_mount() reads the block headers to find the newest
+ *   block and the first erased page in it; pages torn by a power loss fail
+ *   their CRC and are skipped when reading back.
+ *
+ *   **Example Usage:**
+ *   @code
+ *   static const struct log_flash_dev nor = {
+ *       .read = nor_read, .prog = nor_prog, .erase = nor_erase,
+ *       .page_size = 256u, .block_size = 4096u, .block_count = 16u,
+ *   };
+ *   static struct log_flash flash;
+ *
+ *   (void)log_flash_mount(&flash, &nor, WARN, LOG_MODULES_ALL);
+ *   for (;;) {
+ *       (void)log_flash_flush(&flash, &my_log);
+ *   }
+ *   @endcode
+ *
+ * @{
+ */
+
+#ifndef LOG_FLASH_PAGE_MAX
+#define LOG_FLASH_PAGE_MAX (256u)
+#endif
+
+#define LOG_FLASH_MAGIC            (0x464C4D45u)
+#define LOG_FLASH_BLOCK_HEADER_LEN (8u)
+#define LOG_FLASH_PAGE_HEADER_LEN  (4u)
+
+/**
+ * @brief Flash driver. Callbacks return 0 on success.
+ */
+struct log_flash_dev {
+        /** Read len bytes at addr. */
+        int (*read)(void *user, uint32_t addr, uint8_t *buf, size_t len);
+        /** Program one whole page at a page-aligned addr. */
+        int (*prog)(void *user, uint32_t addr, const uint8_t *buf,
+                    size_t len);
+        /** Erase the block starting at addr to 0xFF. */
+        int (*erase)(void *user, uint32_t addr);
+        void *user;
+        uint32_t page_size;   /**< Program page, at most LOG_FLASH_PAGE_MAX. */
+        uint32_t block_size;  /**< Erase block, a multiple of page_size. */
+        uint32_t block_count; /**< Number of blocks, at least 2. */
+};
+
+/**
+ * @brief Flash log state. Fields may be read, but set them through the API.
+ */
+struct log_flash {
+        const struct log_flash_dev *dev;
+        struct log_sink sink;
+        struct log_batch_buf staging;
+        uint32_t block;     /**< Block being appended to. */
+        uint32_t block_seq; /**< Sequence number of that block. */
+        uint32_t page;      /**< Next page to program in that block. */
+        uint32_t programs;  /**< Pages programmed since mount. */
+        uint32_t erases;    /**< Blocks erased since mount. */
+        uint8_t buf[LOG_FLASH_PAGE_MAX];
+};
+
+/**
+ * @brief Read-back cursor.
+ */
+struct log_flash_iter {
+        uint32_t step;  /**< Blocks visited, oldest first. */
+        uint32_t page;  /**< Page within the current block. */
+        size_t off;     /**< Next record within buf. */
+        size_t len;     /**< End of records within buf. */
+        uint32_t bad;   /**< Pages skipped for a failed CRC. */
+        uint8_t buf[LOG_FLASH_PAGE_MAX];
+};
+
+/**
+ * @brief Attach to a flash device and recover the append position.
+ *
+ * A blank device is accepted; nothing is erased until the first flush. The
+ * sink is positioned at sequence number 0, see log_sink_seek().
+ *
+ * @param f             Flash log state.
+ * @param dev           Flash driver; must stay valid while in use.
+ * @param min_level     Lowest level persisted.
+ * @param module_mask   Modules persisted, e.g. LOG_MODULES_ALL.
+ *
+ * @return              0 on success, -1 on a read error or an unsupported
+ *                      geometry.
+ */
+int log_flash_mount(struct log_flash *f, const struct log_flash_dev *dev,
+                    enum log_level min_level, uint32_t module_mask);
+
+/**
+ * @brief Persist every pending entry.
+ *
+ * The last page of a flush is programmed even if partly filled; call it
+ * once per batch rather than once per entry. After a driver error the
+ * entries of the failed page are offered again on the next flush.
+ *
+ * @param f         Flash log state.
+ * @param ctx       Pointer to log context.
+ *
+ * @return          Pages programmed, or -1 on a driver error.
+ */
+int log_flash_flush(struct log_flash *f, const struct log_ctx *ctx);
+
+/**
+ * @brief Start reading back at the oldest persisted entry.
+ *
+ * @param f         Flash log state.
+ * @param it        Cursor to initialise.
+ */
+void log_flash_iter_init(const struct log_flash *f, struct log_flash_iter *it);
+
+/**
+ * @brief Read the next persisted entry.
+ *
+ * @param f         Flash log state.
+ * @param it        Cursor.
+ * @param e         Receives the entry.
+ *
+ * @return          1 if an entry was read, 0 at the end, -1 on a read error.
+ */
+int log_flash_next(const struct log_flash *f, struct log_flash_iter *it,
+                   struct log_entry *e);
+
+/**
+ * Close group: log_flash
+ * @}
+ */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* LOG_FLASH_H */
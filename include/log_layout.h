@@ -0,0 +1,190 @@
+/*
+ * @licence MIT
+ *
+ * @file: log_layout.h
+ */
+
+#ifndef LOG_LAYOUT_H
+#define LOG_LAYOUT_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "log.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @defgroup log_layout In-Memory Layout Descriptor
+ * @ingroup log_api
+ *
+ * @brief
+ *   Describe struct log_ctx to tools that read it from raw memory.
+ *
+ *   The first member of every initialised context points to a constant
+ *   descriptor giving the geometry (entry size, capacity, message length)
+ *   and the offsets of every field a reader needs. A debugger script, core
+ *   extractor or shared-memory tailer therefore needs to know only this
+ *   descriptor format, not the build options of the firmware: it reads the
+ *   pointer at offset 0 of the context, copies the descriptor, checks it
+ *   with log_layout_check(), and decodes the context image with
+ *   log_layout_entry() and log_layout_seq_at().
+ *
+ *   The descriptor is 56 bytes, all fields naturally aligned and in the
+ *   byte order given by LOG_LAYOUT_BIG_ENDIAN. Offsets into the context are
+ *   32-bit, as fields after the buffer lie beyond 64 KiB in large builds:
+ *   | Offset | Size | Field                                        |
+ *   |--------|------|----------------------------------------------|
+ *   | 0      | 4    | Magic, "EMLL"                                |
+ *   | 4      | 2    | Descriptor version                           |
+ *   | 6      | 2    | Descriptor size in bytes                     |
+ *   | 8      | 2    | Flags, LOG_LAYOUT_*                          |
+ *   | 10     | 2    | Size of struct log_entry                     |
+ *   | 12     | 2    | Capacity, LOG_ENTRIES                        |
+ *   | 14     | 2    | Message length, LOG_MSG_LEN                  |
+ *   | 16     | 4    | Offset of buffer in struct log_ctx           |
+ *   | 20     | 4    | Offset of head (u16)                         |
+ *   | 24     | 4    | Offset of count (u16)                        |
+ *   | 28     | 4    | Offset of seq (u32)                          |
+ *   | 32     | 4    | Offset of pinned (u16), see log_set_pinned() |
+ *   | 36     | 4    | Size of struct log_ctx                       |
+ *   | 40     | 2    | Offset of timestamp (u32) in an entry        |
+ *   | 42     | 2    | Offset of level (u16) in an entry            |
+ *   | 44     | 2    | Offset of module (u8) in an entry            |
+ *   | 46     | 2    | Offset of msg in an entry                    |
+ *   | 48     | 4    | Offset of pin_seq (u32)                      |
+ *   | 52     | 4    | Offset of slot_seq (u32[capacity]), or 0     |
+ *
+ * @{
+ */
+
+#define LOG_LAYOUT_MAGIC   (0x4C4C4D45u)
+#define LOG_LAYOUT_VERSION (4u)
+
+/** Multi-byte fields of the context are big-endian. */
+#define LOG_LAYOUT_BIG_ENDIAN (0x0001u)
+/** The context carries per-level entry lists, see LOG_LEVEL_INDEX. */
+#define LOG_LAYOUT_LEVEL_INDEX (0x0002u)
+/**
+ * Entries carry their own sequence numbers in slot_seq and the buffer may
+ * hold holes, see LOG_MODULE_QUOTA.
+ */
+#define LOG_LAYOUT_SLOT_SEQ (0x0004u)
+
+/**
+ * @brief Layout descriptor.
+ */
+struct log_layout {
+        uint32_t magic;
+        uint16_t version;
+        uint16_t size;
+        uint16_t flags;
+        uint16_t entry_size;
+        uint16_t capacity;
+        uint16_t msg_len;
+        uint32_t ctx_buffer;
+        uint32_t ctx_head;
+        uint32_t ctx_count;
+        uint32_t ctx_seq;
+        uint32_t ctx_pinned;
+        uint32_t ctx_size;
+        uint16_t entry_timestamp;
+        uint16_t entry_level;
+        uint16_t entry_module;
+        uint16_t entry_msg;
+        uint32_t ctx_pin_seq;
+        uint32_t ctx_slot_seq;
+};
+
+/**
+ * @brief Descriptor of this build, referenced by every context.
+ */
+extern const struct log_layout log_ctx_layout;
+
+/**
+ * @brief Validate a descriptor read from a target.
+ *
+ * Fields are used as found: a descriptor copied from a target of the other
+ * byte order must be swapped by the caller first. LOG_LAYOUT_BIG_ENDIAN
+ * then tells log_layout_entry() how to read the context itself.
+ *
+ * @param lay       Descriptor.
+ *
+ * @return          1 if usable, 0 if not a descriptor, an unknown version,
+ *                  or offsets that do not fit the sizes given.
+ */
+uint8_t log_layout_check(const struct log_layout *lay);
+
+/**
+ * @brief Number of entries in a context image.
+ *
+ * @param lay       Descriptor of the image, checked by log_layout_check().
+ * @param image     Copy of the context, lay->ctx_size bytes.
+ * @param len       Bytes available.
+ *
+ * @return          Number of entries, or 0 if the image is too short or
+ *                  inconsistent.
+ */
+uint16_t log_layout_count(const struct log_layout *lay, const uint8_t *image,
+                          size_t len);
+
+/**
+ * @brief Sequence number of the next entry in a context image.
+ *
+ * @param lay       Descriptor of the image.
+ * @param image     Copy of the context.
+ * @param len       Bytes available.
+ *
+ * @return          Sequence number, or 0 if the image is too short.
+ */
+uint32_t log_layout_seq(const struct log_layout *lay, const uint8_t *image,
+                        size_t len);
+
+/**
+ * @brief Sequence number of one entry of a context image.
+ *
+ * As log_get_seq_at(): consecutive numbers, unless LOG_LAYOUT_SLOT_SEQ is
+ * set and the numbers are read from the image.
+ *
+ * @param lay       Descriptor of the image.
+ * @param image     Copy of the context.
+ * @param len       Bytes available.
+ * @param idx       Index, 0 = oldest.
+ *
+ * @return          Sequence number of entry idx, or that of the next entry
+ *                  if idx is out of range; 0 if the image is too short.
+ */
+uint32_t log_layout_seq_at(const struct log_layout *lay, const uint8_t *image,
+                           size_t len, uint16_t idx);
+
+/**
+ * @brief Decode one entry of a context image, oldest first.
+ *
+ * Messages longer than LOG_MSG_LEN - 1 of this build are truncated. With
+ * LOG_LAYOUT_SLOT_SEQ, an entry decoded with level LOG_LEVEL_HOLE is a hole
+ * left by a quota eviction and should be skipped.
+ *
+ * @param lay       Descriptor of the image.
+ * @param image     Copy of the context.
+ * @param len       Bytes available.
+ * @param idx       Index, 0 = oldest.
+ * @param e         Receives the entry.
+ *
+ * @return          1 if decoded, 0 if idx is out of range or the image is
+ *                  too short.
+ */
+uint8_t log_layout_entry(const struct log_layout *lay, const uint8_t *image,
+                         size_t len, uint16_t idx, struct log_entry *e);
+
+/**
+ * Close group: log_layout
+ * @}
+ */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* LOG_LAYOUT_H */
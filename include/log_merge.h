@@ -0,0 +1,141 @@
+/*
+ * @licence MIT
+ *
+ * @file: log_merge.h
+ */
+
+#ifndef LOG_MERGE_H
+#define LOG_MERGE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "log.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @defgroup log_merge K-way Log Merge (host only)
+ * @ingroup log_api
+ *
+ * @brief
+ *   Merge any number of exported logs into one timeline.
+ *
+ *   Each source is an export file (see log_export.h) read through a sliding
+ *   read-only mmap window, so memory use is bounded by the number of sources
+ *   times the window size regardless of file size. The current record of
+ *   every source sits in a binary min-heap keyed by calibrated timestamp;
+ *   each call to log_merge_next() pops the earliest record and refills from
+ *   the same source, costing O(log N) per record.
+ *
+ *   Timestamps are unwrapped per source to 64 bits, then calibrated as
+ *   @code
+ *   key = ticks * mult / div + offset
+ *   @endcode
+ *   so that sources with different tick rates or boot times line up. Equal
+ *   keys are returned in source order, and records from one source always
+ *   keep their file order.
+ *
+ *   Requires a POSIX host; not part of the embedded library.
+ *
+ * @{
+ */
+
+#define LOG_MERGE_WINDOW_DEFAULT (1024u * 1024u)
+
+/**
+ * @brief Per-source timestamp calibration.
+ */
+struct log_merge_calib {
+        int64_t offset;
+        uint32_t mult;
+        uint32_t div;
+};
+
+/**
+ * @brief One merge input. Treat as opaque.
+ */
+struct log_merge_src {
+        int fd;
+        uint64_t size;
+        uint64_t off;
+        const uint8_t *map;
+        uint64_t map_off;
+        size_t map_len;
+        size_t window;
+        struct log_merge_calib calib;
+        uint32_t last_ts;
+        uint32_t epoch;
+        int64_t key;
+        struct log_entry entry;
+};
+
+/**
+ * @brief Merge state over caller-supplied sources and heap storage.
+ */
+struct log_merge {
+        struct log_merge_src *src;
+        uint32_t *heap;
+        uint32_t n;
+};
+
+/**
+ * @brief Open an export file as a merge source.
+ *
+ * @param src       Source to initialise.
+ * @param path      Path of the export file.
+ * @param calib     Timestamp calibration, or NULL for identity.
+ * @param window    Bytes mapped at a time, or 0 for the default. Rounded up
+ *                  to a multiple of the page size.
+ *
+ * @return          0 on success, -1 on error (errno is set).
+ */
+int log_merge_open(struct log_merge_src *src, const char *path,
+                   const struct log_merge_calib *calib, size_t window);
+
+/**
+ * @brief Release the mapping and descriptor held by a source.
+ *
+ * @param src       Source to close.
+ */
+void log_merge_close(struct log_merge_src *src);
+
+/**
+ * @brief Prime the heap with the first record of every source.
+ *
+ * @param m         Merge state to initialise.
+ * @param src       Array of n opened sources.
+ * @param heap      Scratch array of n elements.
+ * @param n         Number of sources.
+ *
+ * @return          0 on success, -1 on a malformed source.
+ */
+int log_merge_init(struct log_merge *m, struct log_merge_src *src,
+                   uint32_t *heap, uint32_t n);
+
+/**
+ * @brief Pop the next record in calibrated timestamp order.
+ *
+ * @param m         Merge state.
+ * @param out       Receives the record.
+ * @param src_idx   If non-NULL, receives the index of the source.
+ * @param key       If non-NULL, receives the calibrated timestamp.
+ *
+ * @return          1 if a record was returned, 0 when all sources are
+ *                  exhausted, -1 on a malformed source.
+ */
+int log_merge_next(struct log_merge *m, struct log_entry *out,
+                   uint32_t *src_idx, int64_t *key);
+
+/**
+ * Close group: log_merge
+ * @}
+ */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* LOG_MERGE_H */
@@ -0,0 +1,133 @@
+/*
+ * @licence MIT
+ *
+ * @file: log_pingpong.h
+ */
+
+#ifndef LOG_PINGPONG_H
+#define LOG_PINGPONG_H
+
+#include <stdint.h>
+
+#include "log.h"
+
+#ifdef __cplusplus
+/* Same layout as the C11 atomics the sources use. */
+#include <atomic>
+using std::atomic_uint_least8_t;
+#else
+#include <stdatomic.h>
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @defgroup log_pingpong Double-Buffered Context
+ * @ingroup log_api
+ *
+ * @brief
+ *   Two log contexts handed between one producer and one consumer.
+ *
+ *   The producer always logs into its own context with plain log_event();
+ *   nothing on that path is atomic or shared. When it decides to hand over
+ *   (buffer full, end of a cycle, ...) it calls log_pingpong_publish(),
+ *   which swaps buffers with a single atomic exchange if the consumer has
+ *   returned the other one, and otherwise keeps logging into the current
+ *   buffer, overwriting the oldest entries as usual.
+ *
+ *   The consumer takes a published buffer with log_pingpong_acquire(), ships
+ *   it in place (e.g. log_get_spans() into DMA or one write) and gives it
+ *   back with log_pingpong_release().
+ *
+ *   **Example Usage:**
+ *   @code
+ *   static struct log_pingpong pp;
+ *
+ *   // Producer
+ *   log_event(log_pingpong_producer(&pp), INFO, "cycle %u", n);
+ *   if (log_get_count(log_pingpong_producer(&pp)) == LOG_ENTRIES) {
+ *       (void)log_pingpong_publish(&pp);
+ *   }
+ *
+ *   // Consumer
+ *   const struct log_ctx *full = log_pingpong_acquire(&pp);
+ *   if (full != NULL) {
+ *       ship(full);
+ *       log_pingpong_release(&pp);
+ *   }
+ *   @endcode
+ *
+ * @{
+ */
+
+/**
+ * @brief Pair of contexts and the handoff slot between them.
+ */
+struct log_pingpong {
+        struct log_ctx ctx[2];
+        uint8_t active;             /**< Producer-owned buffer. */
+        atomic_uint_least8_t slot;  /**< Other buffer, free or full. */
+};
+
+/**
+ * @brief Initialise both contexts; the consumer starts with an empty one.
+ *
+ * @param pp            Pointer to double-buffered context.
+ * @param timestamp_fn  Pointer to user-supplied timestamp function.
+ */
+void log_pingpong_init(struct log_pingpong *pp, uint32_t (*timestamp_fn)(void));
+
+/**
+ * @brief Get the context the producer should log into.
+ *
+ * @param pp        Pointer to double-buffered context.
+ *
+ * @return          Producer context, or NULL if pp is NULL.
+ */
+struct log_ctx *log_pingpong_producer(struct log_pingpong *pp);
+
+/**
+ * @brief Hand the producer buffer to the consumer if it has a free one.
+ *
+ * Producer side only. An empty producer buffer is never published.
+ * Streamed entries are fenced first, see log_set_streaming().
+ *
+ * @param pp        Pointer to double-buffered context.
+ *
+ * @return          1 if the buffers were swapped, 0 otherwise.
+ */
+uint8_t log_pingpong_publish(struct log_pingpong *pp);
+
+/**
+ * @brief Get the published buffer, if any.
+ *
+ * Consumer side only. The buffer stays with the consumer, and is returned
+ * again by further calls, until log_pingpong_release().
+ *
+ * @param pp        Pointer to double-buffered context.
+ *
+ * @return          Published context, or NULL if none is ready.
+ */
+const struct log_ctx *log_pingpong_acquire(struct log_pingpong *pp);
+
+/**
+ * @brief Return the acquired buffer so the producer can reuse it.
+ *
+ * Consumer side only. Does nothing if no buffer is held.
+ *
+ * @param pp        Pointer to double-buffered context.
+ */
+void log_pingpong_release(struct log_pingpong *pp);
+
+/**
+ * Close group: log_pingpong
+ * @}
+ */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* LOG_PINGPONG_H */
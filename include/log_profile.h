@@ -0,0 +1,191 @@
+/*
+ * @licence MIT
+ *
+ * @file: log_profile.h
+ */
+
+#ifndef LOG_PROFILE_H
+#define LOG_PROFILE_H
+
+#include <stdarg.h>
+#include <stdint.h>
+
+#include "log.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @defgroup log_profile Call-Site Profiling
+ * @ingroup log_api
+ *
+ * @brief
+ *   What each log statement costs, to find the ones worth demoting.
+ *
+ *   With LOG_PROFILE enabled and a profile attached to a context,
+ *   log_event(), log_event_mod() and log_vevent() time the formatting of
+ *   every message with log_profile_cycles() and add it to the statistics
+ *   of the calling statement: number of calls, formatting cycles, bytes
+ *   stored and messages truncated.
+ *
+ *   A call site is the return address of the logging call (with GCC or
+ *   Clang) together with the format string, so statements that log
+ *   through a wrapper around log_vevent() are still told apart by their
+ *   format. Sites are kept in a fixed-size open-addressing hash table;
+ *   calls from sites that do not fit are counted in lost.
+ *
+ *   A tap sees the same call sites together with the arguments of each
+ *   event, before it is formatted; log_capture.h uses one to record a
+ *   workload.
+ *
+ *   **Example Usage:**
+ *   @code
+ *   static struct log_profile prof;
+ *   const struct log_profile_site *top[10];
+ *
+ *   log_profile_init(&prof);
+ *   (void)log_set_profile(&my_log, &prof);
+ *   ...
+ *   uint16_t n = log_profile_report(&prof, top, 10u);
+ *   for (uint16_t i = 0u; i < n; ++i) {
+ *       printf("%p %-30s %8u calls %10llu cycles\n", top[i]->site,
+ *              top[i]->fmt, top[i]->calls, top[i]->cycles);
+ *   }
+ *   @endcode
+ *
+ * @{
+ */
+
+#ifndef LOG_PROFILE_SITES
+#define LOG_PROFILE_SITES (64u)
+#endif
+
+/**
+ * @brief Statistics of one call site.
+ */
+struct log_profile_site {
+        const void *site; /**< Return address, or NULL if unknown. */
+        const char *fmt;  /**< Format string; NULL marks a free slot. */
+        uint32_t calls;
+        uint32_t truncated; /**< Messages cut to LOG_MSG_LEN - 1. */
+        uint64_t cycles;    /**< Total formatting time. */
+        uint64_t bytes;     /**< Total message bytes stored. */
+};
+
+/**
+ * @brief Profile. Fields may be read at any time.
+ */
+struct log_profile {
+        struct log_profile_site site[LOG_PROFILE_SITES];
+        uint16_t used; /**< Sites in the table. */
+        uint32_t lost; /**< Calls from sites that did not fit. */
+};
+
+/**
+ * @brief Observer of every logging call, see log_set_tap().
+ */
+struct log_tap {
+        /**
+         * Called before formatting, from the logging thread. args holds
+         * the arguments of fmt and may be consumed with va_arg().
+         */
+        void (*fn)(void *user, const void *site, uint8_t module,
+                   enum log_level level, const char *fmt, va_list args);
+        void *user; /**< Passed to fn. */
+};
+
+/**
+ * @brief Clear a profile.
+ *
+ * @param p         Profile.
+ */
+void log_profile_init(struct log_profile *p);
+
+/**
+ * @brief Attach a profile to a context.
+ *
+ * @param ctx       Pointer to log context.
+ * @param p         Profile, or NULL to stop profiling.
+ *
+ * @return          1 if applied, 0 if built without LOG_PROFILE.
+ */
+uint8_t log_set_profile(struct log_ctx *ctx, struct log_profile *p);
+
+/**
+ * @brief Attach a tap to a context.
+ *
+ * The tap is called by log_event(), log_event_mod() and log_vevent() for
+ * every event that is stored, with the call site as described above. Its
+ * time is not counted in an attached profile.
+ *
+ * @param ctx       Pointer to log context.
+ * @param t         Tap, or NULL to remove it.
+ *
+ * @return          1 if applied, 0 if built without LOG_PROFILE.
+ */
+uint8_t log_set_tap(struct log_ctx *ctx, struct log_tap *t);
+
+/**
+ * @brief Read the cycle counter.
+ *
+ * The default reads the time stamp counter on x86 and the virtual counter
+ * on AArch64, and returns 0 elsewhere. With GCC or Clang this is a weak
+ * symbol: define log_profile_cycles() in the application to use another
+ * counter, such as the DWT cycle counter on Cortex-M.
+ *
+ * @return          Cycle count.
+ */
+uint64_t log_profile_cycles(void);
+
+/**
+ * @brief Hash a call site for the site tables.
+ *
+ * Shared by the profile and the capture (log_capture.h); not needed by
+ * applications. Take it modulo the table size to get the first slot.
+ *
+ * @param site      Return address of the logging call, or NULL.
+ * @param fmt       Format string.
+ *
+ * @return          Hash of both.
+ */
+uint32_t log_profile_hash(const void *site, const char *fmt);
+
+/**
+ * @brief Add one call to a profile.
+ *
+ * Called by the context; not needed by applications.
+ *
+ * @param p         Profile.
+ * @param site      Return address of the logging call, or NULL.
+ * @param fmt       Format string.
+ * @param cycles    Formatting time.
+ * @param len       Return value of vsnprintf().
+ */
+void log_profile_record(struct log_profile *p, const void *site,
+                        const char *fmt, uint64_t cycles, int len);
+
+/**
+ * @brief List the most expensive call sites.
+ *
+ * @param p         Profile.
+ * @param out       Receives pointers into the profile, by total formatting
+ *                  cycles, most expensive first; ties by calls.
+ * @param max       Size of out.
+ *
+ * @return          Number of sites written to out.
+ */
+uint16_t log_profile_report(const struct log_profile *p,
+                            const struct log_profile_site **out,
+                            uint16_t max);
+
+/**
+ * Close group: log_profile
+ * @}
+ */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* LOG_PROFILE_H */
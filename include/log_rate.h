@@ -0,0 +1,138 @@
+/*
+ * @licence MIT
+ *
+ * @file: log_rate.h
+ */
+
+#ifndef LOG_RATE_H
+#define LOG_RATE_H
+
+#include <stdint.h>
+
+#include "log.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @defgroup log_rate Rate Counters
+ * @ingroup log_api
+ *
+ * @brief
+ *   Entries per level over a sliding time window, without scanning the
+ *   buffer.
+ *
+ *   A rate counter splits its window into LOG_RATE_BUCKETS buckets of equal
+ *   width, in timestamp ticks. Every entry logged to a context the counter
+ *   is registered with increments the current bucket and a running total
+ *   per level; when time moves past a bucket, the oldest bucket is
+ *   subtracted from the totals and reused. Logging costs a few additions,
+ *   and a query subtracts at most the buckets that expired since the last
+ *   entry, so both are bounded by LOG_RATE_BUCKETS whatever the rate.
+ *
+ *   The window slides a bucket at a time: a count covers the current,
+ *   partially filled bucket plus the LOG_RATE_BUCKETS - 1 before it.
+ *
+ *   A counter may be restricted to some modules, so rates per call site
+ *   are counters registered with one module each.
+ *
+ *   **Example Usage:**
+ *   @code
+ *   static struct log_rate faults; // 10 s window, ms timestamps
+ *
+ *   log_rate_init(&faults, 10000u / LOG_RATE_BUCKETS, LOG_MODULES_ALL);
+ *   log_rate_add(&my_log, &faults);
+ *
+ *   // Supervisor
+ *   if (log_rate_count(&faults, FAULT, get_ms()) > 3u) {
+ *       ...
+ *   }
+ *   @endcode
+ *
+ * @{
+ */
+
+#ifndef LOG_RATE_BUCKETS
+#define LOG_RATE_BUCKETS (16u)
+#endif
+
+/**
+ * @brief Rate counter. Fields may be read, but set them through the API.
+ */
+struct log_rate {
+        struct log_rate *next;
+        uint32_t width;       /**< Bucket width in timestamp ticks. */
+        uint32_t module_mask; /**< LOG_MODULE_BIT() of counted modules. */
+        uint32_t start;       /**< Timestamp the current bucket began. */
+        uint8_t started;      /**< Anything counted yet. */
+        uint8_t current;      /**< Index of the current bucket. */
+        uint32_t total[LOG_LEVELS];
+        uint32_t count[LOG_RATE_BUCKETS][LOG_LEVELS];
+};
+
+/**
+ * @brief Initialise a rate counter.
+ *
+ * @param r             Counter to initialise.
+ * @param width         Bucket width in timestamp ticks; the window is
+ *                      LOG_RATE_BUCKETS times as long.
+ * @param module_mask   Modules counted, e.g. LOG_MODULES_ALL.
+ *
+ * @return              0 on success, -1 if r is NULL or width is 0.
+ */
+int log_rate_init(struct log_rate *r, uint32_t width, uint32_t module_mask);
+
+/**
+ * @brief Count the entries logged to a context from now on.
+ *
+ * Not safe against concurrent logging to the same context.
+ *
+ * @param ctx       Pointer to log context.
+ * @param r         Initialised counter, not registered elsewhere.
+ */
+void log_rate_add(struct log_ctx *ctx, struct log_rate *r);
+
+/**
+ * @brief Stop counting a context's entries.
+ *
+ * @param ctx       Pointer to log context.
+ * @param r         Counter registered with ctx.
+ */
+void log_rate_remove(struct log_ctx *ctx, struct log_rate *r);
+
+/**
+ * @brief Count the entries of one level in the window ending now.
+ *
+ * Does not modify the counter.
+ *
+ * @param r         Counter.
+ * @param level     Level.
+ * @param now       Current timestamp, from the context's timestamp source.
+ *
+ * @return          Entries of the level in the window.
+ */
+uint32_t log_rate_count(const struct log_rate *r, enum log_level level,
+                        uint32_t now);
+
+/**
+ * @brief Count one entry.
+ *
+ * Called by the context for every entry; not needed by applications.
+ * Entries older than the current bucket are counted in it.
+ *
+ * @param r         Counter.
+ * @param e         Entry just added.
+ */
+void log_rate_update(struct log_rate *r, const struct log_entry *e);
+
+/**
+ * Close group: log_rate
+ * @}
+ */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* LOG_RATE_H */
@@ -0,0 +1,169 @@
+/*
+ * @licence MIT
+ *
+ * @file: log_sink.h
+ */
+
+#ifndef LOG_SINK_H
+#define LOG_SINK_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "log.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @defgroup log_sink Log Sinks
+ * @ingroup log_api
+ *
+ * @brief
+ *   Export one context to several destinations at their own pace.
+ *
+ *   A sink is a write callback plus its own read position (a sequence
+ *   number, see log_get_seq()) and a level/module filter. Draining a sink
+ *   never modifies the context, so any number of sinks can follow the same
+ *   context: a slow or blocked sink falls behind and counts the entries that
+ *   were overwritten before it got to them, while the producer and the
+ *   other sinks carry on.
+ *
+ *   Entries rejected by the filter are skipped before the callback is
+ *   called, so a sink never pays to format an entry it would discard. A
+ *   compiled filter expression (see log_filter.h) can narrow it further.
+ *
+ *   **Example Usage:**
+ *   @code
+ *   static struct log_sink sinks[3];
+ *
+ *   log_sink_init(&sinks[0], file_write, &file, INFO, LOG_MODULES_ALL);
+ *   log_sink_init(&sinks[1], uart_write, NULL, WARN, LOG_MODULES_ALL);
+ *   log_sink_init(&sinks[2], net_write, &sock, FAULT, LOG_MODULE_BIT(3));
+ *
+ *   // Periodically, e.g. from the idle loop:
+ *   (void)log_fanout_drain(sinks, 3u, &my_log, 16u);
+ *   @endcode
+ *
+ * @{
+ */
+
+struct log_filter;
+
+/**
+ * @brief Sink write callback.
+ *
+ * @param user      User pointer given to log_sink_init().
+ * @param e         Entry that passed the sink filter.
+ * @param seq       Sequence number of the entry.
+ *
+ * @return          0 if the entry was consumed, non-zero if the sink is
+ *                  busy; the same entry is offered again on the next drain.
+ */
+typedef int (*log_sink_write_fn)(void *user, const struct log_entry *e,
+                                 uint32_t seq);
+
+/**
+ * @brief Sink state. Fields may be read, but set them through the API.
+ */
+struct log_sink {
+        log_sink_write_fn write;
+        void *user;
+        uint32_t pos;         /**< Next sequence number to deliver. */
+        uint32_t gen;         /**< Context generation pos refers to. */
+        uint32_t dropped;     /**< Entries overwritten before delivery. */
+        uint32_t module_mask; /**< LOG_MODULE_BIT() of accepted modules. */
+        uint8_t min_level;    /**< Lowest accepted level. */
+        const struct log_filter *filter; /**< Further filter, or NULL. */
+};
+
+/**
+ * @brief Initialise a sink, positioned at sequence number 0.
+ *
+ * @param s             Sink to initialise.
+ * @param write         Write callback.
+ * @param user          Passed to the write callback.
+ * @param min_level     Lowest level delivered.
+ * @param module_mask   Modules delivered, e.g. LOG_MODULES_ALL.
+ */
+void log_sink_init(struct log_sink *s, log_sink_write_fn write, void *user,
+                   enum log_level min_level, uint32_t module_mask);
+
+/**
+ * @brief Deliver only entries matching a filter expression as well.
+ *
+ * The expression is evaluated after the level and module checks.
+ *
+ * @param s         Sink.
+ * @param f         Compiled filter, which must outlive its use by the sink,
+ *                  or NULL to remove it.
+ */
+void log_sink_set_filter(struct log_sink *s, const struct log_filter *f);
+
+/**
+ * @brief Position a sink at the oldest buffered entry, or past the newest.
+ *
+ * @param s         Sink.
+ * @param ctx       Pointer to log context.
+ * @param newest    0 to deliver what is already buffered, 1 to deliver only
+ *                  entries written from now on.
+ */
+void log_sink_seek(struct log_sink *s, const struct log_ctx *ctx,
+                   uint8_t newest);
+
+/**
+ * @brief Deliver pending entries to one sink.
+ *
+ * Stops early when the callback reports busy. Expired entries (see
+ * log_set_retention()) are skipped without counting as dropped. When the
+ * context has been re-initialised with log_init() since the last drain or
+ * seek, its generation no longer matches and the sink starts again from
+ * the oldest entry; so does a sink found ahead of the context.
+ *
+ * @param s         Sink.
+ * @param ctx       Pointer to log context.
+ * @param budget    Maximum number of entries to examine.
+ *
+ * @return          Number of entries delivered.
+ */
+uint16_t log_sink_drain(struct log_sink *s, const struct log_ctx *ctx,
+                        uint16_t budget);
+
+/**
+ * @brief Deliver pending entries to several sinks.
+ *
+ * Each sink is drained independently with the same budget.
+ *
+ * @param s         Array of sinks.
+ * @param n         Number of sinks.
+ * @param ctx       Pointer to log context.
+ * @param budget    Maximum number of entries to examine per sink.
+ *
+ * @return          Total number of entries delivered.
+ */
+uint32_t log_fanout_drain(struct log_sink *s, uint8_t n,
+                          const struct log_ctx *ctx, uint16_t budget);
+
+/**
+ * @brief Render an entry as a text line, "[timestamp] LEVEL: message\n".
+ *
+ * @param e         Entry to render.
+ * @param buf       Destination buffer.
+ * @param len       Size of destination buffer.
+ *
+ * @return          Length of the line, excluding the terminator, truncated
+ *                  to len - 1.
+ */
+size_t log_format(const struct log_entry *e, char *buf, size_t len);
+
+/**
+ * Close group: log_sink
+ * @}
+ */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* LOG_SINK_H */
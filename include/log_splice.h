@@ -0,0 +1,88 @@
+/*
+ * @licence MIT
+ *
+ * @file: log_splice.h
+ */
+
+#ifndef LOG_SPLICE_H
+#define LOG_SPLICE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "log_pingpong.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @defgroup log_splice Zero-Copy Pipe Export (Linux only)
+ * @ingroup log_api
+ *
+ * @brief
+ *   Hand published buffers of a double-buffered context to a pipe without
+ *   copying them.
+ *
+ *   Each buffer published by the producer (see log_pingpong.h) is mapped
+ *   into the pipe with vmsplice(): the pipe references the buffer's pages
+ *   instead of copying their contents. The buffer is returned to the
+ *   producer only once the reading process has consumed everything in the
+ *   pipe, so the pages are never rewritten while still referenced.
+ *
+ *   The pipe carries raw struct log_entry records, oldest first. The reader
+ *   must therefore share the producer's entry layout.
+ *
+ *   For the kernel to reference whole pages, allocate the struct
+ *   log_pingpong page-aligned, e.g. with aligned_alloc(); unaligned
+ *   buffers work too, with the first and last page shared with neighbours.
+ *
+ * @{
+ */
+
+/**
+ * @brief Pipe exporter state.
+ */
+struct log_splice {
+        struct log_pingpong *pp;
+        int fd;
+        const struct log_ctx *held; /**< Buffer currently in the pipe. */
+        size_t off;                 /**< Bytes of held already spliced. */
+        size_t len;                 /**< Bytes of held to splice. */
+        uint64_t bytes;             /**< Total bytes spliced. */
+        uint32_t buffers;           /**< Buffers recycled. */
+};
+
+/**
+ * @brief Bind an exporter to a double-buffered context and a pipe.
+ *
+ * @param s         Exporter state.
+ * @param pp        Double-buffered context; this exporter is its consumer.
+ * @param pipe_fd   Write end of a pipe.
+ */
+void log_splice_init(struct log_splice *s, struct log_pingpong *pp,
+                     int pipe_fd);
+
+/**
+ * @brief Make progress without blocking.
+ *
+ * Recycles the buffer in the pipe once the reader has drained it, takes
+ * the next published buffer and splices as much of it as the pipe accepts.
+ *
+ * @param s         Exporter state.
+ *
+ * @return          Bytes spliced by this call, or -1 on error (errno is set;
+ *                  ENOSYS on non-Linux hosts).
+ */
+long log_splice_pump(struct log_splice *s);
+
+/**
+ * Close group: log_splice
+ * @}
+ */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* LOG_SPLICE_H */
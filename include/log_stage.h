@@ -0,0 +1,160 @@
+/*
+ * @licence MIT
+ *
+ * @file: log_stage.h
+ */
+
+#ifndef LOG_STAGE_H
+#define LOG_STAGE_H
+
+#include <pthread.h>
+#include <stdint.h>
+
+#include "log.h"
+
+#ifdef __cplusplus
+/* Same layout as the C11 atomics the sources use. */
+#include <atomic>
+using std::atomic_uint_least64_t;
+#else
+#include <stdatomic.h>
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @defgroup log_stage Per-Thread Staging (host only)
+ * @ingroup log_api
+ *
+ * @brief
+ *   Many producer threads sharing one context with one lock per batch.
+ *
+ *   Each thread formats its entries into a private staging buffer, with no
+ *   locks or shared writes, and publishes them to the shared context a batch
+ *   at a time: when the buffer is full, on a FAULT, on log_stage_flush() and
+ *   at thread exit. Publishing takes the hub lock once, so the lock and its
+ *   cache line move between cores once per LOG_STAGE_ENTRIES entries instead
+ *   of once per entry.
+ *
+ *   Published batches pass through a hold buffer that keeps the context in
+ *   timestamp order: entries are merged by timestamp and only released to
+ *   the context once no thread still has an older entry staged. Each thread
+ *   announces the timestamp of its oldest staged entry with one atomic store
+ *   per batch. Order is kept as long as the hold buffer does not overflow;
+ *   a thread that stops logging with entries staged holds back everyone
+ *   else's, so idle threads should call log_stage_flush(). Timestamps must
+ *   be monotonic across threads.
+ *
+ *   **Example Usage:**
+ *   @code
+ *   static struct log_ctx my_log;
+ *   static struct log_stage_hub hub;
+ *
+ *   log_init(&my_log, my_timestamp);
+ *   log_stage_hub_init(&hub, &my_log);
+ *
+ *   // Any thread
+ *   log_stage_event(&hub, 3u, INFO, "rx %u", len);
+ *
+ *   // Readers of my_log
+ *   pthread_mutex_lock(&hub.lock);
+ *   ...
+ *   pthread_mutex_unlock(&hub.lock);
+ *   @endcode
+ *
+ *   Requires a POSIX host; not part of the embedded library.
+ *
+ * @{
+ */
+
+#ifndef LOG_STAGE_ENTRIES
+#define LOG_STAGE_ENTRIES (16u)
+#endif
+#ifndef LOG_STAGE_THREADS
+#define LOG_STAGE_THREADS (64u)
+#endif
+#ifndef LOG_STAGE_HOLD
+#define LOG_STAGE_HOLD (256u)
+#endif
+
+struct log_stage_hub;
+
+/**
+ * @brief One thread's staging buffer. Treat as opaque.
+ */
+struct log_stage {
+        struct log_stage_hub *hub;
+        struct log_entry entry[LOG_STAGE_ENTRIES];
+        uint16_t n;                   /**< Staged entries, owner only. */
+        uint8_t used;                 /**< Claimed by a thread, under lock. */
+        atomic_uint_least64_t oldest; /**< Announced timestamp, 0 = none. */
+};
+
+/**
+ * @brief Shared context, per-thread stages and the hold buffer.
+ */
+struct log_stage_hub {
+        struct log_ctx *ctx;
+        pthread_mutex_t lock; /**< Serialises the context; readers take it. */
+        pthread_key_t key;
+        struct log_stage stage[LOG_STAGE_THREADS];
+        struct log_entry hold[LOG_STAGE_HOLD];
+        uint16_t held;
+        uint32_t batches;     /**< Batches published. */
+        uint32_t forced;      /**< Entries released early, out of order. */
+};
+
+/**
+ * @brief Set up a hub in front of a context.
+ *
+ * @param h         Hub to initialise.
+ * @param ctx       Shared context; log to it only through the hub.
+ *
+ * @return          0 on success, -1 on error (errno is set).
+ */
+int log_stage_hub_init(struct log_stage_hub *h, struct log_ctx *ctx);
+
+/**
+ * @brief Stage an entry in the calling thread's buffer.
+ *
+ * The first call from a thread claims one of LOG_STAGE_THREADS stages,
+ * released again at thread exit. Without a free stage the entry is
+ * published on its own.
+ *
+ * @param h         Hub.
+ * @param module    Module number, below LOG_MODULES.
+ * @param level     Log level; FAULT publishes the batch at once.
+ * @param fmt       printf-style format string.
+ * @param ...       Arguments for format string.
+ */
+void log_stage_event(struct log_stage_hub *h, uint8_t module,
+                     enum log_level level, const char *fmt, ...);
+
+/**
+ * @brief Publish the calling thread's staged entries.
+ *
+ * @param h         Hub.
+ */
+void log_stage_flush(struct log_stage_hub *h);
+
+/**
+ * @brief Publish everything staged and held, then release the hub.
+ *
+ * Call once every other producer thread has exited.
+ *
+ * @param h         Hub.
+ */
+void log_stage_hub_destroy(struct log_stage_hub *h);
+
+/**
+ * Close group: log_stage
+ * @}
+ */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* LOG_STAGE_H */
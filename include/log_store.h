@@ -0,0 +1,192 @@
+/*
+ * @licence MIT
+ *
+ * @file: log_store.h
+ */
+
+#ifndef LOG_STORE_H
+#define LOG_STORE_H
+
+#include <pthread.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "log_export.h"
+#include "log_sink.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @defgroup log_store Durable File Storage (host only)
+ * @ingroup log_api
+ *
+ * @brief
+ *   Append a context to an export file (see log_export.h) with group
+ *   commit.
+ *
+ *   Producers log through log_store_event(), which only appends to the
+ *   context. Entries reach the file in batches: the thread that triggers a
+ *   commit becomes the leader, writes every pending entry, then issues a
+ *   single fdatasync() (file mode) or msync() (mmap mode) with the lock
+ *   released. Threads that call log_store_sync() meanwhile wait for that
+ *   commit instead of starting their own, so any number of waiters share
+ *   one sync.
+ *
+ *   A commit is triggered by log_store_sync(), after every N entries, or
+ *   once an interval has elapsed (checked on each event and by
+ *   log_store_poll()), whichever comes first.
+ *
+ *   **Example Usage:**
+ *   @code
+ *   static struct log_ctx my_log;
+ *   static struct log_store store;
+ *
+ *   log_init(&my_log, my_timestamp);
+ *   log_store_open(&store, &my_log, "app.elog", LOG_STORE_FILE, 0u);
+ *   log_store_policy(&store, 32u, 100u);
+ *
+ *   uint32_t seq;
+ *   if (log_store_event(&store, &seq, 0u, FAULT, "Brownout") == 0) {
+ *       log_store_sync(&store, seq); // returns once the FAULT is on disk
+ *   }
+ *   @endcode
+ *
+ *   Requires a POSIX host; not part of the embedded library.
+ *
+ * @{
+ */
+
+#define LOG_STORE_BUF_LEN (4096u)
+
+/**
+ * @brief Storage backend.
+ */
+enum log_store_mode {
+        LOG_STORE_FILE, /**< write() and fdatasync(); the file grows. */
+        LOG_STORE_MMAP  /**< Preallocated shared mapping and msync(). */
+};
+
+/**
+ * @brief Store state. Fields may be read under lock; set them through the
+ *        API.
+ */
+struct log_store {
+        struct log_ctx *ctx;
+        enum log_store_mode mode;
+        int fd;
+        uint8_t *map;
+        size_t map_len;
+        size_t off;         /**< Bytes written. */
+        size_t synced;      /**< Bytes known durable. */
+        struct log_sink sink;
+        struct log_batch_buf staging;
+        pthread_mutex_t lock; /**< Serialises the context and the file. */
+        pthread_cond_t done;
+        uint32_t durable;   /**< Entries below this sequence are durable. */
+        uint32_t next;      /**< Sequence number of the next entry staged. */
+        uint32_t lost_from; /**< Entries in [lost_from, lost_to) may have */
+        uint32_t lost_to;   /**< been overwritten before being stored. */
+        uint8_t syncing;    /**< A leader is committing. */
+        int error;          /**< errno of the first failure, sticky. */
+        uint32_t every;     /**< Commit after this many entries, 0 = off. */
+        uint32_t interval_ms; /**< Commit after this long, 0 = off. */
+        uint64_t last_ms;
+        uint32_t syncs;     /**< Commits issued. */
+        uint8_t buf[LOG_STORE_BUF_LEN];
+};
+
+/**
+ * @brief Bind a context to a file.
+ *
+ * In file mode the file is appended to, and given an export header if
+ * empty. In mmap mode it is truncated and preallocated to size bytes;
+ * log_store_close() trims it to the bytes used. Entries already buffered
+ * in ctx are stored too.
+ *
+ * @param s         Store to initialise.
+ * @param ctx       Context; while the store is open, log only through it.
+ * @param path      File path.
+ * @param mode      Backend.
+ * @param size      File capacity in mmap mode; ignored in file mode.
+ *
+ * @return          0 on success, -1 on error (errno is set).
+ */
+int log_store_open(struct log_store *s, struct log_ctx *ctx, const char *path,
+                   enum log_store_mode mode, size_t size);
+
+/**
+ * @brief Set when commits happen on their own.
+ *
+ * @param s             Store.
+ * @param every         Commit once this many entries are pending, 0 = off.
+ * @param interval_ms   Commit once this long has passed since the last
+ *                      commit, 0 = off.
+ */
+void log_store_policy(struct log_store *s, uint32_t every,
+                      uint32_t interval_ms);
+
+/**
+ * @brief Log an event through the store.
+ *
+ * @param s         Store.
+ * @param seq       If non-NULL, receives the entry's sequence number, to
+ *                  pass to log_store_sync().
+ * @param module    Module identifier, below LOG_MODULES.
+ * @param level     Severity level.
+ * @param fmt       printf-style format string.
+ *
+ * @return          0 on success, -1 with errno EINVAL if the context did
+ *                  not take the entry (bad module or level, NULL fmt, or
+ *                  logging disabled); seq is then left unchanged.
+ */
+int log_store_event(struct log_store *s, uint32_t *seq, uint8_t module,
+                    enum log_level level, const char *fmt, ...);
+
+/**
+ * @brief Commit if the interval has elapsed; call from a timer or idle loop.
+ *
+ * @param s         Store.
+ *
+ * @return          0 on success, -1 after a write or sync error.
+ */
+int log_store_poll(struct log_store *s);
+
+/**
+ * @brief Wait until an entry is durable.
+ *
+ * Joins the commit in progress if there is one, else leads a new one.
+ * An entry the context overwrote before a commit reached it is never
+ * durable. The store remembers a single span of such entries, from the
+ * first lost to the last, and reports every entry in it as lost.
+ *
+ * @param s         Store.
+ * @param seq       Sequence number from log_store_event().
+ *
+ * @return          0 once durable, -1 otherwise (errno is set: EINVAL if seq
+ *                  has not been logged yet, ENODATA if the entry was
+ *                  overwritten before it was stored, ENOSPC when an mmap
+ *                  store is full, or the error of a failed write or sync).
+ */
+int log_store_sync(struct log_store *s, uint32_t seq);
+
+/**
+ * @brief Commit everything, then release the file.
+ *
+ * @param s         Store.
+ *
+ * @return          0 on success, -1 if anything was not stored.
+ */
+int log_store_close(struct log_store *s);
+
+/**
+ * Close group: log_store
+ * @}
+ */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* LOG_STORE_H */
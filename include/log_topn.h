@@ -0,0 +1,111 @@
+/*
+ * @licence MIT
+ *
+ * @file: log_topn.h
+ */
+
+#ifndef LOG_TOPN_H
+#define LOG_TOPN_H
+
+#include <stdint.h>
+
+#include "log.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @defgroup log_topn Frequent Message Analysis
+ * @ingroup log_api
+ *
+ * @brief
+ *   Find the messages that dominate a log buffer.
+ *
+ *   Every entry is keyed by a 32-bit FNV-1a hash of its normalised message,
+ *   where each run of decimal digits counts as a single placeholder, so
+ *   "Retry 3 of 5" and "Retry 4 of 5" share a key. Keys are tracked in a
+ *   fixed-size Space-Saving sketch of LOG_TOPN_SLOTS counters: a single pass
+ *   over the buffer, no allocation, and any message holding more than
+ *   1/LOG_TOPN_SLOTS of the entries is guaranteed to be reported.
+ *
+ *   Expired entries (see log_set_retention()) are not counted. Counts and
+ *   bytes are upper bounds; @c error is the most a count may have
+ *   been overestimated by after a slot was reused. Both are exact while fewer
+ *   than LOG_TOPN_SLOTS distinct messages are present.
+ *
+ *   **Example Usage:**
+ *   @code
+ *   struct log_topn top;
+ *   uint16_t n = log_topn(&my_log, &top, LOG_TOPN_BY_COUNT);
+ *   for (uint16_t i = 0; (i < n) && (i < 5u); ++i) {
+ *       const struct log_entry *e = log_get_entry(&my_log, top.item[i].last);
+ *       printf("%u x %s\n", top.item[i].count, e->msg);
+ *   }
+ *   @endcode
+ *
+ * @{
+ */
+
+#ifndef LOG_TOPN_SLOTS
+#define LOG_TOPN_SLOTS (16u)
+#endif
+
+/**
+ * @brief Ranking applied to the result.
+ */
+enum log_topn_order {
+        LOG_TOPN_BY_COUNT = 0u,
+        LOG_TOPN_BY_BYTES = 1u
+};
+
+/**
+ * @brief One tracked message.
+ */
+struct log_topn_item {
+        uint32_t hash;  /**< Normalised message hash. */
+        uint16_t count; /**< Number of entries. */
+        uint16_t error; /**< Maximum overestimate of count. */
+        uint32_t bytes; /**< Message bytes, excluding terminators. */
+        uint16_t last;  /**< Index of the newest matching entry. */
+};
+
+/**
+ * @brief Heavy-hitters sketch and result.
+ */
+struct log_topn {
+        struct log_topn_item item[LOG_TOPN_SLOTS];
+        uint16_t used;
+};
+
+/**
+ * @brief Hash a message, treating each run of digits as one placeholder.
+ *
+ * @param msg       NUL-terminated message, at most LOG_MSG_LEN bytes read.
+ *
+ * @return          32-bit FNV-1a hash of the normalised message.
+ */
+uint32_t log_msg_hash(const char *msg);
+
+/**
+ * @brief Rank the most frequent messages in the buffer.
+ *
+ * @param ctx       Pointer to log context.
+ * @param top       Receives the ranked items, largest first.
+ * @param order     Rank by entry count or by bytes consumed.
+ *
+ * @return          Number of valid items in top.
+ */
+uint16_t log_topn(const struct log_ctx *ctx, struct log_topn *top,
+                  enum log_topn_order order);
+
+/**
+ * Close group: log_topn
+ * @}
+ */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* LOG_TOPN_H */
@@ -0,0 +1,191 @@
+/*
+ * @licence MIT
+ *
+ * @file: log_uart.h
+ */
+
+#ifndef LOG_UART_H
+#define LOG_UART_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "log.h"
+#include "log_crc.h"
+#include "log_export.h"
+#include "log_sink.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @defgroup log_uart Serial Streaming
+ * @ingroup log_api
+ *
+ * @brief
+ *   Stream a context over a UART as COBS-framed binary batches.
+ *
+ *   Each frame carries one batch (see log_export.h) followed by a
+ *   CRC-16/CCITT-FALSE of the batch, little-endian, all COBS-encoded and
+ *   terminated by a single 0x00 byte. A receiver can therefore resynchronise
+ *   at any zero byte and reject corrupted frames.
+ *
+ *   Transmission is asynchronous: log_uart_poll() builds a frame and hands
+ *   the whole span to the user transmit callback (e.g. to start a DMA
+ *   transfer). The frame buffer stays untouched until the user reports
+ *   completion with log_uart_tx_done(). A failed transfer rewinds to the
+ *   start of that frame; after a link loss, log_uart_resume() restarts from
+ *   whatever sequence number the receiver last acknowledged.
+ *
+ *   **Example Usage:**
+ *   @code
+ *   static struct log_uart uart;
+ *
+ *   static int uart_start(void *user, const uint8_t *buf, size_t len) {
+ *       return dma_start(UART1_TX, buf, len); // 0 if started
+ *   }
+ *   void dma_uart1_tx_complete(void) { log_uart_tx_done(&uart, 1u); }
+ *
+ *   log_uart_init(&uart, uart_start, NULL, 0u, INFO, LOG_MODULES_ALL);
+ *   for (;;) {
+ *       (void)log_uart_poll(&uart, &my_log);
+ *   }
+ *   @endcode
+ *
+ * @{
+ */
+
+#ifndef LOG_UART_FRAME_MAX
+#define LOG_UART_FRAME_MAX (256u)
+#endif
+
+/** Worst-case encoded frame: COBS overhead plus delimiter. */
+#define LOG_UART_WIRE_MAX                                                      \
+        (LOG_UART_FRAME_MAX + (LOG_UART_FRAME_MAX / 254u) + 2u)
+
+/**
+ * @brief Transmit callback.
+ *
+ * @param user      User pointer given to log_uart_init().
+ * @param buf       Encoded frame, valid until log_uart_tx_done().
+ * @param len       Frame length including the 0x00 delimiter.
+ *
+ * @return          0 if transmission started, non-zero to retry later.
+ */
+typedef int (*log_uart_tx_fn)(void *user, const uint8_t *buf, size_t len);
+
+/**
+ * @brief Serial sink state.
+ */
+struct log_uart {
+        struct log_sink sink;
+        struct log_batch_buf staging;
+        log_uart_tx_fn tx;
+        void *user;
+        uint32_t source;
+        uint32_t frame_seq;     /**< Sink position and dropped count */
+        uint32_t frame_dropped; /**< before the frame in flight. */
+        uint32_t frames;        /**< Frames completed. */
+        volatile uint8_t busy;
+        uint8_t raw[LOG_UART_FRAME_MAX];
+        uint8_t wire[LOG_UART_WIRE_MAX];
+};
+
+/**
+ * @brief Initialise a serial sink, positioned at sequence number 0.
+ *
+ * @param u             Serial sink.
+ * @param tx            Transmit callback.
+ * @param user          Passed to the transmit callback.
+ * @param source        Identifier sent in every batch.
+ * @param min_level     Lowest level sent.
+ * @param module_mask   Modules sent, e.g. LOG_MODULES_ALL.
+ */
+void log_uart_init(struct log_uart *u, log_uart_tx_fn tx, void *user,
+                   uint32_t source, enum log_level min_level,
+                   uint32_t module_mask);
+
+/**
+ * @brief Start transmitting the next frame if the link is idle.
+ *
+ * @param u         Serial sink.
+ * @param ctx       Pointer to log context.
+ *
+ * @return          1 if a frame was handed to the transmit callback.
+ */
+uint8_t log_uart_poll(struct log_uart *u, const struct log_ctx *ctx);
+
+/**
+ * @brief Report completion of the frame in flight.
+ *
+ * Must not run concurrently with log_uart_poll(); from an interrupt, make
+ * sure the poll loop cannot be preempted mid-call, or defer the call.
+ *
+ * @param u         Serial sink.
+ * @param ok        1 if the frame went out, 0 to resend it.
+ */
+void log_uart_tx_done(struct log_uart *u, uint8_t ok);
+
+/**
+ * @brief Restart from a sequence number, e.g. after a link loss.
+ *
+ * Any frame in flight is abandoned. Entries the context has overwritten
+ * since are counted as dropped.
+ *
+ * @param u         Serial sink.
+ * @param seq       Next sequence number the receiver expects.
+ */
+void log_uart_resume(struct log_uart *u, uint32_t seq);
+
+/**
+ * @brief COBS-encode a buffer. No delimiter is appended.
+ *
+ * @param in        Data.
+ * @param len       Length of data.
+ * @param out       Destination, at least len + len / 254 + 1 bytes.
+ * @param cap       Size of destination.
+ *
+ * @return          Encoded length, or 0 if it does not fit.
+ */
+size_t log_cobs_encode(const uint8_t *in, size_t len, uint8_t *out,
+                       size_t cap);
+
+/**
+ * @brief Decode one COBS frame (without its delimiter).
+ *
+ * @param in        Encoded data.
+ * @param len       Length of encoded data.
+ * @param out       Destination.
+ * @param cap       Size of destination.
+ *
+ * @return          Decoded length, or 0 if malformed or too large.
+ */
+size_t log_cobs_decode(const uint8_t *in, size_t len, uint8_t *out,
+                       size_t cap);
+
+/**
+ * @brief Receiver side: decode and check a frame.
+ *
+ * @param in        Encoded frame, without the 0x00 delimiter.
+ * @param len       Length of encoded frame.
+ * @param out       Receives the batch header and records.
+ * @param cap       Size of out.
+ * @param b         Receives the batch header.
+ *
+ * @return          Length of the batch (header plus records), or 0 if the
+ *                  frame is malformed or fails its CRC.
+ */
+size_t log_uart_decode(const uint8_t *in, size_t len, uint8_t *out,
+                       size_t cap, struct log_batch *b);
+
+/**
+ * Close group: log_uart
+ * @}
+ */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* LOG_UART_H */
@@ -0,0 +1,130 @@
+/*
+ * @licence MIT
+ *
+ * @file: log_unix.h
+ */
+
+#ifndef LOG_UNIX_H
+#define LOG_UNIX_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "log.h"
+#include "log_export.h"
+#include "log_sink.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @defgroup log_unix Unix-Domain Socket Streaming (host only)
+ * @ingroup log_api
+ *
+ * @brief
+ *   Stream a context to a local collector as binary batches.
+ *
+ *   Each flush drains the context through a filtered sink into up to
+ *   LOG_UNIX_BATCHES batches (see log_export.h for the wire format) and
+ *   sends them together: one sendmmsg() for SOCK_SEQPACKET and SOCK_DGRAM,
+ *   one gathering sendmsg() for SOCK_STREAM, never raising SIGPIPE if the
+ *   collector has gone away. On SOCK_SEQPACKET and SOCK_DGRAM every
+ *   batch is one message; on SOCK_STREAM the length field of the batch
+ *   header delimits batches. If the socket cannot take everything, the sink
+ *   is rewound to the first unsent batch and the rest is retried on the
+ *   next flush. A batch cut short on SOCK_STREAM is kept, and its remaining
+ *   bytes are written first by the next flush, so the stream stays framed;
+ *   reconnecting discards them.
+ *
+ *   The log-collectd tool receives batches from any number of producers
+ *   and writes them into rotating export segments.
+ *
+ *   Requires a POSIX host; not part of the embedded library.
+ *
+ * @{
+ */
+
+#ifndef LOG_UNIX_BATCH_LEN
+#define LOG_UNIX_BATCH_LEN (4096u)
+#endif
+#ifndef LOG_UNIX_BATCHES
+#define LOG_UNIX_BATCHES (8u)
+#endif
+
+/**
+ * @brief Socket sink state.
+ */
+struct log_unix {
+        int fd;
+        int type;
+        uint32_t source;
+        struct log_sink sink;
+        struct log_batch_buf staging;
+        uint32_t batches; /**< Batches sent. */
+        size_t tail;      /**< Unsent bytes of a batch cut short, at buf[0]. */
+        uint8_t buf[LOG_UNIX_BATCHES][LOG_UNIX_BATCH_LEN];
+};
+
+/**
+ * @brief Connect a socket sink to a collector.
+ *
+ * @param u             Socket sink to initialise.
+ * @param path          Path of the collector socket.
+ * @param type          SOCK_SEQPACKET, SOCK_DGRAM or SOCK_STREAM.
+ * @param source        Identifier sent in every batch, e.g. the pid.
+ * @param min_level     Lowest level sent.
+ * @param module_mask   Modules sent, e.g. LOG_MODULES_ALL.
+ *
+ * @return          0 on success, -1 on error (errno is set).
+ */
+int log_unix_connect(struct log_unix *u, const char *path, int type,
+                     uint32_t source, enum log_level min_level,
+                     uint32_t module_mask);
+
+/**
+ * @brief Use an already connected socket, e.g. one end of a socketpair().
+ *
+ * Parameters as for log_unix_connect(). The sink takes ownership of fd.
+ */
+void log_unix_attach(struct log_unix *u, int fd, int type, uint32_t source,
+                     enum log_level min_level, uint32_t module_mask);
+
+/**
+ * @brief Send everything pending in the context.
+ *
+ * @param u         Socket sink.
+ * @param ctx       Pointer to log context.
+ *
+ * @return          Number of batches sent, or -1 on a socket error other
+ *                  than the socket being full (errno is set).
+ */
+int log_unix_flush(struct log_unix *u, const struct log_ctx *ctx);
+
+/**
+ * @brief Close the socket.
+ *
+ * @param u         Socket sink.
+ */
+void log_unix_close(struct log_unix *u);
+
+/**
+ * @brief Create a listening collector socket, replacing any stale one.
+ *
+ * @param path      Socket path.
+ * @param type      SOCK_SEQPACKET, SOCK_DGRAM or SOCK_STREAM.
+ *
+ * @return          Socket descriptor, or -1 on error (errno is set).
+ */
+int log_unix_listen(const char *path, int type);
+
+/**
+ * Close group: log_unix
+ * @}
+ */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* LOG_UNIX_H */
@@ -0,0 +1,141 @@
+/*
+ * @licence MIT
+ *
+ * @file: log_watch.h
+ */
+
+#ifndef LOG_WATCH_H
+#define LOG_WATCH_H
+
+#include <stdint.h>
+
+#include "log.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @defgroup log_watch Watches
+ * @ingroup log_api
+ *
+ * @brief
+ *   Callbacks fired as matching entries are written.
+ *
+ *   A watch selects entries by level, by module and optionally by a
+ *   substring of the message. Registering a watch folds its level and
+ *   module masks into a per-level module mask kept in the context, so
+ *   log_event() tests one bit before doing anything else; only entries
+ *   that pass it are compared with the individual watches, and only those
+ *   whose masks match have their message scanned. The substring is
+ *   compiled into a KMP automaton when the watch is initialised, so the
+ *   scan reads each message byte once.
+ *
+ *   A context without watches pays a single mask test per entry.
+ *
+ *   **Example Usage:**
+ *   @code
+ *   static struct log_watch can_fault, overcurrent;
+ *
+ *   log_watch_init(&can_fault, LOG_LEVEL_BIT(FAULT), LOG_MODULE_BIT(CAN),
+ *                  NULL, on_can_fault, NULL);
+ *   log_watch_init(&overcurrent, LOG_LEVELS_ALL, LOG_MODULES_ALL,
+ *                  "overcurrent", on_overcurrent, &motor);
+ *   log_watch_add(&my_log, &can_fault);
+ *   log_watch_add(&my_log, &overcurrent);
+ *   @endcode
+ *
+ * @{
+ */
+
+#ifndef LOG_WATCH_TEXT
+#define LOG_WATCH_TEXT (32u)
+#endif
+
+/**
+ * @brief Watch callback.
+ *
+ * Called from log_event() (or log_put_entry()) after the entry has been
+ * added, so the context is consistent, but the callback must not log to
+ * the same context.
+ *
+ * @param user      User pointer given to log_watch_init().
+ * @param e         Entry that matched.
+ * @param seq       Sequence number of the entry.
+ */
+typedef void (*log_watch_fn)(void *user, const struct log_entry *e,
+                             uint32_t seq);
+
+/**
+ * @brief Watch state. Fields may be read, but set them through the API.
+ */
+struct log_watch {
+        struct log_watch *next;
+        log_watch_fn fn;
+        void *user;
+        uint32_t module_mask; /**< LOG_MODULE_BIT() of matched modules. */
+        uint8_t level_mask;   /**< LOG_LEVEL_BIT() of matched levels. */
+        uint8_t text_len;     /**< 0 if the message is not examined. */
+        char text[LOG_WATCH_TEXT];
+        uint8_t fail[LOG_WATCH_TEXT]; /**< KMP failure function. */
+        uint32_t hits;                /**< Times the callback was called. */
+};
+
+/**
+ * @brief Initialise a watch.
+ *
+ * @param w             Watch to initialise.
+ * @param level_mask    Levels matched, e.g. LOG_LEVEL_BIT(FAULT).
+ * @param module_mask   Modules matched, e.g. LOG_MODULES_ALL.
+ * @param text          Substring the message must contain, or NULL.
+ * @param fn            Callback.
+ * @param user          Passed to the callback.
+ *
+ * @return              0 on success, -1 if w or fn is NULL or text is
+ *                      longer than LOG_WATCH_TEXT bytes.
+ */
+int log_watch_init(struct log_watch *w, uint8_t level_mask,
+                   uint32_t module_mask, const char *text, log_watch_fn fn,
+                   void *user);
+
+/**
+ * @brief Register a watch with a context.
+ *
+ * Not safe against concurrent logging to the same context.
+ *
+ * @param ctx       Pointer to log context.
+ * @param w         Initialised watch, not registered elsewhere.
+ */
+void log_watch_add(struct log_ctx *ctx, struct log_watch *w);
+
+/**
+ * @brief Unregister a watch.
+ *
+ * @param ctx       Pointer to log context.
+ * @param w         Watch registered with ctx.
+ */
+void log_watch_remove(struct log_ctx *ctx, struct log_watch *w);
+
+/**
+ * @brief Run the watches for a new entry.
+ *
+ * Called by the context once the entry passed the mask test; not needed
+ * by applications.
+ *
+ * @param ctx       Pointer to log context.
+ * @param e         Entry just added.
+ * @param seq       Its sequence number.
+ */
+void log_watch_run(const struct log_ctx *ctx, const struct log_entry *e,
+                   uint32_t seq);
+
+/**
+ * Close group: log_watch
+ * @}
+ */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* LOG_WATCH_H */
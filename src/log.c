@@ -1,9 +1,42 @@
 
 #include <stdarg.h>
+#include <stddef.h>
 #include <stdio.h>
 #include <string.h>
 
 #include "../include/log.h"
+#include "../include/log_layout.h"
+#include "../include/log_profile.h"
+#include "../include/log_rate.h"
+#include "../include/log_watch.h"
+
+#if LOG_STREAM && defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+/* Call site attributed by the profiler. */
+#if LOG_PROFILE && defined(__GNUC__)
+#define CALLER() __builtin_return_address(0)
+#else
+#define CALLER() NULL
+#endif
+
+/* Marks a context disabled by log_init(ctx, NULL); never called. */
+static uint32_t
+timestamp_disabled(void)
+{
+        return 0u;
+}
+
+#if defined(__GNUC__)
+__attribute__((weak))
+#endif
+uint32_t
+log_timestamp_default(void)
+{
+        static uint32_t ticks = 0u;
+        return ticks++;
+}
 
 void
 log_init(struct log_ctx *ctx, uint32_t (*timestamp_fn)(void))
@@ -11,35 +44,509 @@ log_init(struct log_ctx *ctx, uint32_t (*timestamp_fn)(void))
         if (ctx == NULL) {
                 return;
         }
-        ctx->head = 0u;
-        ctx->count = 0u;
-        ctx->timestamp_fn = timestamp_fn;
+        ctx->layout = &log_ctx_layout;
+        ctx->gen = ((ctx->gen + 1u) != 0u) ? (ctx->gen + 1u) : 1u;
+        ctx->timestamp_fn = (timestamp_fn != NULL) ? timestamp_fn
+                                                   : timestamp_disabled;
+        ctx->max_age = 0u;
+        ctx->seq = 0u;
+        ctx->pinned = 0u;
+        ctx->watch = NULL;
+        ctx->rate = NULL;
+#if LOG_PROFILE
+        ctx->profile = NULL;
+        ctx->tap = NULL;
+#endif
+        (void)memset((void *)ctx->watch_mask, 0, sizeof(ctx->watch_mask));
+#if LOG_STREAM
+        ctx->stream = 0u;
+#endif
+#if LOG_MODULE_QUOTA
+        (void)memset((void *)ctx->quota, 0, sizeof(ctx->quota));
+#endif
         (void)memset((void *)ctx->buffer, 0, sizeof(ctx->buffer));
+        log_clear(ctx);
 }
 
 void
-log_event(struct log_ctx *ctx, enum log_level level, const char *fmt, ...)
+log_clear(struct log_ctx *ctx)
 {
-        if ((ctx == NULL) || (ctx->timestamp_fn == NULL) || (fmt == NULL)) {
+        if (ctx == NULL) {
                 return;
         }
+        ctx->head = 0u;
+        ctx->count = 0u;
+        ctx->pin_seq = ctx->seq;
+        for (uint16_t l = 0u; l < LOG_LEVELS; ++l) {
+                ctx->level_count[l] = 0u;
+        }
+#if LOG_MODULE_QUOTA
+        ctx->holes = 0u;
+        for (uint8_t m = 0u; m < LOG_MODULES; ++m) {
+                ctx->module_count[m] = 0u;
+        }
+#endif
+}
 
-        struct log_entry *entry = &ctx->buffer[ctx->head];
-        entry->timestamp = ctx->timestamp_fn();
-        entry->level = (uint16_t)level;
+/* Pinned entries held: the first ones written, never dropped. */
+static uint16_t
+pinned_count(const struct log_ctx *ctx)
+{
+        return (ctx->count < ctx->pinned) ? ctx->count : ctx->pinned;
+}
+
+/* Slot of the idx-th oldest entry; slots below pinned never wrap. */
+static uint16_t
+entry_slot(const struct log_ctx *ctx, uint16_t idx)
+{
+        uint16_t npin = pinned_count(ctx);
+        if (idx < npin) {
+                return idx;
+        }
+        uint32_t ring = (uint32_t)LOG_ENTRIES - ctx->pinned;
+        uint32_t back = (uint32_t)ctx->count - idx;
+        return (uint16_t)(ctx->pinned
+                          + (((uint32_t)ctx->head - ctx->pinned + ring - back)
+                             % ring));
+}
+
+#if LOG_LEVEL_INDEX || LOG_MODULE_QUOTA
+/* Intrusive lists threaded through next[]; a list is empty when its count
+ * is 0, so first and last need no sentinel. */
+static void
+list_append(uint16_t *first, uint16_t *last, uint16_t *next, uint16_t n,
+            uint16_t slot)
+{
+        next[slot] = LOG_IDX_NONE;
+        if (n == 0u) {
+                *first = slot;
+        } else {
+                next[*last] = slot;
+        }
+        *last = slot;
+}
+
+/* Pinned entries may precede slot, so this can walk. */
+static void
+list_unlink(uint16_t *first, uint16_t *last, uint16_t *next, uint16_t slot)
+{
+        if (*first == slot) {
+                *first = next[slot];
+                return;
+        }
+        uint16_t prev = *first;
+        while (next[prev] != slot) {
+                prev = next[prev];
+        }
+        next[prev] = next[slot];
+        if (*last == slot) {
+                *last = prev;
+        }
+}
+#endif
 
+#if LOG_LEVEL_INDEX && LOG_MODULE_QUOTA
+/* Holes are punched anywhere in the ring, so the level lists are doubly
+ * linked there and unlinking never walks. */
+static void
+level_unlink(struct log_ctx *ctx, uint16_t level, uint16_t slot)
+{
+        uint16_t prev = ctx->level_prev[slot];
+        uint16_t next = ctx->level_next[slot];
+        if (prev == LOG_IDX_NONE) {
+                ctx->level_first[level] = next;
+        } else {
+                ctx->level_next[prev] = next;
+        }
+        if (next == LOG_IDX_NONE) {
+                ctx->level_last[level] = prev;
+        } else {
+                ctx->level_prev[next] = prev;
+        }
+}
+#endif
+
+/* Remove an entry from the per-level and per-module bookkeeping. */
+static void
+index_remove(struct log_ctx *ctx, uint16_t slot)
+{
+#if LOG_STREAM
+        /* The tag spares a read of the slot, which may be cold. */
+        uint16_t level = ctx->slot_tag[slot] & 3u;
+#else
+        uint16_t level = ctx->buffer[slot].level;
+#endif
+#if LOG_LEVEL_INDEX && LOG_MODULE_QUOTA
+        level_unlink(ctx, level, slot);
+#elif LOG_LEVEL_INDEX
+        list_unlink(&ctx->level_first[level], &ctx->level_last[level],
+                    ctx->level_next, slot);
+#endif
+        ctx->level_count[level]--;
+#if LOG_MODULE_QUOTA
+#if LOG_STREAM
+        uint8_t module = (uint8_t)(ctx->slot_tag[slot] >> 2);
+#else
+        uint8_t module = ctx->buffer[slot].module;
+#endif
+        list_unlink(&ctx->module_first[module], &ctx->module_last[module],
+                    ctx->module_next, slot);
+        ctx->module_count[module]--;
+#endif
+}
+
+static void
+index_append(struct log_ctx *ctx, uint16_t slot, uint16_t level,
+             uint8_t module)
+{
+#if LOG_LEVEL_INDEX
+#if LOG_MODULE_QUOTA
+        ctx->level_prev[slot] = (ctx->level_count[level] > 0u)
+                                    ? ctx->level_last[level]
+                                    : LOG_IDX_NONE;
+#endif
+        list_append(&ctx->level_first[level], &ctx->level_last[level],
+                    ctx->level_next, ctx->level_count[level], slot);
+#endif
+        ctx->level_count[level]++;
+#if LOG_MODULE_QUOTA
+        list_append(&ctx->module_first[module], &ctx->module_last[module],
+                    ctx->module_next, ctx->module_count[module], slot);
+        ctx->module_count[module]++;
+#endif
+#if LOG_STREAM
+        ctx->slot_tag[slot] = (uint8_t)(level | ((uint16_t)module << 2));
+#endif
+        (void)slot;
+        (void)module;
+}
+
+#if LOG_MODULE_QUOTA
+_Static_assert((LOG_QUOTA_SLACK > 0u) && (LOG_QUOTA_SLACK < LOG_ENTRIES),
+               "LOG_QUOTA_SLACK must leave room for entries");
+
+static uint8_t
+is_hole(const struct log_ctx *ctx, uint16_t slot)
+{
+        return (ctx->buffer[slot].level == LOG_LEVEL_HOLE) ? 1u : 0u;
+}
+
+/* Holes reaching the front of the ring are given back at once, so the
+ * oldest ring entry is never one. */
+static void
+reclaim(struct log_ctx *ctx)
+{
+        while ((ctx->holes > 0u) && (ctx->count > ctx->pinned)
+               && (is_hole(ctx, entry_slot(ctx, ctx->pinned)) != 0u)) {
+                ctx->holes--;
+                ctx->count--;
+        }
+}
+#endif
+
+/* Drop the oldest ring entry. */
+static void
+drop_oldest(struct log_ctx *ctx)
+{
+        index_remove(ctx, entry_slot(ctx, pinned_count(ctx)));
+        ctx->count--;
+#if LOG_MODULE_QUOTA
+        reclaim(ctx);
+#endif
+}
+
+#if LOG_MODULE_QUOTA
+/* Oldest ring entry of the module furthest over its quota, or LOG_IDX_NONE
+ * to overwrite the oldest entry as usual. */
+static uint16_t
+quota_victim(const struct log_ctx *ctx)
+{
+        uint16_t npin = pinned_count(ctx);
+        uint8_t oldest = ctx->buffer[entry_slot(ctx, npin)].module;
+        if (ctx->module_count[oldest] > ctx->quota[oldest]) {
+                return LOG_IDX_NONE;
+        }
+        uint8_t best = LOG_MODULES;
+        uint16_t excess = 0u;
+        for (uint8_t m = 0u; m < LOG_MODULES; ++m) {
+                if (ctx->module_count[m] > (ctx->quota[m] + excess)) {
+                        excess = (uint16_t)(ctx->module_count[m]
+                                            - ctx->quota[m]);
+                        best = m;
+                }
+        }
+        if (best == LOG_MODULES) {
+                return LOG_IDX_NONE;
+        }
+        uint16_t slot = ctx->module_first[best];
+        for (uint16_t i = 0u; i < ctx->module_count[best]; ++i) {
+                if (slot >= npin) {
+                        return slot;
+                }
+                slot = ctx->module_next[slot];
+        }
+        return LOG_IDX_NONE;
+}
+
+/* Once LOG_ENTRIES - LOG_QUOTA_SLACK entries are held and the oldest is
+ * protected, over-quota modules give up entries as holes. The holes keep
+ * their timestamp and sequence number, so the ring stays searchable. */
+static void
+quota_evict(struct log_ctx *ctx)
+{
+        while (((uint16_t)(ctx->count - ctx->holes)
+                >= (LOG_ENTRIES - LOG_QUOTA_SLACK))
+               && (ctx->count > ctx->pinned)) {
+                uint16_t slot = quota_victim(ctx);
+                if (slot == LOG_IDX_NONE) {
+                        return;
+                }
+                index_remove(ctx, slot);
+                ctx->buffer[slot].level = LOG_LEVEL_HOLE;
+                ctx->holes++;
+        }
+}
+
+/* Close every hole in one pass, moving the ring entries behind them to the
+ * front in write order, and rebuild the lists. */
+static void
+compact(struct log_ctx *ctx)
+{
+        uint16_t npin = pinned_count(ctx);
+        uint32_t ring = (uint32_t)LOG_ENTRIES - ctx->pinned;
+        uint32_t tail = (uint32_t)entry_slot(ctx, npin) - ctx->pinned;
+        uint16_t n = 0u;
+        for (uint16_t i = npin; i < ctx->count; ++i) {
+                uint16_t src = entry_slot(ctx, i);
+                if (is_hole(ctx, src) != 0u) {
+                        continue;
+                }
+                uint16_t dst = (uint16_t)(ctx->pinned + ((tail + n) % ring));
+                if (dst != src) {
+                        ctx->buffer[dst] = ctx->buffer[src];
+                        ctx->slot_seq[dst] = ctx->slot_seq[src];
+                }
+                n++;
+        }
+        ctx->head = (uint16_t)(ctx->pinned + ((tail + n) % ring));
+        ctx->count = (uint16_t)(npin + n);
+        ctx->holes = 0u;
+
+        for (uint16_t l = 0u; l < LOG_LEVELS; ++l) {
+                ctx->level_count[l] = 0u;
+        }
+        for (uint8_t m = 0u; m < LOG_MODULES; ++m) {
+                ctx->module_count[m] = 0u;
+        }
+        for (uint16_t i = 0u; i < ctx->count; ++i) {
+                uint16_t slot = entry_slot(ctx, i);
+                index_append(ctx, slot, ctx->buffer[slot].level,
+                             ctx->buffer[slot].module);
+        }
+}
+#endif
+
+/* Free one slot of a full buffer. */
+static void
+make_room(struct log_ctx *ctx)
+{
+#if LOG_MODULE_QUOTA
+        if (ctx->holes > 0u) {
+                compact(ctx);
+                return;
+        }
+#endif
+        drop_oldest(ctx);
+}
+
+static void vevent(struct log_ctx *ctx, const void *site, uint8_t module,
+                   enum log_level level, const char *fmt, va_list args);
+
+void
+log_event(struct log_ctx *ctx, enum log_level level, const char *fmt, ...)
+{
         va_list args;
         va_start(args, fmt);
-        (void)vsnprintf(entry->msg, (size_t)LOG_MSG_LEN, fmt, args);
+        vevent(ctx, CALLER(), 0u, level, fmt, args);
         va_end(args);
+}
+
+void
+log_event_mod(struct log_ctx *ctx, uint8_t module, enum log_level level,
+              const char *fmt, ...)
+{
+        va_list args;
+        va_start(args, fmt);
+        vevent(ctx, CALLER(), module, level, fmt, args);
+        va_end(args);
+}
+
+#if LOG_STREAM
+_Static_assert((LOG_LEVELS <= 4u) && (LOG_MODULES <= 64u),
+               "level and module must fit in a slot tag");
+
+/* Copy an entry to its slot without allocating cache lines. Entries are
+ * only 4 byte aligned, which rules out the 16 byte MOVNTDQ. */
+static void
+entry_stream(struct log_entry *dst, const struct log_entry *src)
+{
+#if defined(__SSE2__)
+        int *d = (int *)(void *)dst;
+        const int *s = (const int *)(const void *)src;
+        for (size_t i = 0u; i < (sizeof(*dst) / sizeof(int)); ++i) {
+                _mm_stream_si32(&d[i], s[i]);
+        }
+#elif defined(__aarch64__)
+        uint32_t *d = (uint32_t *)(void *)dst;
+        const uint32_t *s = (const uint32_t *)(const void *)src;
+        size_t n = sizeof(*dst) / sizeof(uint32_t);
+        for (size_t i = 0u; (i + 1u) < n; i += 2u) {
+                __asm__ volatile("stnp %w1, %w2, [%0]"
+                                 :
+                                 : "r"(&d[i]), "r"(s[i]), "r"(s[i + 1u])
+                                 : "memory");
+        }
+        if ((n % 2u) != 0u) {
+                d[n - 1u] = s[n - 1u];
+        }
+#else
+        *dst = *src;
+#endif
+}
+#endif
 
+/* Slot the next entry goes to, making room if the buffer is full. */
+static struct log_entry *
+append_begin(struct log_ctx *ctx)
+{
+        if (ctx->layout == NULL) {
+                ctx->layout = &log_ctx_layout;
+        }
+#if LOG_MODULE_QUOTA
+        quota_evict(ctx);
+#endif
+        if (ctx->count >= LOG_ENTRIES) {
+                make_room(ctx);
+        }
+        return &ctx->buffer[ctx->head];
+}
+
+/* Commit the entry filled in after append_begin(). Level and module are
+ * passed in: reading a streamed slot back would stall on memory. */
+static void
+append_end(struct log_ctx *ctx, uint16_t level, uint8_t module)
+{
+        index_append(ctx, ctx->head, level, module);
+#if LOG_MODULE_QUOTA
+        ctx->slot_seq[ctx->head] = ctx->seq;
+#endif
         ctx->head++;
         if (ctx->head >= LOG_ENTRIES) {
-                ctx->head = 0u;
+                ctx->head = ctx->pinned;
+        }
+        ctx->count++;
+        ctx->seq++;
+}
+
+/* Rate counters and watches see the entry once it is in the buffer. */
+static void
+append_notify(struct log_ctx *ctx, const struct log_entry *e)
+{
+        for (struct log_rate *r = ctx->rate; r != NULL; r = r->next) {
+                log_rate_update(r, e);
+        }
+        if ((ctx->watch_mask[e->level] & LOG_MODULE_BIT(e->module)) != 0u) {
+                log_watch_run(ctx, e, ctx->seq - 1u);
+        }
+}
+
+static void
+vevent(struct log_ctx *ctx, const void *site, uint8_t module,
+       enum log_level level, const char *fmt, va_list args)
+{
+        if ((ctx == NULL) || (ctx->timestamp_fn == timestamp_disabled)
+            || (fmt == NULL) || ((uint32_t)level >= LOG_LEVELS)
+            || (module >= LOG_MODULES)) {
+                return;
+        }
+        struct log_entry *slot = append_begin(ctx);
+        struct log_entry *entry = slot;
+#if LOG_STREAM
+        struct log_entry local;
+        if (ctx->stream != 0u) {
+                entry = &local;
+        }
+#endif
+        entry->timestamp = (ctx->timestamp_fn != NULL)
+                               ? ctx->timestamp_fn()
+                               : log_timestamp_default();
+        entry->level = (uint16_t)level;
+        entry->module = module;
+#if LOG_PROFILE
+        struct log_tap *tap = ctx->tap;
+        if (tap != NULL) {
+                va_list copy;
+                va_copy(copy, args);
+                tap->fn(tap->user, site, module, level, fmt, copy);
+                va_end(copy);
         }
-        if (ctx->count < LOG_ENTRIES) {
-                ctx->count++;
+        struct log_profile *prof = ctx->profile;
+        uint64_t t0 = (prof != NULL) ? log_profile_cycles() : 0u;
+        int len = vsnprintf(entry->msg, (size_t)LOG_MSG_LEN, fmt, args);
+        if (prof != NULL) {
+                log_profile_record(prof, site, fmt, log_profile_cycles() - t0,
+                                   len);
         }
+#else
+        (void)site;
+        (void)vsnprintf(entry->msg, (size_t)LOG_MSG_LEN, fmt, args);
+#endif
+#if LOG_STREAM
+        if (entry == &local) {
+                /* Streamed whole: clear what follows the message. */
+                size_t n = strlen(local.msg);
+                (void)memset(&local.msg[n], 0,
+                             sizeof(local) - offsetof(struct log_entry, msg)
+                                 - n);
+                entry_stream(slot, &local);
+        }
+#endif
+        append_end(ctx, (uint16_t)level, module);
+        append_notify(ctx, entry);
+}
+
+void
+log_vevent(struct log_ctx *ctx, uint8_t module, enum log_level level,
+           const char *fmt, va_list args)
+{
+        vevent(ctx, CALLER(), module, level, fmt, args);
+}
+
+void
+log_put_entry(struct log_ctx *ctx, const struct log_entry *e)
+{
+        if ((ctx == NULL) || (ctx->timestamp_fn == timestamp_disabled)
+            || (e == NULL) || ((uint32_t)e->level >= LOG_LEVELS)
+            || (e->module >= LOG_MODULES)) {
+                return;
+        }
+        struct log_entry *slot = append_begin(ctx);
+        struct log_entry *entry = slot;
+#if LOG_STREAM
+        struct log_entry local;
+        if (ctx->stream != 0u) {
+                entry = &local;
+        }
+#endif
+        *entry = *e;
+        entry->msg[LOG_MSG_LEN - 1u] = '\0';
+#if LOG_STREAM
+        if (entry == &local) {
+                entry_stream(slot, &local);
+        }
+#endif
+        append_end(ctx, e->level, e->module);
+        append_notify(ctx, entry);
 }
 
 uint16_t
@@ -57,12 +564,218 @@ log_get_entry(const struct log_ctx *ctx, uint16_t idx)
         if ((ctx == NULL) || (idx >= ctx->count)) {
                 return NULL;
         }
-        uint16_t phys_idx =
-            (uint16_t)((ctx->head + LOG_ENTRIES - ctx->count + idx)
-                       % LOG_ENTRIES);
-        return &ctx->buffer[phys_idx];
+        const struct log_entry *e = &ctx->buffer[entry_slot(ctx, idx)];
+#if LOG_MODULE_QUOTA
+        if (e->level == LOG_LEVEL_HOLE) {
+                return NULL;
+        }
+#endif
+        return e;
+}
+
+uint8_t
+log_get_spans(const struct log_ctx *ctx,
+              const struct log_entry *span[LOG_SPANS_MAX],
+              uint16_t len[LOG_SPANS_MAX])
+{
+        if ((ctx == NULL) || (span == NULL) || (len == NULL)
+            || (ctx->count == 0u)) {
+                return 0u;
+        }
+        uint8_t n = 0u;
+        uint16_t npin = pinned_count(ctx);
+        if (npin > 0u) {
+                span[n] = &ctx->buffer[0];
+                len[n] = npin;
+                n++;
+        }
+        uint16_t rest = (uint16_t)(ctx->count - npin);
+        if (rest == 0u) {
+                return n;
+        }
+        uint16_t first = entry_slot(ctx, npin);
+        if (((uint32_t)first + rest) <= LOG_ENTRIES) {
+                span[n] = &ctx->buffer[first];
+                len[n] = rest;
+                return (uint8_t)(n + 1u);
+        }
+        span[n] = &ctx->buffer[first];
+        len[n] = (uint16_t)(LOG_ENTRIES - first);
+        span[n + 1u] = &ctx->buffer[ctx->pinned];
+        len[n + 1u] = (uint16_t)(rest - len[n]);
+        return (uint8_t)(n + 2u);
+}
+
+uint8_t
+log_set_pinned(struct log_ctx *ctx, uint16_t k)
+{
+        if ((ctx == NULL) || (k >= LOG_ENTRIES) || (ctx->count > k)
+            || ((ctx->seq - ctx->pin_seq) != ctx->count)) {
+                return 0u;
+        }
+        ctx->pinned = k;
+        return 1u;
+}
+
+uint16_t
+log_get_pinned(const struct log_ctx *ctx, uint32_t *seq)
+{
+        if (ctx == NULL) {
+                return 0u;
+        }
+        if (seq != NULL) {
+                *seq = ctx->pin_seq;
+        }
+        return pinned_count(ctx);
+}
+
+uint32_t
+log_get_seq(const struct log_ctx *ctx)
+{
+        if (ctx == NULL) {
+                return 0u;
+        }
+        return ctx->seq;
+}
+
+uint32_t
+log_get_seq_at(const struct log_ctx *ctx, uint16_t idx)
+{
+        if (ctx == NULL) {
+                return 0u;
+        }
+        uint16_t npin = pinned_count(ctx);
+        if (idx < npin) {
+                return ctx->pin_seq + idx;
+        }
+        if (idx >= ctx->count) {
+                return ctx->seq;
+        }
+#if LOG_MODULE_QUOTA
+        return ctx->slot_seq[entry_slot(ctx, idx)];
+#else
+        return ctx->seq - ((uint32_t)ctx->count - idx);
+#endif
+}
+
+const struct log_entry *
+log_get_entry_seq(const struct log_ctx *ctx, uint32_t seq)
+{
+        if (ctx == NULL) {
+                return NULL;
+        }
+        uint16_t npin = pinned_count(ctx);
+        if ((seq - ctx->pin_seq) < npin) {
+                return &ctx->buffer[seq - ctx->pin_seq];
+        }
+#if LOG_MODULE_QUOTA
+        /* Evictions leave gaps: search the ring, which is in seq order. */
+        uint16_t lo = npin;
+        uint16_t hi = ctx->count;
+        while (lo < hi) {
+                uint16_t mid = (uint16_t)(lo + ((hi - lo) / 2u));
+                uint16_t slot = entry_slot(ctx, mid);
+                int32_t d = (int32_t)(ctx->slot_seq[slot] - seq);
+                if (d == 0) {
+                        return (is_hole(ctx, slot) == 0u) ? &ctx->buffer[slot]
+                                                          : NULL;
+                }
+                if (d < 0) {
+                        lo = (uint16_t)(mid + 1u);
+                } else {
+                        hi = mid;
+                }
+        }
+        return NULL;
+#else
+        uint32_t back = ctx->seq - seq;
+        if ((back == 0u) || (back > ((uint32_t)ctx->count - npin))) {
+                return NULL;
+        }
+        return log_get_entry(ctx, (uint16_t)(ctx->count - back));
+#endif
+}
+
+uint16_t
+log_count_level(const struct log_ctx *ctx, enum log_level level)
+{
+        if ((ctx == NULL) || ((uint32_t)level >= LOG_LEVELS)) {
+                return 0u;
+        }
+        return ctx->level_count[level];
+}
+
+#if LOG_LEVEL_INDEX
+const struct log_entry *
+log_level_first(const struct log_ctx *ctx, enum log_level level, uint16_t *it)
+{
+        if ((ctx == NULL) || (it == NULL) || ((uint32_t)level >= LOG_LEVELS)) {
+                return NULL;
+        }
+        if (ctx->level_count[level] == 0u) {
+                *it = LOG_IDX_NONE;
+                return NULL;
+        }
+        *it = ctx->level_first[level];
+        return &ctx->buffer[*it];
+}
+
+const struct log_entry *
+log_level_next(const struct log_ctx *ctx, uint16_t *it)
+{
+        if ((ctx == NULL) || (it == NULL) || (*it >= LOG_ENTRIES)) {
+                return NULL;
+        }
+        *it = ctx->level_next[*it];
+        return (*it == LOG_IDX_NONE) ? NULL : &ctx->buffer[*it];
+}
+#endif
+
+#if LOG_MODULE_QUOTA
+uint8_t
+log_set_quota(struct log_ctx *ctx, uint8_t module, uint16_t slots)
+{
+        if ((ctx == NULL) || (module >= LOG_MODULES)) {
+                return 0u;
+        }
+        ctx->quota[module] = slots;
+        return 1u;
+}
+
+uint16_t
+log_count_module(const struct log_ctx *ctx, uint8_t module)
+{
+        if ((ctx == NULL) || (module >= LOG_MODULES)) {
+                return 0u;
+        }
+        return ctx->module_count[module];
+}
+
+const struct log_entry *
+log_module_first(const struct log_ctx *ctx, uint8_t module, uint16_t *it)
+{
+        if ((ctx == NULL) || (it == NULL) || (module >= LOG_MODULES)) {
+                return NULL;
+        }
+        if (ctx->module_count[module] == 0u) {
+                *it = LOG_IDX_NONE;
+                return NULL;
+        }
+        *it = ctx->module_first[module];
+        return &ctx->buffer[*it];
 }
 
+const struct log_entry *
+log_module_next(const struct log_ctx *ctx, uint16_t *it)
+{
+        if ((ctx == NULL) || (it == NULL) || (*it >= LOG_ENTRIES)) {
+                return NULL;
+        }
+        *it = ctx->module_next[*it];
+        return (*it == LOG_IDX_NONE) ? NULL : &ctx->buffer[*it];
+}
+#endif
+
 const struct log_entry *
 log_get_buffer(const struct log_ctx *ctx, uint16_t *count)
 {
@@ -77,3 +790,98 @@ log_get_buffer(const struct log_ctx *ctx, uint16_t *count)
         }
         return ctx->buffer;
 }
+
+/* Index of the first ring entry with timestamp >= t, comparing across wrap. */
+static uint16_t
+lower_bound(const struct log_ctx *ctx, uint32_t t)
+{
+        uint16_t lo = pinned_count(ctx);
+        uint16_t hi = ctx->count;
+        while (lo < hi) {
+                uint16_t mid = (uint16_t)(lo + ((hi - lo) / 2u));
+                /* Holes keep their timestamp. */
+                const struct log_entry *e = &ctx->buffer[entry_slot(ctx, mid)];
+                if ((int32_t)(e->timestamp - t) < 0) {
+                        lo = (uint16_t)(mid + 1u);
+                } else {
+                        hi = mid;
+                }
+        }
+        return lo;
+}
+
+uint8_t
+log_set_streaming(struct log_ctx *ctx, uint8_t on)
+{
+        if (ctx == NULL) {
+                return 0u;
+        }
+#if LOG_STREAM
+        ctx->stream = (on != 0u) ? 1u : 0u;
+#if defined(__SSE2__) || defined(__aarch64__)
+        return ctx->stream;
+#else
+        return 0u;
+#endif
+#else
+        (void)on;
+        return 0u;
+#endif
+}
+
+void
+log_stream_fence(void)
+{
+#if LOG_STREAM && defined(__SSE2__)
+        _mm_sfence();
+#elif LOG_STREAM && defined(__aarch64__)
+        __asm__ volatile("dmb ishst" ::: "memory");
+#endif
+}
+
+void
+log_set_retention(struct log_ctx *ctx, uint32_t max_age)
+{
+        if (ctx == NULL) {
+                return;
+        }
+        ctx->max_age = max_age;
+}
+
+uint16_t
+log_first_live(const struct log_ctx *ctx)
+{
+        if (ctx == NULL) {
+                return 0u;
+        }
+        if ((ctx->max_age == 0u) || (ctx->timestamp_fn == timestamp_disabled)
+            || (ctx->count == 0u)) {
+                return pinned_count(ctx);
+        }
+        /* The default clock is shared and advances on every read: go by
+         * the newest entry instead. */
+        uint32_t now;
+        if (ctx->timestamp_fn != NULL) {
+                now = ctx->timestamp_fn();
+        } else {
+                now = ctx->buffer[entry_slot(ctx,
+                                             (uint16_t)(ctx->count - 1u))]
+                          .timestamp;
+        }
+        return lower_bound(ctx, now - ctx->max_age);
+}
+
+uint16_t
+log_trim_before(struct log_ctx *ctx, uint32_t t)
+{
+        if (ctx == NULL) {
+                return 0u;
+        }
+        uint16_t keep = (uint16_t)(ctx->count - lower_bound(ctx, t));
+        uint16_t n = 0u;
+        while ((uint16_t)(ctx->count - pinned_count(ctx)) > keep) {
+                drop_oldest(ctx);
+                n++;
+        }
+        return n;
+}
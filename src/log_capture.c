@@ -0,0 +1,593 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "../include/log_capture.h"
+
+#if LOG_CAPTURE_ARGS > 8u
+#error "log_replay_emit() passes at most 8 arguments"
+#endif
+
+/* Precision of a string conversion, besides a fixed value. */
+#define PREC_NONE (-1)
+#define PREC_ARG  (-2)
+
+/* Longest record: tag, address or delta, level and module, arguments. */
+#define EVENT_MAX (3u + 10u + 1u + (LOG_CAPTURE_ARGS * 10u))
+#define DEF_MAX   (3u + 10u + 2u + LOG_CAPTURE_FMT_MAX)
+
+static int
+write_all(int fd, const uint8_t *buf, size_t len)
+{
+        while (len > 0u) {
+                ssize_t n = write(fd, buf, len);
+                if (n < 0) {
+                        if (errno == EINTR) {
+                                continue;
+                        }
+                        return -1;
+                }
+                buf += n;
+                len -= (size_t)n;
+        }
+        return 0;
+}
+
+static uint8_t
+is_signed(uint8_t a)
+{
+        return (uint8_t)((a == LOG_ARG_INT) || (a == LOG_ARG_LONG)
+                         || (a == LOG_ARG_LLONG) || (a == LOG_ARG_INTMAX)
+                         || (a == LOG_ARG_PTRDIFF));
+}
+
+static int64_t
+unzigzag(uint64_t v)
+{
+        return (int64_t)(v >> 1) ^ -(int64_t)(v & 1u);
+}
+
+static uint8_t
+integer(char conv, char len1, char len2, uint8_t *a)
+{
+        static const uint8_t sig[] = { LOG_ARG_INT, LOG_ARG_LONG,
+                                       LOG_ARG_LLONG, LOG_ARG_INTMAX,
+                                       LOG_ARG_SIZE, LOG_ARG_PTRDIFF };
+        static const uint8_t uns[] = { LOG_ARG_UINT, LOG_ARG_ULONG,
+                                       LOG_ARG_ULLONG, LOG_ARG_UINTMAX,
+                                       LOG_ARG_SIZE, LOG_ARG_PTRDIFF };
+        uint32_t k;
+        if ((len1 == 'l') && (len2 == 'l')) {
+                k = 2u;
+        } else if (len1 == 'l') {
+                k = 1u;
+        } else if (len1 == 'q') {
+                k = 2u;
+        } else if (len1 == 'j') {
+                k = 3u;
+        } else if (len1 == 'z') {
+                k = 4u;
+        } else if (len1 == 't') {
+                k = 5u;
+        } else if ((len1 == '\0') || (len1 == 'h')) {
+                k = 0u;
+        } else {
+                return 0u;
+        }
+        *a = ((conv == 'd') || (conv == 'i')) ? sig[k] : uns[k];
+        return 1u;
+}
+
+/*
+ * The arguments a format consumes, with the precision of each string.
+ * Returns their number, or -1 if the format cannot be captured.
+ */
+static int
+parse(const char *fmt, uint8_t *shape, int32_t *prec)
+{
+        int n = 0;
+        for (const char *f = fmt; *f != '\0'; ++f) {
+                if (*f != '%') {
+                        continue;
+                }
+                if (*++f == '%') {
+                        continue;
+                }
+                int32_t p = PREC_NONE;
+                while ((*f != '\0') && (strchr("-+ #0'", *f) != NULL)) {
+                        f++;
+                }
+                if (*f == '*') {
+                        if (n >= (int)LOG_CAPTURE_ARGS) {
+                                return -1;
+                        }
+                        shape[n] = LOG_ARG_INT;
+                        prec[n++] = PREC_NONE;
+                        f++;
+                } else {
+                        while ((*f >= '0') && (*f <= '9')) {
+                                f++;
+                        }
+                        if (*f == '$') {
+                                return -1;
+                        }
+                }
+                if (*f == '.') {
+                        f++;
+                        if (*f == '*') {
+                                if (n >= (int)LOG_CAPTURE_ARGS) {
+                                        return -1;
+                                }
+                                shape[n] = LOG_ARG_INT;
+                                prec[n++] = PREC_NONE;
+                                p = PREC_ARG;
+                                f++;
+                        } else {
+                                p = 0;
+                                while ((*f >= '0') && (*f <= '9')) {
+                                        p = (p * 10) + (*f++ - '0');
+                                }
+                        }
+                }
+                char len1 = '\0';
+                char len2 = '\0';
+                if ((*f != '\0') && (strchr("hlqjztL", *f) != NULL)) {
+                        len1 = *f++;
+                        if (((len1 == 'h') || (len1 == 'l')) && (*f == len1)) {
+                                len2 = *f++;
+                        }
+                }
+                uint8_t a;
+                switch (*f) {
+                case 'd': case 'i': case 'u': case 'o': case 'x': case 'X':
+                        if (integer(*f, len1, len2, &a) == 0u) {
+                                return -1;
+                        }
+                        break;
+                case 'c':
+                        a = LOG_ARG_INT;
+                        if (len1 != '\0') {
+                                return -1;
+                        }
+                        break;
+                case 's':
+                        a = LOG_ARG_STR;
+                        if (len1 != '\0') {
+                                return -1;
+                        }
+                        break;
+                case 'p':
+                        a = LOG_ARG_PTR;
+                        break;
+                case 'f': case 'F': case 'e': case 'E':
+                case 'g': case 'G': case 'a': case 'A':
+                        a = LOG_ARG_DOUBLE;
+                        if ((len1 != '\0') && (len1 != 'l')) {
+                                return -1;
+                        }
+                        break;
+                default:
+                        return -1;
+                }
+                if (n >= (int)LOG_CAPTURE_ARGS) {
+                        return -1;
+                }
+                shape[n] = a;
+                prec[n++] = p;
+        }
+        return n;
+}
+
+int
+log_capture_flush(struct log_capture *c)
+{
+        if (c == NULL) {
+                errno = EINVAL;
+                return -1;
+        }
+        if ((c->error == 0) && (c->len > 0u)
+            && (write_all(c->fd, c->buf, c->len) != 0)) {
+                c->error = errno;
+        }
+        c->len = 0u;
+        if (c->error != 0) {
+                errno = c->error;
+                return -1;
+        }
+        return 0;
+}
+
+#if LOG_PROFILE
+static uint64_t
+now_ns(void)
+{
+        struct timespec ts;
+        (void)clock_gettime(CLOCK_MONOTONIC, &ts);
+        return ((uint64_t)ts.tv_sec * 1000000000u) + (uint64_t)ts.tv_nsec;
+}
+
+static uint8_t *
+put_varint(uint8_t *p, uint64_t v)
+{
+        while (v >= 0x80u) {
+                *p++ = (uint8_t)(v | 0x80u);
+                v >>= 7;
+        }
+        *p++ = (uint8_t)v;
+        return p;
+}
+
+static uint64_t
+zigzag(int64_t v)
+{
+        return ((uint64_t)v << 1) ^ (uint64_t)(v >> 63);
+}
+
+/* Make room for one record. */
+static uint8_t *
+reserve(struct log_capture *c, size_t need)
+{
+        if ((c->len + need) > LOG_CAPTURE_BUF_LEN) {
+                (void)log_capture_flush(c);
+        }
+        return &c->buf[c->len];
+}
+
+/* Id of a site, defined in the trace on first use; -1 if it does not fit. */
+static int
+site_id(struct log_capture *c, const void *site, const char *fmt)
+{
+        uint32_t h = log_profile_hash(site, fmt);
+        for (uint32_t i = 0u; i < LOG_CAPTURE_SITES; ++i) {
+                uint32_t k = (h + i) % LOG_CAPTURE_SITES;
+                if ((c->fmt[k] == fmt) && (c->addr[k] == site)) {
+                        return c->id[k];
+                }
+                if (c->fmt[k] != NULL) {
+                        continue;
+                }
+                size_t len = strlen(fmt);
+                if (len > LOG_CAPTURE_FMT_MAX) {
+                        return -1;
+                }
+                c->addr[k] = site;
+                c->fmt[k] = fmt;
+                c->id[k] = c->sites++;
+
+                uint8_t *p = reserve(c, DEF_MAX);
+                uint8_t *q = put_varint(p, ((uint64_t)c->id[k] << 1) | 1u);
+                q = put_varint(q, (uint64_t)(uintptr_t)site);
+                q = put_varint(q, len);
+                (void)memcpy(q, fmt, len);
+                c->len += (size_t)(q - p) + len;
+                return c->id[k];
+        }
+        return -1;
+}
+
+static void
+capture(void *user, const void *site, uint8_t module, enum log_level level,
+        const char *fmt, va_list args)
+{
+        struct log_capture *c = user;
+        uint64_t now = now_ns();
+        int id = site_id(c, site, fmt);
+        if (id < 0) {
+                c->lost++;
+                return;
+        }
+        uint8_t shape[LOG_CAPTURE_ARGS];
+        int32_t prec[LOG_CAPTURE_ARGS];
+        int n = parse(fmt, shape, prec);
+
+        uint8_t *p = reserve(c, EVENT_MAX);
+        uint8_t *q = put_varint(p, (uint64_t)id << 1);
+        q = put_varint(q, (c->events > 0u) ? now - c->last_ns : 0u);
+        *q++ = (uint8_t)(((uint32_t)level << 5) | module);
+        int64_t prev = 0;
+        for (int i = 0; i < n; ++i) {
+                uint64_t v = 0u;
+                switch (shape[i]) {
+                case LOG_ARG_INT: prev = va_arg(args, int); break;
+                case LOG_ARG_UINT: v = va_arg(args, unsigned int); break;
+                case LOG_ARG_LONG: prev = va_arg(args, long); break;
+                case LOG_ARG_ULONG: v = va_arg(args, unsigned long); break;
+                case LOG_ARG_LLONG: prev = va_arg(args, long long); break;
+                case LOG_ARG_ULLONG:
+                        v = va_arg(args, unsigned long long);
+                        break;
+                case LOG_ARG_INTMAX: prev = va_arg(args, intmax_t); break;
+                case LOG_ARG_UINTMAX: v = va_arg(args, uintmax_t); break;
+                case LOG_ARG_SIZE: v = va_arg(args, size_t); break;
+                case LOG_ARG_PTRDIFF: prev = va_arg(args, ptrdiff_t); break;
+                case LOG_ARG_PTR:
+                        v = (uintptr_t)va_arg(args, void *);
+                        break;
+                case LOG_ARG_STR: {
+                        const char *s = va_arg(args, const char *);
+                        int32_t max = (prec[i] == PREC_ARG)
+                                          ? ((prev < 0) ? PREC_NONE
+                                                        : (int32_t)prev)
+                                          : prec[i];
+                        v = (s == NULL) ? 0u
+                            : (max < 0) ? strlen(s)
+                                        : strnlen(s, (size_t)max);
+                        break;
+                }
+                default: {
+                        double d = va_arg(args, double);
+                        (void)memcpy(&v, &d, sizeof(v));
+                        for (uint32_t b = 0u; b < 8u; ++b) {
+                                *q++ = (uint8_t)(v >> (8u * b));
+                        }
+                        continue;
+                }
+                }
+                if (is_signed(shape[i]) != 0u) {
+                        v = zigzag(prev);
+                }
+                q = put_varint(q, v);
+        }
+        c->len += (size_t)(q - p);
+        c->last_ns = now;
+        c->events++;
+}
+#endif
+
+int
+log_capture_open(struct log_capture *c, struct log_ctx *ctx,
+                 const char *path)
+{
+        if ((c == NULL) || (ctx == NULL) || (path == NULL)) {
+                errno = EINVAL;
+                return -1;
+        }
+#if !LOG_PROFILE
+        errno = ENOTSUP;
+        return -1;
+#else
+        (void)memset(c, 0, sizeof(*c));
+        c->ctx = ctx;
+        c->fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (c->fd < 0) {
+                return -1;
+        }
+        c->buf[0] = (uint8_t)LOG_CAPTURE_MAGIC;
+        c->buf[1] = (uint8_t)(LOG_CAPTURE_MAGIC >> 8);
+        c->buf[2] = (uint8_t)(LOG_CAPTURE_MAGIC >> 16);
+        c->buf[3] = (uint8_t)(LOG_CAPTURE_MAGIC >> 24);
+        c->buf[4] = (uint8_t)LOG_CAPTURE_VERSION;
+        c->len = LOG_CAPTURE_HEADER_LEN;
+        c->tap.fn = capture;
+        c->tap.user = c;
+        (void)log_set_tap(ctx, &c->tap);
+        return 0;
+#endif
+}
+
+int
+log_capture_close(struct log_capture *c)
+{
+        if (c == NULL) {
+                errno = EINVAL;
+                return -1;
+        }
+        (void)log_set_tap(c->ctx, NULL);
+        int rc = log_capture_flush(c);
+        if ((close(c->fd) != 0) && (rc == 0)) {
+                rc = -1;
+        }
+        c->fd = -1;
+        return rc;
+}
+
+/* Next byte of the trace: 1, 0 at the end, -1 on error. */
+static int
+get_byte(struct log_replay *r, uint8_t *b)
+{
+        if (r->off == r->len) {
+                ssize_t n;
+                do {
+                        n = read(r->fd, r->buf, sizeof(r->buf));
+                } while ((n < 0) && (errno == EINTR));
+                if (n <= 0) {
+                        return (n == 0) ? 0 : -1;
+                }
+                r->len = (size_t)n;
+                r->off = 0u;
+        }
+        *b = r->buf[r->off++];
+        return 1;
+}
+
+static int
+get_varint(struct log_replay *r, uint64_t *v)
+{
+        *v = 0u;
+        for (uint32_t shift = 0u; shift < 64u; shift += 7u) {
+                uint8_t b;
+                int rc = get_byte(r, &b);
+                if (rc <= 0) {
+                        return (shift == 0u) ? rc : -1;
+                }
+                *v |= (uint64_t)(b & 0x7Fu) << shift;
+                if (b < 0x80u) {
+                        return 1;
+                }
+        }
+        return -1;
+}
+
+int
+log_replay_open(struct log_replay *r, const char *path)
+{
+        if ((r == NULL) || (path == NULL)) {
+                errno = EINVAL;
+                return -1;
+        }
+        (void)memset(r, 0, sizeof(*r));
+        (void)memset(r->pad, 'x', LOG_CAPTURE_STR_MAX);
+        r->fd = open(path, O_RDONLY);
+        if (r->fd < 0) {
+                return -1;
+        }
+        uint8_t hdr[LOG_CAPTURE_HEADER_LEN] = { 0u };
+        for (uint32_t i = 0u; i < LOG_CAPTURE_HEADER_LEN; ++i) {
+                if (get_byte(r, &hdr[i]) <= 0) {
+                        hdr[0] = 0u;
+                        break;
+                }
+        }
+        uint32_t magic = (uint32_t)hdr[0] | ((uint32_t)hdr[1] << 8)
+                         | ((uint32_t)hdr[2] << 16) | ((uint32_t)hdr[3] << 24);
+        if ((magic != LOG_CAPTURE_MAGIC) || (hdr[4] != LOG_CAPTURE_VERSION)) {
+                (void)close(r->fd);
+                r->fd = -1;
+                errno = EINVAL;
+                return -1;
+        }
+        return 0;
+}
+
+static int
+read_site(struct log_replay *r, uint64_t id)
+{
+        uint64_t addr;
+        uint64_t len;
+        if ((id != r->sites) || (id >= LOG_CAPTURE_SITES)
+            || (get_varint(r, &addr) <= 0) || (get_varint(r, &len) <= 0)
+            || (len > LOG_CAPTURE_FMT_MAX)) {
+                return -1;
+        }
+        struct log_replay_site *s = &r->site[id];
+        char *fmt = r->fmt[id];
+        for (uint64_t i = 0u; i < len; ++i) {
+                if (get_byte(r, (uint8_t *)&fmt[i]) <= 0) {
+                        return -1;
+                }
+        }
+        fmt[len] = '\0';
+        int32_t prec[LOG_CAPTURE_ARGS];
+        s->addr = (const void *)(uintptr_t)addr;
+        s->fmt = fmt;
+        s->nargs = (int8_t)parse(fmt, s->shape, prec);
+        r->sites++;
+        return 0;
+}
+
+int
+log_replay_next(struct log_replay *r, struct log_replay_event *e)
+{
+        if ((r == NULL) || (e == NULL) || (r->fd < 0)) {
+                return -1;
+        }
+        uint64_t tag;
+        int rc;
+        while (((rc = get_varint(r, &tag)) > 0) && ((tag & 1u) != 0u)) {
+                if (read_site(r, tag >> 1) != 0) {
+                        return -1;
+                }
+        }
+        if (rc <= 0) {
+                return rc;
+        }
+        uint8_t lm;
+        if (((tag >> 1) >= r->sites) || (get_varint(r, &e->delta_ns) <= 0)
+            || (get_byte(r, &lm) <= 0) || ((lm >> 5) >= LOG_LEVELS)) {
+                return -1;
+        }
+        const struct log_replay_site *s = &r->site[tag >> 1];
+        e->site = s;
+        e->level = (enum log_level)(lm >> 5);
+        e->module = (uint8_t)(lm & 0x1Fu);
+        for (int i = 0; i < s->nargs; ++i) {
+                uint64_t v = 0u;
+                if (s->shape[i] == LOG_ARG_DOUBLE) {
+                        for (uint32_t b = 0u; b < 8u; ++b) {
+                                uint8_t x;
+                                if (get_byte(r, &x) <= 0) {
+                                        return -1;
+                                }
+                                v |= (uint64_t)x << (8u * b);
+                        }
+                        (void)memcpy(&e->arg[i].d, &v, sizeof(v));
+                        continue;
+                }
+                if (get_varint(r, &v) <= 0) {
+                        return -1;
+                }
+                if (s->shape[i] == LOG_ARG_STR) {
+                        v = (v < LOG_CAPTURE_STR_MAX) ? v
+                                                      : LOG_CAPTURE_STR_MAX;
+                        v = (uintptr_t)&r->pad[LOG_CAPTURE_STR_MAX - v];
+                } else if (is_signed(s->shape[i]) != 0u) {
+                        v = (uint64_t)unzigzag(v);
+                }
+                e->arg[i].u = v;
+        }
+        return 1;
+}
+
+uint8_t
+log_replay_emit(struct log_ctx *ctx, const struct log_replay_event *e)
+{
+        if ((e == NULL) || (e->site == NULL) || (e->site->nargs < 0)
+            || (sizeof(void *) != sizeof(uint64_t))) {
+                return 0u;
+        }
+        const struct log_replay_site *s = e->site;
+        uint64_t w[8] = { 0u };
+        double d[4] = { 0.0 };
+        uint32_t mask = 0u;
+        for (int i = 0; i < s->nargs; ++i) {
+                if (s->shape[i] != LOG_ARG_DOUBLE) {
+                        w[i] = e->arg[i].u;
+                } else if (i < 4) {
+                        d[i] = e->arg[i].d;
+                        mask |= 1u << i;
+                } else {
+                        return 0u;
+                }
+        }
+        /* Arguments past the format's are evaluated and ignored. */
+#define EMIT(a0, a1, a2, a3)                                                 \
+        log_event_mod(ctx, e->module, e->level, s->fmt, a0, a1, a2, a3,      \
+                      w[4], w[5], w[6], w[7])
+        switch (mask) {
+        case 0x0u: EMIT(w[0], w[1], w[2], w[3]); break;
+        case 0x1u: EMIT(d[0], w[1], w[2], w[3]); break;
+        case 0x2u: EMIT(w[0], d[1], w[2], w[3]); break;
+        case 0x3u: EMIT(d[0], d[1], w[2], w[3]); break;
+        case 0x4u: EMIT(w[0], w[1], d[2], w[3]); break;
+        case 0x5u: EMIT(d[0], w[1], d[2], w[3]); break;
+        case 0x6u: EMIT(w[0], d[1], d[2], w[3]); break;
+        case 0x7u: EMIT(d[0], d[1], d[2], w[3]); break;
+        case 0x8u: EMIT(w[0], w[1], w[2], d[3]); break;
+        case 0x9u: EMIT(d[0], w[1], w[2], d[3]); break;
+        case 0xAu: EMIT(w[0], d[1], w[2], d[3]); break;
+        case 0xBu: EMIT(d[0], d[1], w[2], d[3]); break;
+        case 0xCu: EMIT(w[0], w[1], d[2], d[3]); break;
+        case 0xDu: EMIT(d[0], w[1], d[2], d[3]); break;
+        case 0xEu: EMIT(w[0], d[1], d[2], d[3]); break;
+        default: EMIT(d[0], d[1], d[2], d[3]); break;
+        }
+#undef EMIT
+        return 1u;
+}
+
+void
+log_replay_close(struct log_replay *r)
+{
+        if ((r == NULL) || (r->fd < 0)) {
+                return;
+        }
+        (void)close(r->fd);
+        r->fd = -1;
+}
@@ -0,0 +1,22 @@
+#include <stddef.h>
+#include <stdint.h>
+
+#include "../include/log_crc.h"
+
+uint16_t
+log_crc16(const uint8_t *buf, size_t len)
+{
+        uint16_t crc = 0xFFFFu;
+        if (buf == NULL) {
+                return crc;
+        }
+        for (size_t i = 0u; i < len; ++i) {
+                crc ^= (uint16_t)((uint16_t)buf[i] << 8);
+                for (uint8_t b = 0u; b < 8u; ++b) {
+                        crc = ((crc & 0x8000u) != 0u)
+                                  ? (uint16_t)((crc << 1) ^ 0x1021u)
+                                  : (uint16_t)(crc << 1);
+                }
+        }
+        return crc;
+}
@@ -0,0 +1,237 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <errno.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <time.h>
+
+#include "../include/log_drain.h"
+
+#define BUDGET_DEFAULT  (64u)
+#define BUSY_BACKOFF_NS (100000L)
+
+_Static_assert((LOG_DRAIN_SOURCES & (LOG_DRAIN_SOURCES - 1u)) == 0u,
+               "deque indices wrap, so LOG_DRAIN_SOURCES must be a power of 2");
+
+/* New work goes to the owner end, a source that had its turn to the far
+ * end, behind everything else queued on that worker. */
+static void
+push(struct log_drain *d, uint32_t w, struct log_drain_src *src,
+     uint8_t requeue)
+{
+        struct log_drain_deque *q = &d->deque[w];
+        (void)pthread_mutex_lock(&q->lock);
+        if (requeue != 0u) {
+                q->top--;
+                q->item[q->top % LOG_DRAIN_SOURCES] = src;
+        } else {
+                q->item[q->bottom % LOG_DRAIN_SOURCES] = src;
+                q->bottom++;
+        }
+        (void)pthread_mutex_unlock(&q->lock);
+
+        (void)atomic_fetch_add(&d->queued, 1u);
+        (void)pthread_mutex_lock(&d->idle_lock);
+        (void)pthread_cond_signal(&d->wake);
+        (void)pthread_mutex_unlock(&d->idle_lock);
+}
+
+/* Take from the owner end (own deque) or the stealing end (others). */
+static struct log_drain_src *
+take(struct log_drain *d, uint32_t w, uint8_t steal)
+{
+        struct log_drain_deque *q = &d->deque[w];
+        struct log_drain_src *src = NULL;
+        (void)pthread_mutex_lock(&q->lock);
+        if (q->top != q->bottom) {
+                if (steal != 0u) {
+                        src = q->item[q->top % LOG_DRAIN_SOURCES];
+                        q->top++;
+                } else {
+                        q->bottom--;
+                        src = q->item[q->bottom % LOG_DRAIN_SOURCES];
+                }
+        }
+        (void)pthread_mutex_unlock(&q->lock);
+        if (src != NULL) {
+                (void)atomic_fetch_sub(&d->queued, 1u);
+        }
+        return src;
+}
+
+static uint8_t
+pending(const struct log_drain_src *src)
+{
+        return (src->sink->pos != log_get_seq(src->ctx)) ? 1u : 0u;
+}
+
+static uint8_t
+stopping(struct log_drain *d)
+{
+        (void)pthread_mutex_lock(&d->idle_lock);
+        uint8_t stop = d->stop;
+        (void)pthread_mutex_unlock(&d->idle_lock);
+        return stop;
+}
+
+static void
+run(struct log_drain *d, uint32_t w, struct log_drain_src *src)
+{
+        if (src->lock != NULL) {
+                (void)pthread_mutex_lock(src->lock);
+        }
+        uint32_t pos = src->sink->pos;
+        (void)log_sink_drain(src->sink, src->ctx, d->budget);
+        uint8_t advanced = (src->sink->pos != pos) ? 1u : 0u;
+        uint8_t more = pending(src);
+        if (src->lock != NULL) {
+                (void)pthread_mutex_unlock(src->lock);
+        }
+        src->turns++;
+
+        if (more != 0u) {
+                if (advanced != 0u) {
+                        push(d, w, src, 1u);
+                        return;
+                }
+                /* The sink is busy: try again shortly, keeping the source
+                 * scheduled. A stopping pool gives up on it. */
+                if (stopping(d) == 0u) {
+                        struct timespec ts = { 0, BUSY_BACKOFF_NS };
+                        (void)nanosleep(&ts, NULL);
+                        push(d, w, src, 1u);
+                } else {
+                        atomic_store(&src->scheduled, 0u);
+                }
+                return;
+        }
+        atomic_store(&src->scheduled, 0u);
+        /* A producer that saw the flag still set before we cleared it
+         * relies on this second look. */
+        if (src->lock != NULL) {
+                (void)pthread_mutex_lock(src->lock);
+        }
+        more = pending(src);
+        if (src->lock != NULL) {
+                (void)pthread_mutex_unlock(src->lock);
+        }
+        if ((more != 0u) && (atomic_exchange(&src->scheduled, 1u) == 0u)) {
+                push(d, w, src, 1u);
+        }
+}
+
+static void *
+worker(void *arg)
+{
+        struct log_drain_deque *own = arg;
+        struct log_drain *d = own->pool;
+        uint32_t w = (uint32_t)(own - d->deque);
+        for (;;) {
+                struct log_drain_src *src = take(d, w, 0u);
+                for (uint32_t k = 1u; (src == NULL) && (k < d->threads); ++k) {
+                        src = take(d, (w + k) % d->threads, 1u);
+                        if (src != NULL) {
+                                (void)atomic_fetch_add(&d->steals, 1u);
+                        }
+                }
+                if (src != NULL) {
+                        run(d, w, src);
+                        continue;
+                }
+                (void)pthread_mutex_lock(&d->idle_lock);
+                while ((atomic_load(&d->queued) == 0u) && (d->stop == 0u)) {
+                        (void)pthread_cond_wait(&d->wake, &d->idle_lock);
+                }
+                uint8_t done = (d->stop != 0u)
+                               && (atomic_load(&d->queued) == 0u);
+                (void)pthread_mutex_unlock(&d->idle_lock);
+                if (done) {
+                        return NULL;
+                }
+        }
+}
+
+int
+log_drain_start(struct log_drain *d, uint8_t threads, uint16_t budget)
+{
+        if ((d == NULL) || (threads == 0u) || (threads > LOG_DRAIN_THREADS)) {
+                errno = EINVAL;
+                return -1;
+        }
+        d->threads = 0u;
+        d->budget = (budget != 0u) ? budget : BUDGET_DEFAULT;
+        d->stop = 0u;
+        atomic_init(&d->queued, 0u);
+        atomic_init(&d->next, 0u);
+        atomic_init(&d->steals, 0u);
+        int rc = pthread_mutex_init(&d->idle_lock, NULL);
+        if (rc == 0) {
+                rc = pthread_cond_init(&d->wake, NULL);
+        }
+        for (uint8_t w = 0u; (rc == 0) && (w < threads); ++w) {
+                struct log_drain_deque *q = &d->deque[w];
+                q->pool = d;
+                q->top = 0u;
+                q->bottom = 0u;
+                rc = pthread_mutex_init(&q->lock, NULL);
+        }
+        /* Workers index deques modulo d->threads, so publish it first. */
+        if (rc == 0) {
+                d->threads = threads;
+        }
+        for (uint8_t w = 0u; (rc == 0) && (w < threads); ++w) {
+                rc = pthread_create(&d->thread[w], NULL, worker, &d->deque[w]);
+                if (rc != 0) {
+                        d->threads = w;
+                        log_drain_stop(d);
+                }
+        }
+        if (rc != 0) {
+                errno = rc;
+                return -1;
+        }
+        return 0;
+}
+
+void
+log_drain_src_init(struct log_drain_src *src, struct log_ctx *ctx,
+                   struct log_sink *sink, pthread_mutex_t *lock)
+{
+        if (src == NULL) {
+                return;
+        }
+        src->ctx = ctx;
+        src->sink = sink;
+        src->lock = lock;
+        atomic_init(&src->scheduled, 0u);
+        src->turns = 0u;
+}
+
+void
+log_drain_notify(struct log_drain *d, struct log_drain_src *src)
+{
+        if ((d == NULL) || (src == NULL) || (src->ctx == NULL)
+            || (src->sink == NULL) || (d->threads == 0u)) {
+                return;
+        }
+        if (atomic_exchange(&src->scheduled, 1u) != 0u) {
+                return;
+        }
+        push(d, atomic_fetch_add(&d->next, 1u) % d->threads, src, 0u);
+}
+
+void
+log_drain_stop(struct log_drain *d)
+{
+        if (d == NULL) {
+                return;
+        }
+        (void)pthread_mutex_lock(&d->idle_lock);
+        d->stop = 1u;
+        (void)pthread_cond_broadcast(&d->wake);
+        (void)pthread_mutex_unlock(&d->idle_lock);
+        for (uint8_t w = 0u; w < d->threads; ++w) {
+                (void)pthread_join(d->thread[w], NULL);
+        }
+        d->threads = 0u;
+}
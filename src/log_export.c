@@ -0,0 +1,199 @@
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "../include/log_export.h"
+
+_Static_assert(LOG_MSG_LEN <= 256u, "message length must fit in one byte");
+
+static void
+put_le16(uint8_t *p, uint16_t v)
+{
+        p[0] = (uint8_t)(v & 0xFFu);
+        p[1] = (uint8_t)(v >> 8);
+}
+
+static void
+put_le32(uint8_t *p, uint32_t v)
+{
+        p[0] = (uint8_t)(v & 0xFFu);
+        p[1] = (uint8_t)((v >> 8) & 0xFFu);
+        p[2] = (uint8_t)((v >> 16) & 0xFFu);
+        p[3] = (uint8_t)(v >> 24);
+}
+
+static uint16_t
+get_le16(const uint8_t *p)
+{
+        return (uint16_t)((uint16_t)p[0] | ((uint16_t)p[1] << 8));
+}
+
+static uint32_t
+get_le32(const uint8_t *p)
+{
+        return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16)
+             | ((uint32_t)p[3] << 24);
+}
+
+static size_t
+msg_len(const char *msg)
+{
+        size_t n = 0u;
+        while ((n < ((size_t)LOG_MSG_LEN - 1u)) && (msg[n] != '\0')) {
+                n++;
+        }
+        return n;
+}
+
+size_t
+log_export_header(uint8_t *buf, size_t len)
+{
+        if ((buf == NULL) || (len < LOG_EXPORT_HEADER_LEN)) {
+                return 0u;
+        }
+        put_le32(&buf[0], LOG_EXPORT_MAGIC);
+        put_le16(&buf[4], (uint16_t)LOG_EXPORT_VERSION);
+        put_le16(&buf[6], 0u);
+        return LOG_EXPORT_HEADER_LEN;
+}
+
+size_t
+log_export_check_header(const uint8_t *buf, size_t len)
+{
+        if ((buf == NULL) || (len < LOG_EXPORT_HEADER_LEN)) {
+                return 0u;
+        }
+        if ((get_le32(&buf[0]) != LOG_EXPORT_MAGIC)
+            || (get_le16(&buf[4]) != (uint16_t)LOG_EXPORT_VERSION)) {
+                return 0u;
+        }
+        return LOG_EXPORT_HEADER_LEN;
+}
+
+size_t
+log_record_encode(const struct log_entry *e, uint8_t *buf, size_t len)
+{
+        if ((e == NULL) || (buf == NULL)) {
+                return 0u;
+        }
+        size_t n = msg_len(e->msg);
+        if (len < (LOG_RECORD_HEADER_LEN + n)) {
+                return 0u;
+        }
+        put_le32(&buf[0], e->timestamp);
+        buf[4] = (uint8_t)e->level;
+        buf[5] = e->module;
+        buf[6] = (uint8_t)n;
+        (void)memcpy(&buf[LOG_RECORD_HEADER_LEN], e->msg, n);
+        return LOG_RECORD_HEADER_LEN + n;
+}
+
+size_t
+log_record_decode(const uint8_t *buf, size_t len, struct log_entry *e)
+{
+        if ((buf == NULL) || (e == NULL) || (len < LOG_RECORD_HEADER_LEN)) {
+                return 0u;
+        }
+        size_t n = (size_t)buf[6];
+        if (len < (LOG_RECORD_HEADER_LEN + n)) {
+                return 0u;
+        }
+        size_t copy = (n < ((size_t)LOG_MSG_LEN - 1u))
+                          ? n
+                          : ((size_t)LOG_MSG_LEN - 1u);
+        e->timestamp = get_le32(&buf[0]);
+        e->level = (uint16_t)buf[4];
+        e->module = buf[5];
+        (void)memcpy(e->msg, &buf[LOG_RECORD_HEADER_LEN], copy);
+        e->msg[copy] = '\0';
+        return LOG_RECORD_HEADER_LEN + n;
+}
+
+size_t
+log_export(const struct log_ctx *ctx, uint16_t *idx, uint8_t *buf, size_t len)
+{
+        return log_export_filter(ctx, idx, NULL, buf, len);
+}
+
+size_t
+log_export_filter(const struct log_ctx *ctx, uint16_t *idx,
+                  const struct log_filter *f, uint8_t *buf, size_t len)
+{
+        if ((ctx == NULL) || (idx == NULL) || (buf == NULL)) {
+                return 0u;
+        }
+        size_t used = 0u;
+        uint16_t count = log_get_count(ctx);
+        uint16_t npin = log_get_pinned(ctx, NULL);
+        uint16_t live = log_first_live(ctx);
+        for (;;) {
+                if ((*idx >= npin) && (*idx < live)) {
+                        *idx = live;
+                }
+                if (*idx >= count) {
+                        break;
+                }
+                /* NULL for a hole left by a quota eviction. */
+                const struct log_entry *e = log_get_entry(ctx, *idx);
+                if ((e == NULL)
+                    || ((f != NULL) && (log_filter_match(f, e) == 0u))) {
+                        (*idx)++;
+                        continue;
+                }
+                size_t n = log_record_encode(e, &buf[used], len - used);
+                if (n == 0u) {
+                        break;
+                }
+                used += n;
+                (*idx)++;
+        }
+        return used;
+}
+
+size_t
+log_batch_header(const struct log_batch *b, uint8_t *buf, size_t len)
+{
+        if ((b == NULL) || (buf == NULL) || (len < LOG_BATCH_HEADER_LEN)) {
+                return 0u;
+        }
+        put_le32(&buf[0], b->source);
+        put_le32(&buf[4], b->seq);
+        put_le32(&buf[8], b->dropped);
+        put_le16(&buf[12], b->count);
+        put_le16(&buf[14], b->len);
+        return LOG_BATCH_HEADER_LEN;
+}
+
+size_t
+log_batch_parse(const uint8_t *buf, size_t len, struct log_batch *b)
+{
+        if ((buf == NULL) || (b == NULL) || (len < LOG_BATCH_HEADER_LEN)) {
+                return 0u;
+        }
+        b->source = get_le32(&buf[0]);
+        b->seq = get_le32(&buf[4]);
+        b->dropped = get_le32(&buf[8]);
+        b->count = get_le16(&buf[12]);
+        b->len = get_le16(&buf[14]);
+        return LOG_BATCH_HEADER_LEN;
+}
+
+int
+log_batch_write(void *user, const struct log_entry *e, uint32_t seq)
+{
+        struct log_batch_buf *bb = user;
+        if ((bb == NULL) || (bb->buf == NULL) || (bb->len > bb->cap)
+            || (bb->count == UINT16_MAX)) {
+                return 1;
+        }
+        size_t n = log_record_encode(e, &bb->buf[bb->len], bb->cap - bb->len);
+        if (n == 0u) {
+                return 1;
+        }
+        if (bb->count == 0u) {
+                bb->seq = seq;
+        }
+        bb->len += n;
+        bb->count++;
+        return 0;
+}
@@ -0,0 +1,533 @@
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "../include/log_filter.h"
+
+#define NONE    (0xFFFFu)
+#define PENDING (0xFFFFu)
+
+/* Bounds the parser's recursion on nested parentheses and negations. */
+#define MAX_DEPTH (16u)
+
+enum { K_AND = LOG_FILTER_JT + 1, K_OR };
+
+/* Expression tree, built on the stack while compiling. */
+struct node {
+        uint8_t kind; /* enum log_filter_op of a predicate, NOT, K_AND, K_OR */
+        uint8_t cmp;
+        uint8_t text; /* Tests the message: 0 never, 1 sometimes, 2 always */
+        uint16_t arg;
+        uint32_t a;
+        uint32_t b;
+        uint16_t child; /* First operand. */
+        uint16_t next;  /* Next operand of the parent. */
+};
+
+struct parser {
+        const char *src;
+        size_t pos;
+        struct log_filter *f;
+        struct node node[LOG_FILTER_INSNS];
+        uint16_t nodes;
+        uint16_t text_used;
+        uint8_t depth;
+        uint8_t failed;
+};
+
+static uint16_t parse_or(struct parser *p);
+
+static uint8_t
+is_word(char c)
+{
+        return (uint8_t)(((c >= 'a') && (c <= 'z'))
+                         || ((c >= 'A') && (c <= 'Z'))
+                         || ((c >= '0') && (c <= '9')) || (c == '_'));
+}
+
+static void
+skip_space(struct parser *p)
+{
+        while ((p->src[p->pos] == ' ') || (p->src[p->pos] == '\t')
+               || (p->src[p->pos] == '\n') || (p->src[p->pos] == '\r')) {
+                p->pos++;
+        }
+}
+
+static uint8_t
+fail(struct parser *p)
+{
+        p->failed = 1u;
+        return 0u;
+}
+
+/* Consume an operator. */
+static uint8_t
+accept(struct parser *p, const char *tok)
+{
+        size_t n = strlen(tok);
+        skip_space(p);
+        if (strncmp(&p->src[p->pos], tok, n) != 0) {
+                return 0u;
+        }
+        p->pos += n;
+        return 1u;
+}
+
+/* Consume a whole word. */
+static uint8_t
+accept_word(struct parser *p, const char *word)
+{
+        size_t n = strlen(word);
+        skip_space(p);
+        if ((strncmp(&p->src[p->pos], word, n) != 0)
+            || (is_word(p->src[p->pos + n]) != 0u)) {
+                return 0u;
+        }
+        p->pos += n;
+        return 1u;
+}
+
+static uint8_t
+expect(struct parser *p, const char *tok)
+{
+        return (accept(p, tok) != 0u) ? 1u : fail(p);
+}
+
+static uint8_t
+parse_number(struct parser *p, uint32_t *v)
+{
+        uint32_t base = 10u;
+        uint8_t digits = 0u;
+        skip_space(p);
+        size_t start = p->pos;
+        *v = 0u;
+        if ((p->src[p->pos] == '0')
+            && ((p->src[p->pos + 1u] == 'x') || (p->src[p->pos + 1u] == 'X'))) {
+                base = 16u;
+                p->pos += 2u;
+        }
+        for (;;) {
+                char c = p->src[p->pos];
+                uint32_t d;
+                if ((c >= '0') && (c <= '9')) {
+                        d = (uint32_t)(c - '0');
+                } else if ((base == 16u) && (c >= 'a') && (c <= 'f')) {
+                        d = (uint32_t)(c - 'a') + 10u;
+                } else if ((base == 16u) && (c >= 'A') && (c <= 'F')) {
+                        d = (uint32_t)(c - 'A') + 10u;
+                } else {
+                        break;
+                }
+                if (*v > ((UINT32_MAX - d) / base)) {
+                        p->pos = start;
+                        return fail(p);
+                }
+                *v = (*v * base) + d;
+                digits++;
+                p->pos++;
+        }
+        if ((digits == 0u) || (is_word(p->src[p->pos]) != 0u)) {
+                p->pos = start;
+                return fail(p);
+        }
+        return 1u;
+}
+
+static uint8_t
+parse_level(struct parser *p, uint32_t *v)
+{
+        if (accept_word(p, "INFO") != 0u) {
+                *v = INFO;
+        } else if (accept_word(p, "WARN") != 0u) {
+                *v = WARN;
+        } else if (accept_word(p, "FAULT") != 0u) {
+                *v = FAULT;
+        } else {
+                return parse_number(p, v);
+        }
+        return 1u;
+}
+
+static uint8_t
+parse_cmp(struct parser *p, uint8_t *cmp)
+{
+        /* Two-character operators first. */
+        static const struct {
+                const char *tok;
+                uint8_t cmp;
+        } ops[] = {
+                { "==", LOG_FILTER_EQ }, { "!=", LOG_FILTER_NE },
+                { "<=", LOG_FILTER_LE }, { ">=", LOG_FILTER_GE },
+                { "<", LOG_FILTER_LT },  { ">", LOG_FILTER_GT },
+        };
+        for (size_t i = 0u; i < (sizeof(ops) / sizeof(ops[0])); ++i) {
+                if (accept(p, ops[i].tok) != 0u) {
+                        *cmp = ops[i].cmp;
+                        return 1u;
+                }
+        }
+        return fail(p);
+}
+
+static uint8_t
+parse_string(struct parser *p, uint16_t *off, uint32_t *len)
+{
+        if (expect(p, "\"") == 0u) {
+                return 0u;
+        }
+        *off = p->text_used;
+        *len = 0u;
+        for (;;) {
+                char c = p->src[p->pos];
+                if (c == '\0') {
+                        return fail(p);
+                }
+                p->pos++;
+                if (c == '"') {
+                        return 1u;
+                }
+                if (c == '\\') {
+                        c = p->src[p->pos];
+                        if ((c != '"') && (c != '\\')) {
+                                return fail(p);
+                        }
+                        p->pos++;
+                }
+                if (p->text_used >= LOG_FILTER_TEXT) {
+                        return fail(p);
+                }
+                p->f->text[p->text_used++] = c;
+                (*len)++;
+        }
+}
+
+static uint16_t
+new_node(struct parser *p, uint8_t kind)
+{
+        if (p->nodes >= LOG_FILTER_INSNS) {
+                (void)fail(p);
+                return NONE;
+        }
+        struct node *n = &p->node[p->nodes];
+        (void)memset(n, 0, sizeof(*n));
+        n->kind = kind;
+        n->child = NONE;
+        n->next = NONE;
+        return p->nodes++;
+}
+
+static uint16_t
+parse_predicate(struct parser *p)
+{
+        struct node n = { 0u, 0u, 0u, 0u, 0u, 0u, NONE, NONE };
+        if (accept_word(p, "level") != 0u) {
+                n.kind = LOG_FILTER_LEVEL;
+                (void)(parse_cmp(p, &n.cmp) && parse_level(p, &n.a));
+        } else if (accept_word(p, "module") != 0u) {
+                n.kind = LOG_FILTER_MODULE;
+                (void)(parse_cmp(p, &n.cmp) && parse_number(p, &n.a));
+        } else if (accept_word(p, "time") != 0u) {
+                if (accept_word(p, "in") != 0u) {
+                        n.kind = LOG_FILTER_TIME_IN;
+                        (void)(expect(p, "[") && parse_number(p, &n.a)
+                               && expect(p, ",") && parse_number(p, &n.b)
+                               && expect(p, "]"));
+                } else {
+                        n.kind = LOG_FILTER_TIME;
+                        (void)(parse_cmp(p, &n.cmp) && parse_number(p, &n.a));
+                }
+        } else if (accept_word(p, "msg") != 0u) {
+                n.kind = LOG_FILTER_CONTAINS;
+                n.text = 2u;
+                (void)((accept_word(p, "contains") || fail(p))
+                       && parse_string(p, &n.arg, &n.a));
+        } else {
+                (void)fail(p);
+        }
+        if (p->failed != 0u) {
+                return NONE;
+        }
+        uint16_t i = new_node(p, n.kind);
+        if (i != NONE) {
+                p->node[i] = n;
+        }
+        return i;
+}
+
+static uint16_t
+parse_unary(struct parser *p)
+{
+        uint16_t i = NONE;
+        if (p->depth >= MAX_DEPTH) {
+                (void)fail(p);
+                return NONE;
+        }
+        p->depth++;
+        if (accept(p, "!") != 0u) {
+                uint16_t c = parse_unary(p);
+                if (p->failed == 0u) {
+                        i = new_node(p, LOG_FILTER_NOT);
+                }
+                if (i != NONE) {
+                        p->node[i].child = c;
+                        p->node[i].text = p->node[c].text;
+                }
+        } else if (accept(p, "(") != 0u) {
+                i = parse_or(p);
+                if ((p->failed == 0u) && (expect(p, ")") == 0u)) {
+                        i = NONE;
+                }
+        } else {
+                i = parse_predicate(p);
+        }
+        p->depth--;
+        return i;
+}
+
+/* operand (op operand)* as one node with a list of operands. */
+static uint16_t
+parse_list(struct parser *p, uint8_t kind, const char *op,
+           uint16_t (*operand)(struct parser *))
+{
+        uint16_t first = operand(p);
+        if ((p->failed != 0u) || (accept(p, op) == 0u)) {
+                return first;
+        }
+        uint16_t i = new_node(p, kind);
+        if (i == NONE) {
+                return NONE;
+        }
+        p->node[i].child = first;
+        p->node[i].text = p->node[first].text;
+        uint16_t last = first;
+        do {
+                uint16_t c = operand(p);
+                if (p->failed != 0u) {
+                        return NONE;
+                }
+                p->node[last].next = c;
+                if (p->node[c].text != p->node[i].text) {
+                        p->node[i].text = 1u;
+                }
+                last = c;
+        } while (accept(p, op) != 0u);
+        return i;
+}
+
+static uint16_t
+parse_and(struct parser *p)
+{
+        return parse_list(p, K_AND, "&&", parse_unary);
+}
+
+static uint16_t
+parse_or(struct parser *p)
+{
+        return parse_list(p, K_OR, "||", parse_and);
+}
+
+static void
+emit_insn(struct parser *p, uint8_t op, uint8_t cmp, uint16_t arg, uint32_t a,
+          uint32_t b)
+{
+        struct log_filter *f = p->f;
+        if (f->len >= LOG_FILTER_INSNS) {
+                (void)fail(p);
+                return;
+        }
+        struct log_filter_insn *in = &f->code[f->len++];
+        in->op = op;
+        in->cmp = cmp;
+        in->arg = arg;
+        in->a = a;
+        in->b = b;
+}
+
+static void
+emit(struct parser *p, uint16_t i)
+{
+        const struct node *n = &p->node[i];
+        if (n->kind == LOG_FILTER_NOT) {
+                emit(p, n->child);
+                emit_insn(p, LOG_FILTER_NOT, 0u, 0u, 0u, 0u);
+                return;
+        }
+        if ((n->kind != K_AND) && (n->kind != K_OR)) {
+                emit_insn(p, n->kind, n->cmp, n->arg, n->a, n->b);
+                return;
+        }
+
+        /* Each operand but the last decides the result if it is false (&&)
+         * or true (||). Operands that never test text go first, those
+         * that always do last. */
+        uint8_t jump = (n->kind == K_AND) ? LOG_FILTER_JF : LOG_FILTER_JT;
+        uint16_t start = p->f->len;
+        uint16_t left = 0u;
+        for (uint16_t c = n->child; c != NONE; c = p->node[c].next) {
+                left++;
+        }
+        for (uint8_t text = 0u; text < 3u; ++text) {
+                for (uint16_t c = n->child; c != NONE; c = p->node[c].next) {
+                        if (p->node[c].text != text) {
+                                continue;
+                        }
+                        emit(p, c);
+                        if (--left > 0u) {
+                                emit_insn(p, jump, 0u, PENDING, 0u, 0u);
+                        }
+                }
+        }
+        /* Jumps of nested lists were resolved when they were emitted. */
+        for (uint16_t k = start; k < p->f->len; ++k) {
+                struct log_filter_insn *in = &p->f->code[k];
+                if (((in->op == LOG_FILTER_JF) || (in->op == LOG_FILTER_JT))
+                    && (in->arg == PENDING)) {
+                        in->arg = p->f->len;
+                }
+        }
+}
+
+int
+log_filter_compile(struct log_filter *f, const char *expr)
+{
+        if (f == NULL) {
+                return -1;
+        }
+        struct parser p;
+        p.src = (expr != NULL) ? expr : "";
+        p.pos = 0u;
+        p.f = f;
+        p.nodes = 0u;
+        p.text_used = 0u;
+        p.depth = 0u;
+        p.failed = (expr == NULL) ? 1u : 0u;
+        f->len = 0u;
+        f->error = 0u;
+
+        skip_space(&p);
+        if ((p.failed == 0u) && (p.src[p.pos] != '\0')) {
+                uint16_t root = parse_or(&p);
+                skip_space(&p);
+                if (p.src[p.pos] != '\0') {
+                        (void)fail(&p);
+                }
+                if (p.failed == 0u) {
+                        emit(&p, root);
+                }
+        }
+        if (p.failed != 0u) {
+                /* r starts out true; a lone NOT makes it match nothing. */
+                f->len = 0u;
+                f->error = (p.pos < UINT16_MAX) ? (uint16_t)p.pos : UINT16_MAX;
+                emit_insn(&p, LOG_FILTER_NOT, 0u, 0u, 0u, 0u);
+                return -1;
+        }
+        return 0;
+}
+
+static uint8_t
+compare(uint32_t v, uint8_t cmp, uint32_t a)
+{
+        switch (cmp) {
+        case LOG_FILTER_EQ: return (uint8_t)(v == a);
+        case LOG_FILTER_NE: return (uint8_t)(v != a);
+        case LOG_FILTER_LT: return (uint8_t)(v < a);
+        case LOG_FILTER_LE: return (uint8_t)(v <= a);
+        case LOG_FILTER_GT: return (uint8_t)(v > a);
+        default: return (uint8_t)(v >= a);
+        }
+}
+
+static uint8_t
+contains(const char *msg, const char *text, size_t n)
+{
+        size_t len = 0u;
+        while ((len < ((size_t)LOG_MSG_LEN - 1u)) && (msg[len] != '\0')) {
+                len++;
+        }
+        if (n > len) {
+                return 0u;
+        }
+        for (size_t i = 0u; i <= (len - n); ++i) {
+                if ((n == 0u)
+                    || ((msg[i] == text[0])
+                        && (memcmp(&msg[i], text, n) == 0))) {
+                        return 1u;
+                }
+        }
+        return 0u;
+}
+
+uint8_t
+log_filter_match(const struct log_filter *f, const struct log_entry *e)
+{
+        if ((f == NULL) || (e == NULL)) {
+                return 0u;
+        }
+        uint8_t r = 1u;
+        uint16_t pc = 0u;
+        while (pc < f->len) {
+                const struct log_filter_insn *in = &f->code[pc++];
+                switch (in->op) {
+                case LOG_FILTER_LEVEL:
+                        r = compare(e->level, in->cmp, in->a);
+                        break;
+                case LOG_FILTER_MODULE:
+                        r = compare(e->module, in->cmp, in->a);
+                        break;
+                case LOG_FILTER_TIME:
+                        r = compare(e->timestamp, in->cmp, in->a);
+                        break;
+                case LOG_FILTER_TIME_IN:
+                        r = (uint8_t)((e->timestamp - in->a)
+                                      <= (in->b - in->a));
+                        break;
+                case LOG_FILTER_CONTAINS:
+                        r = contains(e->msg, &f->text[in->arg], in->a);
+                        break;
+                case LOG_FILTER_NOT:
+                        r = (uint8_t)(r == 0u);
+                        break;
+                case LOG_FILTER_JF:
+                        if (r == 0u) {
+                                pc = in->arg;
+                        }
+                        break;
+                case LOG_FILTER_JT:
+                        if (r != 0u) {
+                                pc = in->arg;
+                        }
+                        break;
+                default:
+                        return 0u;
+                }
+        }
+        return r;
+}
+
+const struct log_entry *
+log_filter_next(const struct log_filter *f, const struct log_ctx *ctx,
+                uint16_t *idx)
+{
+        if ((f == NULL) || (ctx == NULL) || (idx == NULL)) {
+                return NULL;
+        }
+        uint16_t count = log_get_count(ctx);
+        uint16_t npin = log_get_pinned(ctx, NULL);
+        uint16_t live = log_first_live(ctx);
+        for (;;) {
+                if ((*idx >= npin) && (*idx < live)) {
+                        *idx = live;
+                }
+                if (*idx >= count) {
+                        return NULL;
+                }
+                /* NULL for a hole left by a quota eviction. */
+                const struct log_entry *e = log_get_entry(ctx, *idx);
+                (*idx)++;
+                if ((e != NULL) && (log_filter_match(f, e) != 0u)) {
+                        return e;
+                }
+        }
+}
@@ -0,0 +1,281 @@
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "../include/log_crc.h"
+#include "../include/log_flash.h"
+
+#define ERASED16 (0xFFFFu)
+
+static void
+put_le16(uint8_t *p, uint16_t v)
+{
+        p[0] = (uint8_t)(v & 0xFFu);
+        p[1] = (uint8_t)(v >> 8);
+}
+
+static void
+put_le32(uint8_t *p, uint32_t v)
+{
+        p[0] = (uint8_t)(v & 0xFFu);
+        p[1] = (uint8_t)((v >> 8) & 0xFFu);
+        p[2] = (uint8_t)((v >> 16) & 0xFFu);
+        p[3] = (uint8_t)(v >> 24);
+}
+
+static uint16_t
+get_le16(const uint8_t *p)
+{
+        return (uint16_t)((uint16_t)p[0] | ((uint16_t)p[1] << 8));
+}
+
+static uint32_t
+get_le32(const uint8_t *p)
+{
+        return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16)
+             | ((uint32_t)p[3] << 24);
+}
+
+static uint32_t
+pages_per_block(const struct log_flash_dev *dev)
+{
+        return dev->block_size / dev->page_size;
+}
+
+static uint32_t
+page_addr(const struct log_flash_dev *dev, uint32_t block, uint32_t page)
+{
+        return (block * dev->block_size) + (page * dev->page_size);
+}
+
+static size_t
+header_len(uint32_t page)
+{
+        return (page == 0u)
+                   ? (LOG_FLASH_BLOCK_HEADER_LEN + LOG_FLASH_PAGE_HEADER_LEN)
+                   : LOG_FLASH_PAGE_HEADER_LEN;
+}
+
+/* Read a block's sequence number; 0 means no valid block header. */
+static int
+block_seq(const struct log_flash_dev *dev, uint32_t block, uint32_t *seq)
+{
+        uint8_t hdr[LOG_FLASH_BLOCK_HEADER_LEN];
+        if (dev->read(dev->user, page_addr(dev, block, 0u), hdr, sizeof(hdr))
+            != 0) {
+                return -1;
+        }
+        *seq = (get_le32(&hdr[0]) == LOG_FLASH_MAGIC) ? get_le32(&hdr[4])
+                                                      : 0u;
+        return 0;
+}
+
+int
+log_flash_mount(struct log_flash *f, const struct log_flash_dev *dev,
+                enum log_level min_level, uint32_t module_mask)
+{
+        if ((f == NULL) || (dev == NULL) || (dev->read == NULL)
+            || (dev->prog == NULL) || (dev->erase == NULL)
+            || (dev->page_size > LOG_FLASH_PAGE_MAX)
+            || (dev->page_size < (header_len(0u) + LOG_RECORD_HEADER_LEN
+                                  + LOG_MSG_LEN))
+            || (dev->block_size < dev->page_size)
+            || ((dev->block_size % dev->page_size) != 0u)
+            || (dev->block_count < 2u)) {
+                return -1;
+        }
+        f->dev = dev;
+        f->staging = (struct log_batch_buf){ 0 };
+        log_sink_init(&f->sink, log_batch_write, &f->staging, min_level,
+                      module_mask);
+        f->programs = 0u;
+        f->erases = 0u;
+
+        /* Blank device: the first flush starts at block 0. */
+        f->block = dev->block_count - 1u;
+        f->block_seq = 0u;
+        f->page = pages_per_block(dev);
+
+        for (uint32_t b = 0u; b < dev->block_count; ++b) {
+                uint32_t seq;
+                if (block_seq(dev, b, &seq) != 0) {
+                        return -1;
+                }
+                if ((seq != 0u)
+                    && ((f->block_seq == 0u)
+                        || ((int32_t)(seq - f->block_seq) > 0))) {
+                        f->block = b;
+                        f->block_seq = seq;
+                }
+        }
+        if (f->block_seq == 0u) {
+                return 0;
+        }
+
+        for (f->page = 0u; f->page < pages_per_block(dev); ++f->page) {
+                uint8_t hdr[2];
+                uint32_t addr = page_addr(dev, f->block, f->page)
+                              + (uint32_t)header_len(f->page)
+                              - LOG_FLASH_PAGE_HEADER_LEN;
+                if (dev->read(dev->user, addr, hdr, sizeof(hdr)) != 0) {
+                        return -1;
+                }
+                if (get_le16(hdr) == ERASED16) {
+                        break;
+                }
+        }
+        return 0;
+}
+
+static int
+next_block(struct log_flash *f)
+{
+        const struct log_flash_dev *dev = f->dev;
+        uint32_t block = (f->block + 1u) % dev->block_count;
+        if (dev->erase(dev->user, page_addr(dev, block, 0u)) != 0) {
+                return -1;
+        }
+        f->erases++;
+        f->block = block;
+        f->block_seq++;
+        if (f->block_seq == 0u) {
+                f->block_seq = 1u;
+        }
+        f->page = 0u;
+        return 0;
+}
+
+int
+log_flash_flush(struct log_flash *f, const struct log_ctx *ctx)
+{
+        if ((f == NULL) || (f->dev == NULL) || (ctx == NULL)) {
+                return -1;
+        }
+        const struct log_flash_dev *dev = f->dev;
+        int pages = 0;
+
+        for (;;) {
+                /* Erase only once there is something to put there. */
+                uint8_t full = (uint8_t)(f->page == pages_per_block(dev));
+                size_t hdr = header_len((full != 0u) ? 0u : f->page);
+                uint32_t start = f->sink.pos;
+                f->staging = (struct log_batch_buf){
+                    .buf = &f->buf[hdr], .cap = dev->page_size - hdr};
+                (void)log_sink_drain(&f->sink, ctx, UINT16_MAX);
+                if (f->staging.count == 0u) {
+                        break;
+                }
+                if ((full != 0u) && (next_block(f) != 0)) {
+                        f->sink.pos = start;
+                        return -1;
+                }
+
+                uint8_t *p = f->buf;
+                if (f->page == 0u) {
+                        put_le32(&p[0], LOG_FLASH_MAGIC);
+                        put_le32(&p[4], f->block_seq);
+                        p = &p[LOG_FLASH_BLOCK_HEADER_LEN];
+                }
+                put_le16(&p[0], (uint16_t)f->staging.len);
+                put_le16(&p[2], log_crc16(&f->buf[hdr], f->staging.len));
+                (void)memset(&f->buf[hdr + f->staging.len], 0xFF,
+                             dev->page_size - hdr - f->staging.len);
+
+                if (dev->prog(dev->user, page_addr(dev, f->block, f->page),
+                              f->buf, dev->page_size)
+                    != 0) {
+                        f->sink.pos = start;
+                        return -1;
+                }
+                f->page++;
+                f->programs++;
+                pages++;
+        }
+        return pages;
+}
+
+void
+log_flash_iter_init(const struct log_flash *f, struct log_flash_iter *it)
+{
+        if ((f == NULL) || (it == NULL)) {
+                return;
+        }
+        it->step = 0u;
+        it->page = 0u;
+        it->off = 0u;
+        it->len = 0u;
+        it->bad = 0u;
+}
+
+/* Load the next programmed page: 1 = loaded, 0 = end, -1 = read error. */
+static int
+iter_load(const struct log_flash *f, struct log_flash_iter *it)
+{
+        const struct log_flash_dev *dev = f->dev;
+
+        while (it->step < dev->block_count) {
+                uint32_t block = (f->block + 1u + it->step) % dev->block_count;
+                uint32_t end = (block == f->block) ? f->page
+                                                   : pages_per_block(dev);
+                if (it->page == 0u) {
+                        uint32_t seq;
+                        if (block_seq(dev, block, &seq) != 0) {
+                                return -1;
+                        }
+                        if (seq == 0u) {
+                                end = 0u;
+                        }
+                }
+                if (it->page >= end) {
+                        it->step++;
+                        it->page = 0u;
+                        continue;
+                }
+
+                size_t hdr = header_len(it->page);
+                if (dev->read(dev->user, page_addr(dev, block, it->page),
+                              it->buf, dev->page_size)
+                    != 0) {
+                        return -1;
+                }
+                it->page++;
+                const uint8_t *p = &it->buf[hdr - LOG_FLASH_PAGE_HEADER_LEN];
+                size_t len = get_le16(&p[0]);
+                if (len == ERASED16) {
+                        continue;
+                }
+                if ((len > (dev->page_size - hdr))
+                    || (log_crc16(&it->buf[hdr], len) != get_le16(&p[2]))) {
+                        it->bad++;
+                        continue;
+                }
+                it->off = hdr;
+                it->len = hdr + len;
+                return 1;
+        }
+        return 0;
+}
+
+int
+log_flash_next(const struct log_flash *f, struct log_flash_iter *it,
+               struct log_entry *e)
+{
+        if ((f == NULL) || (f->dev == NULL) || (it == NULL) || (e == NULL)) {
+                return -1;
+        }
+        for (;;) {
+                if (it->off < it->len) {
+                        size_t n = log_record_decode(&it->buf[it->off],
+                                                     it->len - it->off, e);
+                        if (n != 0u) {
+                                it->off += n;
+                                return 1;
+                        }
+                        it->off = it->len;
+                }
+                int rc = iter_load(f, it);
+                if (rc <= 0) {
+                        return rc;
+                }
+        }
+}
@@ -0,0 +1,190 @@
+#include <stddef.h>
+#include <stdint.h>
+
+#include "../include/log_layout.h"
+
+_Static_assert(LOG_ENTRIES < LOG_IDX_NONE, "entry index must fit in 16 bits");
+_Static_assert(sizeof(struct log_ctx) <= UINT32_MAX, "context too large");
+_Static_assert(sizeof(struct log_entry) <= UINT16_MAX, "entry too large");
+_Static_assert(offsetof(struct log_ctx, layout) == 0u,
+               "descriptor pointer must come first");
+
+#if defined(__BYTE_ORDER__) && (__BYTE_ORDER__ == __ORDER_BIG_ENDIAN__)
+#define LAYOUT_ENDIAN LOG_LAYOUT_BIG_ENDIAN
+#else
+#define LAYOUT_ENDIAN (0u)
+#endif
+
+#if LOG_LEVEL_INDEX
+#define LAYOUT_INDEX LOG_LAYOUT_LEVEL_INDEX
+#else
+#define LAYOUT_INDEX (0u)
+#endif
+
+#if LOG_MODULE_QUOTA
+#define LAYOUT_SLOT_SEQ LOG_LAYOUT_SLOT_SEQ
+#define SLOT_SEQ_OFFSET offsetof(struct log_ctx, slot_seq)
+#else
+#define LAYOUT_SLOT_SEQ (0u)
+#define SLOT_SEQ_OFFSET (0u)
+#endif
+
+const struct log_layout log_ctx_layout = {
+        .magic = LOG_LAYOUT_MAGIC,
+        .version = LOG_LAYOUT_VERSION,
+        .size = (uint16_t)sizeof(struct log_layout),
+        .flags = (uint16_t)(LAYOUT_ENDIAN | LAYOUT_INDEX | LAYOUT_SLOT_SEQ),
+        .entry_size = (uint16_t)sizeof(struct log_entry),
+        .capacity = (uint16_t)LOG_ENTRIES,
+        .msg_len = (uint16_t)LOG_MSG_LEN,
+        .ctx_buffer = (uint32_t)offsetof(struct log_ctx, buffer),
+        .ctx_head = (uint32_t)offsetof(struct log_ctx, head),
+        .ctx_count = (uint32_t)offsetof(struct log_ctx, count),
+        .ctx_seq = (uint32_t)offsetof(struct log_ctx, seq),
+        .ctx_pinned = (uint32_t)offsetof(struct log_ctx, pinned),
+        .ctx_size = (uint32_t)sizeof(struct log_ctx),
+        .entry_timestamp = (uint16_t)offsetof(struct log_entry, timestamp),
+        .entry_level = (uint16_t)offsetof(struct log_entry, level),
+        .entry_module = (uint16_t)offsetof(struct log_entry, module),
+        .entry_msg = (uint16_t)offsetof(struct log_entry, msg),
+        .ctx_pin_seq = (uint32_t)offsetof(struct log_ctx, pin_seq),
+        .ctx_slot_seq = (uint32_t)SLOT_SEQ_OFFSET,
+};
+
+static uint16_t
+get16(const struct log_layout *lay, const uint8_t *p)
+{
+        if ((lay->flags & LOG_LAYOUT_BIG_ENDIAN) != 0u) {
+                return (uint16_t)(((uint16_t)p[0] << 8) | (uint16_t)p[1]);
+        }
+        return (uint16_t)((uint16_t)p[0] | ((uint16_t)p[1] << 8));
+}
+
+static uint32_t
+get32(const struct log_layout *lay, const uint8_t *p)
+{
+        if ((lay->flags & LOG_LAYOUT_BIG_ENDIAN) != 0u) {
+                return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16)
+                     | ((uint32_t)p[2] << 8) | (uint32_t)p[3];
+        }
+        return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16)
+             | ((uint32_t)p[3] << 24);
+}
+
+uint8_t
+log_layout_check(const struct log_layout *lay)
+{
+        if ((lay == NULL) || (lay->magic != LOG_LAYOUT_MAGIC)
+            || (lay->version != LOG_LAYOUT_VERSION)
+            || (lay->size < sizeof(struct log_layout)) || (lay->capacity == 0u)
+            || (lay->msg_len == 0u)) {
+                return 0u;
+        }
+        uint64_t buffer_end = (uint64_t)lay->ctx_buffer
+                            + ((uint64_t)lay->entry_size * lay->capacity);
+        uint64_t slot_seq_end = 0u;
+        if ((lay->flags & LOG_LAYOUT_SLOT_SEQ) != 0u) {
+                slot_seq_end = (uint64_t)lay->ctx_slot_seq
+                             + (4u * (uint64_t)lay->capacity);
+        }
+        return (uint8_t)((buffer_end <= lay->ctx_size)
+                         && (slot_seq_end <= lay->ctx_size)
+                         && (((uint64_t)lay->ctx_pin_seq + 4u)
+                             <= lay->ctx_size)
+                         && (((uint64_t)lay->ctx_head + 2u) <= lay->ctx_size)
+                         && (((uint64_t)lay->ctx_count + 2u) <= lay->ctx_size)
+                         && (((uint64_t)lay->ctx_seq + 4u) <= lay->ctx_size)
+                         && (((uint64_t)lay->ctx_pinned + 2u)
+                             <= lay->ctx_size)
+                         && ((lay->entry_timestamp + 4u) <= lay->entry_size)
+                         && ((lay->entry_level + 2u) <= lay->entry_size)
+                         && ((lay->entry_module + 1u) <= lay->entry_size)
+                         && (((uint32_t)lay->entry_msg + lay->msg_len)
+                             <= lay->entry_size));
+}
+
+uint16_t
+log_layout_count(const struct log_layout *lay, const uint8_t *image,
+                 size_t len)
+{
+        if ((lay == NULL) || (image == NULL) || (len < lay->ctx_size)) {
+                return 0u;
+        }
+        uint16_t head = get16(lay, &image[lay->ctx_head]);
+        uint16_t count = get16(lay, &image[lay->ctx_count]);
+        uint16_t pinned = get16(lay, &image[lay->ctx_pinned]);
+        if ((head >= lay->capacity) || (count > lay->capacity)
+            || (pinned >= lay->capacity)) {
+                return 0u;
+        }
+        return count;
+}
+
+uint32_t
+log_layout_seq(const struct log_layout *lay, const uint8_t *image, size_t len)
+{
+        if ((lay == NULL) || (image == NULL) || (len < lay->ctx_size)) {
+                return 0u;
+        }
+        return get32(lay, &image[lay->ctx_seq]);
+}
+
+/* Same mapping as the library: pinned slots first, then the ring. */
+static uint32_t
+image_slot(const struct log_layout *lay, const uint8_t *image, uint16_t idx)
+{
+        uint16_t head = get16(lay, &image[lay->ctx_head]);
+        uint16_t count = get16(lay, &image[lay->ctx_count]);
+        uint16_t pinned = get16(lay, &image[lay->ctx_pinned]);
+        uint16_t npin = (count < pinned) ? count : pinned;
+        if (idx < npin) {
+                return idx;
+        }
+        uint32_t ring = (uint32_t)lay->capacity - pinned;
+        return pinned
+             + (((uint32_t)head - pinned + ring - (count - idx)) % ring);
+}
+
+uint32_t
+log_layout_seq_at(const struct log_layout *lay, const uint8_t *image,
+                  size_t len, uint16_t idx)
+{
+        uint32_t seq = log_layout_seq(lay, image, len);
+        uint16_t count = log_layout_count(lay, image, len);
+        if (idx >= count) {
+                return seq;
+        }
+        uint16_t pinned = get16(lay, &image[lay->ctx_pinned]);
+        if (idx < pinned) {
+                return get32(lay, &image[lay->ctx_pin_seq]) + idx;
+        }
+        if ((lay->flags & LOG_LAYOUT_SLOT_SEQ) != 0u) {
+                uint32_t slot = image_slot(lay, image, idx);
+                return get32(lay, &image[lay->ctx_slot_seq + (4u * slot)]);
+        }
+        return seq - ((uint32_t)count - idx);
+}
+
+uint8_t
+log_layout_entry(const struct log_layout *lay, const uint8_t *image,
+                 size_t len, uint16_t idx, struct log_entry *e)
+{
+        if ((e == NULL) || (idx >= log_layout_count(lay, image, len))) {
+                return 0u;
+        }
+        uint32_t slot = image_slot(lay, image, idx);
+        const uint8_t *p = &image[lay->ctx_buffer
+                                  + (slot * (uint32_t)lay->entry_size)];
+
+        e->timestamp = get32(lay, &p[lay->entry_timestamp]);
+        e->level = get16(lay, &p[lay->entry_level]);
+        e->module = p[lay->entry_module];
+        size_t n = 0u;
+        while ((n < ((size_t)LOG_MSG_LEN - 1u)) && (n < lay->msg_len)
+               && (p[lay->entry_msg + n] != 0u)) {
+                e->msg[n] = (char)p[lay->entry_msg + n];
+                n++;
+        }
+        e->msg[n] = '\0';
+        return 1u;
+}
@@ -0,0 +1,252 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "../include/log_export.h"
+#include "../include/log_merge.h"
+
+static size_t
+page_size(void)
+{
+        long sz = sysconf(_SC_PAGESIZE);
+        return (sz > 0) ? (size_t)sz : 4096u;
+}
+
+static void
+src_unmap(struct log_merge_src *src)
+{
+        if (src->map != NULL) {
+                (void)munmap((void *)src->map, src->map_len);
+                src->map = NULL;
+                src->map_len = 0u;
+        }
+}
+
+/* Make [off, off + need) addressable through the current window. */
+static int
+src_map(struct log_merge_src *src, size_t need)
+{
+        if ((src->map != NULL) && (src->off >= src->map_off)
+            && ((src->off + need) <= (src->map_off + src->map_len))) {
+                return 0;
+        }
+        src_unmap(src);
+
+        uint64_t start = src->off - (src->off % page_size());
+        uint64_t len = src->size - start;
+        if (len > src->window) {
+                len = src->window;
+        }
+        void *p = mmap(NULL, (size_t)len, PROT_READ, MAP_PRIVATE, src->fd,
+                       (off_t)start);
+        if (p == MAP_FAILED) {
+                return -1;
+        }
+        (void)posix_madvise(p, (size_t)len, POSIX_MADV_SEQUENTIAL);
+        src->map = (const uint8_t *)p;
+        src->map_off = start;
+        src->map_len = (size_t)len;
+        return 0;
+}
+
+static int64_t
+src_key(struct log_merge_src *src, uint32_t ts)
+{
+        if ((ts < src->last_ts) && ((src->last_ts - ts) > 0x80000000u)) {
+                src->epoch++;
+        }
+        src->last_ts = ts;
+
+        uint64_t t = ((uint64_t)src->epoch << 32) | (uint64_t)ts;
+        uint64_t mult = (src->calib.mult != 0u) ? src->calib.mult : 1u;
+        uint64_t div = (src->calib.div != 0u) ? src->calib.div : 1u;
+        uint64_t scaled = ((t / div) * mult) + (((t % div) * mult) / div);
+        return (int64_t)scaled + src->calib.offset;
+}
+
+/* Read the record at src->off: 1 = read, 0 = end of file, -1 = malformed. */
+static int
+src_read(struct log_merge_src *src)
+{
+        if (src->off >= src->size) {
+                src_unmap(src);
+                return 0;
+        }
+        uint64_t left = src->size - src->off;
+        size_t need = (left < LOG_RECORD_MAX_LEN) ? (size_t)left
+                                                  : LOG_RECORD_MAX_LEN;
+        if (src_map(src, need) != 0) {
+                return -1;
+        }
+        const uint8_t *p = &src->map[src->off - src->map_off];
+        size_t n = log_record_decode(p, need, &src->entry);
+        if (n == 0u) {
+                errno = EINVAL;
+                return -1;
+        }
+        src->off += n;
+        src->key = src_key(src, src->entry.timestamp);
+        return 1;
+}
+
+int
+log_merge_open(struct log_merge_src *src, const char *path,
+               const struct log_merge_calib *calib, size_t window)
+{
+        if ((src == NULL) || (path == NULL)) {
+                errno = EINVAL;
+                return -1;
+        }
+        *src = (struct log_merge_src){ .fd = -1 };
+        if (calib != NULL) {
+                src->calib = *calib;
+        }
+
+        size_t pg = page_size();
+        if (window == 0u) {
+                window = LOG_MERGE_WINDOW_DEFAULT;
+        }
+        window = ((window + pg - 1u) / pg) * pg;
+        if (window < (2u * pg)) {
+                window = 2u * pg;
+        }
+        src->window = window;
+
+        src->fd = open(path, O_RDONLY);
+        if (src->fd < 0) {
+                return -1;
+        }
+        struct stat st;
+        if (fstat(src->fd, &st) != 0) {
+                log_merge_close(src);
+                return -1;
+        }
+        src->size = (uint64_t)st.st_size;
+        if ((src->size < LOG_EXPORT_HEADER_LEN)
+            || (src_map(src, LOG_EXPORT_HEADER_LEN) != 0)
+            || (log_export_check_header(src->map, src->map_len) == 0u)) {
+                log_merge_close(src);
+                errno = EINVAL;
+                return -1;
+        }
+        src->off = LOG_EXPORT_HEADER_LEN;
+        return 0;
+}
+
+void
+log_merge_close(struct log_merge_src *src)
+{
+        if (src == NULL) {
+                return;
+        }
+        src_unmap(src);
+        if (src->fd >= 0) {
+                (void)close(src->fd);
+                src->fd = -1;
+        }
+}
+
+static int
+heap_less(const struct log_merge *m, uint32_t a, uint32_t b)
+{
+        int64_t ka = m->src[m->heap[a]].key;
+        int64_t kb = m->src[m->heap[b]].key;
+        if (ka != kb) {
+                return ka < kb;
+        }
+        return m->heap[a] < m->heap[b];
+}
+
+static void
+heap_swap(struct log_merge *m, uint32_t a, uint32_t b)
+{
+        uint32_t t = m->heap[a];
+        m->heap[a] = m->heap[b];
+        m->heap[b] = t;
+}
+
+static void
+heap_down(struct log_merge *m, uint32_t i)
+{
+        for (;;) {
+                uint32_t l = (2u * i) + 1u;
+                uint32_t r = l + 1u;
+                uint32_t min = i;
+                if ((l < m->n) && heap_less(m, l, min)) {
+                        min = l;
+                }
+                if ((r < m->n) && heap_less(m, r, min)) {
+                        min = r;
+                }
+                if (min == i) {
+                        return;
+                }
+                heap_swap(m, i, min);
+                i = min;
+        }
+}
+
+int
+log_merge_init(struct log_merge *m, struct log_merge_src *src, uint32_t *heap,
+               uint32_t n)
+{
+        if ((m == NULL) || ((n > 0u) && ((src == NULL) || (heap == NULL)))) {
+                errno = EINVAL;
+                return -1;
+        }
+        m->src = src;
+        m->heap = heap;
+        m->n = 0u;
+        for (uint32_t i = 0u; i < n; ++i) {
+                int rc = src_read(&src[i]);
+                if (rc < 0) {
+                        return -1;
+                }
+                if (rc > 0) {
+                        m->heap[m->n++] = i;
+                }
+        }
+        for (uint32_t i = m->n / 2u; i > 0u; --i) {
+                heap_down(m, i - 1u);
+        }
+        return 0;
+}
+
+int
+log_merge_next(struct log_merge *m, struct log_entry *out, uint32_t *src_idx,
+               int64_t *key)
+{
+        if ((m == NULL) || (out == NULL)) {
+                errno = EINVAL;
+                return -1;
+        }
+        if (m->n == 0u) {
+                return 0;
+        }
+        uint32_t top = m->heap[0];
+        struct log_merge_src *s = &m->src[top];
+        *out = s->entry;
+        if (src_idx != NULL) {
+                *src_idx = top;
+        }
+        if (key != NULL) {
+                *key = s->key;
+        }
+
+        int rc = src_read(s);
+        if (rc < 0) {
+                return -1;
+        }
+        if (rc == 0) {
+                m->n--;
+                m->heap[0] = m->heap[m->n];
+        }
+        heap_down(m, 0u);
+        return 1;
+}
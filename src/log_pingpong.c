@@ -0,0 +1,81 @@
+#include <stdatomic.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "../include/log_pingpong.h"
+
+/* Slot state in the high bits, buffer index in bit 0. */
+#define SLOT_FREE (0x10u)
+#define SLOT_FULL (0x20u)
+#define SLOT_IDX  (0x01u)
+
+void
+log_pingpong_init(struct log_pingpong *pp, uint32_t (*timestamp_fn)(void))
+{
+        if (pp == NULL) {
+                return;
+        }
+        log_init(&pp->ctx[0], timestamp_fn);
+        log_init(&pp->ctx[1], timestamp_fn);
+        pp->active = 0u;
+        atomic_init(&pp->slot, (uint_least8_t)(SLOT_FREE | 1u));
+}
+
+struct log_ctx *
+log_pingpong_producer(struct log_pingpong *pp)
+{
+        if (pp == NULL) {
+                return NULL;
+        }
+        return &pp->ctx[pp->active];
+}
+
+uint8_t
+log_pingpong_publish(struct log_pingpong *pp)
+{
+        if ((pp == NULL) || (pp->ctx[pp->active].count == 0u)) {
+                return 0u;
+        }
+        /* Only the producer moves the slot out of the free state. */
+        uint_least8_t s = atomic_load_explicit(&pp->slot, memory_order_acquire);
+        if ((s & SLOT_FREE) == 0u) {
+                return 0u;
+        }
+        /* Streamed entries are not ordered by the exchange everywhere. */
+        log_stream_fence();
+        s = atomic_exchange_explicit(&pp->slot,
+                                     (uint_least8_t)(SLOT_FULL | pp->active),
+                                     memory_order_acq_rel);
+        pp->active = (uint8_t)(s & SLOT_IDX);
+        log_clear(&pp->ctx[pp->active]);
+        return 1u;
+}
+
+const struct log_ctx *
+log_pingpong_acquire(struct log_pingpong *pp)
+{
+        if (pp == NULL) {
+                return NULL;
+        }
+        uint_least8_t s = atomic_load_explicit(&pp->slot, memory_order_acquire);
+        if ((s & SLOT_FULL) == 0u) {
+                return NULL;
+        }
+        return &pp->ctx[s & SLOT_IDX];
+}
+
+void
+log_pingpong_release(struct log_pingpong *pp)
+{
+        if (pp == NULL) {
+                return;
+        }
+        /* Only the consumer moves the slot out of the full state. */
+        uint_least8_t s = atomic_load_explicit(&pp->slot, memory_order_relaxed);
+        if ((s & SLOT_FULL) == 0u) {
+                return;
+        }
+        atomic_store_explicit(&pp->slot,
+                              (uint_least8_t)(SLOT_FREE | (s & SLOT_IDX)),
+                              memory_order_release);
+}
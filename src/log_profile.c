@@ -0,0 +1,152 @@
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "../include/log_profile.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <x86intrin.h>
+#endif
+
+void
+log_profile_init(struct log_profile *p)
+{
+        if (p == NULL) {
+                return;
+        }
+        (void)memset(p, 0, sizeof(*p));
+}
+
+uint8_t
+log_set_profile(struct log_ctx *ctx, struct log_profile *p)
+{
+#if LOG_PROFILE
+        if (ctx == NULL) {
+                return 0u;
+        }
+        ctx->profile = p;
+        return 1u;
+#else
+        (void)ctx;
+        (void)p;
+        return 0u;
+#endif
+}
+
+uint8_t
+log_set_tap(struct log_ctx *ctx, struct log_tap *t)
+{
+#if LOG_PROFILE
+        if (ctx == NULL) {
+                return 0u;
+        }
+        ctx->tap = t;
+        return 1u;
+#else
+        (void)ctx;
+        (void)t;
+        return 0u;
+#endif
+}
+
+#if defined(__GNUC__)
+__attribute__((weak))
+#endif
+uint64_t
+log_profile_cycles(void)
+{
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+        return __rdtsc();
+#elif defined(__GNUC__) && defined(__aarch64__)
+        uint64_t v;
+        __asm__ volatile("mrs %0, cntvct_el0" : "=r"(v));
+        return v;
+#else
+        return 0u;
+#endif
+}
+
+uint32_t
+log_profile_hash(const void *site, const char *fmt)
+{
+        uintptr_t k = (uintptr_t)site ^ ((uintptr_t)fmt * 31u);
+        uint32_t h = (uint32_t)(k ^ (k >> 16)) * 2654435761u;
+        return h >> 8;
+}
+
+void
+log_profile_record(struct log_profile *p, const void *site, const char *fmt,
+                   uint64_t cycles, int len)
+{
+        if ((p == NULL) || (fmt == NULL)) {
+                return;
+        }
+        uint32_t h = log_profile_hash(site, fmt);
+        struct log_profile_site *s = NULL;
+        for (uint32_t i = 0u; i < LOG_PROFILE_SITES; ++i) {
+                struct log_profile_site *t = &p->site[(h + i)
+                                                      % LOG_PROFILE_SITES];
+                if (t->fmt == NULL) {
+                        t->site = site;
+                        t->fmt = fmt;
+                        p->used++;
+                        s = t;
+                        break;
+                }
+                if ((t->site == site) && (t->fmt == fmt)) {
+                        s = t;
+                        break;
+                }
+        }
+        if (s == NULL) {
+                p->lost++;
+                return;
+        }
+        uint32_t n = (len > 0) ? (uint32_t)len : 0u;
+        if (n > (LOG_MSG_LEN - 1u)) {
+                n = LOG_MSG_LEN - 1u;
+                s->truncated++;
+        }
+        s->calls++;
+        s->cycles += cycles;
+        s->bytes += n;
+}
+
+static uint8_t
+costlier(const struct log_profile_site *a, const struct log_profile_site *b)
+{
+        return (uint8_t)((a->cycles > b->cycles)
+                         || ((a->cycles == b->cycles)
+                             && (a->calls > b->calls)));
+}
+
+uint16_t
+log_profile_report(const struct log_profile *p,
+                   const struct log_profile_site **out, uint16_t max)
+{
+        if ((p == NULL) || (out == NULL)) {
+                return 0u;
+        }
+        uint16_t n = 0u;
+        for (uint32_t i = 0u; i < LOG_PROFILE_SITES; ++i) {
+                const struct log_profile_site *s = &p->site[i];
+                if (s->fmt == NULL) {
+                        continue;
+                }
+                /* Insertion into the sorted top max. */
+                uint16_t k = n;
+                if (n < max) {
+                        n++;
+                } else if ((max == 0u) || (costlier(s, out[max - 1u]) == 0u)) {
+                        continue;
+                } else {
+                        k = max - 1u;
+                }
+                while ((k > 0u) && (costlier(s, out[k - 1u]) != 0u)) {
+                        out[k] = out[k - 1u];
+                        k--;
+                }
+                out[k] = s;
+        }
+        return n;
+}
@@ -0,0 +1,113 @@
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "../include/log_rate.h"
+
+_Static_assert((LOG_RATE_BUCKETS > 0u) && (LOG_RATE_BUCKETS <= 255u),
+               "bucket index must fit in one byte");
+
+int
+log_rate_init(struct log_rate *r, uint32_t width, uint32_t module_mask)
+{
+        if ((r == NULL) || (width == 0u)) {
+                return -1;
+        }
+        (void)memset(r, 0, sizeof(*r));
+        r->width = width;
+        r->module_mask = module_mask;
+        return 0;
+}
+
+void
+log_rate_add(struct log_ctx *ctx, struct log_rate *r)
+{
+        if ((ctx == NULL) || (r == NULL) || (r->width == 0u)) {
+                return;
+        }
+        struct log_rate **p = &ctx->rate;
+        while (*p != NULL) {
+                if (*p == r) {
+                        return;
+                }
+                p = &(*p)->next;
+        }
+        r->next = NULL;
+        *p = r;
+}
+
+void
+log_rate_remove(struct log_ctx *ctx, struct log_rate *r)
+{
+        if ((ctx == NULL) || (r == NULL)) {
+                return;
+        }
+        for (struct log_rate **p = &ctx->rate; *p != NULL; p = &(*p)->next) {
+                if (*p == r) {
+                        *p = r->next;
+                        r->next = NULL;
+                        return;
+                }
+        }
+}
+
+/* Buckets that ended between the start of the current one and now. */
+static uint32_t
+expired(const struct log_rate *r, uint32_t now)
+{
+        uint32_t elapsed = now - r->start;
+        if ((int32_t)elapsed < 0) {
+                return 0u;
+        }
+        return elapsed / r->width;
+}
+
+void
+log_rate_update(struct log_rate *r, const struct log_entry *e)
+{
+        if ((r == NULL) || (e == NULL) || (e->level >= LOG_LEVELS)
+            || ((r->module_mask & LOG_MODULE_BIT(e->module)) == 0u)) {
+                return;
+        }
+        if (r->started == 0u) {
+                r->start = e->timestamp;
+                r->started = 1u;
+        }
+        uint32_t steps = expired(r, e->timestamp);
+        if (steps >= LOG_RATE_BUCKETS) {
+                (void)memset(r->total, 0, sizeof(r->total));
+                (void)memset(r->count, 0, sizeof(r->count));
+        } else {
+                for (uint32_t s = 0u; s < steps; ++s) {
+                        /* The oldest bucket becomes the current one. */
+                        r->current = (uint8_t)((r->current + 1u)
+                                               % LOG_RATE_BUCKETS);
+                        uint32_t *c = r->count[r->current];
+                        for (uint8_t l = 0u; l < LOG_LEVELS; ++l) {
+                                r->total[l] -= c[l];
+                                c[l] = 0u;
+                        }
+                }
+        }
+        r->start += steps * r->width;
+        r->count[r->current][e->level]++;
+        r->total[e->level]++;
+}
+
+uint32_t
+log_rate_count(const struct log_rate *r, enum log_level level, uint32_t now)
+{
+        if ((r == NULL) || ((uint32_t)level >= LOG_LEVELS)
+            || (r->started == 0u)) {
+                return 0u;
+        }
+        uint32_t steps = expired(r, now);
+        if (steps >= LOG_RATE_BUCKETS) {
+                return 0u;
+        }
+        uint32_t n = r->total[level];
+        for (uint32_t s = 1u; s <= steps; ++s) {
+                n -= r->count[(r->current + s) % LOG_RATE_BUCKETS][level];
+        }
+        return n;
+}
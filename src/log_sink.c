@@ -0,0 +1,155 @@
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "../include/log_filter.h"
+#include "../include/log_sink.h"
+
+void
+log_sink_init(struct log_sink *s, log_sink_write_fn write, void *user,
+              enum log_level min_level, uint32_t module_mask)
+{
+        if (s == NULL) {
+                return;
+        }
+        s->write = write;
+        s->user = user;
+        s->pos = 0u;
+        s->gen = 0u;
+        s->dropped = 0u;
+        s->module_mask = module_mask;
+        s->min_level = (uint8_t)min_level;
+        s->filter = NULL;
+}
+
+void
+log_sink_set_filter(struct log_sink *s, const struct log_filter *f)
+{
+        if (s == NULL) {
+                return;
+        }
+        s->filter = f;
+}
+
+void
+log_sink_seek(struct log_sink *s, const struct log_ctx *ctx, uint8_t newest)
+{
+        if ((s == NULL) || (ctx == NULL)) {
+                return;
+        }
+        s->pos = (newest != 0u) ? log_get_seq(ctx) : log_get_seq_at(ctx, 0u);
+        s->gen = ctx->gen;
+}
+
+static uint8_t
+sink_accepts(const struct log_sink *s, const struct log_entry *e)
+{
+        return (uint8_t)((e->level >= s->min_level)
+                         && (e->module < LOG_MODULES)
+                         && ((s->module_mask & LOG_MODULE_BIT(e->module))
+                             != 0u)
+                         && ((s->filter == NULL)
+                             || (log_filter_match(s->filter, e) != 0u)));
+}
+
+uint16_t
+log_sink_drain(struct log_sink *s, const struct log_ctx *ctx, uint16_t budget)
+{
+        if ((s == NULL) || (ctx == NULL) || (s->write == NULL)) {
+                return 0u;
+        }
+
+        /* Live: [pin, pin_end) pinned, then [ring, end) of which entries
+         * before live have expired. Anything else was overwritten, and
+         * holes left by quota evictions read as NULL. */
+        uint32_t end = log_get_seq(ctx);
+        uint32_t pin;
+        uint16_t npin = log_get_pinned(ctx, &pin);
+        uint32_t ring = log_get_seq_at(ctx, npin);
+        uint32_t live = log_get_seq_at(ctx, log_first_live(ctx));
+        uint32_t pin_end = pin + npin;
+        if (npin == 0u) {
+                pin = ring;
+                pin_end = ring;
+        }
+        /* Re-initialised since the last drain: start over. A sink that
+         * has never seen the context just takes its generation. */
+        if (((s->gen != ctx->gen) && (s->gen != 0u))
+            || ((int32_t)(s->pos - end) > 0)) {
+                s->pos = pin;
+        }
+        s->gen = ctx->gen;
+        if ((int32_t)(pin - s->pos) > 0) {
+                s->dropped += pin - s->pos;
+                s->pos = pin;
+        }
+
+        uint16_t delivered = 0u;
+        while ((budget > 0u) && (s->pos != end)) {
+                if (((int32_t)(s->pos - pin_end) >= 0)
+                    && ((int32_t)(ring - s->pos) > 0)) {
+                        s->dropped += ring - s->pos;
+                        s->pos = ring;
+                }
+                if (((int32_t)(s->pos - ring) >= 0)
+                    && ((int32_t)(live - s->pos) > 0)) {
+                        s->pos = live;
+                        if (s->pos == end) {
+                                break;
+                        }
+                }
+                const struct log_entry *e = log_get_entry_seq(ctx, s->pos);
+                if (e == NULL) {
+                        s->dropped++;
+                } else if (sink_accepts(s, e) != 0u) {
+                        if (s->write(s->user, e, s->pos) != 0) {
+                                break;
+                        }
+                        delivered++;
+                }
+                s->pos++;
+                budget--;
+        }
+        return delivered;
+}
+
+uint32_t
+log_fanout_drain(struct log_sink *s, uint8_t n, const struct log_ctx *ctx,
+                 uint16_t budget)
+{
+        if (s == NULL) {
+                return 0u;
+        }
+        uint32_t total = 0u;
+        for (uint8_t i = 0u; i < n; ++i) {
+                total += log_sink_drain(&s[i], ctx, budget);
+        }
+        return total;
+}
+
+static const char *
+level_name(uint16_t level)
+{
+        switch (level) {
+        case INFO: return "INFO";
+        case WARN: return "WARN";
+        case FAULT: return "FAULT";
+        default: return "?";
+        }
+}
+
+size_t
+log_format(const struct log_entry *e, char *buf, size_t len)
+{
+        if ((e == NULL) || (buf == NULL) || (len == 0u)) {
+                return 0u;
+        }
+        int n = snprintf(buf, len, "[%lu] %s: %.*s\n",
+                         (unsigned long)e->timestamp, level_name(e->level),
+                         (int)(LOG_MSG_LEN - 1u), e->msg);
+        if (n < 0) {
+                buf[0] = '\0';
+                return 0u;
+        }
+        return ((size_t)n < len) ? (size_t)n : (len - 1u);
+}
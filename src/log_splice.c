@@ -0,0 +1,116 @@
+#define _GNU_SOURCE
+
+#include <errno.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "../include/log_splice.h"
+
+#ifdef __linux__
+#include <fcntl.h>
+#include <sys/ioctl.h>
+#include <sys/uio.h>
+#endif
+
+void
+log_splice_init(struct log_splice *s, struct log_pingpong *pp, int pipe_fd)
+{
+        if (s == NULL) {
+                return;
+        }
+        *s = (struct log_splice){ .pp = pp, .fd = pipe_fd };
+}
+
+#ifdef __linux__
+
+/* Bytes the reader has not consumed yet. */
+static int
+pipe_unread(int fd)
+{
+        int n = 0;
+        if (ioctl(fd, FIONREAD, &n) != 0) {
+                return -1;
+        }
+        return n;
+}
+
+/* Describe held[off..len) as iovecs over the buffer itself. */
+static int
+held_iov(const struct log_splice *s, struct iovec iov[LOG_SPANS_MAX])
+{
+        const struct log_entry *span[LOG_SPANS_MAX];
+        uint16_t len[LOG_SPANS_MAX];
+        uint8_t n = log_get_spans(s->held, span, len);
+        size_t skip = s->off;
+        int out = 0;
+
+        for (uint8_t i = 0u; i < n; ++i) {
+                size_t bytes = (size_t)len[i] * sizeof(struct log_entry);
+                if (skip >= bytes) {
+                        skip -= bytes;
+                        continue;
+                }
+                iov[out].iov_base = (uint8_t *)(uintptr_t)span[i] + skip;
+                iov[out].iov_len = bytes - skip;
+                skip = 0u;
+                out++;
+        }
+        return out;
+}
+
+long
+log_splice_pump(struct log_splice *s)
+{
+        if ((s == NULL) || (s->pp == NULL)) {
+                errno = EINVAL;
+                return -1;
+        }
+
+        if ((s->held != NULL) && (s->off == s->len)) {
+                int unread = pipe_unread(s->fd);
+                if (unread < 0) {
+                        return -1;
+                }
+                if (unread > 0) {
+                        return 0;
+                }
+                log_pingpong_release(s->pp);
+                s->held = NULL;
+                s->buffers++;
+        }
+
+        if (s->held == NULL) {
+                s->held = log_pingpong_acquire(s->pp);
+                if (s->held == NULL) {
+                        return 0;
+                }
+                s->off = 0u;
+                s->len = (size_t)log_get_count(s->held)
+                       * sizeof(struct log_entry);
+        }
+
+        struct iovec iov[LOG_SPANS_MAX];
+        int n = held_iov(s, iov);
+        if (n == 0) {
+                return 0;
+        }
+        ssize_t w = vmsplice(s->fd, iov, (unsigned long)n, SPLICE_F_NONBLOCK);
+        if (w < 0) {
+                return ((errno == EAGAIN) || (errno == EINTR)) ? 0 : -1;
+        }
+        s->off += (size_t)w;
+        s->bytes += (uint64_t)w;
+        return (long)w;
+}
+
+#else
+
+long
+log_splice_pump(struct log_splice *s)
+{
+        (void)s;
+        errno = ENOSYS;
+        return -1;
+}
+
+#endif
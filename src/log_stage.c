@@ -0,0 +1,251 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <errno.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "../include/log_stage.h"
+
+#define ANNOUNCED (1ull << 32)
+
+static uint32_t
+now(const struct log_stage_hub *h)
+{
+        return (h->ctx->timestamp_fn != NULL) ? h->ctx->timestamp_fn()
+                                              : log_timestamp_default();
+}
+
+/* a is later than b, comparing across wrap. */
+static int
+later(uint32_t a, uint32_t b)
+{
+        return (int32_t)(a - b) > 0;
+}
+
+static void
+release(struct log_stage_hub *h, uint16_t n)
+{
+        for (uint16_t i = 0u; i < n; ++i) {
+                log_put_entry(h->ctx, &h->hold[i]);
+        }
+        h->held = (uint16_t)(h->held - n);
+        (void)memmove(h->hold, &h->hold[n], h->held * sizeof(h->hold[0]));
+}
+
+/* Merge a sorted batch into the hold buffer, under lock. */
+static void
+hold_merge(struct log_stage_hub *h, const struct log_entry *e, uint16_t n)
+{
+        /* No room: release the oldest of both, order is lost for these. */
+        while ((h->held + n) > LOG_STAGE_HOLD) {
+                if ((h->held > 0u)
+                    && ((n == 0u) || !later(h->hold[0].timestamp,
+                                            e->timestamp))) {
+                        release(h, 1u);
+                } else {
+                        log_put_entry(h->ctx, e);
+                        e++;
+                        n--;
+                }
+                h->forced++;
+        }
+        uint32_t i = h->held;
+        uint32_t j = n;
+        uint32_t k = (uint32_t)h->held + n;
+        while (j > 0u) {
+                if ((i > 0u) && later(h->hold[i - 1u].timestamp,
+                                      e[j - 1u].timestamp)) {
+                        h->hold[--k] = h->hold[--i];
+                } else {
+                        h->hold[--k] = e[--j];
+                }
+        }
+        h->held = (uint16_t)(h->held + n);
+}
+
+/* Release held entries no staged entry can precede, under lock. */
+static void
+hold_release(struct log_stage_hub *h)
+{
+        uint8_t bound = 0u;
+        uint32_t mark = 0u;
+        for (uint32_t s = 0u; s < LOG_STAGE_THREADS; ++s) {
+                uint64_t v = atomic_load(&h->stage[s].oldest);
+                if ((v != 0u) && ((bound == 0u) || later(mark, (uint32_t)v))) {
+                        mark = (uint32_t)v;
+                        bound = 1u;
+                }
+        }
+        uint16_t n = 0u;
+        while ((n < h->held)
+               && ((bound == 0u) || !later(h->hold[n].timestamp, mark))) {
+                n++;
+        }
+        release(h, n);
+        /* Readers take the lock, which need not order streamed stores. */
+        log_stream_fence();
+}
+
+static void
+publish(struct log_stage_hub *h, struct log_stage *st)
+{
+        (void)pthread_mutex_lock(&h->lock);
+        hold_merge(h, st->entry, st->n);
+        atomic_store(&st->oldest, 0u);
+        st->n = 0u;
+        hold_release(h);
+        h->batches++;
+        (void)pthread_mutex_unlock(&h->lock);
+}
+
+static void
+stage_exit(void *arg)
+{
+        struct log_stage *st = arg;
+        struct log_stage_hub *h = st->hub;
+        publish(h, st);
+        (void)pthread_mutex_lock(&h->lock);
+        st->used = 0u;
+        (void)pthread_mutex_unlock(&h->lock);
+}
+
+static struct log_stage *
+stage_get(struct log_stage_hub *h)
+{
+        struct log_stage *st = pthread_getspecific(h->key);
+        if (st != NULL) {
+                return st;
+        }
+        (void)pthread_mutex_lock(&h->lock);
+        for (uint32_t s = 0u; s < LOG_STAGE_THREADS; ++s) {
+                if (h->stage[s].used == 0u) {
+                        st = &h->stage[s];
+                        st->used = 1u;
+                        break;
+                }
+        }
+        (void)pthread_mutex_unlock(&h->lock);
+        if ((st != NULL) && (pthread_setspecific(h->key, st) != 0)) {
+                (void)pthread_mutex_lock(&h->lock);
+                st->used = 0u;
+                (void)pthread_mutex_unlock(&h->lock);
+                st = NULL;
+        }
+        return st;
+}
+
+int
+log_stage_hub_init(struct log_stage_hub *h, struct log_ctx *ctx)
+{
+        if ((h == NULL) || (ctx == NULL)) {
+                errno = EINVAL;
+                return -1;
+        }
+        h->ctx = ctx;
+        h->held = 0u;
+        h->batches = 0u;
+        h->forced = 0u;
+        for (uint32_t s = 0u; s < LOG_STAGE_THREADS; ++s) {
+                h->stage[s].hub = h;
+                h->stage[s].n = 0u;
+                h->stage[s].used = 0u;
+                atomic_init(&h->stage[s].oldest, 0u);
+        }
+        int rc = pthread_key_create(&h->key, stage_exit);
+        if (rc == 0) {
+                rc = pthread_mutex_init(&h->lock, NULL);
+                if (rc != 0) {
+                        (void)pthread_key_delete(h->key);
+                }
+        }
+        if (rc != 0) {
+                errno = rc;
+                return -1;
+        }
+        return 0;
+}
+
+void
+log_stage_event(struct log_stage_hub *h, uint8_t module, enum log_level level,
+                const char *fmt, ...)
+{
+        if ((h == NULL) || (fmt == NULL) || ((uint32_t)level >= LOG_LEVELS)
+            || (module >= LOG_MODULES)) {
+                return;
+        }
+        va_list args;
+        struct log_stage *st = stage_get(h);
+        if (st == NULL) {
+                struct log_entry e;
+                e.level = (uint16_t)level;
+                e.module = module;
+                va_start(args, fmt);
+                (void)vsnprintf(e.msg, (size_t)LOG_MSG_LEN, fmt, args);
+                va_end(args);
+                /* Stamped under lock, so nothing staged can be newer. */
+                (void)pthread_mutex_lock(&h->lock);
+                e.timestamp = now(h);
+                hold_merge(h, &e, 1u);
+                hold_release(h);
+                (void)pthread_mutex_unlock(&h->lock);
+                return;
+        }
+
+        if (st->n == 0u) {
+                /* Announce before stamping, so a publisher that misses the
+                 * announcement only holds entries older than ours. */
+                atomic_store(&st->oldest, ANNOUNCED | now(h));
+        }
+        struct log_entry *e = &st->entry[st->n];
+        e->timestamp = now(h);
+        e->level = (uint16_t)level;
+        e->module = module;
+        va_start(args, fmt);
+        (void)vsnprintf(e->msg, (size_t)LOG_MSG_LEN, fmt, args);
+        va_end(args);
+        st->n++;
+        if ((st->n == LOG_STAGE_ENTRIES) || (level == FAULT)) {
+                publish(h, st);
+        }
+}
+
+void
+log_stage_flush(struct log_stage_hub *h)
+{
+        if (h == NULL) {
+                return;
+        }
+        struct log_stage *st = pthread_getspecific(h->key);
+        if (st != NULL) {
+                publish(h, st);
+        }
+}
+
+void
+log_stage_hub_destroy(struct log_stage_hub *h)
+{
+        if (h == NULL) {
+                return;
+        }
+        struct log_stage *st = pthread_getspecific(h->key);
+        if (st != NULL) {
+                (void)pthread_setspecific(h->key, NULL);
+                stage_exit(st);
+        }
+        (void)pthread_mutex_lock(&h->lock);
+        for (uint32_t s = 0u; s < LOG_STAGE_THREADS; ++s) {
+                st = &h->stage[s];
+                if (st->n > 0u) {
+                        hold_merge(h, st->entry, st->n);
+                        st->n = 0u;
+                }
+                atomic_store(&st->oldest, 0u);
+        }
+        release(h, h->held);
+        (void)pthread_mutex_unlock(&h->lock);
+        (void)pthread_key_delete(h->key);
+        (void)pthread_mutex_destroy(&h->lock);
+}
@@ -0,0 +1,346 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "../include/log_store.h"
+
+static uint64_t
+now_ms(void)
+{
+        struct timespec ts;
+        (void)clock_gettime(CLOCK_MONOTONIC, &ts);
+        return ((uint64_t)ts.tv_sec * 1000u) + ((uint64_t)ts.tv_nsec / 1000000u);
+}
+
+/* Entries [from, to) were overwritten before they were stored. */
+static void
+store_lost(struct log_store *s, uint32_t from, uint32_t to)
+{
+        if (s->lost_from == s->lost_to) {
+                s->lost_from = from;
+        }
+        s->lost_to = to;
+}
+
+static int
+write_all(int fd, const uint8_t *buf, size_t len)
+{
+        while (len > 0u) {
+                ssize_t n = write(fd, buf, len);
+                if (n < 0) {
+                        if (errno == EINTR) {
+                                continue;
+                        }
+                        return -1;
+                }
+                buf += n;
+                len -= (size_t)n;
+        }
+        return 0;
+}
+
+/* Sink callback: stage the entry, noting entries skipped before it. */
+static int
+store_append(void *user, const struct log_entry *e, uint32_t seq)
+{
+        struct log_store *s = user;
+        if (seq != s->next) {
+                store_lost(s, s->next, seq);
+        }
+        if (log_batch_write(&s->staging, e, seq) != 0) {
+                return 1;
+        }
+        s->next = seq + 1u;
+        return 0;
+}
+
+int
+log_store_open(struct log_store *s, struct log_ctx *ctx, const char *path,
+               enum log_store_mode mode, size_t size)
+{
+        if ((s == NULL) || (ctx == NULL) || (path == NULL)
+            || ((mode == LOG_STORE_MMAP) && (size < LOG_EXPORT_HEADER_LEN))) {
+                errno = EINVAL;
+                return -1;
+        }
+        *s = (struct log_store){ .ctx = ctx, .mode = mode, .fd = -1 };
+
+        if (mode == LOG_STORE_FILE) {
+                s->fd = open(path, O_WRONLY | O_CREAT | O_APPEND, 0644);
+        } else {
+                s->fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+        }
+        if (s->fd < 0) {
+                return -1;
+        }
+
+        struct stat st;
+        uint8_t hdr[LOG_EXPORT_HEADER_LEN];
+        size_t hdr_len = log_export_header(hdr, sizeof(hdr));
+        if (mode == LOG_STORE_FILE) {
+                if ((fstat(s->fd, &st) != 0)
+                    || ((st.st_size == 0)
+                        && (write_all(s->fd, hdr, hdr_len) != 0))) {
+                        goto fail;
+                }
+        } else {
+                if (ftruncate(s->fd, (off_t)size) != 0) {
+                        goto fail;
+                }
+                void *p = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED,
+                               s->fd, 0);
+                if (p == MAP_FAILED) {
+                        goto fail;
+                }
+                s->map = p;
+                s->map_len = size;
+                for (size_t i = 0u; i < hdr_len; ++i) {
+                        s->map[i] = hdr[i];
+                }
+                s->off = hdr_len;
+        }
+
+        log_sink_init(&s->sink, store_append, s, INFO, LOG_MODULES_ALL);
+        log_sink_seek(&s->sink, ctx, 0u);
+        s->durable = s->sink.pos;
+        s->next = s->sink.pos;
+        s->lost_from = s->sink.pos;
+        s->lost_to = s->sink.pos;
+        s->last_ms = now_ms();
+        if ((pthread_mutex_init(&s->lock, NULL) != 0)
+            || (pthread_cond_init(&s->done, NULL) != 0)) {
+                errno = ENOMEM;
+                goto fail;
+        }
+        return 0;
+
+fail:
+        if (s->map != NULL) {
+                (void)munmap(s->map, s->map_len);
+                s->map = NULL;
+        }
+        (void)close(s->fd);
+        s->fd = -1;
+        return -1;
+}
+
+void
+log_store_policy(struct log_store *s, uint32_t every, uint32_t interval_ms)
+{
+        if (s == NULL) {
+                return;
+        }
+        (void)pthread_mutex_lock(&s->lock);
+        s->every = every;
+        s->interval_ms = interval_ms;
+        (void)pthread_mutex_unlock(&s->lock);
+}
+
+/* Move pending entries from the context to the file. Lock held. */
+static int
+store_write(struct log_store *s)
+{
+        for (;;) {
+                if (s->mode == LOG_STORE_FILE) {
+                        s->staging = (struct log_batch_buf){
+                            .buf = s->buf, .cap = sizeof(s->buf)};
+                } else {
+                        s->staging = (struct log_batch_buf){
+                            .buf = &s->map[s->off], .cap = s->map_len - s->off};
+                }
+                uint32_t start = s->sink.pos;
+                (void)log_sink_drain(&s->sink, s->ctx, UINT16_MAX);
+                if (s->staging.count == 0u) {
+                        break;
+                }
+                if ((s->mode == LOG_STORE_FILE)
+                    && (write_all(s->fd, s->buf, s->staging.len) != 0)) {
+                        s->sink.pos = start;
+                        s->next = start;
+                        return -1;
+                }
+                s->off += s->staging.len;
+        }
+        if (s->sink.pos != s->next) {
+                store_lost(s, s->next, s->sink.pos);
+                s->next = s->sink.pos;
+        }
+        if (s->sink.pos != log_get_seq(s->ctx)) {
+                errno = ENOSPC;
+                return -1;
+        }
+        return 0;
+}
+
+/* Lead one commit. Called and returns with the lock held. */
+static void
+store_commit(struct log_store *s)
+{
+        s->syncing = 1u;
+        if (store_write(s) != 0) {
+                s->error = errno;
+        }
+        uint32_t target = s->sink.pos;
+        size_t from = s->synced;
+        size_t to = s->off;
+        (void)pthread_mutex_unlock(&s->lock);
+
+        int rc;
+        if (s->mode == LOG_STORE_FILE) {
+                rc = fdatasync(s->fd);
+        } else {
+                long pg = sysconf(_SC_PAGESIZE);
+                size_t start = from - (from % (size_t)((pg > 0) ? pg : 4096));
+                rc = (to > from) ? msync(&s->map[start], to - start, MS_SYNC)
+                                 : 0;
+        }
+        int err = errno;
+
+        (void)pthread_mutex_lock(&s->lock);
+        if (rc != 0) {
+                if (s->error == 0) {
+                        s->error = err;
+                }
+        } else {
+                s->durable = target;
+                s->synced = to;
+        }
+        s->syncing = 0u;
+        s->syncs++;
+        s->last_ms = now_ms();
+        (void)pthread_cond_broadcast(&s->done);
+}
+
+/* Start a commit if the policy asks for one. Lock held. */
+static void
+store_maybe_commit(struct log_store *s)
+{
+        uint32_t pending = log_get_seq(s->ctx) - s->durable;
+        if ((s->syncing != 0u) || (s->error != 0) || (pending == 0u)) {
+                return;
+        }
+        if (((s->every != 0u) && (pending >= s->every))
+            || ((s->interval_ms != 0u)
+                && ((now_ms() - s->last_ms) >= s->interval_ms))) {
+                store_commit(s);
+        }
+}
+
+int
+log_store_event(struct log_store *s, uint32_t *seq, uint8_t module,
+                enum log_level level, const char *fmt, ...)
+{
+        if (s == NULL) {
+                errno = EINVAL;
+                return -1;
+        }
+        va_list ap;
+        va_start(ap, fmt);
+        (void)pthread_mutex_lock(&s->lock);
+        uint32_t next = log_get_seq(s->ctx);
+        log_vevent(s->ctx, module, level, fmt, ap);
+        uint8_t logged = (log_get_seq(s->ctx) != next) ? 1u : 0u;
+        if (logged != 0u) {
+                store_maybe_commit(s);
+        }
+        (void)pthread_mutex_unlock(&s->lock);
+        va_end(ap);
+        if (logged == 0u) {
+                errno = EINVAL;
+                return -1;
+        }
+        if (seq != NULL) {
+                *seq = next;
+        }
+        return 0;
+}
+
+int
+log_store_poll(struct log_store *s)
+{
+        if (s == NULL) {
+                errno = EINVAL;
+                return -1;
+        }
+        (void)pthread_mutex_lock(&s->lock);
+        store_maybe_commit(s);
+        int err = s->error;
+        (void)pthread_mutex_unlock(&s->lock);
+        if (err != 0) {
+                errno = err;
+                return -1;
+        }
+        return 0;
+}
+
+int
+log_store_sync(struct log_store *s, uint32_t seq)
+{
+        if (s == NULL) {
+                errno = EINVAL;
+                return -1;
+        }
+        (void)pthread_mutex_lock(&s->lock);
+        int err = ((int32_t)(seq - log_get_seq(s->ctx)) >= 0) ? EINVAL : 0;
+        while ((err == 0) && ((int32_t)(s->durable - seq) <= 0)
+               && (s->error == 0)) {
+                if (s->syncing != 0u) {
+                        (void)pthread_cond_wait(&s->done, &s->lock);
+                } else {
+                        store_commit(s);
+                }
+        }
+        if (err == 0) {
+                if ((int32_t)(s->durable - seq) <= 0) {
+                        err = s->error;
+                } else if (((int32_t)(seq - s->lost_from) >= 0)
+                           && ((int32_t)(s->lost_to - seq) > 0)) {
+                        err = ENODATA;
+                }
+        }
+        (void)pthread_mutex_unlock(&s->lock);
+        if (err != 0) {
+                errno = err;
+                return -1;
+        }
+        return 0;
+}
+
+int
+log_store_close(struct log_store *s)
+{
+        if ((s == NULL) || (s->fd < 0)) {
+                errno = EINVAL;
+                return -1;
+        }
+        int rc = 0;
+        (void)pthread_mutex_lock(&s->lock);
+        uint32_t end = log_get_seq(s->ctx);
+        uint8_t pending = (end != s->durable) ? 1u : 0u;
+        (void)pthread_mutex_unlock(&s->lock);
+        if (pending != 0u) {
+                rc = log_store_sync(s, end - 1u);
+        }
+        if (s->map != NULL) {
+                (void)munmap(s->map, s->map_len);
+                s->map = NULL;
+                if ((ftruncate(s->fd, (off_t)s->off) != 0) && (rc == 0)) {
+                        rc = -1;
+                }
+        }
+        if ((close(s->fd) != 0) && (rc == 0)) {
+                rc = -1;
+        }
+        s->fd = -1;
+        (void)pthread_cond_destroy(&s->done);
+        (void)pthread_mutex_destroy(&s->lock);
+        return rc;
+}
@@ -0,0 +1,131 @@
+#include <stddef.h>
+#include <stdint.h>
+
+#include "../include/log_topn.h"
+
+#define FNV_OFFSET (2166136261u)
+#define FNV_PRIME  (16777619u)
+
+static uint32_t
+fnv_byte(uint32_t h, uint8_t c)
+{
+        return (h ^ (uint32_t)c) * FNV_PRIME;
+}
+
+static uint32_t
+msg_hash(const char *msg, uint32_t *len)
+{
+        uint32_t h = FNV_OFFSET;
+        uint32_t n = 0u;
+        uint8_t in_digits = 0u;
+
+        while ((n < LOG_MSG_LEN) && (msg[n] != '\0')) {
+                char c = msg[n];
+                if ((c >= '0') && (c <= '9')) {
+                        if (in_digits == 0u) {
+                                h = fnv_byte(h, (uint8_t)'#');
+                        }
+                        in_digits = 1u;
+                } else {
+                        h = fnv_byte(h, (uint8_t)c);
+                        in_digits = 0u;
+                }
+                n++;
+        }
+        *len = n;
+        return h;
+}
+
+uint32_t
+log_msg_hash(const char *msg)
+{
+        uint32_t len;
+        if (msg == NULL) {
+                return FNV_OFFSET;
+        }
+        return msg_hash(msg, &len);
+}
+
+static void
+sketch_add(struct log_topn *top, uint32_t h, uint32_t bytes, uint16_t idx)
+{
+        uint16_t min = 0u;
+        for (uint16_t i = 0u; i < top->used; ++i) {
+                struct log_topn_item *it = &top->item[i];
+                if (it->hash == h) {
+                        it->count++;
+                        it->bytes += bytes;
+                        it->last = idx;
+                        return;
+                }
+                if (it->count < top->item[min].count) {
+                        min = i;
+                }
+        }
+
+        if (top->used < LOG_TOPN_SLOTS) {
+                top->item[top->used] = (struct log_topn_item){
+                    .hash = h, .count = 1u, .bytes = bytes, .last = idx};
+                top->used++;
+                return;
+        }
+
+        /* Space-Saving: the new key inherits the smallest counter. */
+        struct log_topn_item *it = &top->item[min];
+        it->hash = h;
+        it->error = it->count;
+        it->count++;
+        it->bytes += bytes;
+        it->last = idx;
+}
+
+static uint32_t
+metric(const struct log_topn_item *it, enum log_topn_order order)
+{
+        return (order == LOG_TOPN_BY_BYTES) ? it->bytes : (uint32_t)it->count;
+}
+
+uint16_t
+log_topn(const struct log_ctx *ctx, struct log_topn *top,
+         enum log_topn_order order)
+{
+        if (top == NULL) {
+                return 0u;
+        }
+        top->used = 0u;
+        if (ctx == NULL) {
+                return 0u;
+        }
+
+        uint16_t count = log_get_count(ctx);
+        uint16_t npin = log_get_pinned(ctx, NULL);
+        uint16_t live = log_first_live(ctx);
+        for (uint16_t i = 0u; i < count; ++i) {
+                if (i == npin) {
+                        i = live;
+                        if (i >= count) {
+                                break;
+                        }
+                }
+                const struct log_entry *e = log_get_entry(ctx, i);
+                if (e == NULL) {
+                        continue;
+                }
+                uint32_t len;
+                uint32_t h = msg_hash(e->msg, &len);
+                sketch_add(top, h, len, i);
+        }
+
+        for (uint16_t i = 1u; i < top->used; ++i) {
+                struct log_topn_item it = top->item[i];
+                uint16_t j = i;
+                while ((j > 0u)
+                       && (metric(&top->item[j - 1u], order)
+                           < metric(&it, order))) {
+                        top->item[j] = top->item[j - 1u];
+                        j--;
+                }
+                top->item[j] = it;
+        }
+        return top->used;
+}
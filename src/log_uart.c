@@ -0,0 +1,175 @@
+#include <stddef.h>
+#include <stdint.h>
+
+#include "../include/log_uart.h"
+
+#define CRC_LEN (2u)
+
+size_t
+log_cobs_encode(const uint8_t *in, size_t len, uint8_t *out, size_t cap)
+{
+        if ((in == NULL) || (out == NULL) || (cap == 0u)) {
+                return 0u;
+        }
+        size_t code_at = 0u;
+        size_t o = 1u;
+        uint8_t code = 1u;
+
+        for (size_t i = 0u; i < len; ++i) {
+                if (in[i] != 0u) {
+                        if (o >= cap) {
+                                return 0u;
+                        }
+                        out[o++] = in[i];
+                        code++;
+                }
+                if ((in[i] == 0u) || (code == 0xFFu)) {
+                        out[code_at] = code;
+                        code = 1u;
+                        code_at = o;
+                        if (o >= cap) {
+                                return 0u;
+                        }
+                        o++;
+                }
+        }
+        out[code_at] = code;
+        return o;
+}
+
+size_t
+log_cobs_decode(const uint8_t *in, size_t len, uint8_t *out, size_t cap)
+{
+        if ((in == NULL) || (out == NULL)) {
+                return 0u;
+        }
+        size_t i = 0u;
+        size_t o = 0u;
+        while (i < len) {
+                uint8_t code = in[i++];
+                if ((code == 0u) || ((i + code - 1u) > len)) {
+                        return 0u;
+                }
+                for (uint8_t k = 1u; k < code; ++k) {
+                        if ((o >= cap) || (in[i] == 0u)) {
+                                return 0u;
+                        }
+                        out[o++] = in[i++];
+                }
+                if ((code != 0xFFu) && (i < len)) {
+                        if (o >= cap) {
+                                return 0u;
+                        }
+                        out[o++] = 0u;
+                }
+        }
+        return o;
+}
+
+void
+log_uart_init(struct log_uart *u, log_uart_tx_fn tx, void *user,
+              uint32_t source, enum log_level min_level, uint32_t module_mask)
+{
+        if (u == NULL) {
+                return;
+        }
+        u->tx = tx;
+        u->user = user;
+        u->source = source;
+        u->frame_seq = 0u;
+        u->frame_dropped = 0u;
+        u->frames = 0u;
+        u->busy = 0u;
+        u->staging = (struct log_batch_buf){ 0 };
+        log_sink_init(&u->sink, log_batch_write, &u->staging, min_level,
+                      module_mask);
+}
+
+uint8_t
+log_uart_poll(struct log_uart *u, const struct log_ctx *ctx)
+{
+        if ((u == NULL) || (ctx == NULL) || (u->tx == NULL)
+            || (u->busy != 0u)) {
+                return 0u;
+        }
+
+        /* Rewinding to here re-counts the same entries as dropped. */
+        uint32_t start = u->sink.pos;
+        uint32_t dropped = u->sink.dropped;
+        u->staging = (struct log_batch_buf){
+            .buf = &u->raw[LOG_BATCH_HEADER_LEN],
+            .cap = LOG_UART_FRAME_MAX - LOG_BATCH_HEADER_LEN - CRC_LEN};
+        (void)log_sink_drain(&u->sink, ctx, UINT16_MAX);
+        if (u->staging.count == 0u) {
+                return 0u;
+        }
+
+        struct log_batch b = { .source = u->source,
+                               .seq = u->staging.seq,
+                               .dropped = u->sink.dropped,
+                               .count = u->staging.count,
+                               .len = (uint16_t)u->staging.len };
+        size_t n = log_batch_header(&b, u->raw, LOG_BATCH_HEADER_LEN);
+        n += u->staging.len;
+        uint16_t crc = log_crc16(u->raw, n);
+        u->raw[n++] = (uint8_t)(crc & 0xFFu);
+        u->raw[n++] = (uint8_t)(crc >> 8);
+
+        size_t w = log_cobs_encode(u->raw, n, u->wire, sizeof(u->wire) - 1u);
+        u->wire[w++] = 0u;
+
+        u->frame_seq = start;
+        u->frame_dropped = dropped;
+        u->busy = 1u;
+        if (u->tx(u->user, u->wire, w) != 0) {
+                u->sink.pos = start;
+                u->sink.dropped = dropped;
+                u->busy = 0u;
+                return 0u;
+        }
+        return 1u;
+}
+
+void
+log_uart_tx_done(struct log_uart *u, uint8_t ok)
+{
+        if ((u == NULL) || (u->busy == 0u)) {
+                return;
+        }
+        if (ok != 0u) {
+                u->frames++;
+        } else {
+                u->sink.pos = u->frame_seq;
+                u->sink.dropped = u->frame_dropped;
+        }
+        u->busy = 0u;
+}
+
+void
+log_uart_resume(struct log_uart *u, uint32_t seq)
+{
+        if (u == NULL) {
+                return;
+        }
+        u->sink.pos = seq;
+        u->busy = 0u;
+}
+
+size_t
+log_uart_decode(const uint8_t *in, size_t len, uint8_t *out, size_t cap,
+                struct log_batch *b)
+{
+        size_t n = log_cobs_decode(in, len, out, cap);
+        if ((n < (LOG_BATCH_HEADER_LEN + CRC_LEN)) || (b == NULL)) {
+                return 0u;
+        }
+        n -= CRC_LEN;
+        uint16_t crc = (uint16_t)((uint16_t)out[n]
+                                  | ((uint16_t)out[n + 1u] << 8));
+        if ((log_crc16(out, n) != crc)
+            || (log_batch_parse(out, n, b) == 0u)
+            || ((LOG_BATCH_HEADER_LEN + (size_t)b->len) != n)) {
+                return 0u;
+        }
+        return n;
+}
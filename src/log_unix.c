@@ -0,0 +1,254 @@
+#define _GNU_SOURCE
+
+#include <errno.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "../include/log_unix.h"
+
+/* A collector that went away must not raise SIGPIPE in the producer. */
+#ifdef MSG_NOSIGNAL
+#define SEND_FLAGS MSG_NOSIGNAL
+#else
+#define SEND_FLAGS 0
+#endif
+
+static int
+unix_addr(struct sockaddr_un *addr, const char *path)
+{
+        if ((path == NULL) || (strlen(path) >= sizeof(addr->sun_path))) {
+                errno = ENAMETOOLONG;
+                return -1;
+        }
+        (void)memset(addr, 0, sizeof(*addr));
+        addr->sun_family = AF_UNIX;
+        (void)strcpy(addr->sun_path, path);
+        return 0;
+}
+
+int
+log_unix_connect(struct log_unix *u, const char *path, int type,
+                 uint32_t source, enum log_level min_level,
+                 uint32_t module_mask)
+{
+        struct sockaddr_un addr;
+        if ((u == NULL) || (unix_addr(&addr, path) != 0)) {
+                return -1;
+        }
+        int fd = socket(AF_UNIX, type | SOCK_CLOEXEC, 0);
+        if (fd < 0) {
+                return -1;
+        }
+        if (connect(fd, (const struct sockaddr *)&addr, sizeof(addr)) != 0) {
+                int err = errno;
+                (void)close(fd);
+                errno = err;
+                return -1;
+        }
+        log_unix_attach(u, fd, type, source, min_level, module_mask);
+        return 0;
+}
+
+void
+log_unix_attach(struct log_unix *u, int fd, int type, uint32_t source,
+                enum log_level min_level, uint32_t module_mask)
+{
+        if (u == NULL) {
+                return;
+        }
+        u->fd = fd;
+        u->type = type;
+#if !defined(MSG_NOSIGNAL) && defined(SO_NOSIGPIPE)
+        int on = 1;
+        (void)setsockopt(fd, SOL_SOCKET, SO_NOSIGPIPE, &on, sizeof(on));
+#endif
+        u->source = source;
+        u->batches = 0u;
+        u->tail = 0u;
+        u->staging = (struct log_batch_buf){ 0 };
+        log_sink_init(&u->sink, log_batch_write, &u->staging, min_level,
+                      module_mask);
+}
+
+/* Send n prepared batches; returns how many went out, or -1. */
+static int
+send_batches(struct log_unix *u, struct iovec *iov, int n)
+{
+        if (u->type == SOCK_STREAM) {
+                int done = 0;
+                while (done < n) {
+                        struct msghdr msg = { .msg_iov = &iov[done] };
+                        msg.msg_iovlen = (size_t)(n - done);
+                        ssize_t w = sendmsg(u->fd, &msg, SEND_FLAGS);
+                        if (w < 0) {
+                                if (errno == EINTR) {
+                                        continue;
+                                }
+                                return (done > 0) ? done : -1;
+                        }
+                        while ((done < n) && ((size_t)w >= iov[done].iov_len)) {
+                                w -= (ssize_t)iov[done].iov_len;
+                                done++;
+                        }
+                        if (w > 0) {
+                                iov[done].iov_base =
+                                    (uint8_t *)iov[done].iov_base + w;
+                                iov[done].iov_len -= (size_t)w;
+                        }
+                }
+                return done;
+        }
+
+#ifdef __linux__
+        struct mmsghdr msgs[LOG_UNIX_BATCHES];
+        (void)memset(msgs, 0, sizeof(msgs));
+        for (int i = 0; i < n; ++i) {
+                msgs[i].msg_hdr.msg_iov = &iov[i];
+                msgs[i].msg_hdr.msg_iovlen = 1;
+        }
+        int sent;
+        do {
+                sent = sendmmsg(u->fd, msgs, (unsigned int)n, MSG_NOSIGNAL);
+        } while ((sent < 0) && (errno == EINTR));
+        return sent;
+#else
+        int sent = 0;
+        while (sent < n) {
+                struct msghdr msg = { .msg_iov = &iov[sent], .msg_iovlen = 1 };
+                if (sendmsg(u->fd, &msg, SEND_FLAGS) < 0) {
+                        if (errno == EINTR) {
+                                continue;
+                        }
+                        return (sent > 0) ? sent : -1;
+                }
+                sent++;
+        }
+        return sent;
+#endif
+}
+
+static uint8_t
+would_block(void)
+{
+        return (uint8_t)((errno == EAGAIN) || (errno == EWOULDBLOCK)
+                         || (errno == ENOBUFS));
+}
+
+/* Keep the unsent end of a batch cut short on a stream. */
+static void
+keep_tail(struct log_unix *u, const struct iovec *iov)
+{
+        (void)memmove(u->buf[0], iov->iov_base, iov->iov_len);
+        u->tail = iov->iov_len;
+}
+
+static uint8_t
+cut_short(const struct log_unix *u, const struct iovec *iov, int k)
+{
+        return (uint8_t)((u->type == SOCK_STREAM)
+                         && (iov[k].iov_base != (void *)u->buf[k]));
+}
+
+int
+log_unix_flush(struct log_unix *u, const struct log_ctx *ctx)
+{
+        if ((u == NULL) || (ctx == NULL) || (u->fd < 0)) {
+                errno = EINVAL;
+                return -1;
+        }
+
+        /* The rest of a batch already partly written goes out first. */
+        if (u->tail != 0u) {
+                struct iovec rest = { u->buf[0], u->tail };
+                if (send_batches(u, &rest, 1) != 1) {
+                        keep_tail(u, &rest);
+                        return would_block() ? 0 : -1;
+                }
+                u->tail = 0u;
+                u->batches++;
+        }
+
+        /* Sink state before each batch, to rewind to if it is not sent. */
+        struct iovec iov[LOG_UNIX_BATCHES];
+        uint32_t pos[LOG_UNIX_BATCHES];
+        uint32_t dropped[LOG_UNIX_BATCHES];
+        int n = 0;
+        while (n < (int)LOG_UNIX_BATCHES) {
+                pos[n] = u->sink.pos;
+                dropped[n] = u->sink.dropped;
+                u->staging = (struct log_batch_buf){
+                    .buf = &u->buf[n][LOG_BATCH_HEADER_LEN],
+                    .cap = LOG_UNIX_BATCH_LEN - LOG_BATCH_HEADER_LEN};
+                (void)log_sink_drain(&u->sink, ctx, UINT16_MAX);
+                if (u->staging.count == 0u) {
+                        break;
+                }
+                struct log_batch b = { .source = u->source,
+                                       .seq = u->staging.seq,
+                                       .dropped = u->sink.dropped,
+                                       .count = u->staging.count,
+                                       .len = (uint16_t)u->staging.len };
+                (void)log_batch_header(&b, u->buf[n], LOG_BATCH_HEADER_LEN);
+                iov[n].iov_base = u->buf[n];
+                iov[n].iov_len = LOG_BATCH_HEADER_LEN + u->staging.len;
+                n++;
+        }
+        if (n == 0) {
+                return 0;
+        }
+
+        int sent = send_batches(u, iov, n);
+        if (sent < n) {
+                int k = (sent > 0) ? sent : 0;
+                if (cut_short(u, iov, k) != 0u) {
+                        keep_tail(u, &iov[k]);
+                        k++;
+                }
+                if (k < n) {
+                        u->sink.pos = pos[k];
+                        u->sink.dropped = dropped[k];
+                }
+        }
+        if (sent < 0) {
+                return would_block() ? 0 : -1;
+        }
+        u->batches += (uint32_t)sent;
+        return sent;
+}
+
+void
+log_unix_close(struct log_unix *u)
+{
+        if ((u == NULL) || (u->fd < 0)) {
+                return;
+        }
+        (void)close(u->fd);
+        u->fd = -1;
+}
+
+int
+log_unix_listen(const char *path, int type)
+{
+        struct sockaddr_un addr;
+        if (unix_addr(&addr, path) != 0) {
+                return -1;
+        }
+        int fd = socket(AF_UNIX, type | SOCK_CLOEXEC, 0);
+        if (fd < 0) {
+                return -1;
+        }
+        (void)unlink(path);
+        if ((bind(fd, (const struct sockaddr *)&addr, sizeof(addr)) != 0)
+            || ((type != SOCK_DGRAM) && (listen(fd, 16) != 0))) {
+                int err = errno;
+                (void)close(fd);
+                errno = err;
+                return -1;
+        }
+        return fd;
+}
@@ -0,0 +1,136 @@
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "../include/log_watch.h"
+
+_Static_assert(LOG_WATCH_TEXT <= 255u, "text length must fit in one byte");
+
+int
+log_watch_init(struct log_watch *w, uint8_t level_mask, uint32_t module_mask,
+               const char *text, log_watch_fn fn, void *user)
+{
+        if ((w == NULL) || (fn == NULL)) {
+                return -1;
+        }
+        size_t n = (text != NULL) ? strlen(text) : 0u;
+        if (n > LOG_WATCH_TEXT) {
+                return -1;
+        }
+        w->next = NULL;
+        w->fn = fn;
+        w->user = user;
+        w->module_mask = module_mask;
+        w->level_mask = (uint8_t)(level_mask & LOG_LEVELS_ALL);
+        w->text_len = (uint8_t)n;
+        w->hits = 0u;
+        if (n > 0u) {
+                (void)memcpy(w->text, text, n);
+        }
+        /* fail[i]: length of the longest proper border of text[0..i]. */
+        uint8_t k = 0u;
+        for (uint8_t i = 1u; i < w->text_len; ++i) {
+                while ((k > 0u) && (w->text[i] != w->text[k])) {
+                        k = w->fail[k - 1u];
+                }
+                if (w->text[i] == w->text[k]) {
+                        k++;
+                }
+                w->fail[i] = k;
+        }
+        if (n > 0u) {
+                w->fail[0] = 0u;
+        }
+        return 0;
+}
+
+static void
+update_masks(struct log_ctx *ctx)
+{
+        for (uint8_t l = 0u; l < LOG_LEVELS; ++l) {
+                uint32_t mask = 0u;
+                for (const struct log_watch *w = ctx->watch; w != NULL;
+                     w = w->next) {
+                        if ((w->level_mask & LOG_LEVEL_BIT(l)) != 0u) {
+                                mask |= w->module_mask;
+                        }
+                }
+                ctx->watch_mask[l] = mask;
+        }
+}
+
+void
+log_watch_add(struct log_ctx *ctx, struct log_watch *w)
+{
+        if ((ctx == NULL) || (w == NULL) || (w->fn == NULL)) {
+                return;
+        }
+        struct log_watch **p = &ctx->watch;
+        while (*p != NULL) {
+                if (*p == w) {
+                        return;
+                }
+                p = &(*p)->next;
+        }
+        w->next = NULL;
+        *p = w;
+        update_masks(ctx);
+}
+
+void
+log_watch_remove(struct log_ctx *ctx, struct log_watch *w)
+{
+        if ((ctx == NULL) || (w == NULL)) {
+                return;
+        }
+        for (struct log_watch **p = &ctx->watch; *p != NULL;
+             p = &(*p)->next) {
+                if (*p == w) {
+                        *p = w->next;
+                        w->next = NULL;
+                        break;
+                }
+        }
+        update_masks(ctx);
+}
+
+static uint8_t
+contains(const struct log_watch *w, const char *msg)
+{
+        uint8_t k = 0u;
+        for (size_t i = 0u; i < ((size_t)LOG_MSG_LEN - 1u); ++i) {
+                if (msg[i] == '\0') {
+                        break;
+                }
+                while ((k > 0u) && (msg[i] != w->text[k])) {
+                        k = w->fail[k - 1u];
+                }
+                if (msg[i] == w->text[k]) {
+                        k++;
+                        if (k == w->text_len) {
+                                return 1u;
+                        }
+                }
+        }
+        return 0u;
+}
+
+void
+log_watch_run(const struct log_ctx *ctx, const struct log_entry *e,
+              uint32_t seq)
+{
+        if ((ctx == NULL) || (e == NULL)) {
+                return;
+        }
+        for (struct log_watch *w = ctx->watch; w != NULL; w = w->next) {
+                if (((w->level_mask & LOG_LEVEL_BIT(e->level)) == 0u)
+                    || ((w->module_mask & LOG_MODULE_BIT(e->module)) == 0u)) {
+                        continue;
+                }
+                if ((w->text_len > 0u) && (contains(w, e->msg) == 0u)) {
+                        continue;
+                }
+                w->hits++;
+                w->fn(w->user, e, seq);
+        }
+}
@@ -1,8 +1,11 @@
 #include <stdint.h>
+#include <stdio.h>
 
 #include "../subprojects/unity/src/unity.h"
 
 #include "../include/log.h"
+#include "../include/log_export.h"
+#include "../include/log_layout.h"
 
 static uint32_t fake_time = 0;
 
@@ -214,6 +217,591 @@ test_log_get_buffer_null_count_ptr(void)
         TEST_ASSERT_EQUAL_STRING("Hello world", buf[0].msg);
 }
 
+void
+test_log_retention_first_live(void)
+{
+        struct log_ctx ctx;
+        log_init(&ctx, fake_timestamp);
+        fake_time = 100;
+        for (uint16_t i = 0; i < 10; ++i) {
+                log_event(&ctx, INFO, "Sample %u", i);
+                fake_time += 10;
+        }
+
+        // Retention disabled: everything is live
+        TEST_ASSERT_EQUAL_UINT16(0, log_first_live(&ctx));
+
+        // Now 200: entries at 100..140 are older than 55
+        log_set_retention(&ctx, 55);
+        TEST_ASSERT_EQUAL_UINT16(5, log_first_live(&ctx));
+        TEST_ASSERT_EQUAL_UINT32(150, log_get_entry(&ctx, 5)->timestamp);
+        TEST_ASSERT_EQUAL_UINT16(10, log_get_count(&ctx));
+
+        fake_time = 1000;
+        TEST_ASSERT_EQUAL_UINT16(10, log_first_live(&ctx));
+}
+
+void
+test_log_retention_across_timestamp_wrap(void)
+{
+        struct log_ctx ctx;
+        log_init(&ctx, fake_timestamp);
+        fake_time = 0xFFFFFFF0u;
+        for (uint16_t i = 0; i < 8; ++i) {
+                log_event(&ctx, INFO, "Wrap %u", i);
+                fake_time += 8;
+        }
+        // Now 0x30: entries at 0xFFFFFFF0..0x28, keep the last 4
+        log_set_retention(&ctx, 0x20);
+        TEST_ASSERT_EQUAL_UINT16(4, log_first_live(&ctx));
+        TEST_ASSERT_EQUAL_UINT16(2, log_trim_before(&ctx, 0xFFFFFFF0u + 16));
+        TEST_ASSERT_EQUAL_STRING("Wrap 2", log_get_entry(&ctx, 0)->msg);
+}
+
+void
+test_log_trim_before(void)
+{
+        struct log_ctx ctx;
+        log_init(&ctx, fake_timestamp);
+        fake_time = 0;
+        const uint16_t N = LOG_ENTRIES + 7;
+        for (uint16_t i = 0; i < N; ++i) {
+                log_event(&ctx, WARN, "Entry %u", i);
+                fake_time += 1;
+        }
+
+        // Oldest retained entry is 7; drop 7..19
+        TEST_ASSERT_EQUAL_UINT16(13, log_trim_before(&ctx, 20));
+        TEST_ASSERT_EQUAL_UINT16(LOG_ENTRIES - 13, log_get_count(&ctx));
+        TEST_ASSERT_EQUAL_STRING("Entry 20", log_get_entry(&ctx, 0)->msg);
+
+        TEST_ASSERT_EQUAL_UINT16(0, log_trim_before(&ctx, 5));
+
+        // New entries append after the trimmed range
+        log_event(&ctx, FAULT, "After trim");
+        TEST_ASSERT_EQUAL_STRING(
+            "After trim", log_get_entry(&ctx, log_get_count(&ctx) - 1)->msg);
+
+        TEST_ASSERT_EQUAL_UINT16(log_get_count(&ctx),
+                                 log_trim_before(&ctx, fake_time + 1));
+        TEST_ASSERT_EQUAL_UINT16(0, log_get_count(&ctx));
+}
+
+void
+test_log_count_level_tracks_overwrites(void)
+{
+        struct log_ctx ctx;
+        log_init(&ctx, fake_timestamp);
+
+        // 10 FAULTs followed by INFOs that push most of them out
+        for (uint16_t i = 0; i < 10; ++i) {
+                log_event(&ctx, FAULT, "Fault %u", i);
+                fake_time += 1;
+        }
+        TEST_ASSERT_EQUAL_UINT16(10, log_count_level(&ctx, FAULT));
+        for (uint16_t i = 0; i < LOG_ENTRIES - 3; ++i) {
+                log_event(&ctx, (i % 2u) ? INFO : WARN, "Filler %u", i);
+                fake_time += 1;
+        }
+        TEST_ASSERT_EQUAL_UINT16(3, log_count_level(&ctx, FAULT));
+        TEST_ASSERT_EQUAL_UINT16(LOG_ENTRIES,
+                                 log_count_level(&ctx, INFO)
+                                     + log_count_level(&ctx, WARN)
+                                     + log_count_level(&ctx, FAULT));
+
+        // Trimming keeps the counts exact
+        const struct log_entry *e = log_get_entry(&ctx, 5);
+        TEST_ASSERT_EQUAL_UINT16(5, log_trim_before(&ctx, e->timestamp));
+        TEST_ASSERT_EQUAL_UINT16(0, log_count_level(&ctx, FAULT));
+
+        TEST_ASSERT_EQUAL_UINT16(0, log_count_level(NULL, FAULT));
+        TEST_ASSERT_EQUAL_UINT16(0, log_count_level(&ctx, (enum log_level)7));
+}
+
+void
+test_log_level_iteration(void)
+{
+#if LOG_LEVEL_INDEX
+        struct log_ctx ctx;
+        log_init(&ctx, fake_timestamp);
+
+        uint16_t it;
+        const struct log_entry *e;
+        TEST_ASSERT_NULL(log_level_first(&ctx, FAULT, &it));
+
+        // Every 7th entry is a FAULT; wrap the buffer twice
+        for (uint16_t i = 0; i < 2 * LOG_ENTRIES; ++i) {
+                log_event(&ctx, (i % 7u) ? INFO : FAULT, "Entry %u", i);
+        }
+
+        uint16_t seen = 0;
+        uint16_t expected = LOG_ENTRIES;
+        while ((expected % 7u) != 0u) {
+                expected++;
+        }
+        for (e = log_level_first(&ctx, FAULT, &it); e != NULL;
+             e = log_level_next(&ctx, &it)) {
+                char msg[16];
+                snprintf(msg, sizeof(msg), "Entry %u", expected);
+                TEST_ASSERT_EQUAL_STRING(msg, e->msg);
+                TEST_ASSERT_EQUAL_UINT16(FAULT, e->level);
+                expected += 7;
+                seen++;
+        }
+        TEST_ASSERT_EQUAL_UINT16(log_count_level(&ctx, FAULT), seen);
+#else
+        TEST_IGNORE_MESSAGE("LOG_LEVEL_INDEX disabled");
+#endif
+}
+
+void
+test_log_get_spans(void)
+{
+        struct log_ctx ctx;
+        const struct log_entry *span[LOG_SPANS_MAX];
+        uint16_t len[LOG_SPANS_MAX];
+        log_init(&ctx, fake_timestamp);
+        TEST_ASSERT_EQUAL_UINT8(0, log_get_spans(&ctx, span, len));
+
+        log_event(&ctx, INFO, "Entry 0");
+        log_event(&ctx, INFO, "Entry 1");
+        TEST_ASSERT_EQUAL_UINT8(1, log_get_spans(&ctx, span, len));
+        TEST_ASSERT_EQUAL_UINT16(2, len[0]);
+        TEST_ASSERT_EQUAL_STRING("Entry 0", span[0][0].msg);
+
+        for (uint16_t i = 2; i < LOG_ENTRIES + 3; ++i) {
+                log_event(&ctx, INFO, "Entry %u", i);
+        }
+        TEST_ASSERT_EQUAL_UINT8(2, log_get_spans(&ctx, span, len));
+        TEST_ASSERT_EQUAL_UINT16(LOG_ENTRIES - 3, len[0]);
+        TEST_ASSERT_EQUAL_UINT16(3, len[1]);
+        TEST_ASSERT_EQUAL_STRING("Entry 3", span[0][0].msg);
+        TEST_ASSERT_EQUAL_STRING("Entry 52", span[1][2].msg);
+
+        log_clear(&ctx);
+        TEST_ASSERT_EQUAL_UINT16(0, log_get_count(&ctx));
+        TEST_ASSERT_EQUAL_UINT16(0, log_count_level(&ctx, INFO));
+        log_event(&ctx, WARN, "After clear");
+        TEST_ASSERT_EQUAL_STRING("After clear", log_get_entry(&ctx, 0)->msg);
+}
+
+void
+test_log_sequence_numbers(void)
+{
+        struct log_ctx ctx;
+        log_init(&ctx, fake_timestamp);
+        TEST_ASSERT_EQUAL_UINT32(0, log_get_seq(&ctx));
+        TEST_ASSERT_NULL(log_get_entry_seq(&ctx, 0));
+
+        for (uint16_t i = 0; i < LOG_ENTRIES + 4; ++i) {
+                log_event(&ctx, INFO, "Entry %u", i);
+        }
+        TEST_ASSERT_EQUAL_UINT32(LOG_ENTRIES + 4, log_get_seq(&ctx));
+        TEST_ASSERT_NULL(log_get_entry_seq(&ctx, 3));
+        TEST_ASSERT_EQUAL_STRING("Entry 4", log_get_entry_seq(&ctx, 4)->msg);
+        char last[16];
+        (void)snprintf(last, sizeof(last), "Entry %u", LOG_ENTRIES + 3u);
+        TEST_ASSERT_EQUAL_STRING(last,
+                                 log_get_entry_seq(&ctx, LOG_ENTRIES + 3)->msg);
+        TEST_ASSERT_NULL(log_get_entry_seq(&ctx, LOG_ENTRIES + 4));
+
+        // Numbering continues across a clear
+        log_clear(&ctx);
+        TEST_ASSERT_NULL(log_get_entry_seq(&ctx, LOG_ENTRIES + 3));
+        log_event_mod(&ctx, 5, WARN, "After clear");
+        TEST_ASSERT_EQUAL_UINT8(5, log_get_entry_seq(&ctx, LOG_ENTRIES + 4)->module);
+}
+
+void
+test_log_pinned_region_survives_wrap(void)
+{
+        struct log_ctx ctx;
+        const struct log_entry *span[LOG_SPANS_MAX];
+        uint16_t len[LOG_SPANS_MAX];
+        uint32_t pin_seq;
+        char expected[16];
+
+        log_init(&ctx, fake_timestamp);
+        log_event(&ctx, FAULT, "Reset cause");
+        TEST_ASSERT_EQUAL_UINT8(0u, log_set_pinned(&ctx, LOG_ENTRIES));
+        TEST_ASSERT_EQUAL_UINT8(1u, log_set_pinned(&ctx, 3u));
+        log_event(&ctx, INFO, "Version");
+        log_event(&ctx, WARN, "Config");
+        for (uint16_t i = 0; i < LOG_ENTRIES + 10u; ++i) {
+                log_event(&ctx, (i % 2u) ? WARN : FAULT, "Entry %u", i);
+        }
+        TEST_ASSERT_EQUAL_UINT8(0u, log_set_pinned(&ctx, 5u));
+
+        TEST_ASSERT_EQUAL_UINT16(LOG_ENTRIES, log_get_count(&ctx));
+        TEST_ASSERT_EQUAL_UINT16(3u, log_get_pinned(&ctx, &pin_seq));
+        TEST_ASSERT_EQUAL_UINT32(0u, pin_seq);
+        TEST_ASSERT_EQUAL_STRING("Reset cause", log_get_entry(&ctx, 0)->msg);
+        TEST_ASSERT_EQUAL_STRING("Version", log_get_entry(&ctx, 1)->msg);
+        TEST_ASSERT_EQUAL_STRING("Config", log_get_entry(&ctx, 2)->msg);
+
+        // The ring holds the newest LOG_ENTRIES - 3 entries
+        uint16_t first = (uint16_t)(10u + 3u);
+        (void)snprintf(expected, sizeof(expected), "Entry %u", first);
+        TEST_ASSERT_EQUAL_STRING(expected, log_get_entry(&ctx, 3)->msg);
+        TEST_ASSERT_EQUAL_STRING(expected,
+                                 log_get_entry_seq(&ctx, 3u + first)->msg);
+        TEST_ASSERT_NULL(log_get_entry_seq(&ctx, 3u + first - 1u));
+        TEST_ASSERT_EQUAL_STRING("Config", log_get_entry_seq(&ctx, 2)->msg);
+
+        // Pinned run, then the wrapped ring as two runs
+        TEST_ASSERT_EQUAL_UINT8(3u, log_get_spans(&ctx, span, len));
+        TEST_ASSERT_EQUAL_UINT16(3u, len[0]);
+        TEST_ASSERT_EQUAL_UINT16(LOG_ENTRIES - 3u, len[1] + len[2]);
+        TEST_ASSERT_EQUAL_PTR(log_get_entry(&ctx, 3), span[1]);
+
+        uint16_t faults = 0u;
+        for (uint16_t i = 0; i < LOG_ENTRIES; ++i) {
+                faults += (log_get_entry(&ctx, i)->level == FAULT) ? 1u : 0u;
+        }
+        TEST_ASSERT_EQUAL_UINT16(faults, log_count_level(&ctx, FAULT));
+#if LOG_LEVEL_INDEX
+        uint16_t it;
+        const struct log_entry *e = log_level_first(&ctx, FAULT, &it);
+        TEST_ASSERT_EQUAL_STRING("Reset cause", e->msg);
+        uint16_t n = 0u;
+        for (; e != NULL; e = log_level_next(&ctx, &it)) {
+                n++;
+        }
+        TEST_ASSERT_EQUAL_UINT16(faults, n);
+#endif
+
+        // Pinned entries are exempt from trimming and expiry
+        fake_time = 1000u;
+        log_event(&ctx, INFO, "Late");
+        TEST_ASSERT_EQUAL_UINT16(LOG_ENTRIES - 4u, log_trim_before(&ctx, 1000u));
+        TEST_ASSERT_EQUAL_UINT16(4u, log_get_count(&ctx));
+        TEST_ASSERT_EQUAL_STRING("Late", log_get_entry(&ctx, 3)->msg);
+        log_set_retention(&ctx, 10u);
+        fake_time = 2000u;
+        TEST_ASSERT_EQUAL_UINT16(4u, log_first_live(&ctx));
+        TEST_ASSERT_EQUAL_STRING("Reset cause", log_get_entry(&ctx, 0)->msg);
+
+        // The region refills after a clear
+        log_clear(&ctx);
+        log_event(&ctx, INFO, "Second boot");
+        TEST_ASSERT_EQUAL_UINT16(1u, log_get_pinned(&ctx, &pin_seq));
+        TEST_ASSERT_EQUAL_STRING("Second boot",
+                                 log_get_entry_seq(&ctx, pin_seq)->msg);
+}
+
+static struct log_ctx bss_ctx;
+static struct log_ctx static_ctx = LOG_CTX_INIT(fake_timestamp);
+
+void
+test_log_static_contexts_need_no_init(void)
+{
+        // Zeroed storage: default timestamp counter, descriptor on first use
+        TEST_ASSERT_NULL(bss_ctx.layout);
+        log_event(&bss_ctx, WARN, "Boot");
+        log_event(&bss_ctx, WARN, "Clocks up");
+        TEST_ASSERT_EQUAL_UINT16(2, log_get_count(&bss_ctx));
+        TEST_ASSERT_EQUAL_PTR(&log_ctx_layout, bss_ctx.layout);
+        TEST_ASSERT_EQUAL_UINT32(log_get_entry(&bss_ctx, 0)->timestamp + 1u,
+                                 log_get_entry(&bss_ctx, 1)->timestamp);
+        TEST_ASSERT_EQUAL_UINT16(2, log_count_level(&bss_ctx, WARN));
+#if LOG_LEVEL_INDEX
+        uint16_t it;
+        TEST_ASSERT_NULL(log_level_first(&bss_ctx, FAULT, &it));
+        TEST_ASSERT_EQUAL_STRING("Boot",
+                                 log_level_first(&bss_ctx, WARN, &it)->msg);
+        TEST_ASSERT_EQUAL_STRING("Clocks up",
+                                 log_level_next(&bss_ctx, &it)->msg);
+        TEST_ASSERT_NULL(log_level_next(&bss_ctx, &it));
+#endif
+
+        fake_time = 77u;
+        log_event(&static_ctx, INFO, "Static");
+        TEST_ASSERT_EQUAL_UINT32(77u, log_get_entry(&static_ctx, 0)->timestamp);
+
+        // Without a clock, now is the newest entry; reading leaves the
+        // default counter alone
+        log_set_retention(&bss_ctx, 1u);
+        TEST_ASSERT_EQUAL_UINT16(0, log_first_live(&bss_ctx));
+        TEST_ASSERT_EQUAL_UINT16(0, log_first_live(&bss_ctx));
+        log_event(&bss_ctx, WARN, "Running");
+        TEST_ASSERT_EQUAL_UINT32(log_get_entry(&bss_ctx, 1)->timestamp + 1u,
+                                 log_get_entry(&bss_ctx, 2)->timestamp);
+        TEST_ASSERT_EQUAL_UINT16(1, log_first_live(&bss_ctx));
+
+        // A disabled context has no clock, so nothing expires
+        struct log_ctx off;
+        log_init(&off, NULL);
+        log_set_retention(&off, 1u);
+        TEST_ASSERT_EQUAL_UINT16(0, log_first_live(&off));
+}
+
+#if LOG_MODULE_QUOTA
+/* Per-level and per-module lists must list entries in buffer order,
+ * skipping holes. */
+static void
+check_lists(const struct log_ctx *ctx)
+{
+        uint16_t it;
+        const struct log_entry *e;
+        for (uint8_t m = 0u; m < LOG_MODULES; ++m) {
+                uint16_t n = 0u;
+                e = log_module_first(ctx, m, &it);
+                for (uint16_t i = 0u; i < log_get_count(ctx); ++i) {
+                        const struct log_entry *x = log_get_entry(ctx, i);
+                        if ((x != NULL) && (x->module == m)) {
+                                TEST_ASSERT_EQUAL_PTR(x, e);
+                                e = log_module_next(ctx, &it);
+                                n++;
+                        }
+                }
+                TEST_ASSERT_NULL(e);
+                TEST_ASSERT_EQUAL_UINT16(n, log_count_module(ctx, m));
+        }
+#if LOG_LEVEL_INDEX
+        for (uint16_t l = 0u; l < LOG_LEVELS; ++l) {
+                e = log_level_first(ctx, (enum log_level)l, &it);
+                for (uint16_t i = 0u; i < log_get_count(ctx); ++i) {
+                        const struct log_entry *x = log_get_entry(ctx, i);
+                        if ((x != NULL) && (x->level == l)) {
+                                TEST_ASSERT_EQUAL_PTR(x, e);
+                                e = log_level_next(ctx, &it);
+                        }
+                }
+                TEST_ASSERT_NULL(e);
+        }
+#endif
+}
+#endif
+
+void
+test_log_module_quota_protects_quiet_modules(void)
+{
+#if LOG_MODULE_QUOTA
+        struct log_ctx ctx;
+        log_init(&ctx, fake_timestamp);
+        TEST_ASSERT_EQUAL_UINT8(1u, log_set_quota(&ctx, 1u, 5u));
+        TEST_ASSERT_EQUAL_UINT8(0u, log_set_quota(&ctx, LOG_MODULES, 5u));
+
+        fake_time = 0u;
+        for (uint16_t i = 0u; i < 8u; ++i) {
+                log_event_mod(&ctx, 1u, WARN, "Quiet %u", i);
+                fake_time++;
+        }
+        for (uint16_t i = 0u; i < 3u * LOG_ENTRIES; ++i) {
+                log_event_mod(&ctx, 2u, (i % 3u) ? INFO : FAULT, "Chatty %u",
+                              i);
+                fake_time++;
+                check_lists(&ctx);
+        }
+
+        // The quiet module keeps its newest five, still oldest first, in a
+        // buffer short of the slack kept for holes
+        uint16_t count = log_get_count(&ctx);
+        TEST_ASSERT_EQUAL_UINT16(LOG_ENTRIES - LOG_QUOTA_SLACK,
+                                 log_count_level(&ctx, INFO)
+                                     + log_count_level(&ctx, WARN)
+                                     + log_count_level(&ctx, FAULT));
+        TEST_ASSERT_EQUAL_UINT16(5u, log_count_module(&ctx, 1u));
+        TEST_ASSERT_EQUAL_UINT16(5u, log_count_level(&ctx, WARN));
+        for (uint16_t i = 0u; i < 5u; ++i) {
+                char msg[16];
+                snprintf(msg, sizeof(msg), "Quiet %u", i + 3u);
+                TEST_ASSERT_EQUAL_STRING(msg, log_get_entry(&ctx, i)->msg);
+        }
+        uint32_t last = 0u;
+        for (uint16_t i = 0u; i < count; ++i) {
+                const struct log_entry *e = log_get_entry(&ctx, i);
+                if (e != NULL) {
+                        TEST_ASSERT_TRUE((i == 0u) || (last < e->timestamp));
+                        last = e->timestamp;
+                }
+        }
+        TEST_ASSERT_EQUAL_STRING("Chatty 149",
+                                 log_get_entry(&ctx, count - 1u)->msg);
+
+        // Without quotas the chatty module takes over again
+        log_set_quota(&ctx, 1u, 0u);
+        for (uint16_t i = 0u; i < LOG_ENTRIES; ++i) {
+                log_event_mod(&ctx, 2u, INFO, "Chatty");
+        }
+        TEST_ASSERT_EQUAL_UINT16(0u, log_count_module(&ctx, 1u));
+        check_lists(&ctx);
+#else
+        TEST_IGNORE_MESSAGE("LOG_MODULE_QUOTA disabled");
+#endif
+}
+
+void
+test_log_module_quota_with_pinned_region(void)
+{
+#if LOG_MODULE_QUOTA
+        struct log_ctx ctx;
+        log_init(&ctx, fake_timestamp);
+        log_event_mod(&ctx, 3u, INFO, "Boot");
+        log_event_mod(&ctx, 1u, FAULT, "Reset cause");
+        TEST_ASSERT_EQUAL_UINT8(1u, log_set_pinned(&ctx, 2u));
+        log_set_quota(&ctx, 1u, 4u);
+        log_set_quota(&ctx, 3u, 6u);
+
+        // Mixed traffic, mostly module 2, checked after every eviction
+        uint32_t x = 1u;
+        for (uint16_t i = 0u; i < 10u * LOG_ENTRIES; ++i) {
+                x = (x * 1103515245u) + 12345u;
+                uint8_t m = ((x >> 16) % 8u == 0u) ? 1u
+                            : ((x >> 16) % 8u == 1u) ? 3u : 2u;
+                log_event_mod(&ctx, m, (enum log_level)((x >> 20) % 3u),
+                              "Entry %u", i);
+                check_lists(&ctx);
+        }
+        TEST_ASSERT_EQUAL_STRING("Boot", log_get_entry(&ctx, 0)->msg);
+        TEST_ASSERT_EQUAL_STRING("Reset cause", log_get_entry(&ctx, 1)->msg);
+        TEST_ASSERT_TRUE(log_count_module(&ctx, 1u) >= 4u);
+        TEST_ASSERT_TRUE(log_count_module(&ctx, 3u) >= 6u);
+        char msg[16];
+        snprintf(msg, sizeof(msg), "Entry %u", 10u * LOG_ENTRIES - 1u);
+        TEST_ASSERT_EQUAL_STRING(msg,
+                                 log_get_entry(&ctx, log_get_count(&ctx) - 1u)
+                                     ->msg);
+#else
+        TEST_IGNORE_MESSAGE("LOG_MODULE_QUOTA disabled");
+#endif
+}
+
+/* Module 1 keeps 2 entries, module 2 fills the rest up to one short of
+ * LOG_ENTRIES: the evictions from seq 2 on are still holes. */
+static void
+fill_with_holes(struct log_ctx *ctx)
+{
+        log_set_quota(ctx, 1u, 2u);
+        for (uint16_t i = 0u; i < LOG_ENTRIES; ++i) {
+                fake_time = i;
+                log_event_mod(ctx, (i < 2u) ? 1u : 2u, (i < 2u) ? WARN : INFO,
+                              "Entry %u", i);
+        }
+}
+
+void
+test_log_module_quota_keeps_sequence_numbers(void)
+{
+#if LOG_MODULE_QUOTA
+        struct log_ctx ctx;
+        log_init(&ctx, fake_timestamp);
+        fill_with_holes(&ctx);
+
+        // Evicted in place: nothing moved, the holes keep their numbers
+        uint16_t holes = LOG_QUOTA_SLACK;
+        const struct log_entry *buf = log_get_buffer(&ctx, NULL);
+        TEST_ASSERT_EQUAL_UINT16(LOG_ENTRIES, log_get_count(&ctx));
+        TEST_ASSERT_EQUAL_UINT16(LOG_ENTRIES - 2u - holes,
+                                 log_count_module(&ctx, 2u));
+        for (uint16_t i = 0u; i < LOG_ENTRIES; ++i) {
+                char msg[24];
+                uint32_t seq = log_get_seq_at(&ctx, i);
+                TEST_ASSERT_EQUAL_UINT32(i, seq);
+                if ((i >= 2u) && (i < (2u + holes))) {
+                        TEST_ASSERT_NULL(log_get_entry(&ctx, i));
+                        TEST_ASSERT_NULL(log_get_entry_seq(&ctx, seq));
+                        continue;
+                }
+                snprintf(msg, sizeof(msg), "Entry %u", (unsigned)seq);
+                TEST_ASSERT_EQUAL_PTR(&buf[i], log_get_entry(&ctx, i));
+                TEST_ASSERT_EQUAL_STRING(msg, buf[i].msg);
+                TEST_ASSERT_EQUAL_PTR(&buf[i], log_get_entry_seq(&ctx, seq));
+        }
+        check_lists(&ctx);
+
+        // Full: one more eviction, then all holes are closed in one pass
+        log_event_mod(&ctx, 2u, INFO, "Entry %u", LOG_ENTRIES);
+        TEST_ASSERT_EQUAL_UINT16(LOG_ENTRIES - holes, log_get_count(&ctx));
+        TEST_ASSERT_EQUAL_UINT32(1u, log_get_seq_at(&ctx, 1u));
+        TEST_ASSERT_EQUAL_UINT32(3u + holes, log_get_seq_at(&ctx, 2u));
+        TEST_ASSERT_NULL(log_get_entry_seq(&ctx, 2u + holes));
+        TEST_ASSERT_EQUAL_UINT32(LOG_ENTRIES + 1u,
+                                 log_get_seq_at(&ctx, LOG_ENTRIES - holes));
+        for (uint16_t i = 0u; i < (LOG_ENTRIES - holes); ++i) {
+                char msg[24];
+                uint32_t seq = log_get_seq_at(&ctx, i);
+                snprintf(msg, sizeof(msg), "Entry %u", (unsigned)seq);
+                TEST_ASSERT_EQUAL_STRING(msg, log_get_entry(&ctx, i)->msg);
+                TEST_ASSERT_EQUAL_PTR(log_get_entry(&ctx, i),
+                                      log_get_entry_seq(&ctx, seq));
+        }
+        check_lists(&ctx);
+        TEST_ASSERT_NULL(log_get_entry_seq(&ctx, LOG_ENTRIES + 1u));
+#else
+        TEST_IGNORE_MESSAGE("LOG_MODULE_QUOTA disabled");
+#endif
+}
+
+void
+test_log_module_quota_holes_expire_and_trim(void)
+{
+#if LOG_MODULE_QUOTA
+        struct log_ctx ctx;
+        log_init(&ctx, fake_timestamp);
+        fill_with_holes(&ctx);
+        uint16_t holes = LOG_QUOTA_SLACK;
+        char first[24];
+        snprintf(first, sizeof(first), "Entry %u", 2u + holes);
+
+        // Holes keep their timestamps, so the searches see through them
+        log_set_retention(&ctx, LOG_ENTRIES - 4u);
+        TEST_ASSERT_EQUAL_UINT16(3u, log_first_live(&ctx));
+        uint16_t idx = 0u;
+        uint8_t buf[LOG_ENTRIES * (LOG_RECORD_HEADER_LEN + LOG_MSG_LEN)];
+        size_t len = log_export(&ctx, &idx, buf, sizeof(buf));
+        TEST_ASSERT_EQUAL_UINT16(LOG_ENTRIES, idx);
+        struct log_entry e;
+        TEST_ASSERT_TRUE(log_record_decode(buf, len, &e) > 0u);
+        TEST_ASSERT_EQUAL_STRING(first, e.msg);
+        log_set_retention(&ctx, 0u);
+
+        // Trimming the two quiet entries gives back the holes behind them
+        TEST_ASSERT_EQUAL_UINT16(2u, log_trim_before(&ctx, 2u));
+        TEST_ASSERT_EQUAL_UINT16(LOG_ENTRIES - 2u - holes,
+                                 log_get_count(&ctx));
+        TEST_ASSERT_EQUAL_UINT32(2u + holes, log_get_seq_at(&ctx, 0u));
+        TEST_ASSERT_EQUAL_STRING(first, log_get_entry(&ctx, 0u)->msg);
+        check_lists(&ctx);
+#else
+        TEST_IGNORE_MESSAGE("LOG_MODULE_QUOTA disabled");
+#endif
+}
+
+void
+test_log_streaming_stores_match_plain_stores(void)
+{
+        struct log_ctx plain;
+        struct log_ctx nt;
+        log_init(&plain, fake_timestamp);
+        log_init(&nt, fake_timestamp);
+        TEST_ASSERT_EQUAL_UINT8(0u, log_set_streaming(NULL, 1u));
+        (void)log_set_streaming(&nt, 1u);
+
+        fake_time = 0u;
+        for (uint16_t i = 0u; i < LOG_ENTRIES + 7u; ++i) {
+                log_event_mod(&plain, (uint8_t)(i % 4u), WARN, "Entry %u", i);
+                log_event_mod(&nt, (uint8_t)(i % 4u), WARN, "Entry %u", i);
+                fake_time++;
+        }
+        struct log_entry e = *log_get_entry(&plain, 3);
+        log_put_entry(&plain, &e);
+        log_put_entry(&nt, &e);
+
+        TEST_ASSERT_EQUAL_UINT16(log_get_count(&plain), log_get_count(&nt));
+        for (uint16_t i = 0u; i < log_get_count(&plain); ++i) {
+                const struct log_entry *a = log_get_entry(&plain, i);
+                const struct log_entry *b = log_get_entry(&nt, i);
+                TEST_ASSERT_EQUAL_UINT32(a->timestamp, b->timestamp);
+                TEST_ASSERT_EQUAL_UINT16(a->level, b->level);
+                TEST_ASSERT_EQUAL_UINT8(a->module, b->module);
+                TEST_ASSERT_EQUAL_STRING(a->msg, b->msg);
+        }
+        TEST_ASSERT_EQUAL_UINT16(log_count_level(&plain, WARN),
+                                 log_count_level(&nt, WARN));
+        TEST_ASSERT_EQUAL_UINT8(0u, log_set_streaming(&nt, 0u));
+}
+
 int
 main(void)
 {
@@ -228,5 +816,19 @@ main(void)
         RUN_TEST(test_log_init_null_fn);
         RUN_TEST(test_log_get_buffer_returns_correct_count_and_pointer);
         RUN_TEST(test_log_get_buffer_null_count_ptr);
+        RUN_TEST(test_log_retention_first_live);
+        RUN_TEST(test_log_retention_across_timestamp_wrap);
+        RUN_TEST(test_log_trim_before);
+        RUN_TEST(test_log_count_level_tracks_overwrites);
+        RUN_TEST(test_log_level_iteration);
+        RUN_TEST(test_log_get_spans);
+        RUN_TEST(test_log_sequence_numbers);
+        RUN_TEST(test_log_static_contexts_need_no_init);
+        RUN_TEST(test_log_pinned_region_survives_wrap);
+        RUN_TEST(test_log_module_quota_protects_quiet_modules);
+        RUN_TEST(test_log_module_quota_with_pinned_region);
+        RUN_TEST(test_log_module_quota_keeps_sequence_numbers);
+        RUN_TEST(test_log_module_quota_holes_expire_and_trim);
+        RUN_TEST(test_log_streaming_stores_match_plain_stores);
         return UNITY_END();
 }
@@ -0,0 +1,153 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "../subprojects/unity/src/unity.h"
+
+#include "../include/log_capture.h"
+
+static uint32_t fake_time = 0;
+
+static uint32_t
+fake_timestamp(void)
+{
+        return fake_time++;
+}
+
+static struct log_ctx orig;
+static struct log_ctx replayed;
+static struct log_capture cap;
+static struct log_replay rep;
+static char path[64];
+
+void
+setUp(void)
+{
+        fake_time = 0;
+        log_init(&orig, fake_timestamp);
+        log_init(&replayed, fake_timestamp);
+        snprintf(path, sizeof(path), "/tmp/test_log_capture.%ld.trace",
+                 (long)getpid());
+        (void)unlink(path);
+}
+void
+tearDown(void)
+{
+        (void)unlink(path);
+}
+
+void
+test_replay_reproduces_captured_events(void)
+{
+#if LOG_PROFILE
+        // One statement, one site; not unrolled into three
+        volatile int boots = 3;
+        TEST_ASSERT_EQUAL(0, log_capture_open(&cap, &orig, path));
+        for (int i = 0; i < boots; ++i) {
+                log_event(&orig, INFO, "boot %d", -42 * i);
+        }
+        log_event_mod(&orig, 3u, WARN, "rx %u bytes from %s", 1500u, "xxxxx");
+        log_event_mod(&orig, 4u, INFO, "%lld %zu %lx %hhu %c", -5ll,
+                      (size_t)7u, 0xBEEFul, 200, 'q');
+        // Strings are replayed as 'x' of the captured length
+        log_event(&orig, INFO, "%.*s|%.3s|%-6s|", 2, "xxxxxxx", "xxxxxxxx",
+                  "xx");
+        log_event(&orig, FAULT, "t=%5.2f v=%d g=%g", 3.14159, 7, -0.5);
+        log_event(&orig, INFO, "at %p, 100%% done", (void *)&orig);
+        // Not replayable
+        log_event(&orig, INFO, "ld %Lf", (long double)1.0);
+        log_event(&orig, INFO, "%d%d%d%d%d%d%d%d%d", 1, 2, 3, 4, 5, 6, 7, 8,
+                  9);
+        log_event(&orig, INFO, "%d %d %d %d %f", 1, 2, 3, 4, 5.0);
+        TEST_ASSERT_EQUAL(0, log_capture_close(&cap));
+        TEST_ASSERT_EQUAL_UINT64(11u, cap.events);
+        TEST_ASSERT_EQUAL_UINT16(9u, cap.sites);
+        TEST_ASSERT_EQUAL_UINT32(0u, cap.lost);
+
+        // Detached: not captured
+        log_event(&orig, INFO, "boot %d", 1);
+        TEST_ASSERT_EQUAL_UINT64(11u, cap.events);
+
+        struct log_replay_event e;
+        uint16_t events = 0u;
+        uint16_t emitted = 0u;
+        TEST_ASSERT_EQUAL(0, log_replay_open(&rep, path));
+        while (log_replay_next(&rep, &e) == 1) {
+                if (events == 0u) {
+                        TEST_ASSERT_EQUAL_UINT64(0u, e.delta_ns);
+                        TEST_ASSERT_EQUAL_STRING("boot %d", e.site->fmt);
+                        TEST_ASSERT_EQUAL_INT(1, e.site->nargs);
+                        TEST_ASSERT_EQUAL_UINT8(LOG_ARG_INT,
+                                                e.site->shape[0]);
+                        TEST_ASSERT_TRUE(e.site->addr != NULL);
+                }
+                const struct log_entry *o = log_get_entry(&orig, events++);
+                if (log_replay_emit(&replayed, &e) == 0u) {
+                        continue;
+                }
+                const struct log_entry *r = log_get_entry(&replayed,
+                                                          emitted++);
+                TEST_ASSERT_EQUAL_STRING(o->msg, r->msg);
+                TEST_ASSERT_EQUAL_UINT8(o->module, r->module);
+                TEST_ASSERT_EQUAL_UINT16(o->level, r->level);
+        }
+        TEST_ASSERT_EQUAL_UINT16(11u, events);
+        TEST_ASSERT_EQUAL_UINT16(8u, emitted);
+        TEST_ASSERT_EQUAL_UINT16(9u, rep.sites);
+        TEST_ASSERT_EQUAL_INT(-1, rep.site[6].nargs);
+        TEST_ASSERT_EQUAL_INT(-1, rep.site[7].nargs);
+        TEST_ASSERT_EQUAL_INT(5, rep.site[8].nargs);
+        log_replay_close(&rep);
+#else
+        TEST_ASSERT_EQUAL(-1, log_capture_open(&cap, &orig, path));
+        TEST_ASSERT_EQUAL(ENOTSUP, errno);
+        TEST_IGNORE_MESSAGE("LOG_PROFILE disabled");
+#endif
+}
+
+void
+test_replay_rejects_foreign_and_truncated_files(void)
+{
+        static const uint8_t foreign[8] = { 'E', 'M', 'L', 'G', 1u, 0u };
+        int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        TEST_ASSERT_TRUE(fd >= 0);
+        TEST_ASSERT_EQUAL(8, (int)write(fd, foreign, sizeof(foreign)));
+        (void)close(fd);
+        TEST_ASSERT_EQUAL(-1, log_replay_open(&rep, path));
+        TEST_ASSERT_EQUAL(EINVAL, errno);
+
+#if LOG_PROFILE
+        struct log_replay_event e;
+        TEST_ASSERT_EQUAL(0, log_capture_open(&cap, &orig, path));
+        log_event(&orig, INFO, "rx %u", 300u);
+        TEST_ASSERT_EQUAL(0, log_capture_close(&cap));
+        TEST_ASSERT_EQUAL(0, log_replay_open(&rep, path));
+        TEST_ASSERT_EQUAL(1, log_replay_next(&rep, &e));
+        TEST_ASSERT_EQUAL_UINT64(300u, e.arg[0].u);
+        TEST_ASSERT_EQUAL(0, log_replay_next(&rep, &e));
+        log_replay_close(&rep);
+
+        // Cut inside the two byte varint of the argument
+        struct stat st;
+        TEST_ASSERT_EQUAL(0, stat(path, &st));
+        TEST_ASSERT_EQUAL(0, truncate(path, st.st_size - 1));
+        TEST_ASSERT_EQUAL(0, log_replay_open(&rep, path));
+        TEST_ASSERT_EQUAL(-1, log_replay_next(&rep, &e));
+        log_replay_close(&rep);
+#endif
+}
+
+int
+main(void)
+{
+        UNITY_BEGIN();
+        RUN_TEST(test_replay_reproduces_captured_events);
+        RUN_TEST(test_replay_rejects_foreign_and_truncated_files);
+        return UNITY_END();
+}
@@ -0,0 +1,95 @@
+#include <stdint.h>
+
+#include "../subprojects/unity/src/unity.h"
+
+// Every public header has to parse as C++
+#include "../include/log.h"
+#include "../include/log_capture.h"
+#include "../include/log_crc.h"
+#include "../include/log_drain.h"
+#include "../include/log_export.h"
+#include "../include/log_filter.h"
+#include "../include/log_flash.h"
+#include "../include/log_layout.h"
+#include "../include/log_merge.h"
+#include "../include/log_pingpong.h"
+#include "../include/log_profile.h"
+#include "../include/log_rate.h"
+#include "../include/log_sink.h"
+#include "../include/log_splice.h"
+#include "../include/log_stage.h"
+#include "../include/log_store.h"
+#include "../include/log_topn.h"
+#include "../include/log_uart.h"
+#include "../include/log_unix.h"
+#include "../include/log_watch.h"
+
+static uint32_t fake_time = 0;
+
+static uint32_t
+fake_timestamp(void)
+{
+        return fake_time;
+}
+
+// Constant initialisation: usable from other static constructors.
+static constexpr log_ctx empty_ctx{};
+static log_ctx cpp_ctx{fake_timestamp};
+static log_ctx macro_ctx = LOG_CTX_INIT(nullptr);
+
+static_assert(empty_ctx.count == 0u, "constexpr context");
+
+void
+setUp(void)
+{
+}
+void
+tearDown(void)
+{
+}
+
+void
+test_cpp_constexpr_contexts_log_without_init(void)
+{
+        fake_time = 5u;
+        log_event(&cpp_ctx, FAULT, "From C++ %d", 1);
+        TEST_ASSERT_EQUAL_UINT16(1, log_get_count(&cpp_ctx));
+        TEST_ASSERT_EQUAL_UINT32(5u, log_get_entry(&cpp_ctx, 0)->timestamp);
+        TEST_ASSERT_EQUAL_STRING("From C++ 1",
+                                 log_get_entry(&cpp_ctx, 0)->msg);
+
+        // The other headers link with C names too
+        char line[64];
+        TEST_ASSERT_EQUAL_UINT8(1u, log_layout_check(cpp_ctx.layout));
+        TEST_ASSERT_TRUE(log_format(log_get_entry(&cpp_ctx, 0), line,
+                                    sizeof(line)) > 0u);
+
+        log_event(&macro_ctx, INFO, "Default clock");
+        TEST_ASSERT_EQUAL_UINT16(1, log_count_level(&macro_ctx, INFO));
+}
+
+void
+test_cpp_pingpong_hands_over_through_std_atomic(void)
+{
+        static log_pingpong pp;
+
+        fake_time = 7u;
+        log_pingpong_init(&pp, fake_timestamp);
+        log_event(log_pingpong_producer(&pp), WARN, "Swap %d", 2);
+        TEST_ASSERT_EQUAL_UINT8(1u, log_pingpong_publish(&pp));
+
+        const log_ctx *full = log_pingpong_acquire(&pp);
+        TEST_ASSERT_NOT_NULL(full);
+        TEST_ASSERT_EQUAL_STRING("Swap 2", log_get_entry(full, 0)->msg);
+        log_pingpong_release(&pp);
+        TEST_ASSERT_NULL(log_pingpong_acquire(&pp));
+}
+
+int
+main(void)
+{
+        UNITY_BEGIN();
+        RUN_TEST(test_cpp_constexpr_contexts_log_without_init);
+        RUN_TEST(test_cpp_pingpong_hands_over_through_std_atomic);
+        return UNITY_END();
+}
@@ -0,0 +1,228 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <time.h>
+
+#include "../subprojects/unity/src/unity.h"
+
+#include "../include/log_drain.h"
+
+#define CONTEXTS  (64u)
+#define PRODUCERS (4u)
+#define EVENTS    (400u)
+
+static uint32_t
+zero_clock(void)
+{
+        return 0u;
+}
+
+struct conn {
+        struct log_ctx ctx;
+        struct log_sink sink;
+        pthread_mutex_t lock;
+        struct log_drain_src src;
+        atomic_int inside;   /* Workers currently in the callback. */
+        uint32_t next_seq;   /* Expected sequence number. */
+        uint32_t delivered;
+        uint32_t errors;
+        uint32_t refused;    /* Writes refused while busy. */
+        uint8_t busy;
+        uint8_t echo;        /* Each delivery logs another entry. */
+};
+
+static struct conn conns[CONTEXTS];
+static struct log_drain pool;
+
+static int
+conn_write(void *user, const struct log_entry *e, uint32_t seq)
+{
+        struct conn *c = user;
+        (void)e;
+        if (c->busy != 0u) {
+                c->refused++;
+                return 1;
+        }
+        if (atomic_fetch_add(&c->inside, 1) != 0) {
+                c->errors++;
+        }
+        // Entries may be overwritten before delivery, but never reordered
+        if ((int32_t)(seq - c->next_seq) < 0) {
+                c->errors++;
+        }
+        c->next_seq = seq + 1u;
+        c->delivered++;
+        if (c->echo != 0u) {
+                log_event(&c->ctx, INFO, "Echo %u", seq);
+        }
+        (void)atomic_fetch_sub(&c->inside, 1);
+        return 0;
+}
+
+void
+setUp(void)
+{
+        for (uint32_t i = 0u; i < CONTEXTS; ++i) {
+                struct conn *c = &conns[i];
+                log_init(&c->ctx, zero_clock);
+                log_sink_init(&c->sink, conn_write, c, INFO, LOG_MODULES_ALL);
+                (void)pthread_mutex_init(&c->lock, NULL);
+                log_drain_src_init(&c->src, &c->ctx, &c->sink, &c->lock);
+                atomic_init(&c->inside, 0);
+                c->next_seq = 0u;
+                c->delivered = 0u;
+                c->errors = 0u;
+                c->refused = 0u;
+                c->busy = 0u;
+                c->echo = 0u;
+        }
+}
+void
+tearDown(void)
+{
+        for (uint32_t i = 0u; i < CONTEXTS; ++i) {
+                (void)pthread_mutex_destroy(&conns[i].lock);
+        }
+}
+
+static void
+produce(struct conn *c, uint32_t n)
+{
+        for (uint32_t i = 0u; i < n; ++i) {
+                (void)pthread_mutex_lock(&c->lock);
+                log_event(&c->ctx, INFO, "Event %u", i);
+                (void)pthread_mutex_unlock(&c->lock);
+                log_drain_notify(&pool, &c->src);
+        }
+}
+
+static void *
+producer(void *arg)
+{
+        uint32_t p = (uint32_t)(uintptr_t)arg;
+        for (uint32_t round = 0u; round < 4u; ++round) {
+                for (uint32_t i = p; i < CONTEXTS; i += PRODUCERS) {
+                        // Bursty: a few contexts get most of the traffic
+                        produce(&conns[i], ((i % 8u) == 0u) ? EVENTS : 8u);
+                }
+        }
+        return NULL;
+}
+
+void
+test_drain_delivers_every_context_in_order(void)
+{
+        pthread_t t[PRODUCERS];
+        TEST_ASSERT_EQUAL(0, log_drain_start(&pool, 4u, 16u));
+        for (uint32_t i = 0u; i < PRODUCERS; ++i) {
+                TEST_ASSERT_EQUAL(0, pthread_create(&t[i], NULL, producer,
+                                                    (void *)(uintptr_t)i));
+        }
+        for (uint32_t i = 0u; i < PRODUCERS; ++i) {
+                TEST_ASSERT_EQUAL(0, pthread_join(t[i], NULL));
+        }
+        log_drain_stop(&pool);
+
+        for (uint32_t i = 0u; i < CONTEXTS; ++i) {
+                struct conn *c = &conns[i];
+                uint32_t n = ((i % 8u) == 0u) ? 4u * EVENTS : 32u;
+                TEST_ASSERT_EQUAL_UINT32(0u, c->errors);
+                TEST_ASSERT_EQUAL_UINT32(n, log_get_seq(&c->ctx));
+                TEST_ASSERT_EQUAL_UINT32(n, c->sink.pos);
+                TEST_ASSERT_EQUAL_UINT32(n, c->delivered + c->sink.dropped);
+                uint8_t scheduled = atomic_load(&c->src.scheduled);
+                TEST_ASSERT_EQUAL_UINT8(0u, scheduled);
+        }
+        uint32_t queued = atomic_load(&pool.queued);
+        TEST_ASSERT_EQUAL_UINT32(0u, queued);
+}
+
+/* Read a field of c under its lock. */
+static uint32_t
+locked_read(struct conn *c, const uint32_t *field)
+{
+        (void)pthread_mutex_lock(&c->lock);
+        uint32_t v = *field;
+        (void)pthread_mutex_unlock(&c->lock);
+        return v;
+}
+
+void
+test_drain_retries_busy_sink_until_it_accepts(void)
+{
+        struct conn *c = &conns[0];
+        TEST_ASSERT_EQUAL(0, log_drain_start(&pool, 2u, 0u));
+        c->busy = 1u;
+        produce(c, 3u);
+        // Still scheduled, retried without further notifications
+        while (locked_read(c, &c->refused) < 3u) {
+                sched_yield();
+        }
+        TEST_ASSERT_EQUAL_UINT32(0u, locked_read(c, &c->delivered));
+        uint8_t scheduled = atomic_load(&c->src.scheduled);
+        TEST_ASSERT_EQUAL_UINT8(1u, scheduled);
+
+        (void)pthread_mutex_lock(&c->lock);
+        c->busy = 0u;
+        (void)pthread_mutex_unlock(&c->lock);
+        while (locked_read(c, &c->delivered) < 3u) {
+                sched_yield();
+        }
+
+        // Stopping gives up on a sink that stays busy
+        (void)pthread_mutex_lock(&c->lock);
+        c->busy = 1u;
+        (void)pthread_mutex_unlock(&c->lock);
+        produce(c, 1u);
+        log_drain_stop(&pool);
+        TEST_ASSERT_EQUAL_UINT32(3u, c->delivered);
+        TEST_ASSERT_EQUAL_UINT32(0u, c->errors);
+        scheduled = atomic_load(&c->src.scheduled);
+        TEST_ASSERT_EQUAL_UINT8(0u, scheduled);
+}
+
+void
+test_drain_flooding_context_does_not_starve_others(void)
+{
+        struct conn *loud = &conns[0];
+        struct conn *quiet = &conns[1];
+        // One worker, one entry per turn, and a context that never runs dry
+        TEST_ASSERT_EQUAL(0, log_drain_start(&pool, 1u, 1u));
+        loud->echo = 1u;
+        produce(loud, 1u);
+        while (locked_read(loud, &loud->delivered) < 64u) {
+                sched_yield();
+        }
+
+        produce(quiet, 3u);
+        for (uint32_t ms = 0u; ms < 2000u; ++ms) {
+                if (locked_read(quiet, &quiet->delivered) == 3u) {
+                        break;
+                }
+                struct timespec ts = { 0, 1000000L };
+                (void)nanosleep(&ts, NULL);
+        }
+        uint32_t delivered = locked_read(quiet, &quiet->delivered);
+        (void)pthread_mutex_lock(&loud->lock);
+        loud->echo = 0u;
+        (void)pthread_mutex_unlock(&loud->lock);
+        log_drain_stop(&pool);
+
+        TEST_ASSERT_EQUAL_UINT32(3u, delivered);
+        TEST_ASSERT_EQUAL_UINT32(0u, quiet->errors);
+        TEST_ASSERT_EQUAL_UINT32(0u, loud->errors);
+}
+
+int
+main(void)
+{
+        UNITY_BEGIN();
+        RUN_TEST(test_drain_delivers_every_context_in_order);
+        RUN_TEST(test_drain_retries_busy_sink_until_it_accepts);
+        RUN_TEST(test_drain_flooding_context_does_not_starve_others);
+        return UNITY_END();
+}
@@ -0,0 +1,188 @@
+#include <stdint.h>
+#include <string.h>
+
+#include "../subprojects/unity/src/unity.h"
+
+#include "../include/log.h"
+#include "../include/log_export.h"
+
+static uint32_t fake_time = 0;
+
+static uint32_t
+fake_timestamp(void)
+{
+        return fake_time;
+}
+
+void
+setUp(void)
+{
+        fake_time = 0;
+}
+void
+tearDown(void)
+{
+}
+
+void
+test_export_header_roundtrip(void)
+{
+        uint8_t buf[LOG_EXPORT_HEADER_LEN];
+        TEST_ASSERT_EQUAL(0, log_export_header(buf, sizeof(buf) - 1u));
+        TEST_ASSERT_EQUAL(LOG_EXPORT_HEADER_LEN,
+                          log_export_header(buf, sizeof(buf)));
+        TEST_ASSERT_EQUAL_MEMORY("EMLG", buf, 4);
+        TEST_ASSERT_EQUAL(LOG_EXPORT_HEADER_LEN,
+                          log_export_check_header(buf, sizeof(buf)));
+
+        buf[0] ^= 0xFFu;
+        TEST_ASSERT_EQUAL(0, log_export_check_header(buf, sizeof(buf)));
+}
+
+void
+test_record_roundtrip(void)
+{
+        struct log_entry in = { .timestamp = 0x12345678u,
+                                .level = FAULT,
+                                .module = 7u };
+        (void)strcpy(in.msg, "Overtemp 97C");
+
+        uint8_t buf[LOG_RECORD_MAX_LEN];
+        size_t n = log_record_encode(&in, buf, sizeof(buf));
+        TEST_ASSERT_EQUAL(LOG_RECORD_HEADER_LEN + strlen(in.msg), n);
+        TEST_ASSERT_EQUAL_UINT8(0x78u, buf[0]);
+        TEST_ASSERT_EQUAL_UINT8(0x12u, buf[3]);
+
+        struct log_entry out;
+        TEST_ASSERT_EQUAL(n, log_record_decode(buf, n, &out));
+        TEST_ASSERT_EQUAL_UINT32(in.timestamp, out.timestamp);
+        TEST_ASSERT_EQUAL_UINT16(FAULT, out.level);
+        TEST_ASSERT_EQUAL_UINT8(7u, out.module);
+        TEST_ASSERT_EQUAL_STRING(in.msg, out.msg);
+
+        /* Short buffers never produce partial records. */
+        TEST_ASSERT_EQUAL(0, log_record_encode(&in, buf, n - 1u));
+        TEST_ASSERT_EQUAL(0, log_record_decode(buf, n - 1u, &out));
+}
+
+void
+test_record_decode_truncates_long_message(void)
+{
+        uint8_t buf[LOG_RECORD_MAX_LEN];
+        (void)memset(buf, 'x', sizeof(buf));
+        buf[6] = 255u;
+
+        struct log_entry out;
+        TEST_ASSERT_EQUAL(LOG_RECORD_MAX_LEN,
+                          log_record_decode(buf, sizeof(buf), &out));
+        TEST_ASSERT_EQUAL(LOG_MSG_LEN - 1u, strlen(out.msg));
+}
+
+void
+test_export_in_chunks(void)
+{
+        struct log_ctx ctx;
+        log_init(&ctx, fake_timestamp);
+        for (uint16_t i = 0; i < 10u; ++i) {
+                log_event(&ctx, WARN, "Entry %u", i);
+                fake_time += 3;
+        }
+
+        /* Room for two records per call. */
+        uint8_t buf[2u * (LOG_RECORD_HEADER_LEN + 7u) + 3u];
+        uint16_t idx = 0u;
+        uint16_t decoded = 0u;
+        size_t n;
+        while ((n = log_export(&ctx, &idx, buf, sizeof(buf))) > 0u) {
+                size_t off = 0u;
+                struct log_entry e;
+                size_t used;
+                while ((used = log_record_decode(&buf[off], n - off, &e))
+                       > 0u) {
+                        char expected[16];
+                        snprintf(expected, sizeof(expected), "Entry %u",
+                                 decoded);
+                        TEST_ASSERT_EQUAL_STRING(expected, e.msg);
+                        TEST_ASSERT_EQUAL_UINT32(3u * decoded, e.timestamp);
+                        off += used;
+                        decoded++;
+                }
+                TEST_ASSERT_EQUAL(n, off);
+        }
+        TEST_ASSERT_EQUAL_UINT16(10u, decoded);
+        TEST_ASSERT_EQUAL_UINT16(10u, idx);
+}
+
+void
+test_export_skips_expired_entries(void)
+{
+        struct log_ctx ctx;
+        log_init(&ctx, fake_timestamp);
+        for (uint16_t i = 0; i < 6u; ++i) {
+                log_event(&ctx, INFO, "Entry %u", i);
+                fake_time += 10;
+        }
+        log_set_retention(&ctx, 30);
+
+        uint8_t buf[256];
+        uint16_t idx = 0u;
+        size_t n = log_export(&ctx, &idx, buf, sizeof(buf));
+        TEST_ASSERT_EQUAL_UINT16(6u, idx);
+
+        struct log_entry e;
+        size_t used = log_record_decode(buf, n, &e);
+        TEST_ASSERT_EQUAL_STRING("Entry 3", e.msg);
+        TEST_ASSERT_EQUAL(3u * used, n);
+}
+
+void
+test_batch_header_and_writer(void)
+{
+        struct log_ctx ctx;
+        log_init(&ctx, fake_timestamp);
+        for (uint16_t i = 0; i < 10u; ++i) {
+                log_event(&ctx, INFO, "Entry %u", i);
+        }
+
+        /* Room for three records. */
+        uint8_t rec[3u * (LOG_RECORD_HEADER_LEN + 7u)];
+        struct log_batch_buf bb = { .buf = rec, .cap = sizeof(rec) };
+        TEST_ASSERT_EQUAL(0, log_batch_write(&bb, log_get_entry(&ctx, 4), 4));
+        TEST_ASSERT_EQUAL(0, log_batch_write(&bb, log_get_entry(&ctx, 5), 5));
+        TEST_ASSERT_EQUAL(0, log_batch_write(&bb, log_get_entry(&ctx, 6), 6));
+        TEST_ASSERT_EQUAL(1, log_batch_write(&bb, log_get_entry(&ctx, 7), 7));
+        TEST_ASSERT_EQUAL_UINT16(3u, bb.count);
+        TEST_ASSERT_EQUAL_UINT32(4u, bb.seq);
+        TEST_ASSERT_EQUAL(sizeof(rec), bb.len);
+
+        struct log_batch in = { .source = 0xA1B2C3D4u,
+                                .seq = bb.seq,
+                                .dropped = 9u,
+                                .count = bb.count,
+                                .len = (uint16_t)bb.len };
+        struct log_batch out;
+        uint8_t hdr[LOG_BATCH_HEADER_LEN];
+        TEST_ASSERT_EQUAL(LOG_BATCH_HEADER_LEN,
+                          log_batch_header(&in, hdr, sizeof(hdr)));
+        TEST_ASSERT_EQUAL(LOG_BATCH_HEADER_LEN,
+                          log_batch_parse(hdr, sizeof(hdr), &out));
+        TEST_ASSERT_EQUAL_UINT32(in.source, out.source);
+        TEST_ASSERT_EQUAL_UINT32(in.seq, out.seq);
+        TEST_ASSERT_EQUAL_UINT32(in.dropped, out.dropped);
+        TEST_ASSERT_EQUAL_UINT16(in.count, out.count);
+        TEST_ASSERT_EQUAL_UINT16(in.len, out.len);
+        TEST_ASSERT_EQUAL(0, log_batch_parse(hdr, sizeof(hdr) - 1u, &out));
+}
+
+int
+main(void)
+{
+        UNITY_BEGIN();
+        RUN_TEST(test_export_header_roundtrip);
+        RUN_TEST(test_record_roundtrip);
+        RUN_TEST(test_record_decode_truncates_long_message);
+        RUN_TEST(test_export_in_chunks);
+        RUN_TEST(test_export_skips_expired_entries);
+        RUN_TEST(test_batch_header_and_writer);
+        return UNITY_END();
+}
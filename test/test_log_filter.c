@@ -0,0 +1,227 @@
+#include <stdint.h>
+#include <string.h>
+
+#include "../subprojects/unity/src/unity.h"
+
+#include "../include/log.h"
+#include "../include/log_export.h"
+#include "../include/log_filter.h"
+#include "../include/log_sink.h"
+
+static uint32_t fake_time = 0;
+
+static uint32_t
+fake_timestamp(void)
+{
+        return fake_time;
+}
+
+static struct log_ctx test_log;
+static struct log_filter f;
+
+static struct log_entry
+entry(uint32_t ts, enum log_level level, uint8_t module, const char *msg)
+{
+        struct log_entry e;
+        (void)memset(&e, 0, sizeof(e));
+        e.timestamp = ts;
+        e.level = (uint16_t)level;
+        e.module = module;
+        (void)strncpy(e.msg, msg, sizeof(e.msg) - 1u);
+        return e;
+}
+
+void
+setUp(void)
+{
+        fake_time = 0;
+        log_init(&test_log, fake_timestamp);
+}
+void
+tearDown(void)
+{
+}
+
+void
+test_filter_predicates_and_precedence(void)
+{
+        struct log_entry w3 = entry(1500u, WARN, 3u, "link retry 2");
+        struct log_entry i3 = entry(1500u, INFO, 3u, "link retry 2");
+        struct log_entry f4 = entry(2500u, FAULT, 4u, "crc error");
+
+        TEST_ASSERT_EQUAL(0, log_filter_compile(&f, ""));
+        TEST_ASSERT_EQUAL_UINT8(1u, log_filter_match(&f, &i3));
+
+        int rc = log_filter_compile(&f, "level >= WARN && module == 3 && "
+                                        "time in [1000, 2000]");
+        TEST_ASSERT_EQUAL(0, rc);
+        TEST_ASSERT_EQUAL_UINT8(1u, log_filter_match(&f, &w3));
+        TEST_ASSERT_EQUAL_UINT8(0u, log_filter_match(&f, &i3));
+        TEST_ASSERT_EQUAL_UINT8(0u, log_filter_match(&f, &f4));
+
+        // && binds tighter than ||, ! tighter than both
+        rc = log_filter_compile(&f, "module == 4 || level == INFO && "
+                                    "msg contains \"retry\"");
+        TEST_ASSERT_EQUAL(0, rc);
+        TEST_ASSERT_EQUAL_UINT8(0u, log_filter_match(&f, &w3));
+        TEST_ASSERT_EQUAL_UINT8(1u, log_filter_match(&f, &i3));
+        TEST_ASSERT_EQUAL_UINT8(1u, log_filter_match(&f, &f4));
+
+        rc = log_filter_compile(&f, "!(module == 4 || level == INFO) && "
+                                    "time < 0x800");
+        TEST_ASSERT_EQUAL(0, rc);
+        TEST_ASSERT_EQUAL_UINT8(1u, log_filter_match(&f, &w3));
+        TEST_ASSERT_EQUAL_UINT8(0u, log_filter_match(&f, &i3));
+        TEST_ASSERT_EQUAL_UINT8(0u, log_filter_match(&f, &f4));
+
+        rc = log_filter_compile(&f, "msg contains \"crc e\"");
+        TEST_ASSERT_EQUAL(0, rc);
+        TEST_ASSERT_EQUAL_UINT8(0u, log_filter_match(&f, &w3));
+        TEST_ASSERT_EQUAL_UINT8(1u, log_filter_match(&f, &f4));
+
+        // Time windows may span the timestamp wrap
+        struct log_entry late = entry(0xFFFFFFF0u, INFO, 0u, "");
+        struct log_entry early = entry(0x10u, INFO, 0u, "");
+        rc = log_filter_compile(&f, "time in [0xFFFFFF00, 0x100]");
+        TEST_ASSERT_EQUAL(0, rc);
+        TEST_ASSERT_EQUAL_UINT8(1u, log_filter_match(&f, &late));
+        TEST_ASSERT_EQUAL_UINT8(1u, log_filter_match(&f, &early));
+        TEST_ASSERT_EQUAL_UINT8(0u, log_filter_match(&f, &w3));
+}
+
+void
+test_filter_tests_text_last(void)
+{
+        int rc = log_filter_compile(&f, "msg contains \"x\" && "
+                                        "(level == FAULT || msg contains \"y\")"
+                                        " && module != 2");
+        TEST_ASSERT_EQUAL(0, rc);
+        // module, then the || that may avoid text, then text only
+        TEST_ASSERT_EQUAL_UINT8(LOG_FILTER_MODULE, f.code[0].op);
+        TEST_ASSERT_EQUAL_UINT8(LOG_FILTER_JF, f.code[1].op);
+        TEST_ASSERT_EQUAL_UINT8(LOG_FILTER_LEVEL, f.code[2].op);
+        TEST_ASSERT_EQUAL_UINT8(LOG_FILTER_JT, f.code[3].op);
+        TEST_ASSERT_EQUAL_UINT8(LOG_FILTER_CONTAINS, f.code[4].op);
+        TEST_ASSERT_EQUAL_UINT8(LOG_FILTER_JF, f.code[5].op);
+        TEST_ASSERT_EQUAL_UINT8(LOG_FILTER_CONTAINS, f.code[6].op);
+        TEST_ASSERT_EQUAL_UINT16(7u, f.len);
+        TEST_ASSERT_EQUAL_UINT16(7u, f.code[1].arg);
+        TEST_ASSERT_EQUAL_UINT16(5u, f.code[3].arg);
+        TEST_ASSERT_EQUAL_UINT16(7u, f.code[5].arg);
+
+        struct log_entry e = entry(0u, FAULT, 1u, "x");
+        TEST_ASSERT_EQUAL_UINT8(1u, log_filter_match(&f, &e));
+        e = entry(0u, INFO, 1u, "x y");
+        TEST_ASSERT_EQUAL_UINT8(1u, log_filter_match(&f, &e));
+        e = entry(0u, INFO, 1u, "x");
+        TEST_ASSERT_EQUAL_UINT8(0u, log_filter_match(&f, &e));
+        e = entry(0u, FAULT, 2u, "x");
+        TEST_ASSERT_EQUAL_UINT8(0u, log_filter_match(&f, &e));
+}
+
+void
+test_filter_rejects_bad_expressions(void)
+{
+        struct log_entry e = entry(0u, INFO, 0u, "");
+        static const struct {
+                const char *expr;
+                uint16_t error;
+        } bad[] = {
+                { "level >= NOTICE", 9u },
+                { "module == 3 &&", 14u },
+                { "(level == INFO", 14u },
+                { "msg contains \"open", 18u },
+                { "time in [1, 2", 13u },
+                { "levels == 1", 0u },
+                { "module == 99999999999", 10u },
+        };
+        for (size_t i = 0u; i < (sizeof(bad) / sizeof(bad[0])); ++i) {
+                TEST_ASSERT_MESSAGE(log_filter_compile(&f, bad[i].expr) == -1,
+                                    bad[i].expr);
+                TEST_ASSERT_MESSAGE(f.error == bad[i].error, bad[i].expr);
+                TEST_ASSERT_EQUAL_UINT8(0u, log_filter_match(&f, &e));
+        }
+        TEST_ASSERT_EQUAL(-1, log_filter_compile(&f, NULL));
+        TEST_ASSERT_EQUAL(-1, log_filter_compile(NULL, "level == INFO"));
+        TEST_ASSERT_EQUAL_UINT8(0u, log_filter_match(NULL, &e));
+
+        // Too deep, and too many predicates
+        int rc = log_filter_compile(&f, "((((((((((((((((((level == 0))))"
+                                        "))))))))))))))");
+        TEST_ASSERT_EQUAL(-1, rc);
+        char big[LOG_FILTER_INSNS * 12u + 1u] = "";
+        for (uint32_t i = 0u; i < LOG_FILTER_INSNS; ++i) {
+                (void)strcat(big, (i == 0u) ? "module == 1" : "||module==1");
+        }
+        TEST_ASSERT_EQUAL(-1, log_filter_compile(&f, big));
+}
+
+struct capture {
+        uint32_t n;
+        uint8_t module[16];
+};
+
+static int
+capture_write(void *user, const struct log_entry *e, uint32_t seq)
+{
+        struct capture *c = user;
+        (void)seq;
+        c->module[c->n++] = e->module;
+        return 0;
+}
+
+void
+test_filter_applies_to_iteration_export_and_sinks(void)
+{
+        for (uint8_t m = 0u; m < 8u; ++m) {
+                fake_time = m * 100u;
+                log_event_mod(&test_log, m, (m < 4u) ? INFO : WARN, "m%u", m);
+        }
+        int rc = log_filter_compile(&f, "level == WARN && time <= 600 || "
+                                        "msg contains \"m1\"");
+        TEST_ASSERT_EQUAL(0, rc);
+
+        uint16_t i = 0u;
+        const struct log_entry *e = log_filter_next(&f, &test_log, &i);
+        TEST_ASSERT_NOT_NULL(e);
+        TEST_ASSERT_EQUAL_UINT8(1u, e->module);
+        e = log_filter_next(&f, &test_log, &i);
+        TEST_ASSERT_EQUAL_UINT8(4u, e->module);
+        e = log_filter_next(&f, &test_log, &i);
+        TEST_ASSERT_EQUAL_UINT8(5u, e->module);
+        e = log_filter_next(&f, &test_log, &i);
+        TEST_ASSERT_EQUAL_UINT8(6u, e->module);
+        TEST_ASSERT_NULL(log_filter_next(&f, &test_log, &i));
+        TEST_ASSERT_EQUAL_UINT16(8u, i);
+
+        uint8_t buf[64];
+        struct log_entry out;
+        i = 0u;
+        size_t n = log_export_filter(&test_log, &i, &f, buf, sizeof(buf));
+        TEST_ASSERT_EQUAL_UINT16(8u, i);
+        TEST_ASSERT_EQUAL_size_t(4u * (LOG_RECORD_HEADER_LEN + 2u), n);
+        TEST_ASSERT_TRUE(log_record_decode(&buf[9], n - 9u, &out) != 0u);
+        TEST_ASSERT_EQUAL_STRING("m4", out.msg);
+
+        struct capture c;
+        struct log_sink s;
+        (void)memset(&c, 0, sizeof(c));
+        log_sink_init(&s, capture_write, &c, INFO, ~LOG_MODULE_BIT(5));
+        log_sink_set_filter(&s, &f);
+        TEST_ASSERT_EQUAL_UINT16(3u, log_sink_drain(&s, &test_log, 16u));
+        TEST_ASSERT_EQUAL_UINT8(1u, c.module[0]);
+        TEST_ASSERT_EQUAL_UINT8(4u, c.module[1]);
+        TEST_ASSERT_EQUAL_UINT8(6u, c.module[2]);
+        TEST_ASSERT_EQUAL_UINT32(8u, s.pos);
+}
+
+int
+main(void)
+{
+        UNITY_BEGIN();
+        RUN_TEST(test_filter_predicates_and_precedence);
+        RUN_TEST(test_filter_tests_text_last);
+        RUN_TEST(test_filter_rejects_bad_expressions);
+        RUN_TEST(test_filter_applies_to_iteration_export_and_sinks);
+        return UNITY_END();
+}
@@ -0,0 +1,237 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "../subprojects/unity/src/unity.h"
+
+#include "../include/log_flash.h"
+
+#define PAGE   (128u)
+#define BLOCK  (512u)
+#define BLOCKS (4u)
+
+/* File-backed NOR emulator: programming can only clear bits. */
+struct nor {
+        FILE *fp;
+        uint32_t progs;
+        uint32_t erases[BLOCKS];
+        uint8_t fail_prog;
+};
+
+static int
+nor_read(void *user, uint32_t addr, uint8_t *buf, size_t len)
+{
+        struct nor *n = user;
+        if ((fseek(n->fp, (long)addr, SEEK_SET) != 0)
+            || (fread(buf, 1u, len, n->fp) != len)) {
+                return -1;
+        }
+        return 0;
+}
+
+static int
+nor_prog(void *user, uint32_t addr, const uint8_t *buf, size_t len)
+{
+        struct nor *n = user;
+        uint8_t cur[PAGE];
+        if ((n->fail_prog != 0u) || ((addr % PAGE) != 0u) || (len != PAGE)
+            || (nor_read(user, addr, cur, len) != 0)) {
+                return -1;
+        }
+        for (size_t i = 0u; i < len; ++i) {
+                cur[i] &= buf[i];
+        }
+        if ((fseek(n->fp, (long)addr, SEEK_SET) != 0)
+            || (fwrite(cur, 1u, len, n->fp) != len)) {
+                return -1;
+        }
+        n->progs++;
+        return 0;
+}
+
+static int
+nor_erase(void *user, uint32_t addr)
+{
+        struct nor *n = user;
+        uint8_t ff[BLOCK];
+        memset(ff, 0xFF, sizeof(ff));
+        if (((addr % BLOCK) != 0u) || (fseek(n->fp, (long)addr, SEEK_SET) != 0)
+            || (fwrite(ff, 1u, sizeof(ff), n->fp) != sizeof(ff))) {
+                return -1;
+        }
+        n->erases[addr / BLOCK]++;
+        return 0;
+}
+
+static uint32_t fake_time = 0;
+
+static uint32_t
+fake_timestamp(void)
+{
+        return fake_time++;
+}
+
+static struct nor nor;
+static struct log_flash_dev dev;
+static struct log_flash flash;
+static struct log_ctx ctx;
+
+void
+setUp(void)
+{
+        uint8_t ff[BLOCK * BLOCKS];
+        memset(ff, 0xFF, sizeof(ff));
+        memset(&nor, 0, sizeof(nor));
+        nor.fp = tmpfile();
+        TEST_ASSERT_NOT_NULL(nor.fp);
+        TEST_ASSERT_EQUAL(sizeof(ff), fwrite(ff, 1u, sizeof(ff), nor.fp));
+        dev = (struct log_flash_dev){ .read = nor_read,
+                                      .prog = nor_prog,
+                                      .erase = nor_erase,
+                                      .user = &nor,
+                                      .page_size = PAGE,
+                                      .block_size = BLOCK,
+                                      .block_count = BLOCKS };
+        fake_time = 0;
+        log_init(&ctx, fake_timestamp);
+        TEST_ASSERT_EQUAL(0, log_flash_mount(&flash, &dev, INFO,
+                                             LOG_MODULES_ALL));
+}
+void
+tearDown(void)
+{
+        (void)fclose(nor.fp);
+}
+
+static void
+produce(uint32_t from, uint32_t n)
+{
+        for (uint32_t i = from; i < (from + n); ++i) {
+                log_event(&ctx, INFO, "Entry %lu", (unsigned long)i);
+        }
+}
+
+/* Check that flash holds exactly entries [from, to) in order. */
+static void
+expect_entries(uint32_t from, uint32_t to)
+{
+        struct log_flash_iter it;
+        struct log_entry e;
+        char expected[24];
+        log_flash_iter_init(&flash, &it);
+        for (uint32_t i = from; i < to; ++i) {
+                TEST_ASSERT_EQUAL(1, log_flash_next(&flash, &it, &e));
+                snprintf(expected, sizeof(expected), "Entry %lu",
+                         (unsigned long)i);
+                TEST_ASSERT_EQUAL_STRING(expected, e.msg);
+                TEST_ASSERT_EQUAL_UINT32(i, e.timestamp);
+        }
+        TEST_ASSERT_EQUAL(0, log_flash_next(&flash, &it, &e));
+}
+
+void
+test_flash_blank_device_reads_empty(void)
+{
+        expect_entries(0, 0);
+        TEST_ASSERT_EQUAL(0, log_flash_flush(&flash, &ctx));
+        TEST_ASSERT_EQUAL_UINT32(0u, nor.erases[0]);
+}
+
+void
+test_flash_one_program_per_page(void)
+{
+        // "Entry N" records are 14 bytes: 8 fit in page 0, 8 in later pages
+        produce(0, 20);
+        TEST_ASSERT_EQUAL(3, log_flash_flush(&flash, &ctx));
+        TEST_ASSERT_EQUAL_UINT32(3u, nor.progs);
+        TEST_ASSERT_EQUAL_UINT32(1u, nor.erases[0]);
+        expect_entries(0, 20);
+
+        produce(20, 1);
+        TEST_ASSERT_EQUAL(1, log_flash_flush(&flash, &ctx));
+        TEST_ASSERT_EQUAL(0, log_flash_flush(&flash, &ctx));
+        expect_entries(0, 21);
+}
+
+void
+test_flash_remount_recovers_position(void)
+{
+        produce(0, 20);
+        TEST_ASSERT_EQUAL(3, log_flash_flush(&flash, &ctx));
+
+        TEST_ASSERT_EQUAL(0, log_flash_mount(&flash, &dev, INFO,
+                                             LOG_MODULES_ALL));
+        TEST_ASSERT_EQUAL_UINT32(0u, flash.block);
+        TEST_ASSERT_EQUAL_UINT32(3u, flash.page);
+        expect_entries(0, 20);
+
+        log_sink_seek(&flash.sink, &ctx, 1u);
+        produce(20, 5);
+        TEST_ASSERT_EQUAL(1, log_flash_flush(&flash, &ctx));
+        expect_entries(0, 25);
+}
+
+void
+test_flash_wraps_round_robin(void)
+{
+        uint32_t total = 0u;
+        // 4 pages per block: each flush of 7 entries programs one page
+        for (uint32_t round = 0u; round < 22u; ++round) {
+                produce(total, 7);
+                total += 7u;
+                TEST_ASSERT_EQUAL(1, log_flash_flush(&flash, &ctx));
+        }
+        // 22 pages: blocks 0 and 1 reused, block 2 holds the oldest data
+        TEST_ASSERT_EQUAL_UINT32(2u, nor.erases[0]);
+        TEST_ASSERT_EQUAL_UINT32(2u, nor.erases[1]);
+        TEST_ASSERT_EQUAL_UINT32(1u, nor.erases[2]);
+        TEST_ASSERT_EQUAL_UINT32(1u, nor.erases[3]);
+        TEST_ASSERT_EQUAL_UINT32(1u, flash.block);
+        expect_entries(total - (14u * 7u), total);
+
+        TEST_ASSERT_EQUAL(0, log_flash_mount(&flash, &dev, INFO,
+                                             LOG_MODULES_ALL));
+        TEST_ASSERT_EQUAL_UINT32(1u, flash.block);
+        TEST_ASSERT_EQUAL_UINT32(2u, flash.page);
+        expect_entries(total - (14u * 7u), total);
+}
+
+void
+test_flash_skips_torn_page_and_retries_failed_program(void)
+{
+        produce(0, 16);
+        TEST_ASSERT_EQUAL(2, log_flash_flush(&flash, &ctx));
+
+        // Tear page 1: clear bits in its records as a partial program would
+        uint8_t zero = 0u;
+        TEST_ASSERT_EQUAL(0, fseek(nor.fp, (long)(PAGE + 10u), SEEK_SET));
+        TEST_ASSERT_EQUAL(1u, fwrite(&zero, 1u, 1u, nor.fp));
+
+        nor.fail_prog = 1u;
+        produce(16, 8);
+        TEST_ASSERT_EQUAL(-1, log_flash_flush(&flash, &ctx));
+        nor.fail_prog = 0u;
+        TEST_ASSERT_EQUAL(1, log_flash_flush(&flash, &ctx));
+
+        struct log_flash_iter it;
+        struct log_entry e;
+        uint32_t n = 0u;
+        log_flash_iter_init(&flash, &it);
+        while (log_flash_next(&flash, &it, &e) == 1) {
+                n++;
+        }
+        TEST_ASSERT_EQUAL_UINT32(16u, n);
+        TEST_ASSERT_EQUAL_UINT32(1u, it.bad);
+}
+
+int
+main(void)
+{
+        UNITY_BEGIN();
+        RUN_TEST(test_flash_blank_device_reads_empty);
+        RUN_TEST(test_flash_one_program_per_page);
+        RUN_TEST(test_flash_remount_recovers_position);
+        RUN_TEST(test_flash_wraps_round_robin);
+        RUN_TEST(test_flash_skips_torn_page_and_retries_failed_program);
+        return UNITY_END();
+}
@@ -0,0 +1,246 @@
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "../subprojects/unity/src/unity.h"
+
+#include "../include/log_layout.h"
+
+static uint32_t fake_time = 0;
+
+static uint32_t
+fake_timestamp(void)
+{
+        return fake_time++;
+}
+
+static struct log_ctx ctx;
+
+void
+setUp(void)
+{
+        fake_time = 0;
+        log_init(&ctx, fake_timestamp);
+}
+void
+tearDown(void)
+{
+}
+
+void
+test_layout_describes_this_build(void)
+{
+        const struct log_layout *lay = ctx.layout;
+        TEST_ASSERT_EQUAL_PTR(&log_ctx_layout, lay);
+        TEST_ASSERT_EQUAL_UINT8(1u, log_layout_check(lay));
+        TEST_ASSERT_EQUAL(56u, sizeof(struct log_layout));
+        TEST_ASSERT_EQUAL(sizeof(struct log_entry), lay->entry_size);
+        TEST_ASSERT_EQUAL(LOG_ENTRIES, lay->capacity);
+        TEST_ASSERT_EQUAL(LOG_MSG_LEN, lay->msg_len);
+        TEST_ASSERT_EQUAL(sizeof(struct log_ctx), lay->ctx_size);
+        TEST_ASSERT_EQUAL(offsetof(struct log_ctx, seq), lay->ctx_seq);
+        TEST_ASSERT_EQUAL(offsetof(struct log_ctx, pinned), lay->ctx_pinned);
+        TEST_ASSERT_EQUAL(offsetof(struct log_ctx, pin_seq), lay->ctx_pin_seq);
+        TEST_ASSERT_EQUAL(LOG_LEVEL_INDEX ? LOG_LAYOUT_LEVEL_INDEX : 0u,
+                          lay->flags & LOG_LAYOUT_LEVEL_INDEX);
+#if LOG_MODULE_QUOTA
+        TEST_ASSERT_EQUAL(LOG_LAYOUT_SLOT_SEQ,
+                          lay->flags & LOG_LAYOUT_SLOT_SEQ);
+        TEST_ASSERT_EQUAL(offsetof(struct log_ctx, slot_seq),
+                          lay->ctx_slot_seq);
+#else
+        TEST_ASSERT_EQUAL(0u, lay->flags & LOG_LAYOUT_SLOT_SEQ);
+#endif
+}
+
+void
+test_layout_reads_own_image(void)
+{
+        static uint8_t image[sizeof(struct log_ctx)];
+        struct log_entry e;
+
+        for (uint16_t i = 0; i < LOG_ENTRIES + 3; ++i) {
+                log_event_mod(&ctx, (uint8_t)(i % LOG_MODULES), WARN,
+                              "Entry %u", i);
+        }
+        (void)memcpy(image, &ctx, sizeof(image));
+
+        TEST_ASSERT_EQUAL_UINT16(LOG_ENTRIES,
+                                 log_layout_count(ctx.layout, image,
+                                                  sizeof(image)));
+        TEST_ASSERT_EQUAL_UINT32(LOG_ENTRIES + 3,
+                                 log_layout_seq(ctx.layout, image,
+                                                sizeof(image)));
+        for (uint16_t i = 0; i < LOG_ENTRIES; ++i) {
+                const struct log_entry *ref = log_get_entry(&ctx, i);
+                TEST_ASSERT_EQUAL_UINT8(1u,
+                                        log_layout_entry(ctx.layout, image,
+                                                         sizeof(image), i,
+                                                         &e));
+                TEST_ASSERT_EQUAL_UINT32(ref->timestamp, e.timestamp);
+                TEST_ASSERT_EQUAL_UINT16(ref->level, e.level);
+                TEST_ASSERT_EQUAL_UINT8(ref->module, e.module);
+                TEST_ASSERT_EQUAL_STRING(ref->msg, e.msg);
+                TEST_ASSERT_EQUAL_UINT32(log_get_seq_at(&ctx, i),
+                                         log_layout_seq_at(ctx.layout, image,
+                                                           sizeof(image), i));
+        }
+        TEST_ASSERT_EQUAL_UINT8(0u, log_layout_entry(ctx.layout, image,
+                                                     sizeof(image),
+                                                     LOG_ENTRIES, &e));
+        TEST_ASSERT_EQUAL_UINT8(0u, log_layout_entry(ctx.layout, image,
+                                                     sizeof(image) - 1u, 0u,
+                                                     &e));
+}
+
+static void
+put_be(uint8_t *p, uint32_t v, uint8_t n)
+{
+        for (uint8_t i = 0u; i < n; ++i) {
+                p[i] = (uint8_t)(v >> (8u * (n - 1u - i)));
+        }
+}
+
+void
+test_layout_reads_pinned_region(void)
+{
+        static uint8_t image[sizeof(struct log_ctx)];
+        struct log_entry e;
+
+        TEST_ASSERT_EQUAL_UINT8(1u, log_set_pinned(&ctx, 2u));
+        for (uint16_t i = 0; i < (2u * LOG_ENTRIES); ++i) {
+                log_event(&ctx, INFO, "Entry %u", i);
+        }
+        (void)memcpy(image, &ctx, sizeof(image));
+        for (uint16_t i = 0; i < LOG_ENTRIES; ++i) {
+                TEST_ASSERT_EQUAL_UINT8(1u,
+                                        log_layout_entry(ctx.layout, image,
+                                                         sizeof(image), i,
+                                                         &e));
+                TEST_ASSERT_EQUAL_STRING(log_get_entry(&ctx, i)->msg, e.msg);
+                TEST_ASSERT_EQUAL_UINT32(log_get_seq_at(&ctx, i),
+                                         log_layout_seq_at(ctx.layout, image,
+                                                           sizeof(image), i));
+        }
+}
+
+void
+test_layout_reads_quota_holes(void)
+{
+#if LOG_MODULE_QUOTA
+        static uint8_t image[sizeof(struct log_ctx)];
+        struct log_entry e;
+
+        log_set_quota(&ctx, 1u, 2u);
+        for (uint16_t i = 0; i < LOG_ENTRIES; ++i) {
+                log_event_mod(&ctx, (i < 2u) ? 1u : 2u, INFO, "Entry %u", i);
+        }
+        (void)memcpy(image, &ctx, sizeof(image));
+        uint16_t holes = 0u;
+        for (uint16_t i = 0; i < LOG_ENTRIES; ++i) {
+                TEST_ASSERT_EQUAL_UINT8(1u,
+                                        log_layout_entry(ctx.layout, image,
+                                                         sizeof(image), i,
+                                                         &e));
+                TEST_ASSERT_EQUAL_UINT32(log_get_seq_at(&ctx, i),
+                                         log_layout_seq_at(ctx.layout, image,
+                                                           sizeof(image), i));
+                if (log_get_entry(&ctx, i) == NULL) {
+                        TEST_ASSERT_EQUAL_UINT16(LOG_LEVEL_HOLE, e.level);
+                        holes++;
+                } else {
+                        TEST_ASSERT_EQUAL_UINT16(INFO, e.level);
+                }
+        }
+        TEST_ASSERT_EQUAL_UINT16(LOG_QUOTA_SLACK, holes);
+#else
+        TEST_IGNORE_MESSAGE("LOG_MODULE_QUOTA disabled");
+#endif
+}
+
+void
+test_layout_reads_foreign_geometry(void)
+{
+        // Big-endian target, 4 packed entries of 15 bytes, 8 byte messages,
+        // and the rest of the context beyond 64 KiB
+        const struct log_layout lay = { .magic = LOG_LAYOUT_MAGIC,
+                                        .version = LOG_LAYOUT_VERSION,
+                                        .size = sizeof(struct log_layout),
+                                        .flags = LOG_LAYOUT_BIG_ENDIAN,
+                                        .entry_size = 15u,
+                                        .capacity = 4u,
+                                        .msg_len = 8u,
+                                        .ctx_buffer = 4u,
+                                        .ctx_head = 0x10040u,
+                                        .ctx_count = 0x10042u,
+                                        .ctx_seq = 0x10044u,
+                                        .entry_timestamp = 0u,
+                                        .entry_level = 4u,
+                                        .entry_module = 6u,
+                                        .entry_msg = 7u,
+                                        .ctx_size = 0x1004Cu,
+                                        .ctx_pinned = 0x10048u };
+        static uint8_t image[0x1004Cu];
+        static const char *msgs[4] = { "newest", "oldest", "second", "third" };
+        for (uint32_t slot = 0u; slot < 4u; ++slot) {
+                uint8_t *p = &image[4u + (slot * 15u)];
+                put_be(&p[0], 0x01020300u + slot, 4u);
+                put_be(&p[4], FAULT, 2u);
+                p[6] = (uint8_t)slot;
+                (void)memcpy(&p[7], msgs[slot], strlen(msgs[slot]));
+        }
+        put_be(&image[0x10040u], 1u, 2u);
+        put_be(&image[0x10042u], 4u, 2u);
+        put_be(&image[0x10044u], 9u, 4u);
+
+        TEST_ASSERT_EQUAL_UINT8(1u, log_layout_check(&lay));
+        TEST_ASSERT_EQUAL_UINT16(4u,
+                                 log_layout_count(&lay, image, sizeof(image)));
+        TEST_ASSERT_EQUAL_UINT32(9u,
+                                 log_layout_seq(&lay, image, sizeof(image)));
+
+        struct log_entry e;
+        TEST_ASSERT_EQUAL_UINT8(1u, log_layout_entry(&lay, image,
+                                                     sizeof(image), 0u, &e));
+        TEST_ASSERT_EQUAL_UINT32(0x01020301u, e.timestamp);
+        TEST_ASSERT_EQUAL_UINT16(FAULT, e.level);
+        TEST_ASSERT_EQUAL_UINT8(1u, e.module);
+        TEST_ASSERT_EQUAL_STRING("oldest", e.msg);
+        TEST_ASSERT_EQUAL_UINT8(1u, log_layout_entry(&lay, image,
+                                                     sizeof(image), 3u, &e));
+        TEST_ASSERT_EQUAL_STRING("newest", e.msg);
+}
+
+void
+test_layout_check_rejects_bad_descriptors(void)
+{
+        struct log_layout lay = log_ctx_layout;
+        lay.magic ^= 1u;
+        TEST_ASSERT_EQUAL_UINT8(0u, log_layout_check(&lay));
+
+        lay = log_ctx_layout;
+        lay.version = LOG_LAYOUT_VERSION + 1u;
+        TEST_ASSERT_EQUAL_UINT8(0u, log_layout_check(&lay));
+
+        lay = log_ctx_layout;
+        lay.capacity = 0xFFFFu;
+        TEST_ASSERT_EQUAL_UINT8(0u, log_layout_check(&lay));
+
+        lay = log_ctx_layout;
+        lay.entry_msg = lay.entry_size;
+        TEST_ASSERT_EQUAL_UINT8(0u, log_layout_check(&lay));
+        TEST_ASSERT_EQUAL_UINT8(0u, log_layout_check(NULL));
+}
+
+int
+main(void)
+{
+        UNITY_BEGIN();
+        RUN_TEST(test_layout_describes_this_build);
+        RUN_TEST(test_layout_reads_own_image);
+        RUN_TEST(test_layout_reads_pinned_region);
+        RUN_TEST(test_layout_reads_quota_holes);
+        RUN_TEST(test_layout_reads_foreign_geometry);
+        RUN_TEST(test_layout_check_rejects_bad_descriptors);
+        return UNITY_END();
+}
@@ -0,0 +1,173 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "../subprojects/unity/src/unity.h"
+
+#include "../include/log_export.h"
+#include "../include/log_merge.h"
+
+static char paths[3][48]; /* "merge_%d_%ld.elog" at its longest */
+
+/* Write n records with timestamps start, start + step, ... */
+static void
+write_source(const char *path, uint32_t n, uint32_t start, uint32_t step,
+             const char *tag)
+{
+        FILE *f = fopen(path, "wb");
+        TEST_ASSERT_NOT_NULL(f);
+        uint8_t buf[LOG_RECORD_MAX_LEN];
+        size_t len = log_export_header(buf, sizeof(buf));
+        TEST_ASSERT_EQUAL(len, fwrite(buf, 1u, len, f));
+        for (uint32_t i = 0; i < n; ++i) {
+                struct log_entry e = { .timestamp = start + (i * step),
+                                       .level = INFO };
+                snprintf(e.msg, sizeof(e.msg), "%s %u", tag, i);
+                len = log_record_encode(&e, buf, sizeof(buf));
+                TEST_ASSERT_EQUAL(len, fwrite(buf, 1u, len, f));
+        }
+        TEST_ASSERT_EQUAL(0, fclose(f));
+}
+
+void
+setUp(void)
+{
+        for (int i = 0; i < 3; ++i) {
+                snprintf(paths[i], sizeof(paths[i]), "merge_%d_%ld.elog", i,
+                         (long)getpid());
+        }
+}
+void
+tearDown(void)
+{
+        for (int i = 0; i < 3; ++i) {
+                (void)remove(paths[i]);
+        }
+}
+
+void
+test_merge_orders_by_timestamp(void)
+{
+        write_source(paths[0], 100u, 0u, 3u, "a");
+        write_source(paths[1], 100u, 1u, 3u, "b");
+        write_source(paths[2], 100u, 2u, 3u, "c");
+
+        struct log_merge_src src[3];
+        uint32_t heap[3];
+        for (int i = 0; i < 3; ++i) {
+                TEST_ASSERT_EQUAL(0,
+                                  log_merge_open(&src[i], paths[i], NULL, 0u));
+        }
+        struct log_merge m;
+        TEST_ASSERT_EQUAL(0, log_merge_init(&m, src, heap, 3u));
+
+        struct log_entry e;
+        uint32_t idx;
+        int64_t key;
+        uint32_t n = 0u;
+        while (log_merge_next(&m, &e, &idx, &key) == 1) {
+                char expected[16];
+                snprintf(expected, sizeof(expected), "%c %u", 'a' + (n % 3u),
+                         n / 3u);
+                TEST_ASSERT_EQUAL_INT64(n, key);
+                TEST_ASSERT_EQUAL_UINT32(n % 3u, idx);
+                TEST_ASSERT_EQUAL_STRING(expected, e.msg);
+                n++;
+        }
+        TEST_ASSERT_EQUAL_UINT32(300u, n);
+        for (int i = 0; i < 3; ++i) {
+                log_merge_close(&src[i]);
+        }
+}
+
+void
+test_merge_small_window_spans_large_file(void)
+{
+        /* ~16 KiB per file against the minimum two-page window. */
+        write_source(paths[0], 1500u, 0u, 2u, "even");
+        write_source(paths[1], 1500u, 1u, 2u, "odd");
+
+        struct log_merge_src src[2];
+        uint32_t heap[2];
+        for (int i = 0; i < 2; ++i) {
+                TEST_ASSERT_EQUAL(0, log_merge_open(&src[i], paths[i], NULL,
+                                                    1u));
+        }
+        struct log_merge m;
+        TEST_ASSERT_EQUAL(0, log_merge_init(&m, src, heap, 2u));
+
+        struct log_entry e;
+        int64_t key;
+        int64_t prev = -1;
+        uint32_t n = 0u;
+        while (log_merge_next(&m, &e, NULL, &key) == 1) {
+                TEST_ASSERT_EQUAL_INT64(prev + 1, key);
+                TEST_ASSERT_LESS_OR_EQUAL(src[0].window, src[0].map_len);
+                prev = key;
+                n++;
+        }
+        TEST_ASSERT_EQUAL_UINT32(3000u, n);
+        for (int i = 0; i < 2; ++i) {
+                log_merge_close(&src[i]);
+        }
+}
+
+void
+test_merge_calibration_and_wrap(void)
+{
+        /* Source 0 ticks at 1 kHz and wraps; source 1 ticks at 2 kHz. */
+        write_source(paths[0], 4u, 0xFFFFFFFEu, 1u, "ms");
+        write_source(paths[1], 4u, 0u, 2u, "half");
+
+        struct log_merge_calib ms = { .offset = -2 * (int64_t)0xFFFFFFFEu,
+                                      .mult = 2u,
+                                      .div = 1u };
+        struct log_merge_calib half = { .offset = 1, .mult = 1u, .div = 1u };
+
+        struct log_merge_src src[2];
+        uint32_t heap[2];
+        TEST_ASSERT_EQUAL(0, log_merge_open(&src[0], paths[0], &ms, 0u));
+        TEST_ASSERT_EQUAL(0, log_merge_open(&src[1], paths[1], &half, 0u));
+        struct log_merge m;
+        TEST_ASSERT_EQUAL(0, log_merge_init(&m, src, heap, 2u));
+
+        static const int64_t keys[] = { 0, 1, 2, 3, 4, 5, 6, 7 };
+        struct log_entry e;
+        int64_t key;
+        for (unsigned i = 0; i < 8u; ++i) {
+                TEST_ASSERT_EQUAL(1, log_merge_next(&m, &e, NULL, &key));
+                TEST_ASSERT_EQUAL_INT64(keys[i], key);
+        }
+        TEST_ASSERT_EQUAL(0, log_merge_next(&m, &e, NULL, &key));
+        for (int i = 0; i < 2; ++i) {
+                log_merge_close(&src[i]);
+        }
+}
+
+void
+test_merge_rejects_bad_header(void)
+{
+        FILE *f = fopen(paths[0], "wb");
+        TEST_ASSERT_NOT_NULL(f);
+        (void)fputs("not a log file", f);
+        (void)fclose(f);
+
+        struct log_merge_src src;
+        TEST_ASSERT_EQUAL(-1, log_merge_open(&src, paths[0], NULL, 0u));
+        TEST_ASSERT_EQUAL(-1, log_merge_open(&src, "/nonexistent", NULL, 0u));
+}
+
+int
+main(void)
+{
+        UNITY_BEGIN();
+        RUN_TEST(test_merge_orders_by_timestamp);
+        RUN_TEST(test_merge_small_window_spans_large_file);
+        RUN_TEST(test_merge_calibration_and_wrap);
+        RUN_TEST(test_merge_rejects_bad_header);
+        return UNITY_END();
+}
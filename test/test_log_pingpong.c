@@ -0,0 +1,127 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "../subprojects/unity/src/unity.h"
+
+#include "../include/log.h"
+#include "../include/log_pingpong.h"
+
+static uint32_t fake_time = 0;
+
+static uint32_t
+fake_timestamp(void)
+{
+        return fake_time++;
+}
+
+void
+setUp(void)
+{
+        fake_time = 0;
+}
+void
+tearDown(void)
+{
+}
+
+void
+test_pingpong_handoff(void)
+{
+        static struct log_pingpong pp;
+        log_pingpong_init(&pp, fake_timestamp);
+
+        TEST_ASSERT_NULL(log_pingpong_acquire(&pp));
+        TEST_ASSERT_EQUAL_UINT8(0u, log_pingpong_publish(&pp)); // empty
+
+        struct log_ctx *p0 = log_pingpong_producer(&pp);
+        log_event(p0, INFO, "first");
+        log_event(p0, WARN, "second");
+        TEST_ASSERT_EQUAL_UINT8(1u, log_pingpong_publish(&pp));
+
+        // Producer continues in the other, empty buffer
+        struct log_ctx *p1 = log_pingpong_producer(&pp);
+        TEST_ASSERT_TRUE(p0 != p1);
+        TEST_ASSERT_EQUAL_UINT16(0u, log_get_count(p1));
+        log_event(p1, INFO, "third");
+
+        // Consumer has not returned its buffer: no swap possible
+        const struct log_ctx *c = log_pingpong_acquire(&pp);
+        TEST_ASSERT_EQUAL_PTR(p0, c);
+        TEST_ASSERT_EQUAL_UINT8(0u, log_pingpong_publish(&pp));
+        TEST_ASSERT_EQUAL_PTR(p1, log_pingpong_producer(&pp));
+        TEST_ASSERT_EQUAL_UINT16(2u, log_get_count(c));
+        TEST_ASSERT_EQUAL_STRING("first", log_get_entry(c, 0)->msg);
+
+        log_pingpong_release(&pp);
+        TEST_ASSERT_NULL(log_pingpong_acquire(&pp));
+
+        TEST_ASSERT_EQUAL_UINT8(1u, log_pingpong_publish(&pp));
+        c = log_pingpong_acquire(&pp);
+        TEST_ASSERT_EQUAL_PTR(p1, c);
+        TEST_ASSERT_EQUAL_STRING("third", log_get_entry(c, 0)->msg);
+        TEST_ASSERT_EQUAL_UINT16(0u,
+                                 log_get_count(log_pingpong_producer(&pp)));
+}
+
+#define PRODUCED (200000u)
+
+static struct log_pingpong shared;
+
+static void *
+producer(void *arg)
+{
+        (void)arg;
+        for (uint32_t i = 0; i < PRODUCED; ++i) {
+                struct log_ctx *ctx = log_pingpong_producer(&shared);
+                log_event(ctx, INFO, "%lu", (unsigned long)i);
+                if (log_get_count(ctx) == LOG_ENTRIES) {
+                        (void)log_pingpong_publish(&shared);
+                }
+        }
+        while ((log_pingpong_publish(&shared) == 0u)
+               && (log_get_count(log_pingpong_producer(&shared)) != 0u)) {
+        }
+        return NULL;
+}
+
+void
+test_pingpong_threads_deliver_in_order(void)
+{
+        log_pingpong_init(&shared, fake_timestamp);
+
+        pthread_t t;
+        TEST_ASSERT_EQUAL(0, pthread_create(&t, NULL, producer, NULL));
+
+        // Entries arrive in order; gaps only where the producer wrapped
+        unsigned long next = 0;
+        unsigned long received = 0;
+        while (next < PRODUCED) {
+                const struct log_ctx *c = log_pingpong_acquire(&shared);
+                if (c == NULL) {
+                        continue;
+                }
+                for (uint16_t i = 0; i < log_get_count(c); ++i) {
+                        unsigned long v = 0;
+                        TEST_ASSERT_EQUAL(
+                            1, sscanf(log_get_entry(c, i)->msg, "%lu", &v));
+                        TEST_ASSERT_GREATER_OR_EQUAL(next, v);
+                        next = v + 1u;
+                        received++;
+                }
+                log_pingpong_release(&shared);
+        }
+        TEST_ASSERT_EQUAL(0, pthread_join(t, NULL));
+        TEST_ASSERT_GREATER_THAN(0u, received);
+}
+
+int
+main(void)
+{
+        UNITY_BEGIN();
+        RUN_TEST(test_pingpong_handoff);
+        RUN_TEST(test_pingpong_threads_deliver_in_order);
+        return UNITY_END();
+}
@@ -0,0 +1,142 @@
+#include <stdarg.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "../subprojects/unity/src/unity.h"
+
+#include "../include/log.h"
+#include "../include/log_profile.h"
+
+static uint32_t fake_time = 0;
+
+static uint32_t
+fake_timestamp(void)
+{
+        return fake_time;
+}
+
+/* Each formatted message costs `cost` cycles. */
+static uint64_t cycles = 0u;
+static uint64_t cost = 0u;
+static uint8_t odd = 0u;
+
+uint64_t
+log_profile_cycles(void)
+{
+        odd ^= 1u;
+        cycles += (odd != 0u) ? 0u : cost;
+        return cycles;
+}
+
+static struct log_ctx test_log;
+static struct log_profile prof;
+
+void
+setUp(void)
+{
+        fake_time = 0;
+        cycles = 0u;
+        odd = 0u;
+        log_init(&test_log, fake_timestamp);
+        log_profile_init(&prof);
+}
+void
+tearDown(void)
+{
+}
+
+#if LOG_PROFILE
+static void
+wrapped(const char *fmt, ...)
+{
+        va_list args;
+        va_start(args, fmt);
+        log_vevent(&test_log, 1u, INFO, fmt, args);
+        va_end(args);
+}
+#endif
+
+void
+test_profile_attributes_cost_to_call_sites(void)
+{
+#if LOG_PROFILE
+        const struct log_profile_site *top[8];
+        TEST_ASSERT_EQUAL_UINT8(1u, log_set_profile(&test_log, &prof));
+
+        for (uint32_t i = 0u; i < 10u; ++i) {
+                cost = 5u;
+                log_event(&test_log, INFO, "tick %u", i);
+                cost = 100u;
+                log_event_mod(&test_log, 2u, WARN, "%s", "a long message "
+                              "that will not fit in one entry of the log");
+        }
+        cost = 400u;
+        log_event(&test_log, INFO, "tick %u", 10u);
+        cost = 300u;
+        wrapped("wrapped %d", 1);
+        wrapped("other %d", 22);
+
+        TEST_ASSERT_EQUAL_UINT16(5u, prof.used);
+        TEST_ASSERT_EQUAL_UINT16(5u, log_profile_report(&prof, top, 8u));
+        TEST_ASSERT_EQUAL_STRING("%s", top[0]->fmt);
+        TEST_ASSERT_EQUAL_UINT32(10u, top[0]->calls);
+        TEST_ASSERT_EQUAL_UINT64(1000u, top[0]->cycles);
+        TEST_ASSERT_EQUAL_UINT32(10u, top[0]->truncated);
+        TEST_ASSERT_EQUAL_UINT64(10u * (LOG_MSG_LEN - 1u), top[0]->bytes);
+
+        // Same format from another statement is another site
+        TEST_ASSERT_EQUAL_STRING("tick %u", top[1]->fmt);
+        TEST_ASSERT_EQUAL_UINT32(1u, top[1]->calls);
+        TEST_ASSERT_EQUAL_UINT64(400u, top[1]->cycles);
+        TEST_ASSERT_TRUE(top[1]->site != NULL);
+        TEST_ASSERT_EQUAL_UINT64(300u, top[2]->cycles);
+        TEST_ASSERT_EQUAL_UINT64(300u, top[3]->cycles);
+        TEST_ASSERT_TRUE(top[2]->site == top[3]->site);
+        TEST_ASSERT_TRUE(top[2]->fmt != top[3]->fmt);
+        TEST_ASSERT_EQUAL_STRING("tick %u", top[4]->fmt);
+        TEST_ASSERT_EQUAL_UINT32(10u, top[4]->calls);
+        TEST_ASSERT_EQUAL_UINT64(50u, top[4]->cycles);
+        TEST_ASSERT_EQUAL_UINT64(10u * 6u, top[4]->bytes);
+        TEST_ASSERT_TRUE(top[1]->site != top[4]->site);
+
+        // Only the most expensive fit a short report
+        TEST_ASSERT_EQUAL_UINT16(2u, log_profile_report(&prof, top, 2u));
+        TEST_ASSERT_EQUAL_STRING("%s", top[0]->fmt);
+        TEST_ASSERT_EQUAL_UINT64(400u, top[1]->cycles);
+
+        (void)log_set_profile(&test_log, NULL);
+        log_event(&test_log, INFO, "tick %u", 0u);
+        TEST_ASSERT_EQUAL_UINT16(5u, prof.used);
+#else
+        TEST_ASSERT_EQUAL_UINT8(0u, log_set_profile(&test_log, &prof));
+        TEST_IGNORE_MESSAGE("LOG_PROFILE disabled");
+#endif
+}
+
+void
+test_profile_counts_sites_that_do_not_fit(void)
+{
+        static const char fmts[LOG_PROFILE_SITES + 3u][2];
+        for (uint32_t i = 0u; i < (LOG_PROFILE_SITES + 3u); ++i) {
+                log_profile_record(&prof, NULL, fmts[i], 1u, 0);
+        }
+        log_profile_record(&prof, NULL, fmts[0], 1u, 0);
+        TEST_ASSERT_EQUAL_UINT16(LOG_PROFILE_SITES, prof.used);
+        TEST_ASSERT_EQUAL_UINT32(3u, prof.lost);
+
+        const struct log_profile_site *top[1];
+        TEST_ASSERT_EQUAL_UINT16(1u, log_profile_report(&prof, top, 1u));
+        TEST_ASSERT_TRUE(top[0]->fmt == fmts[0]);
+        TEST_ASSERT_EQUAL_UINT32(2u, top[0]->calls);
+        TEST_ASSERT_EQUAL_UINT16(0u, log_profile_report(&prof, top, 0u));
+        TEST_ASSERT_EQUAL_UINT16(0u, log_profile_report(NULL, top, 1u));
+}
+
+int
+main(void)
+{
+        UNITY_BEGIN();
+        RUN_TEST(test_profile_attributes_cost_to_call_sites);
+        RUN_TEST(test_profile_counts_sites_that_do_not_fit);
+        return UNITY_END();
+}
@@ -0,0 +1,132 @@
+#include <stdint.h>
+#include <string.h>
+
+#include "../subprojects/unity/src/unity.h"
+
+#include "../include/log.h"
+#include "../include/log_rate.h"
+
+#define WIDTH (100u)
+
+static uint32_t fake_time = 0;
+
+static uint32_t
+fake_timestamp(void)
+{
+        return fake_time;
+}
+
+static struct log_ctx test_log;
+static struct log_rate all, mod2;
+
+void
+setUp(void)
+{
+        fake_time = 0;
+        log_init(&test_log, fake_timestamp);
+        TEST_ASSERT_EQUAL(0, log_rate_init(&all, WIDTH, LOG_MODULES_ALL));
+        TEST_ASSERT_EQUAL(0, log_rate_init(&mod2, WIDTH, LOG_MODULE_BIT(2)));
+        log_rate_add(&test_log, &all);
+        log_rate_add(&test_log, &mod2);
+}
+void
+tearDown(void)
+{
+}
+
+void
+test_rate_counts_levels_in_window(void)
+{
+        const uint32_t window = WIDTH * LOG_RATE_BUCKETS;
+        TEST_ASSERT_EQUAL_UINT32(0u, log_rate_count(&all, FAULT, 0u));
+
+        // Three WARNs in the first bucket, one FAULT in every bucket
+        fake_time = 1000u;
+        log_event(&test_log, WARN, "w");
+        log_event(&test_log, WARN, "w");
+        log_event_mod(&test_log, 2u, WARN, "w");
+        for (uint32_t b = 0u; b < LOG_RATE_BUCKETS; ++b) {
+                fake_time = 1000u + (b * WIDTH);
+                log_event_mod(&test_log, (uint8_t)b, FAULT, "f%u", b);
+        }
+
+        uint32_t now = 1000u + window - 1u;
+        TEST_ASSERT_EQUAL_UINT32(LOG_RATE_BUCKETS,
+                                 log_rate_count(&all, FAULT, now));
+        TEST_ASSERT_EQUAL_UINT32(3u, log_rate_count(&all, WARN, now));
+        TEST_ASSERT_EQUAL_UINT32(0u, log_rate_count(&all, INFO, now));
+        TEST_ASSERT_EQUAL_UINT32(1u, log_rate_count(&mod2, FAULT, now));
+        TEST_ASSERT_EQUAL_UINT32(1u, log_rate_count(&mod2, WARN, now));
+
+        // Buckets expire as time passes, even without new entries
+        now += 1u;
+        TEST_ASSERT_EQUAL_UINT32(LOG_RATE_BUCKETS - 1u,
+                                 log_rate_count(&all, FAULT, now));
+        TEST_ASSERT_EQUAL_UINT32(0u, log_rate_count(&all, WARN, now));
+        now += 5u * WIDTH;
+        TEST_ASSERT_EQUAL_UINT32(LOG_RATE_BUCKETS - 6u,
+                                 log_rate_count(&all, FAULT, now));
+        TEST_ASSERT_EQUAL_UINT32(0u, log_rate_count(&mod2, FAULT, now));
+
+        // Logging after the gap gives the same answer as the query
+        fake_time = now;
+        log_event(&test_log, INFO, "i");
+        TEST_ASSERT_EQUAL_UINT32(LOG_RATE_BUCKETS - 6u,
+                                 log_rate_count(&all, FAULT, now));
+        TEST_ASSERT_EQUAL_UINT32(1u, log_rate_count(&all, INFO, now));
+
+        // A gap longer than the window clears everything
+        fake_time = now + window;
+        log_event(&test_log, INFO, "i");
+        TEST_ASSERT_EQUAL_UINT32(0u, log_rate_count(&all, FAULT, fake_time));
+        TEST_ASSERT_EQUAL_UINT32(1u, log_rate_count(&all, INFO, fake_time));
+        TEST_ASSERT_EQUAL_UINT32(0u, log_rate_count(&all, INFO,
+                                                    fake_time + window));
+}
+
+void
+test_rate_handles_wrap_and_late_entries(void)
+{
+        fake_time = 0xFFFFFFFFu - WIDTH;
+        log_event(&test_log, FAULT, "before wrap");
+        fake_time += 2u * WIDTH;
+        log_event(&test_log, FAULT, "after wrap");
+        TEST_ASSERT_EQUAL_UINT32(2u, log_rate_count(&all, FAULT, fake_time));
+
+        // An entry older than the current bucket is counted in it
+        struct log_entry e;
+        (void)memset(&e, 0, sizeof(e));
+        e.timestamp = fake_time - (3u * WIDTH);
+        e.level = FAULT;
+        log_put_entry(&test_log, &e);
+        TEST_ASSERT_EQUAL_UINT32(3u, log_rate_count(&all, FAULT, fake_time));
+        // A query from before the current bucket sees everything counted
+        TEST_ASSERT_EQUAL_UINT32(3u, log_rate_count(&all, FAULT, e.timestamp));
+}
+
+void
+test_rate_remove_and_init(void)
+{
+        log_rate_add(&test_log, &all);
+        log_rate_remove(&test_log, &all);
+        log_event(&test_log, FAULT, "f");
+        TEST_ASSERT_EQUAL_UINT32(0u, log_rate_count(&all, FAULT, 0u));
+        TEST_ASSERT_EQUAL_PTR(&mod2, test_log.rate);
+        TEST_ASSERT_NULL(mod2.next);
+
+        log_init(&test_log, fake_timestamp);
+        TEST_ASSERT_NULL(test_log.rate);
+        TEST_ASSERT_EQUAL(-1, log_rate_init(&all, 0u, LOG_MODULES_ALL));
+        TEST_ASSERT_EQUAL(-1, log_rate_init(NULL, WIDTH, LOG_MODULES_ALL));
+        TEST_ASSERT_EQUAL_UINT32(0u, log_rate_count(NULL, FAULT, 0u));
+}
+
+int
+main(void)
+{
+        UNITY_BEGIN();
+        RUN_TEST(test_rate_counts_levels_in_window);
+        RUN_TEST(test_rate_handles_wrap_and_late_entries);
+        RUN_TEST(test_rate_remove_and_init);
+        return UNITY_END();
+}
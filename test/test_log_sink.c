@@ -0,0 +1,241 @@
+#include <stdint.h>
+#include <string.h>
+
+#include "../subprojects/unity/src/unity.h"
+
+#include "../include/log.h"
+#include "../include/log_sink.h"
+
+static uint32_t fake_time = 0;
+
+static uint32_t
+fake_timestamp(void)
+{
+        return fake_time;
+}
+
+struct capture {
+        uint32_t n;
+        uint32_t seq[128];
+        uint8_t busy;
+        uint32_t formatted;
+};
+
+static int
+capture_write(void *user, const struct log_entry *e, uint32_t seq)
+{
+        struct capture *c = user;
+        char line[80];
+        if (c->busy != 0u) {
+                return 1;
+        }
+        (void)log_format(e, line, sizeof(line));
+        c->formatted++;
+        c->seq[c->n++] = seq;
+        return 0;
+}
+
+static struct capture all, warn, fault3;
+static struct log_sink sinks[3];
+
+void
+setUp(void)
+{
+        fake_time = 0;
+        memset(&all, 0, sizeof(all));
+        memset(&warn, 0, sizeof(warn));
+        memset(&fault3, 0, sizeof(fault3));
+        log_sink_init(&sinks[0], capture_write, &all, INFO, LOG_MODULES_ALL);
+        log_sink_init(&sinks[1], capture_write, &warn, WARN, LOG_MODULES_ALL);
+        log_sink_init(&sinks[2], capture_write, &fault3, FAULT,
+                      LOG_MODULE_BIT(3));
+}
+void
+tearDown(void)
+{
+}
+
+void
+test_sink_filters_per_sink(void)
+{
+        struct log_ctx ctx;
+        log_init(&ctx, fake_timestamp);
+
+        log_event(&ctx, INFO, "boot");                       // seq 0
+        log_event_mod(&ctx, 3, WARN, "CAN retry");           // seq 1
+        log_event_mod(&ctx, 3, FAULT, "CAN bus-off");        // seq 2
+        log_event_mod(&ctx, 1, FAULT, "Overtemp");           // seq 3
+        log_event_mod(&ctx, LOG_MODULES, FAULT, "rejected"); // not logged
+        TEST_ASSERT_EQUAL_UINT16(4, log_get_count(&ctx));
+        TEST_ASSERT_EQUAL_UINT8(3, log_get_entry(&ctx, 1)->module);
+
+        TEST_ASSERT_EQUAL_UINT32(4 + 3 + 1,
+                                 log_fanout_drain(sinks, 3, &ctx, 100));
+        TEST_ASSERT_EQUAL_UINT32(4, all.n);
+        TEST_ASSERT_EQUAL_UINT32(3, warn.n);
+        TEST_ASSERT_EQUAL_UINT32(1, warn.seq[0]);
+        TEST_ASSERT_EQUAL_UINT32(1, fault3.n);
+        TEST_ASSERT_EQUAL_UINT32(2, fault3.seq[0]);
+
+        // Discarded entries were never formatted
+        TEST_ASSERT_EQUAL_UINT32(fault3.n, fault3.formatted);
+
+        // Nothing new: nothing delivered
+        TEST_ASSERT_EQUAL_UINT32(0, log_fanout_drain(sinks, 3, &ctx, 100));
+}
+
+void
+test_sink_slow_sink_does_not_stall_others(void)
+{
+        struct log_ctx ctx;
+        log_init(&ctx, fake_timestamp);
+        warn.busy = 1u;
+
+        for (uint16_t i = 0; i < LOG_ENTRIES + 10; ++i) {
+                log_event(&ctx, WARN, "Entry %u", i);
+                (void)log_fanout_drain(sinks, 3, &ctx, 4);
+        }
+        TEST_ASSERT_EQUAL_UINT32(LOG_ENTRIES + 10, all.n);
+        TEST_ASSERT_EQUAL_UINT32(0, warn.n);
+        TEST_ASSERT_EQUAL_UINT32(10, sinks[1].dropped);
+        TEST_ASSERT_EQUAL_UINT32(10, sinks[1].pos);
+
+        // The stalled sink resumes from the oldest surviving entry
+        warn.busy = 0u;
+        TEST_ASSERT_EQUAL_UINT16(LOG_ENTRIES,
+                                 log_sink_drain(&sinks[1], &ctx, 1000));
+        TEST_ASSERT_EQUAL_UINT32(10, sinks[1].dropped);
+        TEST_ASSERT_EQUAL_UINT32(10, warn.seq[0]);
+        TEST_ASSERT_EQUAL_UINT32(0, sinks[0].dropped);
+}
+
+void
+test_sink_budget_and_seek(void)
+{
+        struct log_ctx ctx;
+        log_init(&ctx, fake_timestamp);
+        for (uint16_t i = 0; i < 10; ++i) {
+                log_event(&ctx, INFO, "Entry %u", i);
+        }
+
+        log_sink_seek(&sinks[0], &ctx, 1u);
+        TEST_ASSERT_EQUAL_UINT16(0, log_sink_drain(&sinks[0], &ctx, 100));
+        log_sink_seek(&sinks[0], &ctx, 0u);
+        TEST_ASSERT_EQUAL_UINT16(3, log_sink_drain(&sinks[0], &ctx, 3));
+        TEST_ASSERT_EQUAL_UINT16(7, log_sink_drain(&sinks[0], &ctx, 100));
+        TEST_ASSERT_EQUAL_UINT32(9, all.seq[all.n - 1]);
+}
+
+void
+test_sink_restarts_after_context_reinit(void)
+{
+        struct log_ctx ctx;
+        log_init(&ctx, fake_timestamp);
+        for (uint16_t i = 0; i < 10; ++i) {
+                log_event(&ctx, INFO, "Entry %u", i);
+        }
+        TEST_ASSERT_EQUAL_UINT16(10, log_sink_drain(&sinks[0], &ctx, 100));
+
+        // Sequence numbers restart at 0, behind the sink
+        log_init(&ctx, fake_timestamp);
+        log_event(&ctx, INFO, "Again");
+        log_event(&ctx, INFO, "And again");
+        TEST_ASSERT_EQUAL_UINT16(2, log_sink_drain(&sinks[0], &ctx, 100));
+        TEST_ASSERT_EQUAL_UINT32(0u, all.seq[10]);
+        TEST_ASSERT_EQUAL_UINT32(1u, all.seq[11]);
+        TEST_ASSERT_EQUAL_UINT32(2u, sinks[0].pos);
+        TEST_ASSERT_EQUAL_UINT32(0u, sinks[0].dropped);
+
+        // Re-initialised and already past the sink: still from the start
+        log_init(&ctx, fake_timestamp);
+        for (uint16_t i = 0; i < 5; ++i) {
+                log_event(&ctx, INFO, "Once more %u", i);
+        }
+        TEST_ASSERT_EQUAL_UINT16(5, log_sink_drain(&sinks[0], &ctx, 100));
+        TEST_ASSERT_EQUAL_UINT32(0u, all.seq[12]);
+        TEST_ASSERT_EQUAL_UINT32(4u, all.seq[16]);
+        TEST_ASSERT_EQUAL_UINT32(0u, sinks[0].dropped);
+
+        // Re-initialised and still empty
+        log_init(&ctx, fake_timestamp);
+        TEST_ASSERT_EQUAL_UINT16(0, log_sink_drain(&sinks[0], &ctx, 100));
+        TEST_ASSERT_EQUAL_UINT32(0u, sinks[0].pos);
+}
+
+void
+test_log_format(void)
+{
+        struct log_entry e = { .timestamp = 42, .level = FAULT };
+        strcpy(e.msg, "Overtemp");
+        char line[64];
+        TEST_ASSERT_EQUAL(21, log_format(&e, line, sizeof(line)));
+        TEST_ASSERT_EQUAL_STRING("[42] FAULT: Overtemp\n", line);
+        TEST_ASSERT_EQUAL(5, log_format(&e, line, 6));
+        TEST_ASSERT_EQUAL_STRING("[42] ", line);
+}
+
+void
+test_sink_delivers_pinned_then_ring(void)
+{
+        struct log_ctx ctx;
+        log_init(&ctx, fake_timestamp);
+        TEST_ASSERT_EQUAL_UINT8(1u, log_set_pinned(&ctx, 2u));
+        for (uint16_t i = 0; i < LOG_ENTRIES + 5u; ++i) {
+                log_event(&ctx, INFO, "Entry %u", i);
+        }
+
+        // Seek to the oldest: the pinned pair, then a gap, then the ring
+        log_sink_seek(&sinks[0], &ctx, 0u);
+        TEST_ASSERT_EQUAL_UINT32(0u, sinks[0].pos);
+        TEST_ASSERT_EQUAL_UINT16(LOG_ENTRIES,
+                                 log_sink_drain(&sinks[0], &ctx, 1000u));
+        TEST_ASSERT_EQUAL_UINT32(0u, all.seq[0]);
+        TEST_ASSERT_EQUAL_UINT32(1u, all.seq[1]);
+        TEST_ASSERT_EQUAL_UINT32(7u, all.seq[2]);
+        TEST_ASSERT_EQUAL_UINT32(5u, sinks[0].dropped);
+        TEST_ASSERT_EQUAL_UINT32(LOG_ENTRIES + 5u, sinks[0].pos);
+}
+
+void
+test_sink_counts_quota_evictions_as_dropped(void)
+{
+#if LOG_MODULE_QUOTA
+        struct log_ctx ctx;
+        log_init(&ctx, fake_timestamp);
+        log_set_quota(&ctx, 1u, 2u);
+        log_event_mod(&ctx, 1u, WARN, "Quiet");
+        log_event_mod(&ctx, 1u, WARN, "Quiet");
+        for (uint16_t i = 2u; i < LOG_ENTRIES; ++i) {
+                log_event_mod(&ctx, 2u, INFO, "Chatty");
+        }
+        TEST_ASSERT_EQUAL_UINT16(2, log_sink_drain(&sinks[0], &ctx, 2));
+
+        // Evicts the oldest chatty entries, from seq 2, before delivery
+        log_event_mod(&ctx, 2u, INFO, "Chatty");
+        TEST_ASSERT_EQUAL_UINT16(LOG_ENTRIES - LOG_QUOTA_SLACK - 2u,
+                                 log_sink_drain(&sinks[0], &ctx, 1000u));
+        TEST_ASSERT_EQUAL_UINT32(LOG_QUOTA_SLACK + 1u, sinks[0].dropped);
+        for (uint32_t i = 1u; i < all.n; ++i) {
+                TEST_ASSERT_TRUE(all.seq[i] > all.seq[i - 1u]);
+        }
+        TEST_ASSERT_EQUAL_UINT32(1u, all.seq[1]);
+        TEST_ASSERT_EQUAL_UINT32(LOG_QUOTA_SLACK + 3u, all.seq[2]);
+        TEST_ASSERT_EQUAL_UINT32(LOG_ENTRIES + 1u, sinks[0].pos);
+#else
+        TEST_IGNORE_MESSAGE("LOG_MODULE_QUOTA disabled");
+#endif
+}
+
+int
+main(void)
+{
+        UNITY_BEGIN();
+        RUN_TEST(test_sink_filters_per_sink);
+        RUN_TEST(test_sink_slow_sink_does_not_stall_others);
+        RUN_TEST(test_sink_budget_and_seek);
+        RUN_TEST(test_sink_delivers_pinned_then_ring);
+        RUN_TEST(test_sink_restarts_after_context_reinit);
+        RUN_TEST(test_sink_counts_quota_evictions_as_dropped);
+        RUN_TEST(test_log_format);
+        return UNITY_END();
+}
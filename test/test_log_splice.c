@@ -0,0 +1,99 @@
+#define _GNU_SOURCE
+
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <unistd.h>
+
+#include "../subprojects/unity/src/unity.h"
+
+#include "../include/log_splice.h"
+
+static uint32_t fake_time = 0;
+
+static uint32_t
+fake_timestamp(void)
+{
+        return fake_time++;
+}
+
+static struct log_pingpong pp __attribute__((aligned(4096)));
+static struct log_splice sp;
+static int fds[2];
+
+void
+setUp(void)
+{
+        fake_time = 0;
+        log_pingpong_init(&pp, fake_timestamp);
+        TEST_ASSERT_EQUAL(0, pipe2(fds, O_NONBLOCK));
+        log_splice_init(&sp, &pp, fds[1]);
+}
+void
+tearDown(void)
+{
+        (void)close(fds[0]);
+        (void)close(fds[1]);
+}
+
+static void
+produce(uint16_t from, uint16_t n)
+{
+        for (uint16_t i = from; i < (uint16_t)(from + n); ++i) {
+                log_event(log_pingpong_producer(&pp), INFO, "Entry %u", i);
+        }
+}
+
+static void
+consume(uint16_t from, uint16_t n)
+{
+        for (uint16_t i = from; i < (uint16_t)(from + n); ++i) {
+                struct log_entry e;
+                char expected[16];
+                TEST_ASSERT_EQUAL(sizeof(e), read(fds[0], &e, sizeof(e)));
+                snprintf(expected, sizeof(expected), "Entry %u", i);
+                TEST_ASSERT_EQUAL_STRING(expected, e.msg);
+        }
+}
+
+void
+test_splice_recycles_only_after_reader_drains(void)
+{
+        produce(0, 10);
+        TEST_ASSERT_EQUAL_UINT8(1u, log_pingpong_publish(&pp));
+        TEST_ASSERT_EQUAL(10 * sizeof(struct log_entry), log_splice_pump(&sp));
+
+        // Reader has not consumed yet: the buffer stays out of reach
+        produce(10, 5);
+        TEST_ASSERT_EQUAL(0, log_splice_pump(&sp));
+        TEST_ASSERT_EQUAL(0u, sp.buffers);
+        TEST_ASSERT_EQUAL_UINT8(0u, log_pingpong_publish(&pp));
+
+        consume(0, 10);
+        TEST_ASSERT_EQUAL(0, log_splice_pump(&sp));
+        TEST_ASSERT_EQUAL(1u, sp.buffers);
+
+        // The producer's second buffer can now be handed over
+        TEST_ASSERT_EQUAL_UINT8(1u, log_pingpong_publish(&pp));
+        TEST_ASSERT_EQUAL(5 * sizeof(struct log_entry), log_splice_pump(&sp));
+        consume(10, 5);
+}
+
+void
+test_splice_wrapped_buffer_in_order(void)
+{
+        produce(0, LOG_ENTRIES + 7);
+        TEST_ASSERT_EQUAL_UINT8(1u, log_pingpong_publish(&pp));
+        TEST_ASSERT_EQUAL(LOG_ENTRIES * sizeof(struct log_entry),
+                          log_splice_pump(&sp));
+        consume(7, LOG_ENTRIES);
+}
+
+int
+main(void)
+{
+        UNITY_BEGIN();
+        RUN_TEST(test_splice_recycles_only_after_reader_drains);
+        RUN_TEST(test_splice_wrapped_buffer_in_order);
+        return UNITY_END();
+}
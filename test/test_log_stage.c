@@ -0,0 +1,144 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "../subprojects/unity/src/unity.h"
+
+#include "../include/log_stage.h"
+
+#define THREADS (8u)
+#define EVENTS  (500u)
+
+static atomic_uint clock_ticks;
+
+static uint32_t
+shared_clock(void)
+{
+        return atomic_fetch_add(&clock_ticks, 1u);
+}
+
+static struct log_ctx ctx;
+static struct log_stage_hub hub;
+static atomic_int producers_done;
+
+void
+setUp(void)
+{
+        atomic_store(&clock_ticks, 0u);
+        log_init(&ctx, shared_clock);
+        TEST_ASSERT_EQUAL(0, log_stage_hub_init(&hub, &ctx));
+}
+void
+tearDown(void)
+{
+}
+
+void
+test_stage_batches_until_full_or_fault(void)
+{
+        for (uint16_t i = 0u; i < 3u; ++i) {
+                log_stage_event(&hub, 1u, INFO, "Staged %u", i);
+        }
+        TEST_ASSERT_EQUAL_UINT16(0, log_get_count(&ctx));
+
+        // A FAULT goes out at once, together with what was staged
+        log_stage_event(&hub, 1u, FAULT, "Overtemp");
+        TEST_ASSERT_EQUAL_UINT16(4, log_get_count(&ctx));
+        TEST_ASSERT_EQUAL_STRING("Staged 0", log_get_entry(&ctx, 0)->msg);
+        TEST_ASSERT_EQUAL_STRING("Overtemp", log_get_entry(&ctx, 3)->msg);
+
+        for (uint16_t i = 0u; i < LOG_STAGE_ENTRIES - 1u; ++i) {
+                log_stage_event(&hub, 1u, INFO, "Bulk %u", i);
+        }
+        TEST_ASSERT_EQUAL_UINT16(4, log_get_count(&ctx));
+        log_stage_event(&hub, 1u, INFO, "Last");
+        TEST_ASSERT_EQUAL_UINT16(4u + LOG_STAGE_ENTRIES, log_get_count(&ctx));
+        TEST_ASSERT_EQUAL_UINT32(2u, hub.batches);
+
+        log_stage_event(&hub, 1u, WARN, "Tail");
+        log_stage_flush(&hub);
+        TEST_ASSERT_EQUAL_UINT16(5u + LOG_STAGE_ENTRIES, log_get_count(&ctx));
+        log_stage_hub_destroy(&hub);
+}
+
+static void *
+producer(void *arg)
+{
+        uint8_t module = (uint8_t)(uintptr_t)arg;
+        for (uint32_t i = 0u; i < EVENTS; ++i) {
+                log_stage_event(&hub, module, (i % 100u) ? INFO : FAULT,
+                                "Thread %u event %u", module, i);
+        }
+        return NULL;
+}
+
+static void *
+reader(void *arg)
+{
+        uint32_t *disorder = arg;
+        uint32_t next = 0u;
+        uint32_t last = 0u;
+        while (atomic_load(&producers_done) == 0) {
+                (void)pthread_mutex_lock(&hub.lock);
+                uint32_t end = log_get_seq(&ctx);
+                for (; next != end; ++next) {
+                        const struct log_entry *e;
+                        e = log_get_entry_seq(&ctx, next);
+                        if (e == NULL) {
+                                continue;
+                        }
+                        if (e->timestamp < last) {
+                                (*disorder)++;
+                        }
+                        last = e->timestamp;
+                }
+                (void)pthread_mutex_unlock(&hub.lock);
+        }
+        return NULL;
+}
+
+void
+test_stage_threads_publish_in_timestamp_order(void)
+{
+        pthread_t t[THREADS];
+        pthread_t r;
+        uint32_t disorder = 0u;
+        atomic_store(&producers_done, 0);
+        TEST_ASSERT_EQUAL(0, pthread_create(&r, NULL, reader, &disorder));
+        for (uint32_t i = 0u; i < THREADS; ++i) {
+                TEST_ASSERT_EQUAL(0, pthread_create(&t[i], NULL, producer,
+                                                    (void *)(uintptr_t)i));
+        }
+        for (uint32_t i = 0u; i < THREADS; ++i) {
+                TEST_ASSERT_EQUAL(0, pthread_join(t[i], NULL));
+        }
+        atomic_store(&producers_done, 1);
+        TEST_ASSERT_EQUAL(0, pthread_join(r, NULL));
+
+        // Thread exit published every batch. Order is only given up when a
+        // preempted thread held back release until the hold buffer filled.
+        TEST_ASSERT_EQUAL_UINT32(THREADS * EVENTS, log_get_seq(&ctx));
+        TEST_ASSERT_TRUE(hub.batches < (THREADS * EVENTS) / 4u);
+        if (hub.forced > 0u) {
+                log_stage_hub_destroy(&hub);
+                return;
+        }
+        TEST_ASSERT_EQUAL_UINT32(0u, disorder);
+        for (uint16_t i = 1u; i < log_get_count(&ctx); ++i) {
+                TEST_ASSERT_TRUE(log_get_entry(&ctx, i - 1u)->timestamp
+                                 < log_get_entry(&ctx, i)->timestamp);
+        }
+        log_stage_hub_destroy(&hub);
+}
+
+int
+main(void)
+{
+        UNITY_BEGIN();
+        RUN_TEST(test_stage_batches_until_full_or_fault);
+        RUN_TEST(test_stage_threads_publish_in_timestamp_order);
+        return UNITY_END();
+}
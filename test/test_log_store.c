@@ -0,0 +1,216 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "../subprojects/unity/src/unity.h"
+
+#include "../include/log_merge.h"
+#include "../include/log_store.h"
+
+#define THREADS (8u)
+#define EVENTS  (100u)
+
+static uint32_t fake_time = 0;
+
+static uint32_t
+fake_timestamp(void)
+{
+        return fake_time++;
+}
+
+static struct log_store store;
+static struct log_ctx ctx;
+static pthread_barrier_t logged;
+static char path[64];
+
+void
+setUp(void)
+{
+        fake_time = 0;
+        log_init(&ctx, fake_timestamp);
+        snprintf(path, sizeof(path), "/tmp/test_log_store.%ld.elog",
+                 (long)getpid());
+        (void)unlink(path);
+}
+void
+tearDown(void)
+{
+        (void)unlink(path);
+}
+
+/* Number of records in the export file. */
+static uint32_t
+stored_records(void)
+{
+        struct log_merge_src src;
+        struct log_merge m;
+        struct log_entry e;
+        uint32_t heap;
+        uint32_t n = 0u;
+        TEST_ASSERT_EQUAL(0, log_merge_open(&src, path, NULL, 0u));
+        TEST_ASSERT_EQUAL(0, log_merge_init(&m, &src, &heap, 1u));
+        while (log_merge_next(&m, &e, NULL, NULL) == 1) {
+                n++;
+        }
+        log_merge_close(&src);
+        return n;
+}
+
+void
+test_store_one_sync_covers_all_pending(void)
+{
+        TEST_ASSERT_EQUAL(0, log_store_open(&store, &ctx, path,
+                                            LOG_STORE_FILE, 0u));
+        uint32_t seq = 0u;
+        for (uint32_t i = 0u; i < 10u; ++i) {
+                TEST_ASSERT_EQUAL(0, log_store_event(&store, &seq, 0u, INFO,
+                                                     "Entry %lu",
+                                                     (unsigned long)i));
+        }
+        TEST_ASSERT_EQUAL_UINT32(9u, seq);
+        TEST_ASSERT_EQUAL(0, log_store_sync(&store, seq));
+        TEST_ASSERT_EQUAL_UINT32(1u, store.syncs);
+        TEST_ASSERT_EQUAL_UINT32(10u, store.durable);
+
+        // Already durable: no further commit
+        TEST_ASSERT_EQUAL(0, log_store_sync(&store, 3u));
+        TEST_ASSERT_EQUAL_UINT32(1u, store.syncs);
+        TEST_ASSERT_EQUAL(0, log_store_close(&store));
+        TEST_ASSERT_EQUAL_UINT32(10u, stored_records());
+}
+
+void
+test_store_commits_every_n(void)
+{
+        TEST_ASSERT_EQUAL(0, log_store_open(&store, &ctx, path,
+                                            LOG_STORE_FILE, 0u));
+        log_store_policy(&store, 10u, 0u);
+        for (uint32_t i = 0u; i < 25u; ++i) {
+                (void)log_store_event(&store, NULL, 0u, INFO, "Entry %lu",
+                                      (unsigned long)i);
+        }
+        TEST_ASSERT_EQUAL_UINT32(2u, store.syncs);
+        TEST_ASSERT_EQUAL_UINT32(20u, store.durable);
+        TEST_ASSERT_EQUAL(0, log_store_close(&store));
+        TEST_ASSERT_EQUAL_UINT32(3u, store.syncs);
+        TEST_ASSERT_EQUAL_UINT32(25u, stored_records());
+}
+
+static void *
+producer(void *arg)
+{
+        (void)arg;
+        for (uint32_t i = 0u; i < EVENTS; ++i) {
+                uint32_t seq = 0u;
+                TEST_ASSERT_EQUAL(0, log_store_event(&store, &seq, 0u, FAULT,
+                                                     "Fault %lu",
+                                                     (unsigned long)i));
+                // Every thread has an entry pending before any syncs
+                (void)pthread_barrier_wait(&logged);
+                TEST_ASSERT_EQUAL(0, log_store_sync(&store, seq));
+        }
+        return NULL;
+}
+
+void
+test_store_concurrent_waiters_share_commits(void)
+{
+        pthread_t t[THREADS];
+        TEST_ASSERT_EQUAL(0, log_store_open(&store, &ctx, path,
+                                            LOG_STORE_MMAP, 64u * 1024u));
+        TEST_ASSERT_EQUAL(0, pthread_barrier_init(&logged, NULL, THREADS));
+        for (uint32_t i = 0u; i < THREADS; ++i) {
+                TEST_ASSERT_EQUAL(0, pthread_create(&t[i], NULL, producer,
+                                                    NULL));
+        }
+        for (uint32_t i = 0u; i < THREADS; ++i) {
+                TEST_ASSERT_EQUAL(0, pthread_join(t[i], NULL));
+        }
+        (void)pthread_barrier_destroy(&logged);
+        TEST_ASSERT_EQUAL_UINT32(THREADS * EVENTS, store.durable);
+        // The first sync of a round commits the whole round
+        TEST_ASSERT_EQUAL_UINT32(EVENTS, store.syncs);
+        TEST_ASSERT_EQUAL_UINT32(0u, store.sink.dropped);
+        TEST_ASSERT_EQUAL(0, log_store_close(&store));
+        TEST_ASSERT_EQUAL_UINT32(THREADS * EVENTS, stored_records());
+}
+
+void
+test_store_sync_rejects_unlogged_and_lost_entries(void)
+{
+        TEST_ASSERT_EQUAL(0, log_store_open(&store, &ctx, path,
+                                            LOG_STORE_FILE, 0u));
+        TEST_ASSERT_EQUAL(-1, log_store_sync(&store, 0u));
+        TEST_ASSERT_EQUAL(EINVAL, errno);
+
+        // Rejected by the context: no sequence number to wait for
+        uint32_t none = 77u;
+        TEST_ASSERT_EQUAL(-1, log_store_event(&store, &none, LOG_MODULES,
+                                              INFO, "Bad module"));
+        TEST_ASSERT_EQUAL(EINVAL, errno);
+        TEST_ASSERT_EQUAL_UINT32(77u, none);
+        TEST_ASSERT_EQUAL_UINT32(0u, log_get_seq(&ctx));
+
+        // The ring wraps before the first commit: the oldest 5 are lost
+        uint32_t seq = 0u;
+        for (uint32_t i = 0u; i < (LOG_ENTRIES + 5u); ++i) {
+                TEST_ASSERT_EQUAL(0, log_store_event(&store, &seq, 0u, INFO,
+                                                     "Entry %lu",
+                                                     (unsigned long)i));
+        }
+        TEST_ASSERT_EQUAL(-1, log_store_sync(&store, seq + 1u));
+        TEST_ASSERT_EQUAL(EINVAL, errno);
+        TEST_ASSERT_EQUAL_UINT32(0u, store.syncs);
+        TEST_ASSERT_EQUAL(0, log_store_sync(&store, seq));
+        TEST_ASSERT_EQUAL_UINT32(1u, store.syncs);
+        TEST_ASSERT_EQUAL(-1, log_store_sync(&store, 0u));
+        TEST_ASSERT_EQUAL(ENODATA, errno);
+        TEST_ASSERT_EQUAL(-1, log_store_sync(&store, 4u));
+        TEST_ASSERT_EQUAL(ENODATA, errno);
+        TEST_ASSERT_EQUAL(0, log_store_sync(&store, 5u));
+        TEST_ASSERT_EQUAL_UINT32(1u, store.syncs);
+        TEST_ASSERT_EQUAL(0, log_store_close(&store));
+        TEST_ASSERT_EQUAL_UINT32(LOG_ENTRIES, stored_records());
+}
+
+void
+test_store_mmap_full_reports_enospc(void)
+{
+        struct stat st;
+        TEST_ASSERT_EQUAL(0, log_store_open(&store, &ctx, path,
+                                            LOG_STORE_MMAP, 64u));
+        // 8 byte header + 56 bytes = 4 records of "Entry N"
+        uint32_t seq = 0u;
+        for (uint32_t i = 0u; i < 5u; ++i) {
+                TEST_ASSERT_EQUAL(0, log_store_event(&store, &seq, 0u, INFO,
+                                                     "Entry %lu",
+                                                     (unsigned long)i));
+        }
+        TEST_ASSERT_EQUAL(-1, log_store_sync(&store, seq));
+        TEST_ASSERT_EQUAL(ENOSPC, errno);
+        TEST_ASSERT_EQUAL_UINT32(4u, store.durable);
+        TEST_ASSERT_EQUAL(0, log_store_sync(&store, 3u));
+        TEST_ASSERT_EQUAL(-1, log_store_close(&store));
+
+        TEST_ASSERT_EQUAL(0, stat(path, &st));
+        TEST_ASSERT_EQUAL(64, st.st_size);
+        TEST_ASSERT_EQUAL_UINT32(4u, stored_records());
+}
+
+int
+main(void)
+{
+        UNITY_BEGIN();
+        RUN_TEST(test_store_one_sync_covers_all_pending);
+        RUN_TEST(test_store_commits_every_n);
+        RUN_TEST(test_store_concurrent_waiters_share_commits);
+        RUN_TEST(test_store_sync_rejects_unlogged_and_lost_entries);
+        RUN_TEST(test_store_mmap_full_reports_enospc);
+        return UNITY_END();
+}
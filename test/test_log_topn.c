@@ -0,0 +1,115 @@
+#include <stdint.h>
+#include <string.h>
+
+#include "../subprojects/unity/src/unity.h"
+
+#include "../include/log.h"
+#include "../include/log_topn.h"
+
+static uint32_t fake_time = 0;
+
+static uint32_t
+fake_timestamp(void)
+{
+        return fake_time;
+}
+
+void
+setUp(void)
+{
+}
+void
+tearDown(void)
+{
+}
+
+void
+test_hash_normalises_numbers(void)
+{
+        TEST_ASSERT_EQUAL_UINT32(log_msg_hash("Retry 3 of 5"),
+                                 log_msg_hash("Retry 12 of 50"));
+        TEST_ASSERT_TRUE(log_msg_hash("Retry 3 of 5")
+                         != log_msg_hash("Retry 3 of 5 failed"));
+        TEST_ASSERT_TRUE(log_msg_hash("ADC 1") != log_msg_hash("ADC"));
+}
+
+void
+test_topn_by_count_and_bytes(void)
+{
+        struct log_ctx ctx;
+        log_init(&ctx, fake_timestamp);
+
+        for (uint16_t i = 0; i < 20u; ++i) {
+                log_event(&ctx, INFO, "tick %u", i);
+        }
+        for (uint16_t i = 0; i < 5u; ++i) {
+                log_event(&ctx, WARN, "CAN bus-off on channel %u, resetting",
+                          i);
+        }
+        log_event(&ctx, FAULT, "Overtemp");
+
+        struct log_topn top;
+        TEST_ASSERT_EQUAL_UINT16(3u, log_topn(&ctx, &top, LOG_TOPN_BY_COUNT));
+        TEST_ASSERT_EQUAL_UINT16(20u, top.item[0].count);
+        TEST_ASSERT_EQUAL_UINT16(0u, top.item[0].error);
+        TEST_ASSERT_EQUAL_STRING("tick 19",
+                                 log_get_entry(&ctx, top.item[0].last)->msg);
+        TEST_ASSERT_EQUAL_UINT16(5u, top.item[1].count);
+        TEST_ASSERT_EQUAL_UINT16(1u, top.item[2].count);
+
+        /* 5 long messages outweigh 20 short ones. */
+        TEST_ASSERT_EQUAL_UINT16(3u, log_topn(&ctx, &top, LOG_TOPN_BY_BYTES));
+        TEST_ASSERT_EQUAL_UINT16(5u, top.item[0].count);
+        TEST_ASSERT_EQUAL_UINT32(5u * strlen("CAN bus-off on channel 0, resetting"),
+                                 top.item[0].bytes);
+        TEST_ASSERT_EQUAL_UINT32(10u * 6u + 10u * 7u, top.item[1].bytes);
+}
+
+void
+test_topn_keeps_heavy_hitter_when_sketch_overflows(void)
+{
+        struct log_ctx ctx;
+        log_init(&ctx, fake_timestamp);
+
+        /* Every other entry is unique; the rest repeat one message. */
+        for (uint16_t i = 0; i < LOG_ENTRIES; ++i) {
+                if ((i % 2u) == 0u) {
+                        log_event(&ctx, WARN, "Sensor timeout");
+                } else {
+                        log_event(&ctx, INFO, "unique %c%c", 'a' + (i % 26u),
+                                  'A' + (i / 26u));
+                }
+        }
+
+        struct log_topn top;
+        TEST_ASSERT_EQUAL_UINT16(LOG_TOPN_SLOTS,
+                                 log_topn(&ctx, &top, LOG_TOPN_BY_COUNT));
+        TEST_ASSERT_EQUAL_UINT32(log_msg_hash("Sensor timeout"),
+                                 top.item[0].hash);
+        TEST_ASSERT_GREATER_OR_EQUAL(LOG_ENTRIES / 2u, top.item[0].count);
+        TEST_ASSERT_LESS_OR_EQUAL(LOG_ENTRIES / 2u,
+                                  (uint16_t)(top.item[0].count
+                                             - top.item[0].error));
+}
+
+void
+test_topn_null_and_empty(void)
+{
+        struct log_ctx ctx;
+        struct log_topn top;
+        log_init(&ctx, fake_timestamp);
+        TEST_ASSERT_EQUAL_UINT16(0u, log_topn(&ctx, &top, LOG_TOPN_BY_COUNT));
+        TEST_ASSERT_EQUAL_UINT16(0u, log_topn(NULL, &top, LOG_TOPN_BY_COUNT));
+        TEST_ASSERT_EQUAL_UINT16(0u, log_topn(&ctx, NULL, LOG_TOPN_BY_COUNT));
+}
+
+int
+main(void)
+{
+        UNITY_BEGIN();
+        RUN_TEST(test_hash_normalises_numbers);
+        RUN_TEST(test_topn_by_count_and_bytes);
+        RUN_TEST(test_topn_keeps_heavy_hitter_when_sketch_overflows);
+        RUN_TEST(test_topn_null_and_empty);
+        return UNITY_END();
+}
@@ -0,0 +1,248 @@
+#define _XOPEN_SOURCE 600
+#define _DEFAULT_SOURCE
+
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <termios.h>
+#include <unistd.h>
+
+#include "../subprojects/unity/src/unity.h"
+
+#include "../include/log_export.h"
+#include "../include/log_uart.h"
+
+static uint32_t fake_time = 0;
+
+static uint32_t
+fake_timestamp(void)
+{
+        return fake_time++;
+}
+
+/* pty pair standing in for a UART link */
+static int master = -1;
+static int slave = -1;
+static uint32_t started;
+static uint8_t refuse;
+
+static struct log_uart uart;
+static struct log_ctx ctx;
+
+static int
+pty_tx(void *user, const uint8_t *buf, size_t len)
+{
+        (void)user;
+        if (refuse != 0u) {
+                return 1;
+        }
+        TEST_ASSERT_EQUAL((ssize_t)len, write(master, buf, len));
+        started++;
+        return 0;
+}
+
+/* Read one 0x00-delimited frame from the far end of the link. */
+static size_t
+read_frame(uint8_t *buf, size_t cap)
+{
+        size_t n = 0;
+        for (;;) {
+                uint8_t c;
+                TEST_ASSERT_EQUAL(1, read(slave, &c, 1));
+                if (c == 0u) {
+                        return n;
+                }
+                TEST_ASSERT_LESS_THAN(cap, n);
+                buf[n++] = c;
+        }
+}
+
+/* Receive one frame and return its first sequence number. */
+static uint32_t
+receive(uint16_t *count, char *first_msg)
+{
+        uint8_t wire[LOG_UART_WIRE_MAX];
+        uint8_t batch[LOG_UART_FRAME_MAX];
+        struct log_batch b;
+        size_t n = read_frame(wire, sizeof(wire));
+        size_t len = log_uart_decode(wire, n, batch, sizeof(batch), &b);
+        TEST_ASSERT_GREATER_THAN(0u, len);
+
+        struct log_entry e;
+        TEST_ASSERT_GREATER_THAN(0u,
+                                 log_record_decode(&batch[LOG_BATCH_HEADER_LEN],
+                                                   b.len, &e));
+        strcpy(first_msg, e.msg);
+        *count = b.count;
+        return b.seq;
+}
+
+void
+setUp(void)
+{
+        master = posix_openpt(O_RDWR | O_NOCTTY);
+        TEST_ASSERT_GREATER_OR_EQUAL(0, master);
+        TEST_ASSERT_EQUAL(0, grantpt(master));
+        TEST_ASSERT_EQUAL(0, unlockpt(master));
+        slave = open(ptsname(master), O_RDWR | O_NOCTTY);
+        TEST_ASSERT_GREATER_OR_EQUAL(0, slave);
+
+        struct termios t;
+        TEST_ASSERT_EQUAL(0, tcgetattr(slave, &t));
+        cfmakeraw(&t);
+        TEST_ASSERT_EQUAL(0, tcsetattr(slave, TCSANOW, &t));
+
+        started = 0;
+        refuse = 0;
+        fake_time = 0;
+        log_init(&ctx, fake_timestamp);
+        log_uart_init(&uart, pty_tx, NULL, 7u, INFO, LOG_MODULES_ALL);
+}
+void
+tearDown(void)
+{
+        (void)close(slave);
+        (void)close(master);
+}
+
+void
+test_cobs_roundtrip(void)
+{
+        uint8_t in[600];
+        uint8_t enc[620];
+        uint8_t dec[600];
+        for (size_t i = 0; i < sizeof(in); ++i) {
+                in[i] = (uint8_t)((i % 300u == 0u) ? 0u : (i * 7u));
+        }
+        size_t n = log_cobs_encode(in, sizeof(in), enc, sizeof(enc));
+        TEST_ASSERT_GREATER_THAN(0u, n);
+        TEST_ASSERT_NULL(memchr(enc, 0, n));
+        TEST_ASSERT_EQUAL(sizeof(in), log_cobs_decode(enc, n, dec, sizeof(dec)));
+        TEST_ASSERT_EQUAL_MEMORY(in, dec, sizeof(in));
+
+        TEST_ASSERT_EQUAL_UINT16(0x29B1u, log_crc16((const uint8_t *)"123456789",
+                                                    9u));
+}
+
+void
+test_uart_streams_frames_over_pty(void)
+{
+        for (uint16_t i = 0; i < LOG_ENTRIES; ++i) {
+                log_event(&ctx, INFO, "Entry %u", i);
+        }
+
+        uint32_t next = 0;
+        while (log_uart_poll(&uart, &ctx) != 0u) {
+                // Link busy until the transfer completes
+                TEST_ASSERT_EQUAL_UINT8(0, log_uart_poll(&uart, &ctx));
+
+                uint16_t count;
+                char msg[LOG_MSG_LEN];
+                char expected[LOG_MSG_LEN];
+                TEST_ASSERT_EQUAL_UINT32(next, receive(&count, msg));
+                snprintf(expected, sizeof(expected), "Entry %lu",
+                         (unsigned long)next);
+                TEST_ASSERT_EQUAL_STRING(expected, msg);
+                next += count;
+                log_uart_tx_done(&uart, 1u);
+        }
+        TEST_ASSERT_EQUAL_UINT32(LOG_ENTRIES, next);
+        TEST_ASSERT_GREATER_THAN(1u, uart.frames);
+}
+
+void
+test_uart_failed_frame_is_resent(void)
+{
+        log_event(&ctx, INFO, "Entry 0");
+        refuse = 1u;
+        TEST_ASSERT_EQUAL_UINT8(0, log_uart_poll(&uart, &ctx));
+        refuse = 0u;
+
+        uint16_t count;
+        char msg[LOG_MSG_LEN];
+        TEST_ASSERT_EQUAL_UINT8(1, log_uart_poll(&uart, &ctx));
+        TEST_ASSERT_EQUAL_UINT32(0, receive(&count, msg));
+        log_uart_tx_done(&uart, 0u);
+
+        TEST_ASSERT_EQUAL_UINT8(1, log_uart_poll(&uart, &ctx));
+        TEST_ASSERT_EQUAL_UINT32(0, receive(&count, msg));
+        TEST_ASSERT_EQUAL_STRING("Entry 0", msg);
+        log_uart_tx_done(&uart, 1u);
+        TEST_ASSERT_EQUAL_UINT8(0, log_uart_poll(&uart, &ctx));
+}
+
+void
+test_uart_failed_frame_keeps_dropped_count(void)
+{
+#if LOG_MODULE_QUOTA
+        // Quota evictions leave a gap from seq 2, inside the first frame
+        uint16_t count;
+        char msg[LOG_MSG_LEN];
+        log_set_quota(&ctx, 1u, 2u);
+        log_event_mod(&ctx, 1u, WARN, "Quiet 0");
+        log_event_mod(&ctx, 1u, WARN, "Quiet 1");
+        for (uint16_t i = 2u; i <= LOG_ENTRIES; ++i) {
+                log_event_mod(&ctx, 2u, INFO, "Entry %u", i);
+        }
+        TEST_ASSERT_EQUAL_UINT8(1, log_uart_poll(&uart, &ctx));
+        TEST_ASSERT_EQUAL_UINT32(0, receive(&count, msg));
+        TEST_ASSERT_EQUAL_UINT32(LOG_QUOTA_SLACK + 1u, uart.sink.dropped);
+        log_uart_tx_done(&uart, 0u);
+
+        TEST_ASSERT_EQUAL_UINT8(1, log_uart_poll(&uart, &ctx));
+        TEST_ASSERT_EQUAL_UINT32(0, receive(&count, msg));
+        TEST_ASSERT_EQUAL_UINT32(LOG_QUOTA_SLACK + 1u, uart.sink.dropped);
+#else
+        TEST_IGNORE_MESSAGE("LOG_MODULE_QUOTA disabled");
+#endif
+}
+
+void
+test_uart_resume_from_receiver_cursor(void)
+{
+        for (uint16_t i = 0; i < 5; ++i) {
+                log_event(&ctx, WARN, "Entry %u", i);
+        }
+        uint16_t count;
+        char msg[LOG_MSG_LEN];
+        TEST_ASSERT_EQUAL_UINT8(1, log_uart_poll(&uart, &ctx));
+        (void)receive(&count, msg);
+        log_uart_tx_done(&uart, 1u);
+
+        // Link dropped; receiver says it only has entries 0 and 1
+        log_uart_resume(&uart, 2u);
+        TEST_ASSERT_EQUAL_UINT8(1, log_uart_poll(&uart, &ctx));
+        TEST_ASSERT_EQUAL_UINT32(2, receive(&count, msg));
+        TEST_ASSERT_EQUAL_UINT16(3, count);
+        TEST_ASSERT_EQUAL_STRING("Entry 2", msg);
+}
+
+void
+test_uart_decode_rejects_corruption(void)
+{
+        log_event(&ctx, FAULT, "Overcurrent");
+        TEST_ASSERT_EQUAL_UINT8(1, log_uart_poll(&uart, &ctx));
+
+        uint8_t wire[LOG_UART_WIRE_MAX];
+        uint8_t batch[LOG_UART_FRAME_MAX];
+        struct log_batch b;
+        size_t n = read_frame(wire, sizeof(wire));
+        wire[n / 2u] ^= 0x01u;
+        TEST_ASSERT_EQUAL(0, log_uart_decode(wire, n, batch, sizeof(batch),
+                                             &b));
+}
+
+int
+main(void)
+{
+        UNITY_BEGIN();
+        RUN_TEST(test_cobs_roundtrip);
+        RUN_TEST(test_uart_streams_frames_over_pty);
+        RUN_TEST(test_uart_failed_frame_is_resent);
+        RUN_TEST(test_uart_failed_frame_keeps_dropped_count);
+        RUN_TEST(test_uart_resume_from_receiver_cursor);
+        RUN_TEST(test_uart_decode_rejects_corruption);
+        return UNITY_END();
+}
@@ -0,0 +1,264 @@
+#define _GNU_SOURCE
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <netinet/in.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "../subprojects/unity/src/unity.h"
+
+#include "../include/log_export.h"
+#include "../include/log_unix.h"
+
+static uint32_t fake_time = 0;
+
+static uint32_t
+fake_timestamp(void)
+{
+        return fake_time++;
+}
+
+static struct log_unix u;
+static struct log_ctx ctx;
+static int peer = -1;
+static const char *pad;
+
+void
+setUp(void)
+{
+        fake_time = 0;
+        pad = "";
+        log_init(&ctx, fake_timestamp);
+}
+void
+tearDown(void)
+{
+        log_unix_close(&u);
+        if (peer >= 0) {
+                (void)close(peer);
+                peer = -1;
+        }
+}
+
+static void
+open_pair(int type, enum log_level min_level)
+{
+        int sv[2];
+        TEST_ASSERT_EQUAL(0, socketpair(AF_UNIX, type, 0, sv));
+        log_unix_attach(&u, sv[0], type, 1234u, min_level, LOG_MODULES_ALL);
+        peer = sv[1];
+}
+
+/* Decode every record of one batch, checking they are consecutive. */
+static uint16_t
+check_batch(const uint8_t *buf, size_t len, uint32_t *next)
+{
+        struct log_batch b;
+        TEST_ASSERT_EQUAL(LOG_BATCH_HEADER_LEN, log_batch_parse(buf, len, &b));
+        TEST_ASSERT_EQUAL_UINT32(1234u, b.source);
+        TEST_ASSERT_EQUAL(LOG_BATCH_HEADER_LEN + b.len, len);
+
+        size_t off = LOG_BATCH_HEADER_LEN;
+        for (uint16_t i = 0; i < b.count; ++i) {
+                struct log_entry e;
+                char expected[LOG_MSG_LEN];
+                size_t n = log_record_decode(&buf[off], len - off, &e);
+                TEST_ASSERT_GREATER_THAN(0u, n);
+                snprintf(expected, sizeof(expected), "Entry %lu%s",
+                         (unsigned long)*next, pad);
+                TEST_ASSERT_EQUAL_STRING(expected, e.msg);
+                (*next)++;
+                off += n;
+        }
+        return b.count;
+}
+
+void
+test_unix_seqpacket_batches(void)
+{
+        open_pair(SOCK_SEQPACKET, INFO);
+        for (uint16_t i = 0; i < LOG_ENTRIES; ++i) {
+                log_event(&ctx, INFO, "Entry %u", i);
+        }
+
+        int sent = log_unix_flush(&u, &ctx);
+        TEST_ASSERT_GREATER_THAN(0, sent);
+        TEST_ASSERT_EQUAL(0, log_unix_flush(&u, &ctx));
+
+        uint8_t buf[LOG_UNIX_BATCH_LEN];
+        uint32_t next = 0;
+        uint32_t records = 0;
+        for (int i = 0; i < sent; ++i) {
+                ssize_t n = recv(peer, buf, sizeof(buf), 0);
+                TEST_ASSERT_GREATER_THAN(0, n);
+                records += check_batch(buf, (size_t)n, &next);
+        }
+        TEST_ASSERT_EQUAL_UINT32(LOG_ENTRIES, records);
+}
+
+void
+test_unix_stream_is_length_delimited(void)
+{
+        open_pair(SOCK_STREAM, WARN);
+        for (uint16_t i = 0; i < 20; ++i) {
+                log_event(&ctx, (i % 2u) ? INFO : WARN, "Entry %u", i / 2u);
+        }
+        TEST_ASSERT_EQUAL(1, log_unix_flush(&u, &ctx));
+
+        uint8_t buf[LOG_UNIX_BATCH_LEN];
+        ssize_t n = recv(peer, buf, sizeof(buf), 0);
+        uint32_t next = 0;
+        TEST_ASSERT_EQUAL_UINT16(10, check_batch(buf, (size_t)n, &next));
+}
+
+/* Check the complete batches at the start of buf; returns bytes used. */
+static size_t
+check_stream(const uint8_t *buf, size_t len, uint32_t *next)
+{
+        struct log_batch b;
+        size_t off = 0u;
+        while ((log_batch_parse(&buf[off], len - off, &b) != 0u)
+               && ((len - off) >= (LOG_BATCH_HEADER_LEN + (size_t)b.len))) {
+                // Entries may be lost while the socket is full, not resent
+                TEST_ASSERT_TRUE((int32_t)(b.seq - *next) >= 0);
+                *next = b.seq;
+                (void)check_batch(&buf[off], LOG_BATCH_HEADER_LEN + b.len,
+                                  next);
+                off += LOG_BATCH_HEADER_LEN + b.len;
+        }
+        return off;
+}
+
+void
+test_unix_stream_resumes_cut_batch(void)
+{
+        static uint8_t buf[4u * LOG_UNIX_BATCHES * LOG_UNIX_BATCH_LEN];
+        size_t len = 0u;
+        uint32_t next = 0u;
+        uint32_t logged = 0u;
+        uint8_t cut = 0u;
+        int small = 1;
+        // Loopback TCP: Unix stream sockets do not cut writes this small
+        struct sockaddr_in addr = { .sin_family = AF_INET };
+        socklen_t addr_len = sizeof(addr);
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        int lfd = socket(AF_INET, SOCK_STREAM, 0);
+        int fd = socket(AF_INET, SOCK_STREAM, 0);
+        TEST_ASSERT_EQUAL(0, setsockopt(lfd, SOL_SOCKET, SO_RCVBUF, &small,
+                                        sizeof(small)));
+        TEST_ASSERT_EQUAL(0, setsockopt(fd, SOL_SOCKET, SO_SNDBUF, &small,
+                                        sizeof(small)));
+        TEST_ASSERT_EQUAL(0, bind(lfd, (struct sockaddr *)&addr,
+                                  sizeof(addr)));
+        TEST_ASSERT_EQUAL(0, listen(lfd, 1));
+        TEST_ASSERT_EQUAL(0, getsockname(lfd, (struct sockaddr *)&addr,
+                                         &addr_len));
+        TEST_ASSERT_EQUAL(0, connect(fd, (struct sockaddr *)&addr,
+                                     sizeof(addr)));
+        peer = accept(lfd, NULL, NULL);
+        TEST_ASSERT_TRUE(peer >= 0);
+        (void)close(lfd);
+        TEST_ASSERT_EQUAL(0, fcntl(fd, F_SETFL, O_NONBLOCK));
+        log_unix_attach(&u, fd, SOCK_STREAM, 1234u, INFO, LOG_MODULES_ALL);
+        pad = " .................................";
+
+        // Log faster than the peer reads, so writes are cut short
+        for (uint32_t round = 0u; round < 100u; ++round) {
+                for (uint32_t i = 0u; i < LOG_ENTRIES; ++i) {
+                        log_event(&ctx, INFO, "Entry %lu%s",
+                                  (unsigned long)logged++, pad);
+                }
+                TEST_ASSERT_TRUE(log_unix_flush(&u, &ctx) >= 0);
+                cut |= (u.tail != 0u) ? 1u : 0u;
+                ssize_t n = recv(peer, &buf[len], 1000u, MSG_DONTWAIT);
+                len += (n > 0) ? (size_t)n : 0u;
+                size_t used = check_stream(buf, len, &next);
+                (void)memmove(buf, &buf[used], len - used);
+                len -= used;
+        }
+        TEST_ASSERT_TRUE(cut);
+
+        while ((u.tail != 0u) || (u.sink.pos != logged)) {
+                TEST_ASSERT_TRUE(log_unix_flush(&u, &ctx) >= 0);
+                ssize_t n = recv(peer, &buf[len], sizeof(buf) - len,
+                                 MSG_DONTWAIT);
+                len += (n > 0) ? (size_t)n : 0u;
+        }
+        ssize_t n;
+        while ((n = recv(peer, &buf[len], sizeof(buf) - len, MSG_DONTWAIT))
+               > 0) {
+                len += (size_t)n;
+        }
+        TEST_ASSERT_EQUAL(len, check_stream(buf, len, &next));
+        TEST_ASSERT_EQUAL_UINT32(logged, next);
+}
+
+void
+test_unix_failed_send_rewinds(void)
+{
+        open_pair(SOCK_SEQPACKET, INFO);
+        log_event(&ctx, INFO, "Entry 0");
+        (void)close(peer);
+        peer = -1;
+        TEST_ASSERT_EQUAL(-1, log_unix_flush(&u, &ctx));
+        TEST_ASSERT_EQUAL_UINT32(0, u.sink.pos);
+
+        // Overwritten entries are counted again on the retry, not twice
+        for (uint16_t i = 1; i < (LOG_ENTRIES + 5u); ++i) {
+                log_event(&ctx, INFO, "Entry %u", i);
+        }
+        TEST_ASSERT_EQUAL(-1, log_unix_flush(&u, &ctx));
+        TEST_ASSERT_EQUAL_UINT32(0, u.sink.pos);
+        TEST_ASSERT_EQUAL_UINT32(0, u.sink.dropped);
+}
+
+void
+test_unix_stream_peer_gone_is_an_error_not_a_signal(void)
+{
+        // SIGPIPE would end the test run here
+        open_pair(SOCK_STREAM, INFO);
+        (void)close(peer);
+        peer = -1;
+        log_event(&ctx, INFO, "Entry 0");
+        TEST_ASSERT_EQUAL(-1, log_unix_flush(&u, &ctx));
+        TEST_ASSERT_EQUAL(EPIPE, errno);
+        TEST_ASSERT_EQUAL_UINT32(0, u.sink.pos);
+}
+
+void
+test_unix_listen_and_connect(void)
+{
+        char path[64];
+        snprintf(path, sizeof(path), "collector_%ld.sock", (long)getpid());
+        int lfd = log_unix_listen(path, SOCK_DGRAM);
+        TEST_ASSERT_GREATER_OR_EQUAL(0, lfd);
+        TEST_ASSERT_EQUAL(0, log_unix_connect(&u, path, SOCK_DGRAM, 1234u,
+                                              INFO, LOG_MODULES_ALL));
+
+        log_event(&ctx, INFO, "Entry 0");
+        TEST_ASSERT_EQUAL(1, log_unix_flush(&u, &ctx));
+
+        uint8_t buf[LOG_UNIX_BATCH_LEN];
+        ssize_t n = recv(lfd, buf, sizeof(buf), 0);
+        uint32_t next = 0;
+        TEST_ASSERT_EQUAL_UINT16(1, check_batch(buf, (size_t)n, &next));
+        (void)close(lfd);
+        (void)unlink(path);
+}
+
+int
+main(void)
+{
+        UNITY_BEGIN();
+        RUN_TEST(test_unix_seqpacket_batches);
+        RUN_TEST(test_unix_stream_is_length_delimited);
+        RUN_TEST(test_unix_stream_resumes_cut_batch);
+        RUN_TEST(test_unix_failed_send_rewinds);
+        RUN_TEST(test_unix_stream_peer_gone_is_an_error_not_a_signal);
+        RUN_TEST(test_unix_listen_and_connect);
+        return UNITY_END();
+}
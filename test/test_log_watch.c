@@ -0,0 +1,165 @@
+#include <stdint.h>
+#include <string.h>
+
+#include "../subprojects/unity/src/unity.h"
+
+#include "../include/log.h"
+#include "../include/log_watch.h"
+
+#define CAN (5u)
+
+static uint32_t fake_time = 0;
+
+static uint32_t
+fake_timestamp(void)
+{
+        return fake_time;
+}
+
+static struct log_ctx test_log;
+
+struct capture {
+        uint32_t n;
+        uint32_t seq[8];
+        char msg[8][LOG_MSG_LEN];
+};
+
+static struct capture faults, currents;
+
+static void
+capture(void *user, const struct log_entry *e, uint32_t seq)
+{
+        struct capture *c = user;
+        if (c->n < 8u) {
+                c->seq[c->n] = seq;
+                (void)memcpy(c->msg[c->n], e->msg, LOG_MSG_LEN);
+        }
+        c->n++;
+}
+
+void
+setUp(void)
+{
+        fake_time = 0;
+        log_init(&test_log, fake_timestamp);
+        memset(&faults, 0, sizeof(faults));
+        memset(&currents, 0, sizeof(currents));
+}
+void
+tearDown(void)
+{
+}
+
+void
+test_watch_fires_on_level_module_and_text(void)
+{
+        struct log_watch can_fault, overcurrent;
+        int rc = log_watch_init(&can_fault, LOG_LEVEL_BIT(FAULT),
+                                LOG_MODULE_BIT(CAN), NULL, capture, &faults);
+        TEST_ASSERT_EQUAL(0, rc);
+        rc = log_watch_init(&overcurrent, LOG_LEVELS_ALL, LOG_MODULES_ALL,
+                            "overcurrent", capture, &currents);
+        TEST_ASSERT_EQUAL(0, rc);
+        log_watch_add(&test_log, &can_fault);
+        log_watch_add(&test_log, &overcurrent);
+        TEST_ASSERT_EQUAL_UINT32(LOG_MODULES_ALL, test_log.watch_mask[INFO]);
+
+        log_event_mod(&test_log, CAN, WARN, "bus off");
+        log_event_mod(&test_log, CAN, FAULT, "bus off");
+        log_event_mod(&test_log, 2u, FAULT, "bus off");
+        log_event(&test_log, INFO, "phase %c overcurrent", 'B');
+        log_event(&test_log, INFO, "phase A overcurren");
+        log_event_mod(&test_log, CAN, FAULT, "overcurrent on %u", 3u);
+
+        TEST_ASSERT_EQUAL_UINT32(2u, faults.n);
+        TEST_ASSERT_EQUAL_UINT32(1u, faults.seq[0]);
+        TEST_ASSERT_EQUAL_UINT32(5u, faults.seq[1]);
+        TEST_ASSERT_EQUAL_UINT32(2u, currents.n);
+        TEST_ASSERT_EQUAL_STRING("phase B overcurrent", currents.msg[0]);
+        TEST_ASSERT_EQUAL_STRING("overcurrent on 3", currents.msg[1]);
+        TEST_ASSERT_EQUAL_UINT32(2u, can_fault.hits);
+
+        // Entries added as copies are watched as well
+        struct log_entry e = { 0u };
+        e.level = FAULT;
+        e.module = CAN;
+        log_put_entry(&test_log, &e);
+        TEST_ASSERT_EQUAL_UINT32(3u, faults.n);
+        TEST_ASSERT_EQUAL_UINT32(6u, faults.seq[2]);
+}
+
+void
+test_watch_text_matches_overlapping_prefixes(void)
+{
+        struct log_watch w;
+        int rc = log_watch_init(&w, LOG_LEVELS_ALL, LOG_MODULES_ALL, "abab",
+                                capture, &currents);
+        TEST_ASSERT_EQUAL(0, rc);
+        TEST_ASSERT_EQUAL_UINT8(0u, w.fail[0]);
+        TEST_ASSERT_EQUAL_UINT8(0u, w.fail[1]);
+        TEST_ASSERT_EQUAL_UINT8(1u, w.fail[2]);
+        TEST_ASSERT_EQUAL_UINT8(2u, w.fail[3]);
+        log_watch_add(&test_log, &w);
+
+        log_event(&test_log, INFO, "aabaabac");
+        log_event(&test_log, INFO, "abaababb");
+        log_event(&test_log, INFO, "ababab");
+        log_event(&test_log, INFO, "xyzaba");
+        TEST_ASSERT_EQUAL_UINT32(2u, currents.n);
+        TEST_ASSERT_EQUAL_STRING("abaababb", currents.msg[0]);
+        TEST_ASSERT_EQUAL_STRING("ababab", currents.msg[1]);
+
+        // Text longer than LOG_WATCH_TEXT is refused
+        char big[LOG_WATCH_TEXT + 2u];
+        memset(big, 'x', sizeof(big) - 1u);
+        big[sizeof(big) - 1u] = '\0';
+        rc = log_watch_init(&w, LOG_LEVELS_ALL, LOG_MODULES_ALL, big, capture,
+                            NULL);
+        TEST_ASSERT_EQUAL(-1, rc);
+        rc = log_watch_init(&w, LOG_LEVELS_ALL, LOG_MODULES_ALL, NULL, NULL,
+                            NULL);
+        TEST_ASSERT_EQUAL(-1, rc);
+}
+
+void
+test_watch_remove_clears_masks(void)
+{
+        struct log_watch a, b;
+        (void)log_watch_init(&a, LOG_LEVEL_BIT(WARN), LOG_MODULE_BIT(1), NULL,
+                             capture, &faults);
+        (void)log_watch_init(&b, LOG_LEVEL_BIT(WARN) | LOG_LEVEL_BIT(FAULT),
+                             LOG_MODULE_BIT(2), NULL, capture, &currents);
+        log_watch_add(&test_log, &a);
+        log_watch_add(&test_log, &b);
+        log_watch_add(&test_log, &a);
+        TEST_ASSERT_EQUAL_UINT32(0u, test_log.watch_mask[INFO]);
+        TEST_ASSERT_EQUAL_UINT32(0x6u, test_log.watch_mask[WARN]);
+        TEST_ASSERT_EQUAL_UINT32(0x4u, test_log.watch_mask[FAULT]);
+
+        log_watch_remove(&test_log, &b);
+        TEST_ASSERT_EQUAL_UINT32(0x2u, test_log.watch_mask[WARN]);
+        TEST_ASSERT_EQUAL_UINT32(0u, test_log.watch_mask[FAULT]);
+        log_event_mod(&test_log, 1u, WARN, "a");
+        log_event_mod(&test_log, 2u, WARN, "b");
+        TEST_ASSERT_EQUAL_UINT32(1u, faults.n);
+        TEST_ASSERT_EQUAL_UINT32(0u, currents.n);
+
+        log_watch_remove(&test_log, &a);
+        TEST_ASSERT_NULL(test_log.watch);
+        TEST_ASSERT_EQUAL_UINT32(0u, test_log.watch_mask[WARN]);
+
+        log_watch_add(&test_log, &a);
+        log_init(&test_log, fake_timestamp);
+        TEST_ASSERT_NULL(test_log.watch);
+        TEST_ASSERT_EQUAL_UINT32(0u, test_log.watch_mask[WARN]);
+}
+
+int
+main(void)
+{
+        UNITY_BEGIN();
+        RUN_TEST(test_watch_fires_on_level_module_and_text);
+        RUN_TEST(test_watch_text_matches_overlapping_prefixes);
+        RUN_TEST(test_watch_remove_clears_masks);
+        return UNITY_END();
+}
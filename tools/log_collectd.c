@@ -0,0 +1,437 @@
+/*
+ * @licence MIT
+ *
+ * @file: log_collectd.c
+ *
+ * log-collectd: receive log batches from local producers over a Unix-domain
+ * socket and write them into rotating export segments.
+ *
+ * Usage: log-collectd [-d | -S] [-p] [-s SEGMENT_BYTES] [-o PREFIX]
+ *                     SOCKET_PATH
+ *
+ * Producers connect with log_unix_connect() using SOCK_SEQPACKET (default)
+ * or SOCK_STREAM (-S), or, with -d, send SOCK_DGRAM batches. The records of
+ * all sources are merged by timestamp into one series of segments,
+ * PREFIX.NNNNNN.elog; producers must therefore share a clock, such as
+ * CLOCK_MONOTONIC. Records are held for about HOLD_MS after they arrive,
+ * and longer while a source heard from within HOLD_MS has nothing queued,
+ * so they come out in order unless a producer sends them later than that.
+ * With -p the
+ * records of each source identifier are instead appended in order to their
+ * own segments, PREFIX.SOURCE.NNNNNN.elog, which keeps the source of every
+ * record; log-merge can merge those later. Per-source totals are printed on
+ * SIGINT/SIGTERM.
+ *
+ * Linux only (accept4, recvmmsg).
+ */
+
+#define _GNU_SOURCE
+
+#include <errno.h>
+#include <inttypes.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "../include/log_export.h"
+#include "../include/log_unix.h"
+
+#define MAX_CLIENTS (64)
+#define MAX_SOURCES (256)
+#define RECV_BATCH  (16)
+#define MSG_MAX     (65536u)
+#define STREAM_MAX  (LOG_BATCH_HEADER_LEN + UINT16_MAX)
+#define QUEUE_MAX   (2u * MSG_MAX)
+#define HOLD_MS     (500u)
+
+struct segment {
+        FILE *f;
+        uint64_t bytes;
+        unsigned index;
+};
+
+struct source {
+        uint32_t id;
+        uint64_t records;
+        uint32_t dropped;
+        struct segment seg;  /* -p only */
+        uint8_t *queue;      /* Records not yet merged, from off to len. */
+        size_t off;
+        size_t len;
+        uint64_t since_ms;   /* When the queue last became non-empty. */
+        uint64_t last_ms;    /* When the last batch arrived. */
+};
+
+/* Bytes from a stream client not yet forming a whole batch. */
+struct partial {
+        uint8_t buf[STREAM_MAX];
+        size_t len;
+};
+
+static volatile sig_atomic_t stop;
+
+static struct source sources[MAX_SOURCES];
+static unsigned n_sources;
+
+static struct partial partials[1 + MAX_CLIENTS];
+
+static struct segment merged;
+
+static const char *prefix = "collected";
+static uint64_t segment_limit = 64u * 1024u * 1024u;
+static int per_source;
+
+static void
+on_signal(int sig)
+{
+        (void)sig;
+        stop = 1;
+}
+
+static uint64_t
+now_ms(void)
+{
+        struct timespec ts;
+        (void)clock_gettime(CLOCK_MONOTONIC, &ts);
+        return ((uint64_t)ts.tv_sec * 1000u) + ((uint64_t)ts.tv_nsec / 1000000u);
+}
+
+/* Write len record bytes to a segment, starting a new one when full; the
+ * source id is part of the name with -p. */
+static int
+segment_write(struct segment *g, const struct source *s, const uint8_t *rec,
+              size_t len)
+{
+        if ((g->f == NULL) || ((g->bytes + len) > segment_limit)) {
+                char path[4096];
+                uint8_t hdr[LOG_EXPORT_HEADER_LEN];
+                if (g->f != NULL) {
+                        (void)fclose(g->f);
+                }
+                if (s != NULL) {
+                        snprintf(path, sizeof(path), "%s.%" PRIu32 ".%06u.elog",
+                                 prefix, s->id, g->index++);
+                } else {
+                        snprintf(path, sizeof(path), "%s.%06u.elog", prefix,
+                                 g->index++);
+                }
+                g->f = fopen(path, "wb");
+                if (g->f == NULL) {
+                        perror(path);
+                        return -1;
+                }
+                size_t n = log_export_header(hdr, sizeof(hdr));
+                g->bytes = fwrite(hdr, 1u, n, g->f);
+        }
+        g->bytes += fwrite(rec, 1u, len, g->f);
+        return 0;
+}
+
+static uint32_t
+head_timestamp(const struct source *s)
+{
+        const uint8_t *p = &s->queue[s->off];
+        return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16)
+               | ((uint32_t)p[3] << 24);
+}
+
+/* Write queued records in timestamp order. Unless all is set, stop at the
+ * first record that has not been held long enough, or that a source which
+ * is still sending could precede. */
+static void
+merge_out(int all)
+{
+        uint64_t now = now_ms();
+        for (;;) {
+                struct source *min = NULL;
+                int hold = 0;
+                for (unsigned i = 0; i < n_sources; ++i) {
+                        struct source *s = &sources[i];
+                        if (s->off == s->len) {
+                                hold |= (now - s->last_ms) < HOLD_MS;
+                                continue;
+                        }
+                        if ((min == NULL)
+                            || ((int32_t)(head_timestamp(s)
+                                          - head_timestamp(min))
+                                < 0)) {
+                                min = s;
+                        }
+                }
+                if (min == NULL) {
+                        break;
+                }
+                hold |= (now - min->since_ms) < HOLD_MS;
+                if ((hold != 0) && (all == 0)) {
+                        break;
+                }
+                /* Validated on arrival; byte 6 is the message length. */
+                size_t n = LOG_RECORD_HEADER_LEN
+                           + (size_t)min->queue[min->off + 6u];
+                (void)segment_write(&merged, NULL, &min->queue[min->off], n);
+                min->off += n;
+                if (min->off == min->len) {
+                        min->off = 0u;
+                        min->len = 0u;
+                }
+        }
+}
+
+static struct source *
+source_get(uint32_t id)
+{
+        for (unsigned i = 0; i < n_sources; ++i) {
+                if (sources[i].id == id) {
+                        return &sources[i];
+                }
+        }
+        if (n_sources == MAX_SOURCES) {
+                return NULL;
+        }
+        uint8_t *queue = NULL;
+        if ((per_source == 0) && ((queue = malloc(QUEUE_MAX)) == NULL)) {
+                return NULL;
+        }
+        sources[n_sources] = (struct source){ .id = id, .queue = queue };
+        return &sources[n_sources++];
+}
+
+/* Validate one batch and append its records to the source's segment, or
+ * queue them for merging; returns NULL or why the batch was dropped. */
+static const char *
+handle_batch(const uint8_t *msg, size_t len)
+{
+        struct log_batch b;
+        if ((log_batch_parse(msg, len, &b) == 0u)
+            || ((LOG_BATCH_HEADER_LEN + (size_t)b.len) != len)) {
+                return "bad batch";
+        }
+        const uint8_t *rec = &msg[LOG_BATCH_HEADER_LEN];
+        size_t off = 0u;
+        for (uint16_t i = 0u; i < b.count; ++i) {
+                struct log_entry e;
+                size_t n = log_record_decode(&rec[off], b.len - off, &e);
+                if (n == 0u) {
+                        return "bad batch";
+                }
+                off += n;
+        }
+        if (off != b.len) {
+                return "bad batch";
+        }
+
+        struct source *s = source_get(b.source);
+        if (s == NULL) {
+                return (n_sources == MAX_SOURCES) ? "source table full"
+                                                  : "out of memory";
+        }
+        if (per_source != 0) {
+                if (segment_write(&s->seg, s, rec, b.len) != 0) {
+                        return "cannot write segment";
+                }
+        } else {
+                if ((s->len + b.len) > QUEUE_MAX) {
+                        (void)memmove(s->queue, &s->queue[s->off],
+                                      s->len - s->off);
+                        s->len -= s->off;
+                        s->off = 0u;
+                }
+                /* Still full: the others are behind, write out everything. */
+                if ((s->len + b.len) > QUEUE_MAX) {
+                        merge_out(1);
+                }
+                if (s->len == 0u) {
+                        s->since_ms = now_ms();
+                }
+                (void)memcpy(&s->queue[s->len], rec, b.len);
+                s->len += b.len;
+        }
+        s->last_ms = now_ms();
+        s->records += b.count;
+        s->dropped = b.dropped;
+        return NULL;
+}
+
+static void
+batch_dropped(const char *why)
+{
+        fprintf(stderr, "log-collectd: %s, batch dropped\n", why);
+}
+
+/* Read from a stream client and handle every whole batch; -1 at EOF. */
+static int
+stream_read(int fd, struct partial *p)
+{
+        ssize_t n = read(fd, &p->buf[p->len], sizeof(p->buf) - p->len);
+        if (n <= 0) {
+                return ((n < 0) && ((errno == EAGAIN) || (errno == EINTR)))
+                           ? 0
+                           : -1;
+        }
+        p->len += (size_t)n;
+
+        struct log_batch b;
+        size_t off = 0u;
+        while ((log_batch_parse(&p->buf[off], p->len - off, &b) != 0u)
+               && ((p->len - off) >= (LOG_BATCH_HEADER_LEN + (size_t)b.len))) {
+                size_t len = LOG_BATCH_HEADER_LEN + (size_t)b.len;
+                const char *why = handle_batch(&p->buf[off], len);
+                if (why != NULL) {
+                        batch_dropped(why);
+                }
+                off += len;
+        }
+        (void)memmove(p->buf, &p->buf[off], p->len - off);
+        p->len -= off;
+        return 0;
+}
+
+/* Receive whole batches from a datagram or seqpacket socket. */
+static int
+message_read(int fd)
+{
+        static uint8_t bufs[RECV_BATCH][MSG_MAX];
+        struct mmsghdr msgs[RECV_BATCH];
+        struct iovec iov[RECV_BATCH];
+        for (int m = 0; m < RECV_BATCH; ++m) {
+                iov[m] = (struct iovec){ bufs[m], MSG_MAX };
+                msgs[m] = (struct mmsghdr){
+                    .msg_hdr = { .msg_iov = &iov[m], .msg_iovlen = 1 } };
+        }
+        int got = recvmmsg(fd, msgs, RECV_BATCH, MSG_DONTWAIT, NULL);
+        int eof = (got == 0) || ((got < 0) && (errno != EAGAIN));
+        for (int m = 0; m < got; ++m) {
+                /* A zero-length message marks end of stream. */
+                if (msgs[m].msg_len == 0u) {
+                        eof = 1;
+                        break;
+                }
+                const char *why = handle_batch(bufs[m], msgs[m].msg_len);
+                if (why != NULL) {
+                        batch_dropped(why);
+                }
+        }
+        return (eof != 0) ? -1 : 0;
+}
+
+static void
+usage(void)
+{
+        fprintf(stderr, "usage: log-collectd [-d | -S] [-p] "
+                        "[-s SEGMENT_BYTES] [-o PREFIX] SOCKET_PATH\n");
+}
+
+int
+main(int argc, char **argv)
+{
+        int type = SOCK_SEQPACKET;
+        int opt;
+
+        while ((opt = getopt(argc, argv, "dSps:o:h")) != -1) {
+                switch (opt) {
+                case 'd': type = SOCK_DGRAM; break;
+                case 'S': type = SOCK_STREAM; break;
+                case 'p': per_source = 1; break;
+                case 's': segment_limit = strtoull(optarg, NULL, 0); break;
+                case 'o': prefix = optarg; break;
+                default: usage(); return (opt == 'h') ? 0 : 2;
+                }
+        }
+        if (optind != (argc - 1)) {
+                usage();
+                return 2;
+        }
+        const char *path = argv[optind];
+
+        struct sigaction sa = { .sa_handler = on_signal };
+        (void)sigaction(SIGINT, &sa, NULL);
+        (void)sigaction(SIGTERM, &sa, NULL);
+        (void)signal(SIGPIPE, SIG_IGN);
+
+        int lfd = log_unix_listen(path, type);
+        if (lfd < 0) {
+                fprintf(stderr, "log-collectd: %s: %s\n", path,
+                        strerror(errno));
+                return 1;
+        }
+        struct pollfd fds[1 + MAX_CLIENTS];
+        nfds_t nfds = 1;
+        fds[0] = (struct pollfd){ .fd = lfd, .events = POLLIN };
+
+        while (stop == 0) {
+                if (poll(fds, nfds, (int)HOLD_MS / 2) < 0) {
+                        if (errno == EINTR) {
+                                continue;
+                        }
+                        perror("poll");
+                        break;
+                }
+
+                if ((type != SOCK_DGRAM) && (fds[0].revents & POLLIN)) {
+                        int cfd = accept4(lfd, NULL, NULL, SOCK_CLOEXEC);
+                        if ((cfd >= 0) && (nfds < (nfds_t)(1 + MAX_CLIENTS))) {
+                                partials[nfds].len = 0u;
+                                fds[nfds++] = (struct pollfd){
+                                    .fd = cfd, .events = POLLIN};
+                        } else if (cfd >= 0) {
+                                (void)close(cfd);
+                        }
+                }
+
+                for (nfds_t i = 0; i < nfds; ++i) {
+                        if (((fds[i].revents & (POLLIN | POLLHUP)) == 0)
+                            || ((i == 0) && (type != SOCK_DGRAM))) {
+                                continue;
+                        }
+                        int eof = (type == SOCK_STREAM)
+                                      ? stream_read(fds[i].fd, &partials[i])
+                                      : message_read(fds[i].fd);
+                        if ((i > 0) && (eof != 0)) {
+                                if (partials[i].len != 0u) {
+                                        fprintf(stderr, "log-collectd: "
+                                                        "truncated batch "
+                                                        "dropped\n");
+                                }
+                                (void)close(fds[i].fd);
+                                fds[i] = fds[--nfds];
+                                partials[i].len = partials[nfds].len;
+                                (void)memcpy(partials[i].buf,
+                                             partials[nfds].buf,
+                                             partials[nfds].len);
+                                --i;
+                        }
+                }
+                merge_out(0);
+                for (unsigned i = 0; i < n_sources; ++i) {
+                        if (sources[i].seg.f != NULL) {
+                                (void)fflush(sources[i].seg.f);
+                        }
+                }
+                if (merged.f != NULL) {
+                        (void)fflush(merged.f);
+                }
+        }
+
+        merge_out(1);
+        for (unsigned i = 0; i < n_sources; ++i) {
+                fprintf(stderr, "source %" PRIu32 ": %" PRIu64
+                                " records, %" PRIu32 " lost\n",
+                        sources[i].id, sources[i].records,
+                        sources[i].dropped);
+                if (sources[i].seg.f != NULL) {
+                        (void)fclose(sources[i].seg.f);
+                }
+                free(sources[i].queue);
+        }
+        if (merged.f != NULL) {
+                (void)fclose(merged.f);
+        }
+        (void)close(lfd);
+        (void)unlink(path);
+        return 0;
+}
@@ -0,0 +1,154 @@
+/*
+ * @licence MIT
+ *
+ * @file: log_merge.c
+ *
+ * log-merge: merge exported logs into one timeline.
+ *
+ * Usage: log-merge [-o OUT] [-w WINDOW_KIB] FILE[,OFFSET[,MULT[,DIV]]]...
+ *
+ * Without -o the merged timeline is printed as text, one line per record,
+ * as: calibrated timestamp, source index, level, module, message.
+ * With -o it is written as a single export file.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <errno.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "../include/log_export.h"
+#include "../include/log_merge.h"
+
+static const char *
+level_name(uint16_t level)
+{
+        switch (level) {
+        case INFO: return "INFO";
+        case WARN: return "WARN";
+        case FAULT: return "FAULT";
+        default: return "?";
+        }
+}
+
+static int
+parse_source(char *spec, struct log_merge_calib *calib)
+{
+        *calib = (struct log_merge_calib){ .mult = 1u, .div = 1u };
+        char *field = strchr(spec, ',');
+        if (field == NULL) {
+                return 0;
+        }
+        *field++ = '\0';
+
+        char *end;
+        calib->offset = strtoll(field, &end, 0);
+        if ((*end == ',') && (end[1] != '\0')) {
+                calib->mult = (uint32_t)strtoul(end + 1, &end, 0);
+        }
+        if ((*end == ',') && (end[1] != '\0')) {
+                calib->div = (uint32_t)strtoul(end + 1, &end, 0);
+        }
+        return (*end == '\0') ? 0 : -1;
+}
+
+static void
+usage(void)
+{
+        fprintf(stderr, "usage: log-merge [-o OUT] [-w WINDOW_KIB] "
+                        "FILE[,OFFSET[,MULT[,DIV]]]...\n");
+}
+
+int
+main(int argc, char **argv)
+{
+        const char *out_path = NULL;
+        size_t window = 0u;
+        int opt;
+
+        while ((opt = getopt(argc, argv, "o:w:h")) != -1) {
+                switch (opt) {
+                case 'o': out_path = optarg; break;
+                case 'w':
+                        window = (size_t)strtoul(optarg, NULL, 0) * 1024u;
+                        break;
+                default: usage(); return (opt == 'h') ? 0 : 2;
+                }
+        }
+        uint32_t n = (uint32_t)(argc - optind);
+        if (n == 0u) {
+                usage();
+                return 2;
+        }
+
+        struct log_merge_src *src = calloc(n, sizeof(*src));
+        uint32_t *heap = calloc(n, sizeof(*heap));
+        if ((src == NULL) || (heap == NULL)) {
+                perror("log-merge");
+                return 1;
+        }
+        for (uint32_t i = 0u; i < n; ++i) {
+                struct log_merge_calib calib;
+                char *spec = argv[optind + (int)i];
+                if (parse_source(spec, &calib) != 0) {
+                        fprintf(stderr, "log-merge: bad calibration: %s\n",
+                                spec);
+                        return 2;
+                }
+                if (log_merge_open(&src[i], spec, &calib, window) != 0) {
+                        fprintf(stderr, "log-merge: %s: %s\n", spec,
+                                strerror(errno));
+                        return 1;
+                }
+        }
+
+        FILE *out = stdout;
+        if (out_path != NULL) {
+                out = fopen(out_path, "wb");
+                if (out == NULL) {
+                        perror(out_path);
+                        return 1;
+                }
+        }
+
+        struct log_merge m;
+        int rc = log_merge_init(&m, src, heap, n);
+        uint8_t rec[LOG_RECORD_MAX_LEN];
+        if ((rc == 0) && (out_path != NULL)) {
+                size_t len = log_export_header(rec, sizeof(rec));
+                (void)fwrite(rec, 1u, len, out);
+        }
+
+        struct log_entry e;
+        uint32_t idx;
+        int64_t key;
+        while ((rc == 0) && ((rc = log_merge_next(&m, &e, &idx, &key)) > 0)) {
+                if (out_path != NULL) {
+                        size_t len = log_record_encode(&e, rec, sizeof(rec));
+                        (void)fwrite(rec, 1u, len, out);
+                } else {
+                        fprintf(out, "%" PRId64 " %" PRIu32 " %s %u %s\n",
+                                key, idx, level_name(e.level),
+                                (unsigned)e.module, e.msg);
+                }
+                rc = 0;
+        }
+        if (rc < 0) {
+                fprintf(stderr, "log-merge: malformed input\n");
+        }
+
+        for (uint32_t i = 0u; i < n; ++i) {
+                log_merge_close(&src[i]);
+        }
+        free(src);
+        free(heap);
+        if ((fflush(out) != 0) || ((out != stdout) && (fclose(out) != 0))) {
+                perror("log-merge");
+                return 1;
+        }
+        return (rc < 0) ? 1 : 0;
+}